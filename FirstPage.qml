@@ -8,6 +8,7 @@
     - A scrollable area displaying all existing note lists using a Repeater and custom ListDelegate.
     - Each note list entry allows for selection (triggers elementClicked signal) and deletion (opens confirmation popup).
     - Popups for confirming new list creation and list deletion.
+    - A quick switcher (Ctrl+K) that finds a list by typing part of its name, typos included.
     - Uses QtQuick Controls, Layouts, and custom components for UI structure and interaction.
 
     Components:
@@ -17,6 +18,7 @@
     - Repeater: Dynamically generates note list entries from the model.
     - ProfileConfirmPopup: Popup for entering a new list name.
     - DeleteConfirmation: Popup for confirming list deletion.
+    - QuickSwitcher: Popup for finding a list by name.
 
     Signals:
     - elementClicked: Emitted when a note list entry is selected.
@@ -24,6 +26,7 @@
     Models:
     - todoNotesModel: Provides data for the note lists.
     - todoModel: Used to set the current note ID.
+    - quickSwitcherModel: Provides the best matching lists in the quick switcher.
 
     Custom Delegates:
     - ListDelegate: Represents each note list entry with options to select or delete.
@@ -131,6 +134,17 @@ Rectangle {
             nameConfirmationPopup.close()
         }
     }
+    Shortcut {
+        sequence: "Ctrl+K"
+        onActivated: quickSwitcher.open()
+    }
+    QuickSwitcher{
+        id:quickSwitcher
+        width: parent.width*0.75
+        height: parent.height*0.6
+        anchors.centerIn: parent
+        onNoteChosen: elementClicked()
+    }
     DeleteConfirmation{
         id:deleteListConfirmation
         width: parent.width*0.75
@@ -11,6 +11,10 @@ Rectangle {
     property string serialNumber: "1"         // Serial number of the task
     property string taskName: "taskName"      // Name of the task
     property bool completionStatus: false     // Completion status of the task
+    property bool editable: false             // Double-click edits the task name
+
+    // Emitted when an edit of the task name is confirmed with Enter
+    signal taskEdited(string newName)
 
     // Aliases for accessing child elements externally
     property alias checkBoxComp: completionStatusBox
@@ -29,6 +33,13 @@ Rectangle {
         onClicked: {
             // Handle item click here
         }
+        onDoubleClicked: {
+            if (editable) {
+                nameEditor.text = taskName
+                nameEditor.visible = true
+                nameEditor.forceActiveFocus()
+            }
+        }
     }
 
     // Layout for arranging checkbox, task name, and remove button horizontally
@@ -68,6 +79,7 @@ Rectangle {
             Text {
                 id: testNameText
                 text: taskName
+                visible: !nameEditor.visible
                 anchors.fill: parent
                 font {
                     family: "Roboto"
@@ -80,6 +92,22 @@ Rectangle {
                 horizontalAlignment: Text.AlignHCenter
                 verticalAlignment: Text.AlignVCenter
             }
+
+            // Inline editor shown in place of the name while editing
+            TextField {
+                id: nameEditor
+                visible: false
+                anchors.fill: parent
+                horizontalAlignment: Text.AlignHCenter
+                selectByMouse: true
+                onAccepted: {
+                    visible = false
+                    if (text.trim() !== "" && text !== taskName)
+                        taskEdited(text)
+                }
+                Keys.onEscapePressed: visible = false
+                onActiveFocusChanged: if (!activeFocus) visible = false
+            }
         }
 
         // Remove button section
@@ -41,7 +41,7 @@ ListView {
             }
             // Display timestamp
             Text { 
-                text: timestamp
+                text: Qt.formatDateTime(timestamp, "yyyy-MM-dd hh:mm:ss")
                 width: parent.width * 0.2
                 Layout.fillWidth: true
             }
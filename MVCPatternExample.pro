@@ -1,16 +1,48 @@
-QT += quick sql
+QT += quick sql network
+
+CONFIG += c++17
 
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+        analyticsmodel.cpp \
+        apiloadtest.cpp \
+        apiserver.cpp \
+        attachmentbenchmark.cpp \
+        attachmentcopytask.cpp \
+        benchmarks.cpp \
+        compressedbitmap.cpp \
+        dbbackuptask.cpp \
+        dbchecktask.cpp \
         dbmanager.cpp \
         eventlogsmodel.cpp \
+        listbenchmarks.cpp \
         logger.cpp \
         main.cpp \
+        memoryreport.cpp \
+        orderkey.cpp \
+        quickswitchermodel.cpp \
+        recurrencerule.cpp \
+        reminderscheduler.cpp \
+        stressbenchmarks.cpp \
+        stringpool.cpp \
+        syncengine.cpp \
+        tagfiltermodel.cpp \
+        tagindex.cpp \
+        tasklistcache.cpp \
+        tasktreemodel.cpp \
+        taskwindow.cpp \
+        textarena.cpp \
+        textdelta.cpp \
         todolistmodel.cpp \
-        todonotesmodel.cpp
+        todonotesmodel.cpp \
+        tracer.cpp \
+        trigramindex.cpp \
+        workloadreplayer.cpp \
+        workspacebenchmark.cpp \
+        workspaceregistry.cpp
 
 RESOURCES += qml.qrc
 
@@ -26,11 +58,38 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    analyticsmodel.h \
+    apiloadtest.h \
+    apiserver.h \
+    attachmentcopytask.h \
+    benchmarks.h \
+    compressedbitmap.h \
+    dbbackuptask.h \
+    dbchangeevent.h \
+    dbchecktask.h \
     dbmanager.h \
     eventlogsmodel.h \
     logger.h \
+    orderkey.h \
+    quickswitchermodel.h \
+    recurrencerule.h \
+    reminderscheduler.h \
+    rowlistmodel.h \
+    stringpool.h \
+    syncengine.h \
+    tagfiltermodel.h \
+    tagindex.h \
+    tasklistcache.h \
+    tasktreemodel.h \
+    taskwindow.h \
+    textarena.h \
+    textdelta.h \
     todolistmodel.h \
-    todonotesmodel.h
+    todonotesmodel.h \
+    tracer.h \
+    trigramindex.h \
+    workloadreplayer.h \
+    workspaceregistry.h
 
 # --- Place this at the very end of your .pro ---
 defineReplace(toWindowsPath) {
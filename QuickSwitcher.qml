@@ -0,0 +1,101 @@
+import QtQuick 2.15
+import QtQuick.Controls 2.0
+import QtQuick.Layouts 1.15
+
+// Popup for jumping to a list by typing part of its name (Ctrl+K on the first page)
+Popup {
+    id: quickSwitcherPopup
+    width: parent.width * 0.75
+    height: parent.height * 0.6
+    closePolicy: Popup.CloseOnPressOutside | Popup.CloseOnEscape
+    modal: true
+    focus: true
+
+    // Emitted after a list has been chosen and opened in todoModel
+    signal noteChosen()
+
+    function choose(row) {
+        var noteId = quickSwitcherModel.noteIdAt(row)
+        if (noteId < 0)
+            return
+        todoModel.setNoteID(noteId)
+        quickSwitcherPopup.close()
+        noteChosen()
+    }
+
+    Rectangle {
+        anchors.fill: parent
+        color: "white"
+        radius: width * 0.02
+        border.color: "#cccccc"
+
+        ColumnLayout {
+            anchors.fill: parent
+            anchors.margins: parent.width * 0.05
+            spacing: parent.height * 0.03
+
+            // Input field; results update on every keystroke
+            TextField {
+                id: queryInput
+                placeholderText: "Find a list"
+                font.pixelSize: quickSwitcherPopup.height * 0.05
+                Layout.fillWidth: true
+                padding: parent.width * 0.02
+                background: Rectangle {
+                    radius: width * 0.1
+                    border.color: "#cccccc"
+                    color: "#f9f9f9"
+                }
+                onTextChanged: {
+                    quickSwitcherModel.setQuery(text)
+                    resultsView.currentIndex = 0
+                }
+                Keys.onDownPressed: resultsView.incrementCurrentIndex()
+                Keys.onUpPressed: resultsView.decrementCurrentIndex()
+                onAccepted: quickSwitcherPopup.choose(resultsView.currentIndex)
+            }
+
+            // Best matches, best first
+            ListView {
+                id: resultsView
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+                clip: true
+                spacing: 5
+                model: quickSwitcherModel
+                delegate: Rectangle {
+                    width: resultsView.width
+                    height: quickSwitcherPopup.height * 0.1
+                    color: "beige"
+                    border.width: ListView.isCurrentItem ? 2 : 0
+                    border.color: "#7ADAA5"
+                    opacity: resultMouse.containsMouse ? 0.5 : 1
+                    Text {
+                        text: model.NoteName
+                        anchors.fill: parent
+                        anchors.margins: parent.height * 0.15
+                        font.pixelSize: parent.height * 0.4
+                        elide: Text.ElideRight
+                        verticalAlignment: Text.AlignVCenter
+                    }
+                    MouseArea {
+                        id: resultMouse
+                        anchors.fill: parent
+                        hoverEnabled: true
+                        onClicked: quickSwitcherPopup.choose(index)
+                    }
+                }
+            }
+        }
+    }
+
+    // Clear the query when the popup is closed
+    onClosed: {
+        queryInput.text = ""
+    }
+
+    // Focus the input when the popup is opened
+    onOpened: {
+        queryInput.forceActiveFocus()
+    }
+}
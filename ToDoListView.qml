@@ -40,6 +40,10 @@ Rectangle {
                         serialNumber: model.id // Task serial number
                         taskName: model.ItemName // Task name
                         completionStatus: model.StatusRole // Completion status
+                        editable: true
+
+                        // Handler for a confirmed edit of the task name
+                        onTaskEdited: todoModel.setTaskText(index, newName)
 
                         // Handler for remove button click
                         removeButton.onClicked: {
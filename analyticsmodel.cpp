@@ -0,0 +1,169 @@
+#include "analyticsmodel.h"
+#include "dbmanager.h"
+#include "tracer.h"
+#include "workspaceregistry.h"
+
+AnalyticsModel::AnalyticsModel(QObject *parent)
+    : analyticsBase(parent), m_days(30) {
+  QObject::connect(&WorkspaceRegistry::instance(),
+                   &WorkspaceRegistry::currentWorkspaceChanged, this,
+                   &AnalyticsModel::refresh);
+  QObject::connect(&WorkspaceRegistry::instance(), &WorkspaceRegistry::changed,
+                   this, &AnalyticsModel::applyDatabaseChange);
+  refresh();
+}
+
+/**
+ * @brief Role accessors of AnalyticsModel.
+ */
+QVariant analyticsDayField::get(const AnalyticsModel &,
+                                const analyticsElement &row) {
+  return row.day;
+}
+
+QVariant analyticsAddedField::get(const AnalyticsModel &,
+                                  const analyticsElement &row) {
+  return row.tasksAdded;
+}
+
+QVariant analyticsCompletedField::get(const AnalyticsModel &,
+                                      const analyticsElement &row) {
+  return row.tasksCompleted;
+}
+
+QVariant analyticsReopenedField::get(const AnalyticsModel &,
+                                     const analyticsElement &row) {
+  return row.tasksReopened;
+}
+
+QVariant analyticsDeletedField::get(const AnalyticsModel &,
+                                    const analyticsElement &row) {
+  return row.tasksDeleted;
+}
+
+QVariant analyticsNotesCreatedField::get(const AnalyticsModel &,
+                                         const analyticsElement &row) {
+  return row.notesCreated;
+}
+
+QVariant analyticsNotesDeletedField::get(const AnalyticsModel &,
+                                         const analyticsElement &row) {
+  return row.notesDeleted;
+}
+
+/**
+ * @brief Sets the number of days shown, ending today.
+ *
+ * @param days Number of days; at least 1.
+ */
+void AnalyticsModel::setRange(int days) {
+  days = qMax(1, days);
+  if (days == m_days)
+    return;
+  m_days = days;
+  refresh();
+}
+
+/**
+ * @brief Restricts the counts to one note.
+ *
+ * @param noteName The note name, or an empty string for all notes.
+ */
+void AnalyticsModel::setNoteName(const QString &noteName) {
+  if (noteName == m_noteName)
+    return;
+  m_noteName = noteName;
+  refresh();
+}
+
+/**
+ * @brief Returns the counts of the whole range.
+ *
+ * @return QVariantMap with the role names of the count roles as keys.
+ */
+QVariantMap AnalyticsModel::totals() const {
+  analyticsElement total{QDate(), 0, 0, 0, 0, 0, 0};
+  for (const analyticsElement &row : m_rows) {
+    total.tasksAdded += row.tasksAdded;
+    total.tasksCompleted += row.tasksCompleted;
+    total.tasksReopened += row.tasksReopened;
+    total.tasksDeleted += row.tasksDeleted;
+    total.notesCreated += row.notesCreated;
+    total.notesDeleted += row.notesDeleted;
+  }
+  return {{analyticsAddedField::name, total.tasksAdded},
+          {analyticsCompletedField::name, total.tasksCompleted},
+          {analyticsReopenedField::name, total.tasksReopened},
+          {analyticsDeletedField::name, total.tasksDeleted},
+          {analyticsNotesCreatedField::name, total.notesCreated},
+          {analyticsNotesDeletedField::name, total.notesDeleted}};
+}
+
+/**
+ * @brief Reloads the range, ending today, from the rollups.
+ */
+void AnalyticsModel::refresh() {
+  TRACE_SPAN(span, "model");
+  const QDate last = QDate::currentDate();
+  const QDate first = last.addDays(1 - m_days);
+  const QList<QVariantMap> rollups =
+      DBManager::instance()->getEventRollups(first, last, m_noteName);
+  beginResetModel();
+  m_rows.clear();
+  m_rows.reserve(m_days);
+  for (QDate day = first; day <= last; day = day.addDays(1))
+    m_rows.append({day, 0, 0, 0, 0, 0, 0});
+  for (const QVariantMap &rollup : rollups) {
+    const int row = int(first.daysTo(rollup["day"].toDate()));
+    int analyticsElement::*member = counter(rollup["event_type"].toString());
+    if (member && row >= 0 && row < m_rows.size())
+      m_rows[row].*member += rollup["count"].toInt();
+  }
+  endResetModel();
+}
+
+/**
+ * @brief Adds a rollup update to the matching day.
+ *
+ * An event dated after the last day of the range (the date has changed
+ * since the model was loaded) reloads the range so that it ends today.
+ *
+ * @param event The change published by DBManager.
+ */
+void AnalyticsModel::applyDatabaseChange(const DBChangeEvent &event) {
+  if (event.table != DBChangeEvent::EventRollups)
+    return;
+  if (event.operation == DBChangeEvent::Reloaded) {
+    refresh();
+    return;
+  }
+  if (!m_noteName.isEmpty() &&
+      event.values.value("note_name").toString() != m_noteName)
+    return;
+  const QDate day = event.values.value("day").toDate();
+  if (m_rows.isEmpty() || day > m_rows.last().day) {
+    refresh();
+    return;
+  }
+  const int row = int(m_rows.first().day.daysTo(day));
+  int analyticsElement::*member =
+      counter(event.values.value("event_type").toString());
+  if (!member || row < 0)
+    return;
+  m_rows[row].*member += event.values.value("count").toInt();
+  emit dataChanged(index(row), index(row));
+}
+
+/**
+ * @brief Returns the count an event type adds to, or nullptr for types that are not charted.
+ */
+int analyticsElement::*AnalyticsModel::counter(const QString &eventType) {
+  static const QHash<QString, int analyticsElement::*> counters{
+      {"TASK_ADDED", &analyticsElement::tasksAdded},
+      {"TASK_COMPLETED", &analyticsElement::tasksCompleted},
+      {"TASK_REOPENED", &analyticsElement::tasksReopened},
+      {"TASK_DELETED", &analyticsElement::tasksDeleted},
+      {"NOTE_CREATED", &analyticsElement::notesCreated},
+      {"NOTE_DELETED", &analyticsElement::notesDeleted}};
+  return counters.value(eventType, nullptr);
+}
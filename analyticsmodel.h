@@ -0,0 +1,123 @@
+#ifndef ANALYTICSMODEL_H
+#define ANALYTICSMODEL_H
+
+#include "dbchangeevent.h"
+#include "rowlistmodel.h"
+#include <QDate>
+#include <QObject>
+#include <QVariantMap>
+
+/**
+ * @struct analyticsElement
+ * @brief Event counts of one day.
+ *
+ * @var analyticsElement::day
+ *   The local day.
+ * @var analyticsElement::tasksAdded
+ *   Tasks created (TASK_ADDED).
+ * @var analyticsElement::tasksCompleted
+ *   Tasks marked done (TASK_COMPLETED).
+ * @var analyticsElement::tasksReopened
+ *   Tasks marked not done again (TASK_REOPENED).
+ * @var analyticsElement::tasksDeleted
+ *   Tasks deleted (TASK_DELETED).
+ * @var analyticsElement::notesCreated
+ *   Notes created (NOTE_CREATED).
+ * @var analyticsElement::notesDeleted
+ *   Notes deleted (NOTE_DELETED).
+ */
+struct analyticsElement {
+  QDate day;
+  int tasksAdded;
+  int tasksCompleted;
+  int tasksReopened;
+  int tasksDeleted;
+  int notesCreated;
+  int notesDeleted;
+};
+
+class AnalyticsModel;
+
+/**
+ * @brief Fields of AnalyticsModel, one per role (see RowListModel).
+ */
+struct analyticsDayField {
+  static constexpr const char *name = "day";
+  static QVariant get(const AnalyticsModel &, const analyticsElement &row);
+};
+struct analyticsAddedField {
+  static constexpr const char *name = "created";
+  static QVariant get(const AnalyticsModel &, const analyticsElement &row);
+};
+struct analyticsCompletedField {
+  static constexpr const char *name = "completed";
+  static QVariant get(const AnalyticsModel &, const analyticsElement &row);
+};
+struct analyticsReopenedField {
+  static constexpr const char *name = "reopened";
+  static QVariant get(const AnalyticsModel &, const analyticsElement &row);
+};
+struct analyticsDeletedField {
+  static constexpr const char *name = "deleted";
+  static QVariant get(const AnalyticsModel &, const analyticsElement &row);
+};
+struct analyticsNotesCreatedField {
+  static constexpr const char *name = "notesCreated";
+  static QVariant get(const AnalyticsModel &, const analyticsElement &row);
+};
+struct analyticsNotesDeletedField {
+  static constexpr const char *name = "notesDeleted";
+  static QVariant get(const AnalyticsModel &, const analyticsElement &row);
+};
+
+using analyticsBase =
+    RowListModel<AnalyticsModel, analyticsElement, analyticsDayField,
+                 analyticsAddedField, analyticsCompletedField,
+                 analyticsReopenedField, analyticsDeletedField,
+                 analyticsNotesCreatedField, analyticsNotesDeletedField>;
+
+/**
+ * @class AnalyticsModel
+ * @brief Per-day event counts for charts, read from the EventRollups table.
+ *
+ * The model has one row per day of the range (the last 30 days by default, oldest first), days
+ * without events included, for all notes or for one note. It is loaded from the rollups, which
+ * Logger keeps current as events are written, so a range of years reads a few hundred rows
+ * instead of scanning and parsing the event log. Rollup updates of the current workspace are
+ * applied to the matching day in place.
+ *
+ * @see DBManager::getEventRollups()
+ */
+class AnalyticsModel : public analyticsBase {
+  Q_OBJECT
+public:
+  explicit AnalyticsModel(QObject *parent = nullptr);
+  enum roleEnums {
+    DayRole = roleOf<analyticsDayField>(),
+    CreatedRole = roleOf<analyticsAddedField>(),
+    CompletedRole = roleOf<analyticsCompletedField>(),
+    ReopenedRole = roleOf<analyticsReopenedField>(),
+    DeletedRole = roleOf<analyticsDeletedField>(),
+    NotesCreatedRole = roleOf<analyticsNotesCreatedField>(),
+    NotesDeletedRole = roleOf<analyticsNotesDeletedField>()
+  };
+  Q_ENUM(roleEnums);
+
+  Q_INVOKABLE void setRange(int days);
+  Q_INVOKABLE void setNoteName(const QString &noteName);
+  Q_INVOKABLE QVariantMap totals() const;
+
+public slots:
+  void refresh();
+
+private slots:
+  void applyDatabaseChange(const DBChangeEvent &event);
+
+private:
+  static int analyticsElement::*counter(const QString &eventType);
+
+  int m_days;
+  QString m_noteName;
+};
+
+#endif // ANALYTICSMODEL_H
@@ -0,0 +1,224 @@
+#include "apiloadtest.h"
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <algorithm>
+
+ApiLoadTest::ApiLoadTest(quint16 port, const QByteArray &token,
+                         int requestCount, QObject *parent)
+    : QObject(parent), m_port(port), m_token(token),
+      m_requestCount(requestCount), m_sent(0), m_answered(0), m_errors(0),
+      m_noteId(-1) {}
+
+/**
+ * @brief Runs a load test against the API server on @p port and prints the result to stdout.
+ *
+ * @param port Port of a running application's API server.
+ * @param token The API token that application printed at start-up.
+ * @param requestCount Number of requests to send.
+ */
+void ApiLoadTest::run(quint16 port, const QByteArray &token,
+                      int requestCount) {
+  ApiLoadTest test(port, token, qMax(1, requestCount));
+  if (!test.setUp())
+    return;
+  QEventLoop loop;
+  connect(&test, &ApiLoadTest::finished, &loop, &QEventLoop::quit);
+  QElapsedTimer timer;
+  timer.start();
+  test.start();
+  loop.exec();
+  test.report(timer.nsecsElapsed());
+}
+
+/**
+ * @brief Creates the note and the tasks the load test works on.
+ *
+ * Uses a blocking connection, since nothing else runs yet.
+ *
+ * @return true if the note and its tasks were created, false otherwise.
+ */
+bool ApiLoadTest::setUp() {
+  QTcpSocket socket;
+  socket.connectToHost(QHostAddress::LocalHost, m_port);
+  if (!socket.waitForConnected(2000)) {
+    qDebug() << "Cannot connect to the API server:" << socket.errorString();
+    return false;
+  }
+  auto exchange = [&socket](const QByteArray &data) {
+    socket.write(data);
+    QByteArray response;
+    while (responseSize(response) == 0 && socket.waitForReadyRead(10000))
+      response += socket.readAll();
+    return QJsonDocument::fromJson(
+        response.mid(response.indexOf("\r\n\r\n") + 4));
+  };
+
+  m_noteId = exchange(request("POST", "/notes", R"({"title":"API load test"})"))
+                 .object()["id"]
+                 .toInt(-1);
+  if (m_noteId < 0) {
+    qDebug() << "Failed to create the load test note";
+    return false;
+  }
+  QJsonArray tasks;
+  for (int i = 0; i < seededTasks; ++i)
+    tasks.append(
+        QJsonObject{{"content", QStringLiteral("Seeded task %1").arg(i)}});
+  const QByteArray path = "/notes/" + QByteArray::number(m_noteId) + "/tasks";
+  const QJsonArray ids =
+      exchange(request("POST", path,
+                       QJsonDocument(tasks).toJson(QJsonDocument::Compact)))
+          .object()["ids"]
+          .toArray();
+  for (const QJsonValue &id : ids)
+    m_taskIds.append(id.toInt());
+  if (m_taskIds.isEmpty()) {
+    qDebug() << "Failed to create the load test tasks";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Opens the connections; each sends its first request once connected.
+ */
+void ApiLoadTest::start() {
+  m_readSamples.reserve(m_requestCount);
+  m_writeSamples.reserve(m_requestCount);
+  for (int i = 0; i < connectionCount; ++i) {
+    QTcpSocket *socket = new QTcpSocket(this);
+    m_connections.insert(socket, loadConnection());
+    connect(socket, &QTcpSocket::readyRead, this, &ApiLoadTest::readResponses);
+    connect(socket, &QTcpSocket::connected, this,
+            [this, socket]() { sendNext(socket); });
+    connect(socket, &QTcpSocket::errorOccurred, this, [this, socket]() {
+      qDebug() << "Load test connection error:" << socket->errorString();
+      emit finished();
+    });
+    socket->connectToHost(QHostAddress::LocalHost, m_port);
+  }
+}
+
+/**
+ * @brief Sends the next request of the mix on a connection, if any are left.
+ *
+ * Two in ten requests add a task, one changes the status of a seeded task
+ * and the rest read a page of the note's tasks.
+ */
+void ApiLoadTest::sendNext(QTcpSocket *socket) {
+  if (m_sent == m_requestCount)
+    return;
+  const int n = m_sent++;
+  const QByteArray note = "/notes/" + QByteArray::number(m_noteId);
+  loadConnection &connection = m_connections[socket];
+  connection.write = n % 10 < 3;
+  connection.sent.start();
+  if (n % 10 < 2) {
+    const QJsonObject task{
+        {"content", QStringLiteral("Load test task %1").arg(n)}};
+    socket->write(request("POST", note + "/tasks",
+                          QJsonDocument(task).toJson(QJsonDocument::Compact)));
+  } else if (n % 10 == 2) {
+    const int taskId = m_taskIds[n % m_taskIds.size()];
+    socket->write(request("PATCH", "/tasks/" + QByteArray::number(taskId),
+                          n % 20 == 2 ? R"({"completed":true})"
+                                      : R"({"completed":false})"));
+  } else {
+    socket->write(request("GET", note + "/tasks?limit=" +
+                                     QByteArray::number(readPageSize)));
+  }
+}
+
+/**
+ * @brief Records the latency of a complete response and sends the connection's next request.
+ */
+void ApiLoadTest::readResponses() {
+  QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+  loadConnection &connection = m_connections[socket];
+  connection.buffer += socket->readAll();
+  const int size = responseSize(connection.buffer);
+  if (size == 0)
+    return;
+  (connection.write ? m_writeSamples : m_readSamples)
+      .append(connection.sent.nsecsElapsed());
+  if (connection.buffer.mid(9, 3).toInt() >= 400)
+    ++m_errors;
+  connection.buffer.remove(0, size);
+  if (++m_answered == m_requestCount)
+    emit finished();
+  else
+    sendNext(socket);
+}
+
+/**
+ * @brief Prints the throughput and the latency percentiles of reads and writes.
+ */
+void ApiLoadTest::report(qint64 elapsedNs) {
+  QTextStream out(stdout);
+  auto percentiles = [&out](const char *label, QVector<qint64> &samples) {
+    if (samples.isEmpty())
+      return;
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+      const int index = qMin(samples.size() - 1, int(p * samples.size()));
+      return QString::number(samples.at(index) / 1000.0, 'f', 1);
+    };
+    out << label << QString::number(samples.size()).rightJustified(7)
+        << percentile(0.50).rightJustified(11)
+        << percentile(0.99).rightJustified(11)
+        << QString::number(samples.last() / 1000.0, 'f', 1).rightJustified(11)
+        << "\n";
+  };
+
+  const double seconds = elapsedNs / 1e9;
+  out << m_answered << " of " << m_requestCount << " requests over "
+      << connectionCount << " connections in "
+      << QString::number(seconds, 'f', 2) << " s ("
+      << QString::number(m_answered / qMax(seconds, 1e-9), 'f', 0)
+      << " req/s), " << m_errors << " errors\n";
+  out << "request      count     p50 us     p99 us     max us\n";
+  percentiles("read      ", m_readSamples);
+  percentiles("write     ", m_writeSamples);
+  out.flush();
+}
+
+/**
+ * @brief Builds an HTTP/1.1 keep-alive request carrying the API token.
+ */
+QByteArray ApiLoadTest::request(const QByteArray &method,
+                                const QByteArray &path,
+                                const QByteArray &body) const {
+  return method + ' ' + path + " HTTP/1.1\r\nHost: localhost:" +
+         QByteArray::number(m_port) + "\r\nAuthorization: Bearer " + m_token +
+         "\r\nContent-Type: application/json\r\nContent-Length: " +
+         QByteArray::number(body.size()) + "\r\n\r\n" + body;
+}
+
+/**
+ * @brief Returns the size of the complete response at the start of @p buffer, or 0 if it is incomplete.
+ *
+ * Understands Content-Length and the chunked encoding of streamed responses.
+ */
+int ApiLoadTest::responseSize(const QByteArray &buffer) {
+  const int headerEnd = buffer.indexOf("\r\n\r\n");
+  if (headerEnd < 0)
+    return 0;
+  const QByteArray headers = buffer.left(headerEnd).toLower();
+  if (headers.contains("transfer-encoding: chunked")) {
+    const int end = buffer.indexOf("\r\n0\r\n\r\n", headerEnd);
+    return end < 0 ? 0 : end + 7;
+  }
+  const int field = headers.indexOf("content-length:");
+  int length = 0;
+  if (field >= 0) {
+    const int valueEnd = headers.indexOf('\r', field);
+    length = headers.mid(field + 15, valueEnd < 0 ? -1 : valueEnd - field - 15)
+                 .trimmed()
+                 .toInt();
+  }
+  return buffer.size() < headerEnd + 4 + length ? 0 : headerEnd + 4 + length;
+}
@@ -0,0 +1,82 @@
+#ifndef APILOADTEST_H
+#define APILOADTEST_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QVector>
+
+class QTcpSocket;
+
+/**
+ * @struct loadConnection
+ * @brief One keep-alive connection of ApiLoadTest.
+ *
+ * @var loadConnection::buffer
+ *   Received bytes of the current response.
+ * @var loadConnection::write
+ *   True if the request in flight is a write.
+ * @var loadConnection::sent
+ *   Started when the request in flight was sent.
+ */
+struct loadConnection {
+  QByteArray buffer;
+  bool write = false;
+  QElapsedTimer sent;
+};
+
+/**
+ * @class ApiLoadTest
+ * @brief Load-test client for ApiServer.
+ *
+ * Runs in its own process against an application started with --api-port, with the token that
+ * application printed, so the client does not compete with the server for its event loop. It
+ * creates a note with a few thousand tasks, then keeps a number of keep-alive connections busy
+ * with a mix of reads (streamed task pages) and writes (task additions and status changes) until
+ * the requested number of requests has been answered, and prints the throughput and the latency
+ * percentiles of reads and writes.
+ *
+ * The effect on the application's frame times is measured on the application side: start it with
+ * --trace and --stall-threshold to get a trace of every GUI stall during the run.
+ */
+class ApiLoadTest : public QObject {
+  Q_OBJECT
+public:
+  static constexpr int connectionCount = 8;
+  static constexpr int seededTasks = 2000;
+  static constexpr int readPageSize = 50;
+
+  ApiLoadTest(quint16 port, const QByteArray &token, int requestCount,
+              QObject *parent = nullptr);
+
+  static void run(quint16 port, const QByteArray &token, int requestCount);
+
+signals:
+  void finished();
+
+private slots:
+  void readResponses();
+
+private:
+  bool setUp();
+  void start();
+  void sendNext(QTcpSocket *socket);
+  void report(qint64 elapsedNs);
+  QByteArray request(const QByteArray &method, const QByteArray &path,
+                     const QByteArray &body = QByteArray()) const;
+  static int responseSize(const QByteArray &buffer);
+
+  quint16 m_port;
+  QByteArray m_token;
+  int m_requestCount;
+  int m_sent;
+  int m_answered;
+  int m_errors;
+  int m_noteId;
+  QVector<int> m_taskIds;
+  QHash<QTcpSocket *, loadConnection> m_connections;
+  QVector<qint64> m_readSamples;
+  QVector<qint64> m_writeSamples;
+};
+
+#endif // APILOADTEST_H
@@ -0,0 +1,608 @@
+#include "apiserver.h"
+#include "dbmanager.h"
+#include "logger.h"
+#include "tracer.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRandomGenerator>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+#include <QUrlQuery>
+#include <climits>
+
+namespace {
+// A stream page is only read once the socket has less than this left to send.
+constexpr qint64 streamLowWaterBytes = 64 * 1024;
+
+QByteArray reasonPhrase(int status) {
+  switch (status) {
+  case 200:
+    return "OK";
+  case 201:
+    return "Created";
+  case 400:
+    return "Bad Request";
+  case 401:
+    return "Unauthorized";
+  case 403:
+    return "Forbidden";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 413:
+    return "Payload Too Large";
+  default:
+    return "Internal Server Error";
+  }
+}
+
+QByteArray chunk(const QByteArray &data) {
+  return QByteArray::number(data.size(), 16) + "\r\n" + data + "\r\n";
+}
+
+QByteArray toJson(const QJsonObject &object) {
+  return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+/**
+ * @brief Applies the writes of a batch inside the caller's transaction.
+ *
+ * Tasks to update or delete are looked up with a single query first; unknown
+ * ones are answered with 404. The writes and their event log entries share
+ * the transaction, so the batch costs one commit, and the models receive
+ * the change events once it is committed. The answers are filled in afresh
+ * on every call, since DBManager may retry the batch.
+ *
+ * @return true if every write succeeded, false to roll the batch back.
+ */
+bool applyBatch(DBManager *db, apiBatch &batch) {
+  const QVector<apiWrite> &writes = batch.writes;
+  QVector<int> taskIds;
+  for (const apiWrite &write : writes)
+    if (write.kind != apiWrite::AddTasks && write.kind != apiWrite::AddNote)
+      taskIds.append(write.id);
+  QHash<int, QVariantMap> tasks;
+  for (const QVariantMap &task : db->getNoteContentsByIds(taskIds))
+    tasks.insert(task["id"].toInt(), task);
+  QHash<int, QString> noteNames;
+  auto noteName = [db, &noteNames](int noteId) {
+    auto it = noteNames.find(noteId);
+    if (it == noteNames.end())
+      it = noteNames.insert(noteId, db->getNoteName(noteId));
+    return *it;
+  };
+
+  batch.statuses.fill(200, writes.size());
+  batch.bodies.fill(QByteArray(), writes.size());
+  bool ok = true;
+  Logger &logger = Logger::instance();
+  for (int i = 0; ok && i < writes.size(); ++i) {
+    const apiWrite &write = writes[i];
+    if (write.kind == apiWrite::AddNote) {
+      const QString title = write.contents.first();
+      const int noteId = db->addNote(title);
+      ok = noteId >= 0;
+      if (ok)
+        logger.logEvent(Logger::NOTE_CREATED, title);
+      batch.statuses[i] = 201;
+      batch.bodies[i] = toJson({{"id", noteId}, {"title", title}});
+      continue;
+    }
+    if (write.kind == apiWrite::AddTasks) {
+      QJsonArray ids;
+      for (const QString &content : write.contents) {
+        const int taskId = db->addNoteContent(write.id, content);
+        ok = taskId >= 0;
+        if (!ok)
+          break;
+        ids.append(taskId);
+        logger.logEvent(Logger::TASK_ADDED, noteName(write.id), content);
+      }
+      batch.statuses[i] = 201;
+      batch.bodies[i] = toJson({{"ids", ids}});
+      continue;
+    }
+    auto task = tasks.constFind(write.id);
+    if (task == tasks.cend()) {
+      batch.statuses[i] = 404;
+      continue;
+    }
+    const QString name = noteName((*task)["note_id"].toInt());
+    const QString content = (*task)["content"].toString();
+    if (write.kind == apiWrite::DeleteTask) {
+      ok = db->deleteNoteContent(write.id);
+      if (ok)
+        logger.logEvent(Logger::TASK_DELETED, name, content);
+    } else {
+      if (write.fields.contains("completed")) {
+        const bool completed = write.fields["completed"].toBool();
+        ok = db->updateNoteContent(write.id, completed);
+        if (ok)
+          logger.logEvent(Logger::TASK_STATUS_TOGGLED, name,
+                          content + QString(":%1").arg(completed));
+      }
+      if (ok && write.fields.contains("due_at")) {
+        const QJsonValue dueAt = write.fields["due_at"];
+        ok = db->setNoteContentDueAt(
+            write.id, dueAt.isNull() ? -1 : qint64(dueAt.toDouble()));
+      }
+      const QString text = write.fields["content"].toString().trimmed();
+      if (ok && !text.isEmpty() && text != content) {
+        ok = db->updateNoteContentText(write.id, text);
+        if (ok)
+          logger.logEvent(Logger::TASK_UPDATED, name,
+                          content + QLatin1Char('\n') + text);
+      }
+    }
+    batch.bodies[i] = toJson({{"id", write.id}});
+  }
+  if (!ok)
+    qDebug() << "API batch of" << writes.size() << "writes failed";
+  return ok;
+}
+} // namespace
+
+ApiServer::ApiServer(QObject *parent)
+    : QObject(parent), m_server(new QTcpServer(this)), m_pendingTaskCount(0) {
+  quint32 words[4];
+  QRandomGenerator::system()->fillRange(words);
+  m_token = QByteArray(reinterpret_cast<const char *>(words), sizeof(words))
+                .toHex();
+  m_batchTimer.setSingleShot(true);
+  m_batchTimer.setInterval(batchDelayMs);
+  connect(&m_batchTimer, &QTimer::timeout, this, &ApiServer::flushWrites);
+  connect(m_server, &QTcpServer::newConnection, this,
+          &ApiServer::acceptConnections);
+}
+
+ApiServer::~ApiServer() { flushWrites(); }
+
+/**
+ * @brief Starts accepting connections on the loopback interface.
+ *
+ * @param port TCP port to listen on (0 picks a free one, see port()).
+ * @return true if the server is listening, false otherwise.
+ */
+bool ApiServer::listen(quint16 port) {
+  if (!m_server->listen(QHostAddress::LocalHost, port)) {
+    qDebug() << "API server error:" << m_server->errorString();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Stops listening, applies the queued writes and closes every connection.
+ */
+void ApiServer::close() {
+  m_server->close();
+  flushWrites();
+  const QList<QTcpSocket *> sockets = m_connections.keys();
+  for (QTcpSocket *socket : sockets)
+    socket->disconnectFromHost();
+}
+
+/**
+ * @brief Returns the port the server listens on, or 0 if it does not listen.
+ */
+quint16 ApiServer::port() const { return m_server->serverPort(); }
+
+/**
+ * @brief Returns the random token clients must send as "Authorization: Bearer <token>".
+ *
+ * A new token is made for every server, so it is only valid while this
+ * process runs.
+ */
+QByteArray ApiServer::token() const { return m_token; }
+
+/**
+ * @brief Sets up every connection waiting to be accepted.
+ */
+void ApiServer::acceptConnections() {
+  while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+    m_connections.insert(socket, apiConnection());
+    connect(socket, &QTcpSocket::readyRead, this, &ApiServer::readRequests);
+    connect(socket, &QTcpSocket::bytesWritten, this,
+            &ApiServer::continueStream);
+    connect(socket, &QTcpSocket::disconnected, this,
+            &ApiServer::dropConnection);
+  }
+}
+
+/**
+ * @brief Buffers the received bytes of a connection and handles its next request.
+ */
+void ApiServer::readRequests() {
+  QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+  auto it = m_connections.find(socket);
+  if (it == m_connections.end())
+    return;
+  it->buffer.append(socket->readAll());
+  processRequests(socket);
+}
+
+/**
+ * @brief Parses and handles the next buffered request of a connection, unless one is pending.
+ *
+ * A request whose headers or body exceed maxRequestBytes, or that cannot be
+ * parsed, is answered with an error and the connection is closed.
+ *
+ * Any local program, including a web page in a browser, can reach a loopback
+ * port, so a request is only handled if it carries the server's token (see
+ * token()). Requests with an Origin header, which browsers add to
+ * cross-origin requests, or whose Host is not this server's loopback address
+ * (as after DNS rebinding) are refused before the token is even checked.
+ */
+void ApiServer::processRequests(QTcpSocket *socket) {
+  TRACE_SPAN(span, "api");
+  auto it = m_connections.find(socket);
+  if (it == m_connections.end() || it->busy)
+    return;
+  QByteArray &buffer = it->buffer;
+  const int headerEnd = buffer.indexOf("\r\n\r\n");
+  if (headerEnd < 0) {
+    if (buffer.size() > maxRequestBytes) {
+      sendError(socket, 413, "Request headers too large");
+      socket->disconnectFromHost();
+    }
+    return;
+  }
+  const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+  const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+  if (requestLine.size() != 3) {
+    sendError(socket, 400, "Malformed request line");
+    socket->disconnectFromHost();
+    return;
+  }
+  QHash<QByteArray, QByteArray> headers;
+  for (int i = 1; i < lines.size(); ++i) {
+    const int colon = lines[i].indexOf(':');
+    if (colon > 0)
+      headers.insert(lines[i].left(colon).trimmed().toLower(),
+                     lines[i].mid(colon + 1).trimmed());
+  }
+  const int contentLength = headers.value("content-length").toInt();
+  if (contentLength < 0 || contentLength > maxRequestBytes) {
+    sendError(socket, 413, "Request body too large");
+    socket->disconnectFromHost();
+    return;
+  }
+  const int requestSize = headerEnd + 4 + contentLength;
+  if (buffer.size() < requestSize)
+    return;
+  const QByteArray body = buffer.mid(headerEnd + 4, contentLength);
+  buffer.remove(0, requestSize);
+  it->busy = true;
+  const QByteArray port = ':' + QByteArray::number(m_server->serverPort());
+  const QByteArray host = headers.value("host");
+  if (headers.contains("origin") ||
+      (host != "127.0.0.1" + port && host != "localhost" + port))
+    sendError(socket, 403, "Only local clients without an Origin are served");
+  else if (headers.value("authorization") != "Bearer " + m_token)
+    sendError(socket, 401, "Missing or wrong API token");
+  else
+    handleRequest(socket, requestLine[0], requestLine[1], body);
+}
+
+/**
+ * @brief Routes a request to its endpoint.
+ *
+ * Reads are answered right away (task lists as a stream), writes are queued
+ * for the next batch.
+ *
+ * @param socket The connection of the request.
+ * @param method The HTTP method.
+ * @param target The request target (path and query).
+ * @param body The request body.
+ */
+void ApiServer::handleRequest(QTcpSocket *socket, const QByteArray &method,
+                              const QByteArray &target,
+                              const QByteArray &body) {
+  const QUrl url(QString::fromUtf8(target));
+  const QUrlQuery query(url);
+  const QStringList parts = url.path().split('/', Qt::SkipEmptyParts);
+  const QString resource = parts.value(0);
+  bool validId = false;
+  const int id = parts.value(1).toInt(&validId);
+
+  if (parts.size() == 1 && resource == "notes") {
+    if (method == "GET") {
+      QJsonArray notes;
+      for (const QVariantMap &note : DBManager::instance()->getAllNotes())
+        notes.append(QJsonObject::fromVariantMap(note));
+      sendJson(socket, 200,
+               QJsonDocument(notes).toJson(QJsonDocument::Compact));
+    } else if (method == "POST") {
+      addNote(socket, body);
+    } else {
+      sendError(socket, 405, "Use GET or POST");
+    }
+    return;
+  }
+  if (parts.size() == 3 && resource == "notes" && validId &&
+      parts[2] == "tasks") {
+    if (DBManager::instance()->getNote(id).isEmpty()) {
+      sendError(socket, 404, "No such note");
+    } else if (method == "GET") {
+      const int limit = query.hasQueryItem("limit")
+                            ? query.queryItemValue("limit").toInt()
+                            : INT_MAX;
+      startTaskStream(socket, id,
+                      query.hasQueryItem("after_key")
+                          ? query.queryItemValue("after_key")
+                          : QString(""),
+                      query.hasQueryItem("after_id")
+                          ? query.queryItemValue("after_id").toInt()
+                          : -1,
+                      qMax(0, limit));
+    } else if (method == "POST") {
+      const QJsonDocument document = QJsonDocument::fromJson(body);
+      const QJsonArray items = document.isArray()
+                                   ? document.array()
+                                   : QJsonArray{document.object()};
+      QStringList contents;
+      for (const QJsonValue &item : items)
+        if (item.toObject().contains("content"))
+          contents.append(item.toObject()["content"].toString());
+      if (contents.isEmpty() || contents.size() != items.size())
+        sendError(socket, 400,
+                  "Expected {\"content\": ...} or an array of them");
+      else
+        queueWrite({socket, apiWrite::AddTasks, id, contents, {}},
+                   contents.size());
+    } else {
+      sendError(socket, 405, "Use GET or POST");
+    }
+    return;
+  }
+  if (parts.size() == 2 && resource == "tasks" && validId) {
+    if (method == "PATCH") {
+      const QJsonObject fields = QJsonDocument::fromJson(body).object();
+      if (!fields.contains("completed") && !fields.contains("due_at") &&
+          !fields["content"].isString())
+        sendError(socket, 400,
+                  "Expected \"completed\", \"due_at\" and/or \"content\"");
+      else
+        queueWrite({socket, apiWrite::UpdateTask, id, {}, fields}, 1);
+    } else if (method == "DELETE") {
+      queueWrite({socket, apiWrite::DeleteTask, id, {}, {}}, 1);
+    } else {
+      sendError(socket, 405, "Use PATCH or DELETE");
+    }
+    return;
+  }
+  if (parts.size() == 1 && resource == "logs") {
+    if (method != "GET") {
+      sendError(socket, 405, "Use GET");
+      return;
+    }
+    const int limit = query.hasQueryItem("limit")
+                          ? query.queryItemValue("limit").toInt()
+                          : 100;
+    sendLogs(socket,
+             query.hasQueryItem("before_at")
+                 ? query.queryItemValue("before_at").toLongLong()
+                 : -1,
+             query.queryItemValue("before_id").toInt(),
+             qBound(1, limit, maxLogPageSize));
+    return;
+  }
+  sendError(socket, 404, "No such endpoint");
+}
+
+/**
+ * @brief Starts streaming the top-level tasks of a note as a JSON array.
+ *
+ * The response uses chunked encoding; each chunk holds one page of
+ * streamPageSize tasks read by keyset, and the next page is only read once
+ * the socket has drained (see continueStream()). A client that wants to
+ * resume a stream passes the sort_key and id of the last task it received.
+ *
+ * @param socket The connection of the request.
+ * @param noteId The note.
+ * @param afterKey Sort key to start after ("" for the first task).
+ * @param afterId Task ID to start after (-1 for the first task).
+ * @param limit Maximum number of tasks to stream.
+ */
+void ApiServer::startTaskStream(QTcpSocket *socket, int noteId,
+                                const QString &afterKey, int afterId,
+                                int limit) {
+  apiConnection &connection = m_connections[socket];
+  connection.streamNoteId = noteId;
+  connection.streamKey = afterKey;
+  connection.streamId = afterId;
+  connection.streamRemaining = limit;
+  connection.streamFirst = true;
+  socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                "Transfer-Encoding: chunked\r\n\r\n" +
+                chunk("["));
+  writeStreamPage(socket);
+}
+
+/**
+ * @brief Writes the next page of a task stream when the socket has drained.
+ */
+void ApiServer::continueStream() {
+  QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+  auto it = m_connections.constFind(socket);
+  if (it == m_connections.cend() || it->streamNoteId < 0 ||
+      socket->bytesToWrite() > streamLowWaterBytes)
+    return;
+  writeStreamPage(socket);
+}
+
+/**
+ * @brief Reads and writes one page of a task stream, and ends the stream after the last one.
+ */
+void ApiServer::writeStreamPage(QTcpSocket *socket) {
+  TRACE_SPAN(span, "api");
+  apiConnection &connection = m_connections[socket];
+  const int limit = qMin(streamPageSize, connection.streamRemaining);
+  const QList<QVariantMap> tasks =
+      limit > 0 ? DBManager::instance()->getChildContents(
+                      connection.streamNoteId, -1, connection.streamKey,
+                      connection.streamId, limit)
+                : QList<QVariantMap>();
+  QByteArray data;
+  for (const QVariantMap &task : tasks) {
+    if (!connection.streamFirst)
+      data += ',';
+    connection.streamFirst = false;
+    data += toJson(QJsonObject::fromVariantMap(task));
+  }
+  if (!tasks.isEmpty()) {
+    connection.streamKey = tasks.last()["sort_key"].toString();
+    connection.streamId = tasks.last()["id"].toInt();
+  }
+  connection.streamRemaining -= tasks.size();
+  const bool done = tasks.size() < limit || connection.streamRemaining <= 0;
+  if (done)
+    data += ']';
+  socket->write(chunk(data));
+  if (!done)
+    return;
+  socket->write("0\r\n\r\n");
+  connection.streamNoteId = -1;
+  finishRequest(socket);
+}
+
+/**
+ * @brief Answers with one page of the event log, newest first.
+ *
+ * The response holds the entries and, if there may be more, the "next"
+ * cursor to pass as before_at and before_id.
+ */
+void ApiServer::sendLogs(QTcpSocket *socket, qint64 beforeAt, int beforeId,
+                         int limit) {
+  const QList<QVariantMap> logs =
+      DBManager::instance()->getEventLogsBefore(beforeAt, beforeId, limit);
+  QJsonArray entries;
+  for (const QVariantMap &log : logs)
+    entries.append(QJsonObject::fromVariantMap(log));
+  QJsonObject page{{"logs", entries}};
+  if (logs.size() == limit)
+    page["next"] =
+        QJsonObject{{"before_at", logs.last()["created_at"].toDouble()},
+                    {"before_id", logs.last()["id"].toInt()}};
+  sendJson(socket, 200, toJson(page));
+}
+
+/**
+ * @brief Queues a note to add with the next batch of writes.
+ */
+void ApiServer::addNote(QTcpSocket *socket, const QByteArray &body) {
+  const QString title =
+      QJsonDocument::fromJson(body).object()["title"].toString();
+  if (title.isEmpty()) {
+    sendError(socket, 400, "Expected {\"title\": ...}");
+    return;
+  }
+  queueWrite({socket, apiWrite::AddNote, -1, {title}, {}}, 1);
+}
+
+/**
+ * @brief Queues a write for the next batch; flushes right away once the batch is full.
+ *
+ * @param write The write.
+ * @param taskCount Number of tasks the write touches.
+ */
+void ApiServer::queueWrite(const apiWrite &write, int taskCount) {
+  m_pendingWrites.append(write);
+  m_pendingTaskCount += taskCount;
+  if (m_pendingTaskCount >= maxBatchSize)
+    flushWrites();
+  else if (!m_batchTimer.isActive())
+    m_batchTimer.start();
+}
+
+/**
+ * @brief Hands all queued writes to DBManager::queueWrite() as one transaction.
+ *
+ * If another process holds the write lock, DBManager retries the batch later
+ * and the clients are answered once it is committed (see applyBatch()).
+ */
+void ApiServer::flushWrites() {
+  TRACE_SPAN(span, "api");
+  m_batchTimer.stop();
+  if (m_pendingWrites.isEmpty())
+    return;
+  apiBatch *batch = new apiBatch;
+  batch->writes.swap(m_pendingWrites);
+  m_pendingTaskCount = 0;
+
+  DBManager *db = DBManager::instance();
+  QPointer<ApiServer> server(this);
+  db->queueWrite([db, batch]() { return applyBatch(db, *batch); },
+                 [server, batch](bool ok) {
+                   if (server)
+                     server->answerBatch(*batch, ok);
+                   delete batch;
+                 });
+}
+
+/**
+ * @brief Answers the clients of an applied batch that are still connected.
+ *
+ * @param batch The batch, with the answers applyBatch() filled in.
+ * @param ok Whether the batch was committed; if not, every client gets 500.
+ */
+void ApiServer::answerBatch(const apiBatch &batch, bool ok) {
+  for (int i = 0; i < batch.writes.size(); ++i) {
+    QTcpSocket *socket = batch.writes[i].socket;
+    if (!socket || !m_connections.contains(socket))
+      continue;
+    if (!ok)
+      sendError(socket, 500, "Write failed");
+    else if (batch.statuses[i] == 404)
+      sendError(socket, 404, "No such task");
+    else
+      sendJson(socket, batch.statuses[i], batch.bodies[i]);
+  }
+}
+
+/**
+ * @brief Answers the current request of a connection with a JSON body.
+ */
+void ApiServer::sendJson(QTcpSocket *socket, int status,
+                         const QByteArray &json) {
+  socket->write("HTTP/1.1 " + QByteArray::number(status) + ' ' +
+                reasonPhrase(status) +
+                "\r\nContent-Type: application/json\r\nContent-Length: " +
+                QByteArray::number(json.size()) + "\r\n\r\n" + json);
+  finishRequest(socket);
+}
+
+/**
+ * @brief Answers the current request of a connection with {"error": message}.
+ */
+void ApiServer::sendError(QTcpSocket *socket, int status,
+                          const QString &message) {
+  sendJson(socket, status, toJson({{"error", message}}));
+}
+
+/**
+ * @brief Marks the current request of a connection as answered.
+ *
+ * Requests the client pipelined meanwhile are handled on the next event loop
+ * iteration, so a long pipeline cannot starve the other connections.
+ */
+void ApiServer::finishRequest(QTcpSocket *socket) {
+  auto it = m_connections.find(socket);
+  if (it == m_connections.end())
+    return;
+  it->busy = false;
+  if (!it->buffer.isEmpty())
+    QTimer::singleShot(0, socket,
+                       [this, socket]() { processRequests(socket); });
+}
+
+/**
+ * @brief Forgets a closed connection; its queued writes are still applied.
+ */
+void ApiServer::dropConnection() {
+  QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+  m_connections.remove(socket);
+  socket->deleteLater();
+}
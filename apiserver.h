@@ -0,0 +1,165 @@
+#ifndef APISERVER_H
+#define APISERVER_H
+
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+class QTcpServer;
+class QTcpSocket;
+
+/**
+ * @struct apiConnection
+ * @brief State of one keep-alive client connection of ApiServer.
+ *
+ * @var apiConnection::buffer
+ *   Received bytes not parsed into a request yet.
+ * @var apiConnection::busy
+ *   True while the response to the current request is pending (queued write or stream).
+ * @var apiConnection::streamNoteId
+ *   Note whose tasks are being streamed, or -1 when no stream is open.
+ * @var apiConnection::streamKey
+ *   Sort key of the last streamed task (keyset position).
+ * @var apiConnection::streamId
+ *   ID of the last streamed task (keyset position).
+ * @var apiConnection::streamRemaining
+ *   Number of tasks still to stream.
+ * @var apiConnection::streamFirst
+ *   True until the first task of the stream has been written.
+ */
+struct apiConnection {
+  QByteArray buffer;
+  bool busy = false;
+  int streamNoteId = -1;
+  QString streamKey;
+  int streamId = -1;
+  int streamRemaining = 0;
+  bool streamFirst = true;
+};
+
+/**
+ * @struct apiWrite
+ * @brief One task write requested through ApiServer, waiting for the next batch.
+ *
+ * @var apiWrite::socket
+ *   Connection to answer once the batch is committed (cleared if it closes first).
+ * @var apiWrite::kind
+ *   The operation to apply.
+ * @var apiWrite::id
+ *   Note ID for AddTasks, task ID for UpdateTask and DeleteTask.
+ * @var apiWrite::contents
+ *   Contents of the tasks to add (AddTasks), or the title of the note (AddNote).
+ * @var apiWrite::fields
+ *   Fields to change (UpdateTask only): "completed", "due_at" and/or "content".
+ */
+struct apiWrite {
+  enum Kind { AddNote, AddTasks, UpdateTask, DeleteTask };
+  QPointer<QTcpSocket> socket;
+  Kind kind;
+  int id;
+  QStringList contents;
+  QJsonObject fields;
+};
+
+/**
+ * @struct apiBatch
+ * @brief A batch of writes of ApiServer and their answers, filled in when the batch is applied.
+ *
+ * @var apiBatch::writes
+ *   The writes, in the order they were requested.
+ * @var apiBatch::statuses
+ *   HTTP status of the answer to each write.
+ * @var apiBatch::bodies
+ *   JSON body of the answer to each write (unused for 404).
+ */
+struct apiBatch {
+  QVector<apiWrite> writes;
+  QVector<int> statuses;
+  QVector<QByteArray> bodies;
+};
+
+/**
+ * @class ApiServer
+ * @brief Local HTTP/JSON automation API over the notes, tasks and event logs of the current workspace.
+ *
+ * The server only listens on the loopback interface and speaks a small subset of HTTP/1.1 with
+ * keep-alive, so scripts and other local tools can drive the application while it runs:
+ *
+ *   GET    /notes                       all notes
+ *   POST   /notes        {"title"}      add a note
+ *   GET    /notes/{id}/tasks            top-level tasks, streamed (?after_key, after_id, limit)
+ *   POST   /notes/{id}/tasks            add tasks ({"content"} or an array of them)
+ *   PATCH  /tasks/{id}   {"completed", "due_at", "content"}
+ *   DELETE /tasks/{id}
+ *   GET    /logs                        event log page (?before_at, before_id, limit)
+ *
+ * Sockets are served from the GUI thread's event loop, since DBManager's connection belongs to that
+ * thread, so no request may block it: task lists are streamed with chunked encoding one page at a
+ * time, and the next page is read only once the socket has drained the previous one. Writes are
+ * queued and applied every batchDelayMs (or once maxBatchSize tasks are queued) in a single
+ * transaction through DBManager::queueWrite(), so a batch waits out another process holding the
+ * write lock instead of failing; each client gets its answer after the commit. All writes go
+ * through DBManager and Logger like the models' own, so open views update from the published
+ * change events.
+ *
+ * Requests on one connection are answered in order; a connection does not parse its next request
+ * until the current one has been answered.
+ *
+ * Every request must carry "Authorization: Bearer <token()>" and a Host of 127.0.0.1:<port> or
+ * localhost:<port>, and must not carry an Origin header, so web pages cannot drive the API.
+ *
+ * Usage:
+ *   ApiServer server;
+ *   server.listen(8765);
+ */
+class ApiServer : public QObject {
+  Q_OBJECT
+public:
+  static constexpr int batchDelayMs = 2;
+  static constexpr int maxBatchSize = 512;
+  static constexpr int streamPageSize = 256;
+  static constexpr int maxRequestBytes = 1024 * 1024;
+  static constexpr int maxLogPageSize = 1000;
+
+  explicit ApiServer(QObject *parent = nullptr);
+  ~ApiServer();
+
+  bool listen(quint16 port);
+  void close();
+  quint16 port() const;
+  QByteArray token() const;
+
+private slots:
+  void acceptConnections();
+  void readRequests();
+  void continueStream();
+  void dropConnection();
+  void flushWrites();
+
+private:
+  void processRequests(QTcpSocket *socket);
+  void handleRequest(QTcpSocket *socket, const QByteArray &method,
+                     const QByteArray &target, const QByteArray &body);
+  void startTaskStream(QTcpSocket *socket, int noteId, const QString &afterKey,
+                       int afterId, int limit);
+  void writeStreamPage(QTcpSocket *socket);
+  void sendLogs(QTcpSocket *socket, qint64 beforeAt, int beforeId, int limit);
+  void addNote(QTcpSocket *socket, const QByteArray &body);
+  void queueWrite(const apiWrite &write, int taskCount);
+  void answerBatch(const apiBatch &batch, bool ok);
+  void sendJson(QTcpSocket *socket, int status, const QByteArray &json);
+  void sendError(QTcpSocket *socket, int status, const QString &message);
+  void finishRequest(QTcpSocket *socket);
+
+  QTcpServer *m_server;
+  QByteArray m_token;
+  QHash<QTcpSocket *, apiConnection> m_connections;
+  QVector<apiWrite> m_pendingWrites;
+  int m_pendingTaskCount;
+  QTimer m_batchTimer;
+};
+
+#endif // APISERVER_H
@@ -0,0 +1,96 @@
+#include "benchmarks.h"
+#include "dbmanager.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <QTextStream>
+
+/**
+ * @brief Measures streamed attachment writes and reads of a large file and prints the result.
+ *
+ * Writes a file of @p megabytes MiB of pseudo-random data next to the
+ * current workspace, attaches it to a task, attaches it again to a second
+ * task (deduplicated), exports it and finally deletes both tasks and
+ * collects the blob. Reports the throughput of each step, the growth of the
+ * process's peak memory while attaching and exporting (Linux only), and
+ * whether the exported copy and the cleanup are correct.
+ *
+ * @param megabytes Size of the attachment in MiB.
+ */
+void Benchmarks::runAttachmentBenchmark(int megabytes) {
+  QTextStream out(stdout);
+  DBManager *db = DBManager::instance();
+  const qint64 size = qint64(qMax(1, megabytes)) * 1024 * 1024;
+  const QString sourcePath = db->databasePath() + QStringLiteral(".source");
+  const QString exportPath = db->databasePath() + QStringLiteral(".export");
+  {
+    QFile source(sourcePath);
+    if (!source.open(QIODevice::WriteOnly)) {
+      qDebug() << "Cannot write" << sourcePath;
+      return;
+    }
+    QRandomGenerator random(42);
+    QVector<quint32> chunk(1024 * 1024 / sizeof(quint32));
+    for (qint64 written = 0; written < size; written += 1024 * 1024) {
+      random.fillRange(chunk.data(), chunk.size());
+      source.write(reinterpret_cast<const char *>(chunk.constData()),
+                   qMin<qint64>(1024 * 1024, size - written));
+    }
+  }
+  const int noteId = db->addNote(QStringLiteral("Attachment benchmark"));
+  const int first = db->addNoteContent(noteId, QStringLiteral("First"));
+  const int second = db->addNoteContent(noteId, QStringLiteral("Second"));
+
+  auto throughput = [size](qint64 ns) {
+    return QString::number(size / 1048576.0 / qMax(ns / 1e9, 1e-9), 'f', 1) +
+           " MiB/s";
+  };
+  const qint64 peakBefore = peakResidentKiB();
+  QElapsedTimer timer;
+  timer.start();
+  const int attachment = db->addAttachment(first, sourcePath);
+  const qint64 addNs = timer.nsecsElapsed();
+  timer.restart();
+  const int duplicate = db->addAttachment(second, sourcePath);
+  const qint64 duplicateNs = timer.nsecsElapsed();
+  timer.restart();
+  const bool exported = db->exportAttachment(attachment, exportPath);
+  const qint64 exportNs = timer.nsecsElapsed();
+  const qint64 peakAfter = peakResidentKiB();
+  if (attachment < 0 || duplicate < 0 || !exported) {
+    qDebug() << "Attachment benchmark failed";
+    return;
+  }
+
+  const QString hash = db->getAttachments(first).value(0)["hash"].toString();
+  const bool shared =
+      db->getAttachments(second).value(0)["hash"].toString() == hash;
+  const bool identical = QFileInfo(exportPath).size() == size;
+  db->deleteAllNoteContents(noteId);
+  const int collected = db->collectAttachmentGarbage();
+  const bool cleanedUp =
+      collected == 1 &&
+      !QFile::exists(db->attachmentDirectory() + '/' + hash.left(2) + '/' +
+                     hash);
+  QFile::remove(sourcePath);
+  QFile::remove(exportPath);
+
+  out << "Attachment of " << megabytes << " MiB (SHA-256 " << hash.left(12)
+      << "...)\n";
+  out << "attach:     " << addNs / 1000000 << " ms, " << throughput(addNs)
+      << "\n";
+  out << "duplicate:  " << duplicateNs / 1000000 << " ms, "
+      << throughput(duplicateNs) << ", shared blob: "
+      << (shared ? "yes" : "no") << "\n";
+  out << "export:     " << exportNs / 1000000 << " ms, "
+      << throughput(exportNs) << ", same size: "
+      << (identical ? "yes" : "no") << "\n";
+  if (peakBefore >= 0)
+    out << "Peak memory growth: " << (peakAfter - peakBefore) / 1024
+        << " MiB\n";
+  out << "Blob collected after deleting both tasks: "
+      << (cleanedUp ? "yes" : "no") << "\n";
+  out.flush();
+}
@@ -0,0 +1,64 @@
+#include "attachmentcopytask.h"
+#include <QCryptographicHash>
+#include <QFile>
+
+AttachmentCopyTask::AttachmentCopyTask(const QString &sourcePath,
+                                       const QString &incomingPath,
+                                       qint64 chunkSize)
+    : QObject(nullptr), m_sourcePath(sourcePath), m_incomingPath(incomingPath),
+      m_chunkSize(chunkSize) {
+  setAutoDelete(true);
+}
+
+/**
+ * @brief Runs the copy on the calling (pool) thread.
+ *
+ * The incoming file is removed on failure.
+ */
+void AttachmentCopyTask::run() {
+  QFile source(m_sourcePath);
+  QFile incoming(m_incomingPath);
+  QString digest;
+  qint64 size = 0;
+  QString message;
+  bool ok = source.open(QIODevice::ReadOnly) &&
+            incoming.open(QIODevice::WriteOnly | QIODevice::Truncate) &&
+            copy(&source, &incoming, m_chunkSize, digest, size);
+  if (!ok) {
+    message = source.errorString() + QLatin1Char(' ') + incoming.errorString();
+    incoming.close();
+    QFile::remove(m_incomingPath);
+  }
+  emit finished(m_incomingPath, ok, digest, size, message);
+}
+
+/**
+ * @brief Streams a device into another one in chunks and computes the SHA-256 of the content.
+ *
+ * Only reads what @p source has already; it never waits for more data.
+ *
+ * @param source Readable device positioned at the start of the content.
+ * @param dest Writable device receiving the content.
+ * @param chunkSize Number of bytes read and written at a time.
+ * @param digest Receives the SHA-256 of the content as hex.
+ * @param size Receives the number of bytes copied.
+ * @return true if the whole content was copied, false on a read or write error.
+ */
+bool AttachmentCopyTask::copy(QIODevice *source, QIODevice *dest,
+                              qint64 chunkSize, QString &digest,
+                              qint64 &size) {
+  QCryptographicHash hash(QCryptographicHash::Sha256);
+  QByteArray chunk(int(chunkSize), Qt::Uninitialized);
+  size = 0;
+  for (;;) {
+    const qint64 read = source->read(chunk.data(), chunk.size());
+    if (read < 0 || (read > 0 && dest->write(chunk.constData(), read) != read))
+      return false;
+    if (read == 0)
+      break;
+    hash.addData(chunk.constData(), int(read));
+    size += read;
+  }
+  digest = QString::fromLatin1(hash.result().toHex());
+  return true;
+}
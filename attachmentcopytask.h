@@ -0,0 +1,42 @@
+#ifndef ATTACHMENTCOPYTASK_H
+#define ATTACHMENTCOPYTASK_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QString>
+
+class QIODevice;
+
+/**
+ * @class AttachmentCopyTask
+ * @brief Background job that copies a file into the attachment directory and hashes it.
+ *
+ * Like DBBackupTask, the task runs on a QThreadPool thread, so attaching a large file never
+ * blocks the UI. The file is streamed in chunks into a temporary "incoming" file next to the
+ * blobs while its SHA-256 is computed; DBManager then turns it into a blob under the write lock
+ * (see DBManager::startAttachment()).
+ *
+ * @note Results are reported through the finished() signal, which is emitted from the worker
+ *       thread; connect to it with a queued connection.
+ */
+class AttachmentCopyTask : public QObject, public QRunnable {
+  Q_OBJECT
+public:
+  AttachmentCopyTask(const QString &sourcePath, const QString &incomingPath,
+                     qint64 chunkSize);
+  void run() override;
+
+  static bool copy(QIODevice *source, QIODevice *dest, qint64 chunkSize,
+                   QString &digest, qint64 &size);
+
+signals:
+  void finished(const QString &incomingPath, bool ok, const QString &digest,
+                qint64 size, const QString &message);
+
+private:
+  QString m_sourcePath;
+  QString m_incomingPath;
+  qint64 m_chunkSize;
+};
+
+#endif // ATTACHMENTCOPYTASK_H
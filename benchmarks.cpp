@@ -0,0 +1,267 @@
+#include "benchmarks.h"
+#include "dbmanager.h"
+#include "syncengine.h"
+#include "tagindex.h"
+#include "todolistmodel.h"
+#include "trigramindex.h"
+#include "workspaceregistry.h"
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QEventLoop>
+#include <QFile>
+#include <QTimer>
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Returns the table of benchmark and stress modes, in the order run() checks them.
+ *
+ * Modes that measure a ToDoListModel get a new one, created after the
+ * workspace is open, as the UI creates it.
+ */
+const QVector<benchmarkMode> &Benchmarks::modes() {
+  static const QVector<benchmarkMode> table{
+      {"tag-benchmark",
+       "Time multi-tag queries over a synthetic index and print a report.",
+       "tasks", benchmarkMode::NoTarget,
+       [](int tasks) { return TagIndex::runBenchmark(tasks); }},
+      {"switcher-benchmark",
+       "Time quick switcher searches over synthetic titles and print a report.",
+       "titles", benchmarkMode::NoTarget,
+       [](int titles) {
+         TrigramIndex::runBenchmark(titles);
+         return 0;
+       }},
+      {"workspace-benchmark",
+       "Time typical queries on one database of the given size and on it split "
+       "over workspaces and print a report.",
+       "tasks", benchmarkMode::NoTarget,
+       [](int tasks) {
+         runWorkspaceBenchmark(tasks, 8);
+         return 0;
+       }},
+      {"sync-benchmark",
+       "Time a delta sync between two databases of the given size and print "
+       "a report.",
+       "tasks", benchmarkMode::NoTarget,
+       [](int tasks) { return SyncEngine::runBenchmark(tasks, 10); }},
+      {"stress-writer",
+       "Add the given number of tasks to the first note of --replay-target "
+       "(second process of --multiprocess-stress).",
+       "tasks", benchmarkMode::ExistingTarget,
+       [](int tasks) { return runStressWriter(tasks); }},
+      {"attachment-benchmark",
+       "Time streamed attachment I/O of the given size and print a report.",
+       "MiB", benchmarkMode::FreshTarget,
+       [](int megabytes) {
+         runAttachmentBenchmark(megabytes);
+         return 0;
+       }},
+      {"backup-stress",
+       "Write continuously during a backup of the given number of tasks and "
+       "check the snapshot.",
+       "tasks", benchmarkMode::FreshTarget,
+       [](int tasks) { return runBackupStress(tasks); }},
+      {"memory-report",
+       "Load the given number of tasks and event logs into the models and "
+       "print the resident memory they take.",
+       "rows", benchmarkMode::FreshTarget,
+       [](int rows) {
+         ToDoListModel todoModel;
+         runMemoryReport(todoModel, rows);
+         return 0;
+       }},
+      {"toggle-benchmark",
+       "Count the statements and commits of the given number of task status "
+       "clicks and print a report.",
+       "clicks", benchmarkMode::FreshTarget,
+       [](int clicks) {
+         ToDoListModel todoModel;
+         runToggleBenchmark(todoModel, clicks);
+         return 0;
+       }},
+      {"move-benchmark",
+       "Time task reordering on a note of the given size and print a report.",
+       "tasks", benchmarkMode::FreshTarget,
+       [](int tasks) {
+         ToDoListModel todoModel;
+         runMoveBenchmark(todoModel, tasks, 10000);
+         return 0;
+       }},
+      {"data-benchmark",
+       "Time model data() reads on a note of the given size and print a "
+       "report.",
+       "tasks", benchmarkMode::FreshTarget,
+       [](int tasks) {
+         ToDoListModel todoModel;
+         runDataBenchmark(todoModel, tasks);
+         return 0;
+       }},
+      {"switch-benchmark",
+       "Time switching between notes of the given size and print a report.",
+       "tasks", benchmarkMode::FreshTarget,
+       [](int tasks) {
+         ToDoListModel todoModel;
+         runSwitchBenchmark(todoModel, 8, tasks, 20);
+         return 0;
+       }},
+      {"multiprocess-stress",
+       "Add the given number of tasks from this and a second process at once "
+       "and print a report.",
+       "tasks", benchmarkMode::FreshTarget,
+       [](int tasks) {
+         ToDoListModel todoModel;
+         return runMultiProcessStress(todoModel, tasks);
+       }},
+      {"window-benchmark",
+       "Time scrolling through a note of the given size and print a report.",
+       "tasks", benchmarkMode::FreshTarget,
+       [](int tasks) {
+         ToDoListModel todoModel;
+         runWindowBenchmark(todoModel, tasks);
+         return 0;
+       }},
+  };
+  return table;
+}
+
+/**
+ * @brief Adds the option of every benchmark and stress mode to @p parser.
+ */
+void Benchmarks::addOptions(QCommandLineParser &parser) {
+  for (const benchmarkMode &mode : modes())
+    parser.addOption(QCommandLineOption(mode.name, mode.description,
+                                        mode.valueName));
+}
+
+/**
+ * @brief Returns whether a benchmark or stress mode was selected on the command line.
+ */
+bool Benchmarks::isRequested(const QCommandLineParser &parser) {
+  for (const benchmarkMode &mode : modes())
+    if (parser.isSet(mode.name))
+      return true;
+  return false;
+}
+
+/**
+ * @brief Runs the first selected benchmark or stress mode.
+ *
+ * Modes that write to the current workspace run in the database at
+ * @p targetPath: a fresh one, which must not exist yet, or for the second
+ * process of a stress test the one the first process created.
+ *
+ * @param parser The processed command line.
+ * @param targetPath The --replay-target database.
+ * @return The exit code of the mode, or 1 if none is selected or its workspace cannot be opened.
+ */
+int Benchmarks::run(const QCommandLineParser &parser,
+                    const QString &targetPath) {
+  for (const benchmarkMode &mode : modes()) {
+    if (!parser.isSet(mode.name))
+      continue;
+    if (mode.target != benchmarkMode::NoTarget &&
+        !openTarget(targetPath, mode.target == benchmarkMode::FreshTarget))
+      return 1;
+    return mode.run(parser.value(mode.name).toInt());
+  }
+  return 1;
+}
+
+/**
+ * @brief Opens the database benchmarks and replays write to and makes it the current workspace.
+ *
+ * @param path Path of the database.
+ * @param fresh Whether the database must not exist yet, so no earlier data skews the results.
+ * @return true if the workspace is open and current, false otherwise.
+ */
+bool Benchmarks::openTarget(const QString &path, bool fresh) {
+  if (fresh && QFile::exists(path)) {
+    qDebug() << "Replay target already exists:" << path;
+    return false;
+  }
+  WorkspaceRegistry &workspaces = WorkspaceRegistry::instance();
+  return workspaces.openWorkspace("replay", path) &&
+         workspaces.setCurrentWorkspace("replay");
+}
+
+/**
+ * @brief Returns the peak resident set size of the process in KiB, or -1 where it is not known.
+ */
+qint64 Benchmarks::peakResidentKiB() {
+  QFile status(QStringLiteral("/proc/self/status"));
+  if (!status.open(QIODevice::ReadOnly | QIODevice::Text))
+    return -1;
+  for (QByteArray line = status.readLine(); !line.isEmpty();
+       line = status.readLine())
+    if (line.startsWith("VmHWM:"))
+      return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+  return -1;
+}
+
+/**
+ * @brief Returns the current resident set size of the process in KiB, or -1 where it is not known.
+ *
+ * Reads /proc/self/statm where it exists. Elsewhere the peak from getrusage()
+ * is the closest figure, which is exact as long as memory only grows.
+ */
+qint64 Benchmarks::residentKiB() {
+#ifdef Q_OS_UNIX
+  QFile statm(QStringLiteral("/proc/self/statm"));
+  if (statm.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.size() > 1)
+      return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE) / 1024;
+  }
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+#ifdef Q_OS_MACOS
+    return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+  return -1;
+}
+
+/**
+ * @brief Adds a task in a transaction of its own, as a separate user action would.
+ *
+ * Goes through DBManager::queueWrite() like the models' writes, so a write
+ * that finds the write lock busy is retried later. @p pending counts the
+ * writes that have not finished yet (see waitForWrites()) and @p failed
+ * those that failed.
+ */
+void Benchmarks::addTaskAlone(DBManager *db, int noteId,
+                              const QString &content, int &pending,
+                              int &failed) {
+  ++pending;
+  db->queueWrite(
+      [db, noteId, content]() {
+        return db->addNoteContent(noteId, content) >= 0;
+      },
+      [&pending, &failed](bool ok) {
+        --pending;
+        if (!ok)
+          ++failed;
+      });
+}
+
+/**
+ * @brief Runs the event loop until the writes counted by @p pending have finished.
+ */
+void Benchmarks::waitForWrites(const int &pending) {
+  if (pending == 0)
+    return;
+  QEventLoop loop;
+  QTimer poll;
+  poll.setInterval(1);
+  QObject::connect(&poll, &QTimer::timeout, &loop, [&]() {
+    if (pending == 0)
+      loop.quit();
+  });
+  poll.start();
+  loop.exec();
+}
@@ -0,0 +1,89 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <QString>
+#include <QVector>
+
+class DBManager;
+class QCommandLineParser;
+class ToDoListModel;
+
+/**
+ * @struct benchmarkMode
+ * @brief One command-line benchmark or stress mode run by Benchmarks::run().
+ *
+ * @var benchmarkMode::name
+ *   Name of the command-line option that selects the mode.
+ * @var benchmarkMode::description
+ *   Help text of the option.
+ * @var benchmarkMode::valueName
+ *   Name of the option's integer value in the help text.
+ * @var benchmarkMode::target
+ *   Workspace the mode runs in: none (it makes its own databases), a fresh database at the
+ *   --replay-target path, or the existing database at that path.
+ * @var benchmarkMode::run
+ *   Runs the mode with the option's value and returns the process exit code.
+ */
+struct benchmarkMode {
+  enum Target { NoTarget, FreshTarget, ExistingTarget };
+
+  const char *name;
+  const char *description;
+  const char *valueName;
+  Target target;
+  int (*run)(int value);
+};
+
+/**
+ * @class Benchmarks
+ * @brief Command-line benchmark and stress modes that run instead of the UI.
+ *
+ * Every mode is one entry of a shared table (see benchmarkMode): addOptions() registers its option,
+ * and run() opens the workspace the mode needs and runs it. The modes themselves live with the
+ * feature they measure: the task list in listbenchmarks.cpp, workspaces in workspacebenchmark.cpp,
+ * attachments in attachmentbenchmark.cpp, memory in memoryreport.cpp and concurrent writers in
+ * stressbenchmarks.cpp. Modes of other classes (TagIndex, TrigramIndex, SyncEngine) are listed in the
+ * same table.
+ */
+class Benchmarks {
+public:
+  static void addOptions(QCommandLineParser &parser);
+  static bool isRequested(const QCommandLineParser &parser);
+  static int run(const QCommandLineParser &parser, const QString &targetPath);
+  static bool openTarget(const QString &path, bool fresh);
+
+private:
+  static const QVector<benchmarkMode> &modes();
+
+  // Task list (listbenchmarks.cpp)
+  static void runToggleBenchmark(ToDoListModel &todoModel, int clickCount);
+  static void runMoveBenchmark(ToDoListModel &todoModel, int taskCount,
+                               int moveCount);
+  static void runDataBenchmark(ToDoListModel &todoModel, int taskCount);
+  static void runSwitchBenchmark(ToDoListModel &todoModel, int noteCount,
+                                 int taskCount, int rounds);
+  static void runWindowBenchmark(ToDoListModel &todoModel, int taskCount);
+
+  // Workspaces (workspacebenchmark.cpp)
+  static void runWorkspaceBenchmark(int taskCount, int shardCount);
+
+  // Attachments (attachmentbenchmark.cpp)
+  static void runAttachmentBenchmark(int megabytes);
+
+  // Memory (memoryreport.cpp)
+  static void runMemoryReport(ToDoListModel &todoModel, int rowCount);
+
+  // Concurrent writers (stressbenchmarks.cpp)
+  static int runBackupStress(int taskCount);
+  static int runMultiProcessStress(ToDoListModel &todoModel, int taskCount);
+  static int runStressWriter(int taskCount);
+
+  // Shared by the modes (benchmarks.cpp)
+  static qint64 peakResidentKiB();
+  static qint64 residentKiB();
+  static void addTaskAlone(DBManager *db, int noteId, const QString &content,
+                           int &pending, int &failed);
+  static void waitForWrites(const int &pending);
+};
+
+#endif // BENCHMARKS_H
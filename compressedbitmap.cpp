@@ -0,0 +1,281 @@
+#include "compressedbitmap.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <iterator>
+
+/**
+ * @brief Adds a value to the set.
+ */
+void CompressedBitmap::add(quint32 value) {
+  Container &container = m_containers[quint16(value >> 16)];
+  const quint16 low = quint16(value & 0xFFFF);
+  if (container.isBitset()) {
+    quint64 &word = container.words[low >> 6];
+    const quint64 bit = quint64(1) << (low & 63);
+    if (!(word & bit)) {
+      word |= bit;
+      ++container.count;
+    }
+    return;
+  }
+  auto it = std::lower_bound(container.values.begin(), container.values.end(),
+                             low);
+  if (it != container.values.end() && *it == low)
+    return;
+  container.values.insert(it, low);
+  ++container.count;
+  normalize(container);
+}
+
+/**
+ * @brief Removes a value from the set.
+ *
+ * @return true if the value was in the set.
+ */
+bool CompressedBitmap::remove(quint32 value) {
+  auto found = m_containers.find(quint16(value >> 16));
+  if (found == m_containers.end())
+    return false;
+  Container &container = found.value();
+  const quint16 low = quint16(value & 0xFFFF);
+  if (container.isBitset()) {
+    quint64 &word = container.words[low >> 6];
+    const quint64 bit = quint64(1) << (low & 63);
+    if (!(word & bit))
+      return false;
+    word &= ~bit;
+    --container.count;
+    normalize(container);
+  } else {
+    auto it = std::lower_bound(container.values.begin(),
+                               container.values.end(), low);
+    if (it == container.values.end() || *it != low)
+      return false;
+    container.values.erase(it);
+    --container.count;
+  }
+  if (container.count == 0)
+    m_containers.erase(found);
+  return true;
+}
+
+/**
+ * @brief Returns whether the value is in the set.
+ */
+bool CompressedBitmap::contains(quint32 value) const {
+  auto found = m_containers.constFind(quint16(value >> 16));
+  if (found == m_containers.constEnd())
+    return false;
+  const Container &container = found.value();
+  const quint16 low = quint16(value & 0xFFFF);
+  if (container.isBitset())
+    return (container.words.at(low >> 6) >> (low & 63)) & 1;
+  return std::binary_search(container.values.cbegin(), container.values.cend(),
+                            low);
+}
+
+/**
+ * @brief Returns whether the set is empty.
+ */
+bool CompressedBitmap::isEmpty() const { return m_containers.isEmpty(); }
+
+/**
+ * @brief Returns the number of values in the set, in time proportional to the number of containers.
+ */
+int CompressedBitmap::cardinality() const {
+  int total = 0;
+  for (const Container &container : m_containers)
+    total += container.count;
+  return total;
+}
+
+/**
+ * @brief Returns the values of the set in ascending order.
+ */
+QVector<quint32> CompressedBitmap::toVector() const {
+  QVector<quint32> result;
+  result.reserve(cardinality());
+  for (auto it = m_containers.cbegin(); it != m_containers.cend(); ++it) {
+    const quint32 high = quint32(it.key()) << 16;
+    const Container &container = it.value();
+    if (!container.isBitset()) {
+      for (quint16 low : container.values)
+        result.append(high | low);
+      continue;
+    }
+    for (int i = 0; i < bitsetWords; ++i) {
+      for (quint64 word = container.words.at(i); word; word &= word - 1)
+        result.append(high | quint32(i * 64 + qCountTrailingZeroBits(word)));
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief Keeps only the values also present in @p other.
+ */
+CompressedBitmap &CompressedBitmap::operator&=(const CompressedBitmap &other) {
+  for (auto it = m_containers.begin(); it != m_containers.end();) {
+    auto match = other.m_containers.constFind(it.key());
+    if (match != other.m_containers.constEnd())
+      it.value() = intersect(it.value(), match.value());
+    if (match == other.m_containers.constEnd() || it.value().count == 0)
+      it = m_containers.erase(it);
+    else
+      ++it;
+  }
+  return *this;
+}
+
+/**
+ * @brief Adds every value of @p other.
+ */
+CompressedBitmap &CompressedBitmap::operator|=(const CompressedBitmap &other) {
+  for (auto it = other.m_containers.cbegin(); it != other.m_containers.cend();
+       ++it) {
+    auto match = m_containers.find(it.key());
+    if (match == m_containers.end())
+      m_containers.insert(it.key(), it.value());
+    else
+      match.value() = unite(match.value(), it.value());
+  }
+  return *this;
+}
+
+/**
+ * @brief Removes every value of @p other.
+ */
+CompressedBitmap &CompressedBitmap::operator-=(const CompressedBitmap &other) {
+  for (auto it = m_containers.begin(); it != m_containers.end();) {
+    auto match = other.m_containers.constFind(it.key());
+    if (match != other.m_containers.constEnd())
+      it.value() = subtract(it.value(), match.value());
+    if (it.value().count == 0)
+      it = m_containers.erase(it);
+    else
+      ++it;
+  }
+  return *this;
+}
+
+/**
+ * @brief Converts a sparse container to its bitset form.
+ */
+void CompressedBitmap::toBitset(Container &container) {
+  container.words = QVector<quint64>(bitsetWords, 0);
+  for (quint16 low : qAsConst(container.values))
+    container.words[low >> 6] |= quint64(1) << (low & 63);
+  container.values = QVector<quint16>();
+}
+
+/**
+ * @brief Converts a dense container back to a sorted array.
+ */
+void CompressedBitmap::toArray(Container &container) {
+  QVector<quint16> values;
+  values.reserve(container.count);
+  for (int i = 0; i < bitsetWords; ++i) {
+    for (quint64 word = container.words.at(i); word; word &= word - 1)
+      values.append(quint16(i * 64 + qCountTrailingZeroBits(word)));
+  }
+  container.values = values;
+  container.words = QVector<quint64>();
+}
+
+/**
+ * @brief Picks the cheaper representation for the container's current count.
+ */
+void CompressedBitmap::normalize(Container &container) {
+  if (container.isBitset() && container.count <= maxArraySize)
+    toArray(container);
+  else if (!container.isBitset() && container.count > maxArraySize)
+    toBitset(container);
+}
+
+/**
+ * @brief Counts the bits set in a bitset container.
+ */
+int CompressedBitmap::countBits(const Container &container) {
+  int count = 0;
+  for (quint64 word : container.words)
+    count += qPopulationCount(word);
+  return count;
+}
+
+CompressedBitmap::Container CompressedBitmap::intersect(const Container &a,
+                                                        const Container &b) {
+  Container result;
+  if (a.isBitset() && b.isBitset()) {
+    result.words.resize(bitsetWords);
+    for (int i = 0; i < bitsetWords; ++i)
+      result.words[i] = a.words.at(i) & b.words.at(i);
+    result.count = countBits(result);
+    normalize(result);
+    return result;
+  }
+  if (!a.isBitset() && !b.isBitset()) {
+    std::set_intersection(a.values.cbegin(), a.values.cend(),
+                          b.values.cbegin(), b.values.cend(),
+                          std::back_inserter(result.values));
+  } else {
+    const Container &array = a.isBitset() ? b : a;
+    const Container &bitset = a.isBitset() ? a : b;
+    for (quint16 low : array.values)
+      if ((bitset.words.at(low >> 6) >> (low & 63)) & 1)
+        result.values.append(low);
+  }
+  result.count = result.values.size();
+  return result;
+}
+
+CompressedBitmap::Container CompressedBitmap::unite(const Container &a,
+                                                    const Container &b) {
+  Container result;
+  if (!a.isBitset() && !b.isBitset()) {
+    std::set_union(a.values.cbegin(), a.values.cend(), b.values.cbegin(),
+                   b.values.cend(), std::back_inserter(result.values));
+    result.count = result.values.size();
+    normalize(result);
+    return result;
+  }
+  result = a.isBitset() ? a : b;
+  const Container &other = a.isBitset() ? b : a;
+  if (other.isBitset()) {
+    for (int i = 0; i < bitsetWords; ++i)
+      result.words[i] |= other.words.at(i);
+  } else {
+    for (quint16 low : other.values)
+      result.words[low >> 6] |= quint64(1) << (low & 63);
+  }
+  result.count = countBits(result);
+  return result;
+}
+
+CompressedBitmap::Container CompressedBitmap::subtract(const Container &a,
+                                                       const Container &b) {
+  Container result;
+  if (!a.isBitset()) {
+    if (!b.isBitset()) {
+      std::set_difference(a.values.cbegin(), a.values.cend(),
+                          b.values.cbegin(), b.values.cend(),
+                          std::back_inserter(result.values));
+    } else {
+      for (quint16 low : a.values)
+        if (!((b.words.at(low >> 6) >> (low & 63)) & 1))
+          result.values.append(low);
+    }
+    result.count = result.values.size();
+    return result;
+  }
+  result = a;
+  if (b.isBitset()) {
+    for (int i = 0; i < bitsetWords; ++i)
+      result.words[i] &= ~b.words.at(i);
+  } else {
+    for (quint16 low : b.values)
+      result.words[low >> 6] &= ~(quint64(1) << (low & 63));
+  }
+  result.count = countBits(result);
+  normalize(result);
+  return result;
+}
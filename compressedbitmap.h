@@ -0,0 +1,72 @@
+#ifndef COMPRESSEDBITMAP_H
+#define COMPRESSEDBITMAP_H
+
+#include <QMap>
+#include <QVector>
+
+/**
+ * @class CompressedBitmap
+ * @brief Compressed set of 32-bit integers (task IDs) supporting fast set operations.
+ *
+ * Values are partitioned by their high 16 bits into containers. A container stores its low 16 bits
+ * as a sorted array while it holds at most maxArraySize values, and as a 65536-bit bitset once it
+ * gets denser, so both sparse and dense sets stay small. Intersection, union and difference work
+ * container by container: array/array pairs are merged, anything involving a bitset is done a
+ * 64-bit word at a time.
+ *
+ * Usage:
+ *   CompressedBitmap urgent, ops;
+ *   urgent.add(42);
+ *   CompressedBitmap both = urgent & ops;
+ */
+class CompressedBitmap {
+public:
+  void add(quint32 value);
+  bool remove(quint32 value);
+  bool contains(quint32 value) const;
+  bool isEmpty() const;
+  int cardinality() const;
+  QVector<quint32> toVector() const;
+
+  CompressedBitmap &operator&=(const CompressedBitmap &other);
+  CompressedBitmap &operator|=(const CompressedBitmap &other);
+  CompressedBitmap &operator-=(const CompressedBitmap &other);
+
+private:
+  static constexpr int maxArraySize = 4096;
+  static constexpr int bitsetWords = 1024;
+
+  struct Container {
+    QVector<quint16> values; // sorted, while the container is sparse
+    QVector<quint64> words;  // bitsetWords words, once it is dense
+    int count = 0;
+    bool isBitset() const { return !words.isEmpty(); }
+  };
+
+  static void toBitset(Container &container);
+  static void toArray(Container &container);
+  static void normalize(Container &container);
+  static int countBits(const Container &container);
+  static Container intersect(const Container &a, const Container &b);
+  static Container unite(const Container &a, const Container &b);
+  static Container subtract(const Container &a, const Container &b);
+
+  QMap<quint16, Container> m_containers;
+};
+
+inline CompressedBitmap operator&(CompressedBitmap a,
+                                  const CompressedBitmap &b) {
+  return a &= b;
+}
+
+inline CompressedBitmap operator|(CompressedBitmap a,
+                                  const CompressedBitmap &b) {
+  return a |= b;
+}
+
+inline CompressedBitmap operator-(CompressedBitmap a,
+                                  const CompressedBitmap &b) {
+  return a -= b;
+}
+
+#endif // COMPRESSEDBITMAP_H
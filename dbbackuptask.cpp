@@ -0,0 +1,99 @@
+#include "dbbackuptask.h"
+#include <QFile>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QUuid>
+
+DBBackupTask::DBBackupTask(const QString &sourcePath, const QString &destPath)
+    : QObject(nullptr), m_sourcePath(sourcePath), m_destPath(destPath) {
+  setAutoDelete(true);
+}
+
+/**
+ * @brief Runs the backup on the calling (pool) thread.
+ *
+ * Writes the snapshot to "<destPath>.part", verifies it and atomically replaces
+ * the destination file. The temporary file is removed on failure.
+ */
+void DBBackupTask::run() {
+  const QString tempPath = m_destPath + ".part";
+  QFile::remove(tempPath);
+
+  QString message;
+  bool ok = writeSnapshot(tempPath, message) &&
+            verifyIntegrity(tempPath, message);
+  if (ok) {
+    QFile::remove(m_destPath);
+    ok = QFile::rename(tempPath, m_destPath);
+    if (!ok)
+      message = QStringLiteral("Failed to move snapshot to ") + m_destPath;
+  }
+  if (!ok)
+    QFile::remove(tempPath);
+
+  emit finished(m_destPath, ok, message);
+}
+
+/**
+ * @brief Copies the source database into a new file using "VACUUM INTO".
+ *
+ * @param tempPath File to write the snapshot to. It must not exist.
+ * @param message Receives the error text on failure.
+ * @return true if the snapshot was written, false otherwise.
+ */
+bool DBBackupTask::writeSnapshot(const QString &tempPath, QString &message) {
+  const QString connectionName =
+      QStringLiteral("backup-") + QUuid::createUuid().toString();
+  bool ok = false;
+  {
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    db.setDatabaseName(m_sourcePath);
+    if (!db.open()) {
+      message = db.lastError().text();
+    } else {
+      QString escaped = tempPath;
+      escaped.replace('\'', "''");
+      QSqlQuery query(db);
+      ok = query.exec("VACUUM INTO '" + escaped + "'");
+      if (!ok)
+        message = query.lastError().text();
+      db.close();
+    }
+  }
+  QSqlDatabase::removeDatabase(connectionName);
+  return ok;
+}
+
+/**
+ * @brief Runs "PRAGMA integrity_check" on a snapshot file.
+ *
+ * @param path The snapshot to check.
+ * @param message Receives the first reported problem on failure.
+ * @return true if SQLite reports the file as "ok", false otherwise.
+ */
+bool DBBackupTask::verifyIntegrity(const QString &path, QString &message) {
+  const QString connectionName =
+      QStringLiteral("backup-check-") + QUuid::createUuid().toString();
+  bool ok = false;
+  {
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setConnectOptions("QSQLITE_OPEN_READONLY");
+    db.setDatabaseName(path);
+    if (!db.open()) {
+      message = db.lastError().text();
+    } else {
+      QSqlQuery query(db);
+      if (query.exec("PRAGMA integrity_check") && query.next()) {
+        message = query.value(0).toString();
+        ok = message == QLatin1String("ok");
+      } else {
+        message = query.lastError().text();
+      }
+      db.close();
+    }
+  }
+  QSqlDatabase::removeDatabase(connectionName);
+  return ok;
+}
@@ -0,0 +1,39 @@
+#ifndef DBBACKUPTASK_H
+#define DBBACKUPTASK_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QString>
+
+/**
+ * @class DBBackupTask
+ * @brief Background job that writes a consistent snapshot of a SQLite database to a file.
+ *
+ * The task runs on a QThreadPool thread with its own database connection, so the
+ * connection used by the UI is never blocked. The snapshot is written with
+ * "VACUUM INTO" to a temporary file, checked with "PRAGMA integrity_check" and
+ * only then renamed to the requested destination. With the source database in
+ * WAL mode the snapshot only holds a read transaction, so writers keep going
+ * while a large database is being copied.
+ *
+ * @note Results are reported through the finished() signal, which is emitted from
+ *       the worker thread; connect to it with a queued connection.
+ */
+class DBBackupTask : public QObject, public QRunnable {
+  Q_OBJECT
+public:
+  DBBackupTask(const QString &sourcePath, const QString &destPath);
+  void run() override;
+
+signals:
+  void finished(const QString &destPath, bool ok, const QString &message);
+
+private:
+  bool writeSnapshot(const QString &tempPath, QString &message);
+  bool verifyIntegrity(const QString &path, QString &message);
+
+  QString m_sourcePath;
+  QString m_destPath;
+};
+
+#endif // DBBACKUPTASK_H
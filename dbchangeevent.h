@@ -0,0 +1,55 @@
+#ifndef DBCHANGEEVENT_H
+#define DBCHANGEEVENT_H
+
+#include <QMetaType>
+#include <QVariantMap>
+
+/**
+ * @struct DBChangeEvent
+ * @brief Describes one committed write to a workspace database.
+ *
+ * DBManager publishes one event per modified row once the write is committed (events raised inside a
+ * transaction are held back until the outermost commit and dropped on rollback). Models subscribe to
+ * WorkspaceRegistry::changed() and apply the event as a targeted row insert, update or removal instead
+ * of reloading everything.
+ *
+ * @var DBChangeEvent::table
+ *   Table that was written.
+ * @var DBChangeEvent::operation
+ *   Kind of write. Reloaded is published for writes of another process (see DBManager::
+ *   pollExternalChanges()): the rows matching rowId and noteId (-1 for any) may have changed in any
+ *   way and should be read again.
+ * @var DBChangeEvent::rowId
+ *   Primary key of the affected row, or -1 when every row matching noteId was affected. For TaskTags and
+ *   NoteTags it is the tagged task or note, and values holds the "tag_id". EventRollups events have no
+ *   row ID; values holds the "day", "note_name", "event_type" and the added "count". For Attachments,
+ *   values holds the "content_id" of the task. When a NotesContents subtree is deleted, the event of its
+ *   top task holds the "parent_id" it had.
+ * @var DBChangeEvent::noteId
+ *   Note the row belongs to (the note itself for Notes), or -1 if not known.
+ * @var DBChangeEvent::values
+ *   Column values written by the statement, keyed by column name.
+ */
+struct DBChangeEvent {
+  enum Table {
+    Notes,
+    NotesContents,
+    EventLogs,
+    Tags,
+    TaskTags,
+    NoteTags,
+    RecurrenceRules,
+    EventRollups,
+    Attachments
+  };
+  enum Operation { Inserted, Updated, Deleted, Reloaded };
+
+  Table table;
+  Operation operation;
+  int rowId;
+  int noteId;
+  QVariantMap values;
+};
+Q_DECLARE_METATYPE(DBChangeEvent)
+
+#endif // DBCHANGEEVENT_H
@@ -0,0 +1,46 @@
+#include "dbchecktask.h"
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QUuid>
+
+DBCheckTask::DBCheckTask(const QString &dbPath, const QString &table)
+    : QObject(nullptr), m_dbPath(dbPath), m_table(table) {
+  setAutoDelete(true);
+}
+
+/**
+ * @brief Runs the check on the calling (pool) thread.
+ *
+ * All problems SQLite reports are joined into the message, one per line.
+ */
+void DBCheckTask::run() {
+  const QString connectionName =
+      QStringLiteral("check-") + QUuid::createUuid().toString();
+  bool ok = false;
+  QString message;
+  {
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+    db.setDatabaseName(m_dbPath);
+    if (!db.open()) {
+      message = db.lastError().text();
+    } else {
+      QString escaped = m_table;
+      escaped.replace('"', "\"\"");
+      QSqlQuery query(db);
+      if (query.exec("PRAGMA quick_check(\"" + escaped + "\")")) {
+        QStringList problems;
+        while (query.next())
+          problems.append(query.value(0).toString());
+        message = problems.join('\n');
+        ok = message == QLatin1String("ok");
+      } else {
+        message = query.lastError().text();
+      }
+      db.close();
+    }
+  }
+  QSqlDatabase::removeDatabase(connectionName);
+  emit finished(m_table, ok, message);
+}
@@ -0,0 +1,34 @@
+#ifndef DBCHECKTASK_H
+#define DBCHECKTASK_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QString>
+
+/**
+ * @class DBCheckTask
+ * @brief Background job that runs "PRAGMA quick_check" on one table of a SQLite database.
+ *
+ * Like DBBackupTask, the task runs on a QThreadPool thread with its own read-only connection. With
+ * the database in WAL mode the check only holds a read transaction, so the UI keeps writing while it
+ * runs. Checking one table (and its indexes) at a time keeps each check short; DBManager's
+ * maintenance checks the next table after every pass.
+ *
+ * @note Results are reported through the finished() signal, which is emitted from the worker thread;
+ *       connect to it with a queued connection.
+ */
+class DBCheckTask : public QObject, public QRunnable {
+  Q_OBJECT
+public:
+  DBCheckTask(const QString &dbPath, const QString &table);
+  void run() override;
+
+signals:
+  void finished(const QString &table, bool ok, const QString &message);
+
+private:
+  QString m_dbPath;
+  QString m_table;
+};
+
+#endif // DBCHECKTASK_H
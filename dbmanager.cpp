@@ -1,31 +1,78 @@
 #include "dbmanager.h"
+#include "attachmentcopytask.h"
+#include "dbbackuptask.h"
+#include "dbchecktask.h"
+#include "logger.h"
+#include "orderkey.h"
+#include "textdelta.h"
+#include "tracer.h"
+#include "workspaceregistry.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
-DBManager *DBManager::m_instance = nullptr;
-QMutex DBManager::m_mutex;
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QSaveFile>
+#include <QSet>
+#include <QTemporaryFile>
+#include <QThreadPool>
+#include <QUuid>
+#include <QtEndian>
 
-DBManager::DBManager(QObject *parent) : QObject(parent) {
-  openDB("./database.db");
-  createTablesFromFile("./schema/databaseTemplate.sql");
+/**
+ * @brief Opens (and if needed creates) the database at @p dbPath.
+ *
+ * Every DBManager owns its own named connection, so several databases can be
+ * open at the same time. The tables are created from @p schemaPath if they do
+ * not exist yet.
+ *
+ * @param dbPath Path of the SQLite database file.
+ * @param schemaPath Path of the SQL file describing the tables.
+ * @param parent Parent QObject.
+ */
+DBManager::DBManager(const QString &dbPath, const QString &schemaPath,
+                     QObject *parent)
+    : QObject(parent),
+      m_connectionName(QStringLiteral("workspace-") +
+                       QUuid::createUuid().toString()) {
+  QObject::connect(&m_snapshotTimer, &QTimer::timeout, this,
+                   &DBManager::takeSnapshot);
+  m_attachmentGcTimer.setSingleShot(true);
+  m_attachmentGcTimer.setInterval(0);
+  QObject::connect(&m_attachmentGcTimer, &QTimer::timeout, this,
+                   &DBManager::collectAttachmentGarbage);
+  QObject::connect(&m_externalPollTimer, &QTimer::timeout, this,
+                   &DBManager::pollExternalChanges);
+  QObject::connect(&m_maintenanceTimer, &QTimer::timeout, this,
+                   &DBManager::runMaintenanceStep);
+  m_writeRetryTimer.setSingleShot(true);
+  m_writeRetryTimer.setInterval(writeRetryDelayMs);
+  QObject::connect(&m_writeRetryTimer, &QTimer::timeout, this,
+                   &DBManager::retryQueuedWrites);
+  openDB(dbPath);
+  createTablesFromFile(schemaPath);
+  if (migrateSchema())
+    claimSiteId();
+  if (m_db.isOpen())
+    startExternalChangePolling();
 }
 
 /**
- * @brief Returns the singleton instance of DBManager.
+ * @brief Returns the DBManager of the current workspace.
  *
- * This method implements the double-checked locking pattern to ensure that
- * only one instance of DBManager is created in a thread-safe manner.
- * If the instance does not exist, it acquires a mutex lock and creates
- * the instance.
+ * Kept for the models and the logger, which always work on the workspace that
+ * is currently selected in the WorkspaceRegistry. The default workspace
+ * ("./database.db") is opened on first use.
  *
- * @return Pointer to the singleton DBManager instance.
+ * @return Pointer to the DBManager of the current workspace; never nullptr
+ *         (see WorkspaceRegistry::current()).
  */
 DBManager *DBManager::instance() {
-  if (!m_instance) {
-    QMutexLocker locker(&m_mutex);
-    if (!m_instance) {
-      m_instance = new DBManager();
-    }
-  }
-  return m_instance;
+  return WorkspaceRegistry::instance().current();
 }
 /**
  * @brief Creates database tables by executing SQL statements from a file.
@@ -59,7 +106,7 @@ bool DBManager::createTablesFromFile(const QString &sqlFilePath) {
   // Split by semicolons to execute individual statements
   QStringList queries = sqlContent.split(';', Qt::SkipEmptyParts);
 
-  QSqlQuery query;
+  QSqlQuery query(m_db);
   for (const QString &q : queries) {
     QString trimmed = q.trimmed();
     if (trimmed.isEmpty())
@@ -74,12 +121,163 @@ bool DBManager::createTablesFromFile(const QString &sqlFilePath) {
   return true;
 }
 
+/**
+ * @brief Upgrades databases created by older versions of the application.
+ *
+ * The schema version is kept in "PRAGMA user_version". Each step runs once,
+ * inside a transaction, and bumps the version when it succeeds:
+ * - 1: created_at columns hold integer epoch milliseconds (UTC) instead of
+ *      CURRENT_TIMESTAMP text.
+ * - 2: NotesContents.parent_id for sub-tasks, indexed for child lookups.
+ * - 3: sort_key ordering keys on Notes and NotesContents, backfilled from the
+ *      creation order (newest note first, oldest task first).
+ * - 4: NotesContents.due_at (epoch milliseconds), with a partial index over
+ *      the deadlines of open tasks for the reminder scheduler.
+ * - 5: NotesContents.rule_id and occurrence_at, linking materialized
+ *      occurrences to their RecurrenceRules row.
+ * - 6: EventRollups, backfilled from the existing eventLogs.
+ * - 7: uuid columns on Notes and NotesContents and the sync change log (see
+ *      installChangeLog()).
+ * - 8: reference counts of attachment blobs (see installAttachmentRefCounts()).
+ * - 9: revision history of task texts (see installContentRevisions()).
+ * - 10: SyncPeers.acked_seq, how far each peer has pulled this database's
+ *       change log (see pullChanges()).
+ * - 11: ordering keys are logged as changes of their own (see
+ *       installChangeLog()).
+ *
+ * @return true if the database is at the current schema version, false otherwise.
+ */
+bool DBManager::migrateSchema() {
+  QSqlQuery query(m_db);
+  if (!query.exec("PRAGMA user_version") || !query.next())
+    return false;
+  const int version = query.value(0).toInt();
+  query.finish();
+  if (version >= currentSchemaVersion)
+    return true;
+
+  bool ok = beginTransaction();
+  if (ok && version < 1) {
+    for (const char *table : {"Notes", "NotesContents", "eventLogs"}) {
+      ok = query.exec(
+          QStringLiteral("UPDATE %1 SET created_at = CAST((julianday("
+                         "created_at) - 2440587.5) * 86400000 AS INTEGER) "
+                         "WHERE typeof(created_at) = 'text'")
+              .arg(table));
+      if (!ok) {
+        qDebug() << "Migration error:" << table << query.lastError().text();
+        break;
+      }
+    }
+  }
+  if (ok && version < 2) {
+    if (!tableColumns("main", "NotesContents").contains("parent_id"))
+      ok = query.exec("ALTER TABLE NotesContents ADD COLUMN parent_id INTEGER");
+    ok = ok && query.exec("CREATE INDEX IF NOT EXISTS idx_notescontents_parent "
+                          "ON NotesContents (parent_id)");
+    if (!ok)
+      qDebug() << "Migration error:" << query.lastError().text();
+  }
+  if (ok && version < 3) {
+    for (const char *table : {"Notes", "NotesContents"}) {
+      if (ok && !tableColumns("main", table).contains("sort_key"))
+        ok = query.exec(QStringLiteral("ALTER TABLE %1 ADD COLUMN sort_key TEXT")
+                            .arg(table));
+    }
+    ok = ok &&
+         rewriteSortKeys("Notes", "note_id",
+                         "ORDER BY created_at DESC, note_id DESC") &&
+         rewriteSortKeys("NotesContents", "id", "ORDER BY created_at, id") &&
+         query.exec("CREATE INDEX IF NOT EXISTS idx_notes_sort_key ON Notes "
+                    "(sort_key)") &&
+         query.exec("CREATE INDEX IF NOT EXISTS idx_notescontents_sort ON "
+                    "NotesContents (note_id, parent_id, sort_key)");
+    if (!ok)
+      qDebug() << "Migration error:" << query.lastError().text();
+  }
+  if (ok && version < 4) {
+    if (!tableColumns("main", "NotesContents").contains("due_at"))
+      ok = query.exec("ALTER TABLE NotesContents ADD COLUMN due_at INTEGER");
+    ok = ok && query.exec("CREATE INDEX IF NOT EXISTS idx_notescontents_due "
+                          "ON NotesContents (due_at) WHERE due_at IS NOT "
+                          "NULL AND completed = 0");
+    if (!ok)
+      qDebug() << "Migration error:" << query.lastError().text();
+  }
+  if (ok && version < 5) {
+    const QStringList columns = tableColumns("main", "NotesContents");
+    if (!columns.contains("rule_id"))
+      ok = query.exec("ALTER TABLE NotesContents ADD COLUMN rule_id INTEGER");
+    if (ok && !columns.contains("occurrence_at"))
+      ok = query.exec(
+          "ALTER TABLE NotesContents ADD COLUMN occurrence_at INTEGER");
+    ok = ok && query.exec("CREATE UNIQUE INDEX IF NOT EXISTS "
+                          "idx_notescontents_occurrence ON NotesContents "
+                          "(rule_id, occurrence_at) WHERE rule_id IS NOT NULL");
+    if (!ok)
+      qDebug() << "Migration error:" << query.lastError().text();
+  }
+  if (ok && version < 6)
+    ok = backfillEventRollups();
+  if (ok && version < 7)
+    ok = installChangeLog();
+  if (ok && version < 8)
+    ok = installAttachmentRefCounts();
+  if (ok && version < 9)
+    ok = installContentRevisions();
+  if (ok && version < 10) {
+    if (!tableColumns("main", "SyncPeers").contains("acked_seq"))
+      ok = query.exec("ALTER TABLE SyncPeers ADD COLUMN acked_seq INTEGER NOT "
+                      "NULL DEFAULT 0");
+    if (!ok)
+      qDebug() << "Migration error:" << query.lastError().text();
+  }
+  if (ok && version < 11) {
+    ok = query.exec("DROP TRIGGER IF EXISTS changelog_notes_update") &&
+         query.exec("DROP TRIGGER IF EXISTS changelog_notescontents_update") &&
+         installChangeLog();
+    if (!ok)
+      qDebug() << "Migration error:" << query.lastError().text();
+  }
+  if (ok)
+    ok = query.exec(
+        QStringLiteral("PRAGMA user_version = %1").arg(currentSchemaVersion));
+  if (ok)
+    return commitTransaction();
+  rollbackTransaction();
+  return false;
+}
+
+/**
+ * @brief Converts a created_at column value to a QDateTime.
+ *
+ * Timestamps are stored as integer epoch milliseconds, so this is the single,
+ * parse-free conversion used by the models. Text timestamps written by older
+ * versions ("yyyy-MM-dd HH:mm:ss", UTC) are still understood, e.g. when
+ * reading a database that has not been migrated.
+ *
+ * @param value The column value.
+ * @return The timestamp in local time, or an invalid QDateTime.
+ */
+QDateTime DBManager::toDateTime(const QVariant &value) {
+  bool isNumber = false;
+  const qint64 msecs = value.toLongLong(&isNumber);
+  if (isNumber)
+    return QDateTime::fromMSecsSinceEpoch(msecs);
+  QDateTime legacy =
+      QDateTime::fromString(value.toString(), "yyyy-MM-dd HH:mm:ss");
+  legacy.setTimeSpec(Qt::UTC);
+  return legacy.toLocalTime();
+}
+
 /**
  * @brief Opens a SQLite database at the specified path.
  *
  * This function attempts to open a SQLite database using the provided file path.
  * If the database is already open, it returns true immediately.
  * If the database cannot be opened, it logs the error and returns false.
+ * The database is switched to WAL journaling so that background readers
+ * (such as backups) never block writes from the UI, and vice versa.
  *
  * @param path The file path to the SQLite database.
  * @return true if the database is successfully opened or already open, false otherwise.
@@ -87,32 +285,528 @@ bool DBManager::createTablesFromFile(const QString &sqlFilePath) {
 bool DBManager::openDB(const QString &path) {
   if (m_db.isOpen())
     return true;
+  if (path.isEmpty()) {
+    // SQLite would open a private temporary database instead.
+    qDebug() << "DB open error: no database path";
+    return false;
+  }
 
-  m_db = QSqlDatabase::addDatabase("QSQLITE");
+  m_db = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+  m_db.setConnectOptions(
+      QStringLiteral("QSQLITE_BUSY_TIMEOUT=%1").arg(busyTimeoutMs));
   m_db.setDatabaseName(path);
 
   if (!m_db.open()) {
     qDebug() << "DB open error:" << m_db.lastError().text();
     return false;
   }
+  m_dbPath = path;
+  QSqlQuery query(m_db);
+  if (!query.exec("PRAGMA journal_mode=WAL"))
+    qDebug() << "Failed to enable WAL:" << query.lastError().text();
+  // A backup's read transaction keeps checkpoints from restarting the WAL,
+  // so it grows while one runs; shrink it back once it restarts.
+  query.exec(
+      QStringLiteral("PRAGMA journal_size_limit = %1").arg(walSizeLimitBytes));
   return true;
 }
 
 /**
  * @brief Closes the database connection if it is currently open.
  *
- * This function checks if the database is open and closes it to release resources.
+ * Writes still queued by queueWrite() get one last attempt first, waiting out
+ * busyTimeoutMs each, so that they are not dropped without a word.
  */
 void DBManager::closeDB() {
+  m_writeRetryTimer.stop();
+  const QList<queuedWrite> pending = m_queuedWrites;
+  m_queuedWrites.clear();
+  for (const queuedWrite &next : pending) {
+    bool ok = m_db.isOpen() && beginTransaction();
+    if (ok) {
+      if (next.write())
+        ok = commitTransaction();
+      else {
+        rollbackTransaction();
+        ok = false;
+      }
+    }
+    if (!ok)
+      qDebug() << "Queued write lost on close";
+    if (next.done)
+      next.done(ok);
+  }
   if (m_db.isOpen())
     m_db.close();
 }
 
+/**
+ * @brief Returns the path of the open database file.
+ */
+const QString &DBManager::databasePath() const { return m_dbPath; }
+
+/* ================== WORKSPACES ================== */
+/**
+ * @brief Attaches another database file to this connection for read queries.
+ *
+ * Attached databases are addressed as "<alias>.<table>" in SQL and are used by
+ * findNoteContents() to search several workspaces with a single query.
+ * SQLite refuses to attach inside a transaction or beyond
+ * maxAttachedDatabases files; both are checked up front.
+ *
+ * @param alias Schema name to attach the database as.
+ * @param path Path of the database file.
+ * @return true if the database is attached (or already was), false otherwise.
+ */
+bool DBManager::attachDatabase(const QString &alias, const QString &path) {
+  if (m_attached.contains(alias))
+    return true;
+  if (m_transactionDepth > 0) {
+    qDebug() << "Attach error:" << alias << "a transaction is open";
+    return false;
+  }
+  if (m_attached.size() >= maxAttachedDatabases) {
+    qDebug() << "Attach error:" << alias << "too many attached databases";
+    return false;
+  }
+  QSqlQuery query(m_db);
+  query.prepare(QStringLiteral("ATTACH DATABASE :path AS \"%1\"").arg(alias));
+  query.bindValue(":path", path);
+  if (!query.exec()) {
+    qDebug() << "Attach error:" << alias << query.lastError().text();
+    return false;
+  }
+  m_attached.append(alias);
+  return true;
+}
+
+/**
+ * @brief Detaches a database previously attached with attachDatabase().
+ *
+ * @param alias Schema name the database was attached as.
+ * @return true if the database was detached, false otherwise.
+ */
+bool DBManager::detachDatabase(const QString &alias) {
+  if (!m_attached.contains(alias))
+    return false;
+  if (m_transactionDepth > 0) {
+    qDebug() << "Detach error:" << alias << "a transaction is open";
+    return false;
+  }
+  QSqlQuery query(m_db);
+  if (!query.exec(QStringLiteral("DETACH DATABASE \"%1\"").arg(alias))) {
+    qDebug() << "Detach error:" << alias << query.lastError().text();
+    return false;
+  }
+  m_attached.removeAll(alias);
+  return true;
+}
+
+/**
+ * @brief Searches task contents in this database and the given attached ones.
+ *
+ * Runs one UNION ALL query over "main" and every schema in @p schemas. Each
+ * result carries the schema it came from in the "workspace" key, along with
+ * "id", "note_id", "title", "content" and "completed".
+ *
+ * @param text Text to search for (case-insensitive substring match).
+ * @param schemas Attached schema names to include in the search.
+ * @return QList<QVariantMap> The matching tasks.
+ */
+QList<QVariantMap> DBManager::findNoteContents(const QString &text,
+                                               const QStringList &schemas) {
+  TRACE_SPAN(span, "db");
+  QStringList selects;
+  const QStringList allSchemas = QStringList{"main"} + schemas;
+  for (int i = 0; i < allSchemas.size(); ++i)
+    selects.append(
+        QStringLiteral(
+            "SELECT '%1' AS workspace, c.id, c.note_id, n.title, c.content, "
+            "c.completed FROM \"%1\".NotesContents c JOIN \"%1\".Notes n "
+            "ON n.note_id = c.note_id WHERE c.content LIKE :pattern%2")
+            .arg(allSchemas.at(i))
+            .arg(i));
+
+  QList<QVariantMap> results;
+  QSqlQuery query(m_db);
+  query.prepare(selects.join(" UNION ALL "));
+  for (int i = 0; i < allSchemas.size(); ++i)
+    query.bindValue(QStringLiteral(":pattern%1").arg(i), "%" + text + "%");
+  if (!query.exec()) {
+    qDebug() << "Find contents error:" << query.lastError().text();
+    return results;
+  }
+  while (query.next()) {
+    QVariantMap row;
+    row["workspace"] = query.value("workspace");
+    row["id"] = query.value("id");
+    row["note_id"] = query.value("note_id");
+    row["title"] = query.value("title");
+    row["content"] = query.value("content");
+    row["completed"] = query.value("completed");
+    results.append(row);
+  }
+  span.setQuery(query, results.size());
+  return results;
+}
+
+/**
+ * @brief Starts a database transaction.
+ *
+ * Transactions nest: only the outermost call issues BEGIN, inner calls just
+ * increase the depth counter. This lets callers batch several writes (for
+ * example a status update and its event log entry) into a single commit
+ * without caring whether an enclosing transaction is already open.
+ *
+ * The outermost call takes the write lock right away (BEGIN IMMEDIATE).
+ * Another process may hold it; SQLite then waits for up to busyTimeoutMs
+ * (set in openDB()). A deferred transaction would only ask for the lock at
+ * its first write, and could then fail at once instead of waiting if
+ * another process wrote since its first read. The wait is kept short because
+ * it blocks the event loop; if the lock is still busy, BEGIN fails. Writes
+ * made on behalf of the user go through queueWrite(), which then tries
+ * again later instead of losing them.
+ *
+ * @return true if the transaction is active, false if BEGIN failed.
+ */
+bool DBManager::beginTransaction() {
+  if (m_transactionDepth++ > 0)
+    return true;
+  TRACE_SPAN(span, "db");
+  m_rollbackOnly = false;
+  QSqlQuery query(m_db);
+  m_writeLockBusy = false;
+  const bool ok = query.exec("BEGIN IMMEDIATE");
+  span.setQuery(query);
+  if (!ok) {
+    qDebug() << "Begin transaction error:" << query.lastError().text();
+    m_writeLockBusy = isBusy(query.lastError());
+    m_transactionDepth = 0;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Runs @p write in a transaction, or later if another connection holds the write lock.
+ *
+ * Inside an open transaction the write simply joins it. Otherwise a
+ * transaction is started; if the write lock is still busy after
+ * busyTimeoutMs, or the commit finds it busy, the write is queued and tried
+ * again every writeRetryDelayMs from the event loop without waiting for the
+ * lock, until it has run. Queued writes run in the order they were queued,
+ * and a later write queues behind them, so writes are never reordered or
+ * lost. @p write must therefore not refer to state that may be gone by then.
+ *
+ * @param write Makes the writes; returns false to roll them back.
+ * @param done Called with the outcome once the write has run (optional).
+ * @return false if the write failed right away, true if it ran or was queued.
+ */
+bool DBManager::queueWrite(const std::function<bool()> &write,
+                           const std::function<void(bool)> &done) {
+  const bool outermost = m_transactionDepth == 0;
+  if (outermost && !m_queuedWrites.isEmpty()) {
+    m_queuedWrites.append({write, done});
+    return true;
+  }
+  bool ok = beginTransaction();
+  if (ok) {
+    if (write())
+      ok = commitTransaction();
+    else {
+      rollbackTransaction();
+      ok = false;
+    }
+  }
+  if (!ok && outermost && m_writeLockBusy) {
+    m_queuedWrites.append({write, done});
+    m_writeRetryTimer.start();
+    return true;
+  }
+  if (done)
+    done(ok);
+  return ok;
+}
+
+/**
+ * @brief Runs the queued writes while the write lock is free, and waits for the next retry otherwise.
+ */
+void DBManager::retryQueuedWrites() {
+  if (m_transactionDepth > 0) {
+    m_writeRetryTimer.start();
+    return;
+  }
+  while (!m_queuedWrites.isEmpty()) {
+    if (!tryBeginTransaction()) {
+      if (m_writeLockBusy) {
+        m_writeRetryTimer.start();
+        return;
+      }
+      qDebug() << "Dropping" << m_queuedWrites.size() << "queued writes";
+      const QList<queuedWrite> failed = m_queuedWrites;
+      m_queuedWrites.clear();
+      for (const queuedWrite &next : failed)
+        if (next.done)
+          next.done(false);
+      return;
+    }
+    const queuedWrite next = m_queuedWrites.takeFirst();
+    bool ok = next.write();
+    if (ok)
+      ok = commitTransaction();
+    else
+      rollbackTransaction();
+    if (!ok && m_writeLockBusy) {
+      m_queuedWrites.prepend(next);
+      m_writeRetryTimer.start();
+      return;
+    }
+    if (next.done)
+      next.done(ok);
+  }
+}
+
+/**
+ * @brief Returns whether the last outermost BEGIN or COMMIT failed because another connection held the write lock.
+ */
+bool DBManager::writeLockBusy() const { return m_writeLockBusy; }
+
+/**
+ * @brief Returns the number of outermost transactions committed on this connection so far.
+ *
+ * Each one is a COMMIT, and so one sync of the write-ahead log at SQLite's
+ * default synchronous level.
+ */
+int DBManager::commitCount() const { return m_commitCount; }
+
+/**
+ * @brief Commits the current transaction.
+ *
+ * Only the outermost call actually commits. If an inner call requested a
+ * rollback, the outermost commit rolls the whole transaction back instead.
+ * Change events raised inside the transaction are emitted after the commit.
+ *
+ * @return true if the writes were committed (or the call was nested), false otherwise.
+ */
+bool DBManager::commitTransaction() {
+  TRACE_SPAN(span, "db");
+  if (m_transactionDepth == 0)
+    return false;
+  if (--m_transactionDepth > 0)
+    return true;
+  if (m_rollbackOnly) {
+    m_db.rollback();
+    m_rollbackOnly = false;
+    m_pendingChanges.clear();
+    return false;
+  }
+  if (!m_db.commit()) {
+    qDebug() << "Commit error:" << m_db.lastError().text();
+    m_writeLockBusy = isBusy(m_db.lastError());
+    m_db.rollback();
+    m_pendingChanges.clear();
+    return false;
+  }
+  ++m_commitCount;
+  if (m_externalPollTimer.isActive())
+    skipOwnChanges();
+  QList<DBChangeEvent> events;
+  events.swap(m_pendingChanges);
+  for (const DBChangeEvent &event : qAsConst(events))
+    emit changed(event);
+  return true;
+}
+
+/**
+ * @brief Rolls back the current transaction.
+ *
+ * A nested call only marks the transaction so that the outermost
+ * commitTransaction() rolls it back.
+ */
+void DBManager::rollbackTransaction() {
+  if (m_transactionDepth == 0)
+    return;
+  if (--m_transactionDepth > 0) {
+    m_rollbackOnly = true;
+    return;
+  }
+  m_rollbackOnly = false;
+  m_db.rollback();
+  m_pendingChanges.clear();
+}
+
+/**
+ * @brief Publishes a change event for a write that just succeeded.
+ *
+ * Outside a transaction the event is emitted immediately. Inside one it is
+ * held back until the outermost commit, and dropped if the transaction is
+ * rolled back, so subscribers only ever see committed data.
+ *
+ * @param event The change to publish.
+ */
+void DBManager::publishChange(const DBChangeEvent &event) {
+  if (m_transactionDepth > 0)
+    m_pendingChanges.append(event);
+  else
+    emit changed(event);
+}
+
+/**
+ * @brief Returns true if @p error means the database was locked by another connection.
+ */
+bool DBManager::isBusy(const QSqlError &error) {
+  const int code = error.nativeErrorCode().toInt() & 0xff;
+  return code == 5 || code == 6; // SQLITE_BUSY, SQLITE_LOCKED
+}
+
+/* ================== EXTERNAL CHANGES ================== */
+namespace {
+// One statement, so the three values describe the same snapshot.
+const char *const changeCursors =
+    "SELECT (SELECT data_version FROM pragma_data_version), (SELECT "
+    "MAX(seq) FROM ChangeLog), (SELECT MAX(id) FROM eventLogs)";
+} // namespace
+
+/**
+ * @brief Starts watching the database file for commits of other processes.
+ *
+ * Another instance of the application, or a script, may write to the same
+ * file. "PRAGMA data_version" changes whenever another connection commits,
+ * and reading it costs no I/O in WAL mode, so it is polled every
+ * @p intervalMs; see pollExternalChanges() for what happens on a change.
+ * Changes made before this call are not reported. Called by the constructor.
+ *
+ * @param intervalMs Polling interval, which bounds the delay until views show another process's writes.
+ */
+void DBManager::startExternalChangePolling(int intervalMs) {
+  QSqlQuery query(m_db);
+  if (!query.exec(changeCursors) || !query.next()) {
+    qDebug() << "Cannot watch for external changes:"
+             << query.lastError().text();
+    return;
+  }
+  m_dataVersion = query.value(0).toLongLong();
+  m_changeSeq = query.value(1).toLongLong();
+  m_logId = query.value(2).toInt();
+  m_externalPollTimer.start(intervalMs);
+}
+
+/**
+ * @brief Moves the external change cursors past this connection's own commit.
+ *
+ * If the data version is still the one last polled, no other connection has
+ * committed since, so every change log entry and event log entry up to the
+ * newest is this connection's own and was already published.
+ */
+void DBManager::skipOwnChanges() {
+  QSqlQuery query(m_db);
+  if (!query.exec(changeCursors) || !query.next() ||
+      query.value(0).toLongLong() != m_dataVersion)
+    return;
+  m_changeSeq = query.value(1).toLongLong();
+  m_logId = query.value(2).toInt();
+}
+
+/**
+ * @brief Publishes the writes other processes committed since the last poll.
+ *
+ * Notes and tasks are found through the sync change log, which triggers fill
+ * for every write path (see installChangeLog()). Each changed note is
+ * published once as a Notes event and each note whose tasks changed once as
+ * a NotesContents event, both with the Reloaded operation, so a burst of
+ * writes costs each view at most one refresh. Rows deleted by the other
+ * process are no longer here to say which note they belonged to; they are
+ * published with -1 for "any". New event log entries are published as
+ * ordinary inserts (or as one Reloaded event if there are more than
+ * maxExternalLogEvents), followed by a Reloaded EventRollups event.
+ *
+ * If this connection committed too since the last poll, its own changes
+ * may be published again; views treat that as a refresh of current data.
+ * Tags, recurrence rules, attachments and revision histories are not in
+ * the change log and are not followed.
+ */
+void DBManager::pollExternalChanges() {
+  if (m_transactionDepth > 0)
+    return;
+  TRACE_SPAN(span, "db");
+  QSqlQuery query(m_db);
+  if (!query.exec("PRAGMA data_version") || !query.next() ||
+      query.value(0).toLongLong() == m_dataVersion)
+    return;
+  m_dataVersion = query.value(0).toLongLong();
+  query.finish();
+
+  QMap<int, QString> notes;
+  QSet<int> taskNotes;
+  bool noteDeleted = false;
+  bool taskDeleted = false;
+  query.setForwardOnly(true);
+  query.prepare("SELECT c.seq, c.table_name, n.note_id, n.title, t.note_id "
+                "FROM ChangeLog c LEFT JOIN Notes n ON c.table_name IN "
+                "('Notes', 'Notes.sort_key') AND n.uuid = c.row_uuid LEFT "
+                "JOIN NotesContents t ON c.table_name IN ('NotesContents', "
+                "'NotesContents.sort_key') AND t.uuid = c.row_uuid WHERE "
+                "c.seq > :seq ORDER BY c.seq");
+  query.bindValue(":seq", m_changeSeq);
+  query.exec();
+  int changes = 0;
+  while (query.next()) {
+    m_changeSeq = query.value(0).toLongLong();
+    ++changes;
+    if (query.value(1).toString().section('.', 0, 0) ==
+        QLatin1String("Notes")) {
+      if (query.isNull(2))
+        noteDeleted = true;
+      else
+        notes.insert(query.value(2).toInt(), query.value(3).toString());
+    } else if (query.isNull(4)) {
+      taskDeleted = true;
+    } else {
+      taskNotes.insert(query.value(4).toInt());
+    }
+  }
+  span.setQuery(query, changes);
+  query.finish();
+
+  QList<int> logIds;
+  query.prepare("SELECT id FROM eventLogs WHERE id > :id ORDER BY id");
+  query.bindValue(":id", m_logId);
+  query.exec();
+  while (query.next())
+    logIds.append(query.value(0).toInt());
+  query.finish();
+  if (!logIds.isEmpty())
+    m_logId = logIds.last();
+
+  for (auto it = notes.cbegin(); it != notes.cend(); ++it)
+    emit changed({DBChangeEvent::Notes, DBChangeEvent::Reloaded, it.key(),
+                  it.key(), {{"title", it.value()}}});
+  if (noteDeleted)
+    emit changed({DBChangeEvent::Notes, DBChangeEvent::Reloaded, -1, -1, {}});
+  for (int noteId : qAsConst(taskNotes))
+    emit changed({DBChangeEvent::NotesContents, DBChangeEvent::Reloaded, -1,
+                  noteId, {}});
+  if (taskDeleted)
+    emit changed(
+        {DBChangeEvent::NotesContents, DBChangeEvent::Reloaded, -1, -1, {}});
+  if (logIds.size() > maxExternalLogEvents)
+    emit changed(
+        {DBChangeEvent::EventLogs, DBChangeEvent::Reloaded, -1, -1, {}});
+  else
+    for (int logId : qAsConst(logIds))
+      emit changed(
+          {DBChangeEvent::EventLogs, DBChangeEvent::Inserted, logId, -1, {}});
+  if (!logIds.isEmpty())
+    emit changed(
+        {DBChangeEvent::EventRollups, DBChangeEvent::Reloaded, -1, -1, {}});
+}
+
 /* ================== NOTES ================== */
 /**
  * @brief Adds a new note to the database.
  *
- * Inserts a note with the specified title into the Notes table.
+ * Inserts a note with the specified title into the Notes table, stamped with the
+ * current time in epoch milliseconds and ordered before every existing note.
  * If the insertion is successful, returns the ID of the newly inserted note.
  * If an error occurs during insertion, logs the error and returns -1.
  *
@@ -120,14 +814,27 @@ void DBManager::closeDB() {
  * @return int The ID of the newly inserted note, or -1 if an error occurred.
  */
 int DBManager::addNote(const QString &title) {
-  QSqlQuery query;
-  query.prepare("INSERT INTO Notes (title) VALUES (:title)");
+  TRACE_SPAN(span, "db");
+  QSqlQuery query(m_db);
+  QString firstKey;
+  if (query.exec("SELECT MIN(sort_key) FROM Notes") && query.next())
+    firstKey = query.value(0).toString();
+  const QString sortKey = OrderKey::between(QString(), firstKey);
+  query.prepare("INSERT INTO Notes (title, created_at, sort_key) VALUES "
+                "(:title, :created_at, :sort_key)");
   query.bindValue(":title", title);
-  if (!query.exec()) {
+  query.bindValue(":created_at", QDateTime::currentMSecsSinceEpoch());
+  query.bindValue(":sort_key", sortKey);
+  const bool ok = query.exec();
+  span.setQuery(query);
+  if (!ok) {
     qDebug() << "Add note error:" << query.lastError().text();
     return -1;
   }
-  return query.lastInsertId().toInt();
+  int noteId = query.lastInsertId().toInt();
+  publishChange({DBChangeEvent::Notes, DBChangeEvent::Inserted, noteId, noteId,
+                 {{"title", title}, {"sort_key", sortKey}}});
+  return noteId;
 }
 
 /**
@@ -141,34 +848,42 @@ int DBManager::addNote(const QString &title) {
  * @return true if the update was successful, false otherwise.
  */
 bool DBManager::updateNoteTitle(int noteId, const QString &newTitle) {
-  QSqlQuery query;
+  QSqlQuery query(m_db);
   query.prepare("UPDATE Notes SET title = :title WHERE note_id = :id");
   query.bindValue(":title", newTitle);
   query.bindValue(":id", noteId);
-  return query.exec();
+  if (!query.exec())
+    return false;
+  if (query.numRowsAffected() > 0)
+    publishChange({DBChangeEvent::Notes, DBChangeEvent::Updated, noteId,
+                   noteId, {{"title", newTitle}}});
+  return true;
 }
 
 /**
  * @brief Retrieves all notes from the database.
  *
  * Executes a SQL query to select all records from the Notes table,
- * ordered by the creation date in descending order. Each note is
+ * in the user-defined order given by their sort keys. Each note is
  * represented as a QVariantMap containing the note's ID, title,
- * and creation timestamp.
+ * creation timestamp and sort key.
  *
  * @return QList<QVariantMap> A list of notes, where each note is a QVariantMap
- *         with keys "note_id", "title", and "created_at".
+ *         with keys "note_id", "title", "created_at" and "sort_key".
  */
 QList<QVariantMap> DBManager::getAllNotes() {
+  TRACE_SPAN(span, "db");
   QList<QVariantMap> notes;
-  QSqlQuery query("SELECT * FROM Notes ORDER BY created_at DESC");
+  QSqlQuery query("SELECT * FROM Notes ORDER BY sort_key, note_id DESC", m_db);
   while (query.next()) {
     QVariantMap note;
     note["note_id"] = query.value("note_id");
     note["title"] = query.value("title");
     note["created_at"] = query.value("created_at");
+    note["sort_key"] = query.value("sort_key");
     notes.append(note);
   }
+  span.setQuery(query, notes.size());
   return notes;
 }
 
@@ -176,39 +891,108 @@ QList<QVariantMap> DBManager::getAllNotes() {
  * @brief Deletes a note from the database by its ID.
  *
  * This function prepares and executes a SQL DELETE statement to remove
- * the note with the specified noteId from the Notes table.
+ * the note with the specified noteId from the Notes table. The tags and
+ * recurrence rules of the note are removed in the same transaction.
  *
  * @param noteId The unique identifier of the note to be deleted.
  * @return true if the note was successfully deleted; false otherwise.
  */
 bool DBManager::deleteNote(int noteId) {
-  QSqlQuery query;
-  query.prepare("DELETE FROM Notes WHERE note_id = :id");
+  TRACE_SPAN(span, "db");
+  if (!beginTransaction())
+    return false;
+  QSqlQuery query(m_db);
+  query.prepare("DELETE FROM NoteTags WHERE note_id = :id");
+  query.bindValue(":id", noteId);
+  bool ok = query.exec();
+  if (ok) {
+    query.prepare("DELETE FROM RecurrenceRules WHERE note_id = :id");
+    query.bindValue(":id", noteId);
+    ok = query.exec();
+  }
+  if (ok) {
+    query.prepare("DELETE FROM Notes WHERE note_id = :id");
+    query.bindValue(":id", noteId);
+    ok = query.exec();
+  }
+  if (!ok) {
+    rollbackTransaction();
+    return false;
+  }
+  if (query.numRowsAffected() > 0)
+    publishChange(
+        {DBChangeEvent::Notes, DBChangeEvent::Deleted, noteId, noteId, {}});
+  return commitTransaction();
+}
+
+/**
+ * @brief Retrieves a single note from the database by its ID.
+ *
+ * @param noteId The unique identifier of the note.
+ * @return QVariantMap with keys "note_id", "title", "created_at" and "sort_key", or an empty map if no note is found.
+ */
+QVariantMap DBManager::getNote(int noteId) {
+  QVariantMap note;
+  QSqlQuery query(m_db);
+  query.prepare("SELECT * FROM Notes WHERE note_id = :id");
   query.bindValue(":id", noteId);
-  return query.exec();
+  if (query.exec() && query.next()) {
+    note["note_id"] = query.value("note_id");
+    note["title"] = query.value("title");
+    note["created_at"] = query.value("created_at");
+    note["sort_key"] = query.value("sort_key");
+  }
+  return note;
 }
 
 /* ================== NOTES CONTENT ================== */
 /**
  * @brief Adds content to a note in the database.
  *
- * Inserts a new entry into the NotesContents table with the specified note ID and content.
+ * Inserts a new entry into the NotesContents table with the specified note ID and content,
+ * stamped with the current time in epoch milliseconds and ordered after its siblings.
  *
  * @param noteId The ID of the note to which the content will be added.
  * @param content The content to be added to the note.
+ * @param parentId The task this content is a sub-task of, or -1 for a top-level task.
  * @return The ID of the newly inserted note content on success, or -1 if the operation fails.
  */
-int DBManager::addNoteContent(int noteId, const QString &content) {
-  QSqlQuery query;
-  query.prepare("INSERT INTO NotesContents (note_id, content) VALUES "
-                "(:note_id, :content)");
+int DBManager::addNoteContent(int noteId, const QString &content,
+                              int parentId) {
+  TRACE_SPAN(span, "db");
+  const QVariant parent = parentId < 0 ? QVariant() : QVariant(parentId);
+  QSqlQuery query(m_db);
+  query.prepare("SELECT MAX(sort_key) FROM NotesContents WHERE note_id = "
+                ":note_id AND parent_id IS :parent_id");
+  query.bindValue(":note_id", noteId);
+  query.bindValue(":parent_id", parent);
+  QString lastKey;
+  if (query.exec() && query.next())
+    lastKey = query.value(0).toString();
+  const QString sortKey = OrderKey::between(lastKey, QString());
+
+  query.prepare("INSERT INTO NotesContents (note_id, content, created_at, "
+                "parent_id, sort_key) VALUES (:note_id, :content, "
+                ":created_at, :parent_id, :sort_key)");
   query.bindValue(":note_id", noteId);
   query.bindValue(":content", content);
-  if (!query.exec()) {
+  query.bindValue(":created_at", QDateTime::currentMSecsSinceEpoch());
+  query.bindValue(":parent_id", parent);
+  query.bindValue(":sort_key", sortKey);
+  const bool ok = query.exec();
+  span.setQuery(query);
+  if (!ok) {
     qDebug() << "Add note content error:" << query.lastError().text();
     return -1;
   }
-  return query.lastInsertId().toInt();
+  int contentId = query.lastInsertId().toInt();
+  publishChange({DBChangeEvent::NotesContents, DBChangeEvent::Inserted,
+                 contentId, noteId,
+                 {{"content", content},
+                  {"completed", false},
+                  {"parent_id", parentId},
+                  {"sort_key", sortKey}}});
+  return contentId;
 }
 
 /**
@@ -221,29 +1005,85 @@ int DBManager::addNoteContent(int noteId, const QString &content) {
  * @return true if the update was successful, false otherwise.
  */
 bool DBManager::updateNoteContent(int contentId, bool completed) {
-  QSqlQuery query;
+  TRACE_SPAN(span, "db");
+  QSqlQuery query(m_db);
   query.prepare("UPDATE NotesContents SET completed = "
                 ":completed WHERE id = :id");
   query.bindValue(":completed", completed);
   query.bindValue(":id", contentId);
-  return query.exec();
+  const bool ok = query.exec();
+  span.setQuery(query);
+  if (!ok)
+    return false;
+  if (query.numRowsAffected() > 0)
+    publishChange({DBChangeEvent::NotesContents, DBChangeEvent::Updated,
+                   contentId, -1, {{"completed", completed}}});
+  return true;
+}
+
+/**
+ * @brief Replaces the text of a note content and records the edit in its revision history.
+ *
+ * The previous text and the new one are kept in ContentRevisions (see
+ * addContentRevision()) in the same transaction as the update, so the history
+ * always ends with the current text. Setting the text it already has does
+ * nothing.
+ *
+ * @param contentId The unique identifier of the note content to update.
+ * @param content The new text.
+ * @return true if the text was updated (or unchanged), false otherwise.
+ */
+bool DBManager::updateNoteContentText(int contentId, const QString &content) {
+  TRACE_SPAN(span, "db");
+  if (!beginTransaction())
+    return false;
+  QSqlQuery query(m_db);
+  query.prepare("SELECT content FROM NotesContents WHERE id = :id");
+  query.bindValue(":id", contentId);
+  if (!query.exec() || !query.next()) {
+    rollbackTransaction();
+    return false;
+  }
+  const QString previous = query.value(0).toString();
+  query.finish();
+  if (previous == content)
+    return commitTransaction();
+
+  bool ok = addContentRevision(contentId, previous, content);
+  if (ok) {
+    query.prepare("UPDATE NotesContents SET content = :content WHERE id = :id");
+    query.bindValue(":content", content);
+    query.bindValue(":id", contentId);
+    ok = query.exec();
+    span.setQuery(query);
+  }
+  if (!ok) {
+    qDebug() << "Update note content error:" << query.lastError().text();
+    rollbackTransaction();
+    return false;
+  }
+  publishChange({DBChangeEvent::NotesContents, DBChangeEvent::Updated,
+                 contentId, -1, {{"content", content}}});
+  return commitTransaction();
 }
 
 /**
  * @brief Retrieves the contents of a specific note from the database.
  *
- * This function queries the NotesContents table for all entries associated with the given
- * note ID, ordered by their creation time in ascending order. Each entry is returned as a
- * QVariantMap containing the fields: id, note_id, content, completed, and created_at.
+ * This function queries the NotesContents table for all top-level entries (sub-tasks and
+ * materialized occurrences of recurring tasks are excluded) associated with the given note ID, in the user-defined order given by their sort keys. Each entry is returned as a
+ * QVariantMap containing the fields: id, note_id, content, completed, created_at, sort_key and due_at
+ * (epoch milliseconds, or null when the task has no due date).
  *
  * @param noteId The ID of the note whose contents are to be retrieved.
  * @return QList<QVariantMap> A list of QVariantMap objects, each representing a content entry.
  */
 QList<QVariantMap> DBManager::getNoteContents(int noteId) {
+  TRACE_SPAN(span, "db");
   QList<QVariantMap> contents;
-  QSqlQuery query;
-  query.prepare("SELECT * FROM NotesContents WHERE note_id = :note_id ORDER BY "
-                "created_at ASC");
+  QSqlQuery query(m_db);
+  query.prepare("SELECT * FROM NotesContents WHERE note_id = :note_id AND "
+                "parent_id IS NULL AND rule_id IS NULL ORDER BY sort_key, id");
   query.bindValue(":note_id", noteId);
   query.exec();
   while (query.next()) {
@@ -253,8 +1093,11 @@ QList<QVariantMap> DBManager::getNoteContents(int noteId) {
     content["content"] = query.value("content");
     content["completed"] = query.value("completed");
     content["created_at"] = query.value("created_at");
+    content["sort_key"] = query.value("sort_key");
+    content["due_at"] = query.value("due_at");
     contents.append(content);
   }
+  span.setQuery(query, contents.size());
   return contents;
 }
 
@@ -268,87 +1111,1133 @@ QList<QVariantMap> DBManager::getNoteContents(int noteId) {
  * @return The title of the note as a QString. Returns an empty string if no note is found.
  */
 QString DBManager::getNoteName(int noteId) {
+  TRACE_SPAN(span, "db");
   QString name;
-  QSqlQuery query;
+  QSqlQuery query(m_db);
   query.prepare("SELECT title FROM Notes WHERE note_id = :note_id");
   query.bindValue(":note_id", noteId);
   query.exec();
   while (query.next()) {
     name = query.value("title").toString();
   }
+  span.setQuery(query, name.isNull() ? 0 : 1);
   return name;
 }
 
 /**
- * @brief Deletes a note content from the database by its ID.
+ * @brief Deletes a note content and all of its sub-tasks from the database.
  *
- * This function prepares and executes a SQL DELETE statement to remove
- * the note content with the specified ID from the NotesContents table.
+ * The IDs of the subtree are collected with a recursive CTE and the whole
+ * subtree (and its tags) is then removed with recursive DELETE statements,
+ * inside one transaction. A change event is published for every deleted row.
+ * Attachments of the deleted tasks are released by a trigger, and files no
+ * longer referenced are collected once the transaction is committed.
  *
  * @param contentId The unique identifier of the note content to delete.
  * @return true if the deletion was successful, false otherwise.
  */
 bool DBManager::deleteNoteContent(int contentId) {
-  QSqlQuery query;
-  query.prepare("DELETE FROM NotesContents WHERE id = :id");
-  query.bindValue(":id", contentId);
-  return query.exec();
+  TRACE_SPAN(span, "db");
+  if (!beginTransaction())
+    return false;
+  QList<int> ids;
+  if (!removeTaskSubtree(contentId, ids)) {
+    rollbackTransaction();
+    return false;
+  }
+  if (!commitTransaction())
+    return false;
+  scheduleAttachmentGarbageCollection();
+  return true;
 }
 
 /**
- * @brief Deletes all contents associated with a specific note from the NotesContents table.
+ * @brief Deletes a task, its sub-tasks and their tags, without a transaction.
  *
- * This function executes a SQL DELETE statement to remove all rows in the NotesContents table
- * that are linked to the provided note ID.
- *
- * @param noteID The ID of the note whose contents should be deleted.
- * @return true if the deletion was successful, false otherwise.
- */
-bool DBManager::deleteAllNoteContents(int noteID) {
-  QSqlQuery query;
-  query.prepare("DELETE FROM NotesContents WHERE note_id = :id");
-  query.bindValue(":id", noteID);
-  return query.exec();
-}
-/* ================== EVENT LOGS ================== */
-/**
- * @brief Adds a new event log entry to the database.
+ * A Deleted event is published for every removed task, children first, so
+ * subscribers never see a child whose parent is gone. The event of
+ * @p contentId itself carries its "parent_id" (-1 for a top-level task), so
+ * views that never loaded it can still find the loaded ancestors to update.
  *
- * Inserts a record into the `eventLogs` table with the specified event type and description.
+ * With a @p limit, at most that many tasks are deleted: the deepest ones,
+ * children before parents, so the rest of the subtree stays connected to
+ * @p contentId and a later call carries on where this one stopped. The
+ * subtree is gone once @p contentId itself is among the removed IDs.
  *
- * @param eventType The type of the event to log.
- * @param eventDescription A description of the event.
- * @return The ID of the newly inserted event log entry on success, or -1 if the operation fails.
+ * @param contentId The task to delete. Nothing is deleted if it does not exist.
+ * @param removedIds Receives the IDs of the deleted tasks, parents before children.
+ * @param limit Maximum number of tasks to delete, or -1 for the whole subtree.
+ * @return true if the statements succeeded, false otherwise.
  */
-int DBManager::addEventLog(const QString &eventType,
-                           const QString &eventDescription) {
-  QSqlQuery query;
-  query.prepare("INSERT INTO eventLogs (event_type, event_description) VALUES "
-                "(:type, :desc)");
-  query.bindValue(":type", eventType);
-  query.bindValue(":desc", eventDescription);
-  if (!query.exec()) {
-    qDebug() << "Add log error:" << query.lastError().text();
-    return -1;
+bool DBManager::removeTaskSubtree(int contentId, QList<int> &removedIds,
+                                  int limit) {
+  static const QString subtree =
+      "WITH RECURSIVE subtree(id) AS (SELECT id FROM NotesContents WHERE id = "
+      ":id UNION ALL SELECT c.id FROM NotesContents c JOIN subtree s ON "
+      "c.parent_id = s.id) ";
+  QSqlQuery query(m_db);
+  query.prepare(subtree + "SELECT s.id, c.parent_id FROM subtree s JOIN "
+                          "NotesContents c ON c.id = s.id");
+  query.bindValue(":id", contentId);
+  bool ok = query.exec();
+  QList<int> ids;
+  QVariant parentId;
+  while (ok && query.next()) {
+    ids.append(query.value(0).toInt());
+    if (ids.last() == contentId)
+      parentId = query.value(1);
+  }
+  query.finish();
+
+  // Any tail of a parents-before-children list holds the children of each
+  // of its tasks, so deleting it never leaves a task without its parent.
+  const bool partial = limit >= 0 && ids.size() > limit;
+  if (partial)
+    ids = ids.mid(ids.size() - limit);
+  QStringList idList;
+  for (int id : qAsConst(ids))
+    idList.append(QString::number(id));
+  const QString inList = QString(" IN (%1)").arg(idList.join(','));
+
+  if (ok && partial && !ids.isEmpty()) {
+    ok = query.exec("DELETE FROM TaskTags WHERE content_id" + inList) &&
+         query.exec("DELETE FROM NotesContents WHERE id" + inList);
+  } else if (ok && !partial) {
+    query.prepare(subtree + "DELETE FROM TaskTags WHERE content_id IN subtree");
+    query.bindValue(":id", contentId);
+    ok = query.exec();
+    if (ok) {
+      query.prepare(subtree + "DELETE FROM NotesContents WHERE id IN subtree");
+      query.bindValue(":id", contentId);
+      ok = query.exec();
+    }
+  }
+  if (!ok) {
+    qDebug() << "Delete note content error:" << query.lastError().text();
+    return false;
   }
-  return query.lastInsertId().toInt();
+  removedIds.append(ids);
+  for (int i = ids.size() - 1; i >= 0; --i) {
+    QVariantMap values;
+    if (ids.at(i) == contentId)
+      values.insert("parent_id", parentId.isNull() ? -1 : parentId.toInt());
+    publishChange({DBChangeEvent::NotesContents, DBChangeEvent::Deleted,
+                   ids.at(i), -1, values});
+  }
+  return true;
 }
 
 /**
- * @brief Retrieves all event logs from the database.
+ * @brief Retrieves one page of the direct children of a task.
  *
- * Executes a SQL query to select all records from the eventLogs table,
- * ordered by the creation timestamp in descending order. Each record is
- * mapped to a QVariantMap containing the following keys: "id", "event_type",
- * "event_description", and "created_at". The method returns a QList of these
- * QVariantMap objects.
+ * Each entry is a QVariantMap with the fields id, note_id, parent_id, content,
+ * completed, created_at, sort_key, due_at and child_count (number of direct children,
+ * used by tree views to show an expander without loading the subtree). Pages
+ * are fetched by keyset on (sort_key, id), so fetching a page costs the same
+ * wherever it is in the list.
  *
- * @return QList<QVariantMap> List of event logs, each represented as a QVariantMap.
+ * @param noteId The ID of the note the tasks belong to.
+ * @param parentId The parent task, or -1 for the top-level tasks of the note.
+ * @param afterKey Sort key of the last child of the previous page; empty or null for the first page.
+ * @param afterId ID of the last child of the previous page; -1 for the first page.
+ * @param limit Maximum number of children to return.
+ * @return QList<QVariantMap> The children in their user-defined order.
  */
-QList<QVariantMap> DBManager::getEventLogs() {
-  QList<QVariantMap> logs;
-  QSqlQuery query("SELECT * FROM eventLogs ORDER BY created_at DESC");
-  while (query.next()) {
+QList<QVariantMap> DBManager::getChildContents(int noteId, int parentId,
+                                               const QString &afterKey,
+                                               int afterId, int limit) {
+  TRACE_SPAN(span, "db");
+  QList<QVariantMap> contents;
+  QSqlQuery query(m_db);
+  query.prepare(
+      QStringLiteral(
+          "SELECT n.*, (SELECT COUNT(*) FROM NotesContents c WHERE "
+          "c.parent_id = n.id) AS child_count FROM NotesContents n WHERE "
+          "n.note_id = :note_id AND %1 AND (n.sort_key, n.id) > (:after_key, "
+          ":after_id) ORDER BY n.sort_key, n.id LIMIT :limit")
+          .arg(parentId < 0 ? "n.parent_id IS NULL AND n.rule_id IS NULL"
+                            : "n.parent_id = :parent_id"));
+  query.bindValue(":note_id", noteId);
+  if (parentId >= 0)
+    query.bindValue(":parent_id", parentId);
+  // A null string binds as SQL NULL, which compares false with every row.
+  query.bindValue(":after_key", afterKey.isNull() ? QString("") : afterKey);
+  query.bindValue(":after_id", afterId);
+  query.bindValue(":limit", limit);
+  query.exec();
+  while (query.next()) {
+    QVariantMap content;
+    content["id"] = query.value("id");
+    content["note_id"] = query.value("note_id");
+    content["parent_id"] = query.value("parent_id");
+    content["content"] = query.value("content");
+    content["completed"] = query.value("completed");
+    content["created_at"] = query.value("created_at");
+    content["sort_key"] = query.value("sort_key");
+    content["due_at"] = query.value("due_at");
+    content["child_count"] = query.value("child_count");
+    contents.append(content);
+  }
+  span.setQuery(query, contents.size());
+  return contents;
+}
+
+/**
+ * @brief Counts the direct children of a task.
+ *
+ * @param noteId The ID of the note the tasks belong to.
+ * @param parentId The parent task, or -1 for the top-level tasks of the note.
+ * @return The number of direct children.
+ */
+int DBManager::countChildContents(int noteId, int parentId) {
+  QSqlQuery query(m_db);
+  query.prepare(QStringLiteral("SELECT COUNT(*) FROM NotesContents WHERE "
+                               "note_id = :note_id AND %1")
+                    .arg(parentId < 0 ? "parent_id IS NULL AND rule_id IS NULL"
+                                      : "parent_id = :parent_id"));
+  query.bindValue(":note_id", noteId);
+  if (parentId >= 0)
+    query.bindValue(":parent_id", parentId);
+  if (query.exec() && query.next())
+    return query.value(0).toInt();
+  return 0;
+}
+
+/**
+ * @brief Returns the keyset position of the child a given number of rows after another.
+ *
+ * Lets a pager start a page far from any page it has fetched. The search
+ * seeks to (@p afterKey, @p afterId) and skips @p offset rows of the
+ * (note_id, parent_id, sort_key) index from there, so it costs time
+ * proportional to @p offset: callers remember positions along the way and
+ * start from the nearest one (see TaskWindow).
+ *
+ * @param noteId The ID of the note the tasks belong to.
+ * @param parentId The parent task, or -1 for the top-level tasks of the note.
+ * @param afterKey Sort key of the known child; empty or null to count from the first child.
+ * @param afterId ID of the known child; -1 to count from the first child.
+ * @param offset Number of children to skip after the known one.
+ * @return QVariantMap with the keys "sort_key" and "id", or an empty map if there is no such child.
+ */
+QVariantMap DBManager::getChildContentKeyAt(int noteId, int parentId,
+                                            const QString &afterKey,
+                                            int afterId, int offset) {
+  TRACE_SPAN(span, "db");
+  QVariantMap key;
+  QSqlQuery query(m_db);
+  query.prepare(
+      QStringLiteral("SELECT sort_key, id FROM NotesContents WHERE note_id = "
+                     ":note_id AND %1 AND (sort_key, id) > (:after_key, "
+                     ":after_id) ORDER BY sort_key, id LIMIT 1 OFFSET :offset")
+          .arg(parentId < 0 ? "parent_id IS NULL AND rule_id IS NULL"
+                            : "parent_id = :parent_id"));
+  query.bindValue(":note_id", noteId);
+  if (parentId >= 0)
+    query.bindValue(":parent_id", parentId);
+  query.bindValue(":after_key", afterKey.isNull() ? QString("") : afterKey);
+  query.bindValue(":after_id", afterId);
+  query.bindValue(":offset", offset);
+  if (query.exec() && query.next()) {
+    key["sort_key"] = query.value("sort_key");
+    key["id"] = query.value("id");
+  }
+  span.setQuery(query, key.isEmpty() ? 0 : 1);
+  return key;
+}
+
+/**
+ * @brief Counts all descendants of a task and how many of them are completed.
+ *
+ * Uses a single recursive CTE over the parent_id index.
+ *
+ * @param contentId The task whose subtree is counted (the task itself is excluded).
+ * @return QVariantMap with keys "total" and "completed".
+ */
+QVariantMap DBManager::getSubtreeStats(int contentId) {
+  QVariantMap stats{{"total", 0}, {"completed", 0}};
+  QSqlQuery query(m_db);
+  query.prepare(
+      "WITH RECURSIVE subtree(id) AS (SELECT id FROM NotesContents WHERE "
+      "parent_id = :id UNION ALL SELECT c.id FROM NotesContents c JOIN "
+      "subtree s ON c.parent_id = s.id) SELECT COUNT(*), "
+      "COALESCE(SUM(c.completed), 0) FROM subtree JOIN NotesContents c ON "
+      "c.id = subtree.id");
+  query.bindValue(":id", contentId);
+  if (query.exec() && query.next()) {
+    stats["total"] = query.value(0);
+    stats["completed"] = query.value(1);
+  }
+  return stats;
+}
+
+/**
+ * @brief Lists the ancestors of a task, nearest first.
+ *
+ * Walks parent_id upwards with one recursive CTE. Tree views use it to find
+ * the loaded ancestors of a changed task they have not loaded themselves.
+ *
+ * @param contentId The task whose ancestors are listed (the task itself is excluded).
+ * @return The IDs of its parent, grandparent and so on up to a top-level task.
+ */
+QList<int> DBManager::getTaskAncestors(int contentId) {
+  TRACE_SPAN(span, "db");
+  QList<int> ancestors;
+  QSqlQuery query(m_db);
+  query.prepare(
+      "WITH RECURSIVE up(id, depth) AS (SELECT parent_id, 0 FROM NotesContents "
+      "WHERE id = :id UNION ALL SELECT c.parent_id, up.depth + 1 FROM "
+      "NotesContents c JOIN up ON c.id = up.id) SELECT id FROM up WHERE id IS "
+      "NOT NULL ORDER BY depth");
+  query.bindValue(":id", contentId);
+  if (query.exec()) {
+    while (query.next())
+      ancestors.append(query.value(0).toInt());
+  }
+  span.setQuery(query, ancestors.size());
+  return ancestors;
+}
+
+/**
+ * @brief Deletes all contents associated with a specific note from the NotesContents table.
+ *
+ * This function executes a SQL DELETE statement to remove all rows in the NotesContents table
+ * that are linked to the provided note ID, together with their tags, in one transaction.
+ * Their attachments are released and collected as in deleteNoteContent().
+ *
+ * @param noteID The ID of the note whose contents should be deleted.
+ * @return true if the deletion was successful, false otherwise.
+ */
+bool DBManager::deleteAllNoteContents(int noteID) {
+  TRACE_SPAN(span, "db");
+  if (!beginTransaction())
+    return false;
+  QSqlQuery query(m_db);
+  query.prepare("DELETE FROM TaskTags WHERE content_id IN (SELECT id FROM "
+                "NotesContents WHERE note_id = :id)");
+  query.bindValue(":id", noteID);
+  bool ok = query.exec();
+  if (ok) {
+    query.prepare("DELETE FROM NotesContents WHERE note_id = :id");
+    query.bindValue(":id", noteID);
+    ok = query.exec();
+  }
+  if (!ok) {
+    rollbackTransaction();
+    return false;
+  }
+  if (query.numRowsAffected() > 0)
+    publishChange(
+        {DBChangeEvent::NotesContents, DBChangeEvent::Deleted, -1, noteID, {}});
+  if (!commitTransaction())
+    return false;
+  scheduleAttachmentGarbageCollection();
+  return true;
+}
+
+/* ================== RECURRING TASKS ================== */
+/**
+ * @brief Adds a recurrence rule to a note.
+ *
+ * No task rows are created: occurrences are computed from the rule for the
+ * window a model shows, and only written with materializeOccurrence() when
+ * the user changes one.
+ *
+ * @param noteId The note the recurring task belongs to.
+ * @param content The text of every occurrence.
+ * @param startAtMsecs First occurrence, in epoch milliseconds.
+ * @param frequency "DAILY", "WEEKLY" or "MONTHLY".
+ * @param interval Repeat every @p interval days, weeks or months.
+ * @param weekdays For weekly rules, bit mask of weekdays (Monday = 1 ... Sunday = 64); 0 for the start day.
+ * @param untilMsecs Last possible occurrence, or -1 for none.
+ * @return The ID of the new rule, or -1 if an error occurred.
+ */
+int DBManager::addRecurrenceRule(int noteId, const QString &content,
+                                 qint64 startAtMsecs, const QString &frequency,
+                                 int interval, int weekdays,
+                                 qint64 untilMsecs) {
+  QSqlQuery query(m_db);
+  query.prepare("INSERT INTO RecurrenceRules (note_id, content, start_at, "
+                "frequency, interval, weekdays, until_at) VALUES (:note_id, "
+                ":content, :start_at, :frequency, :interval, :weekdays, "
+                ":until_at)");
+  query.bindValue(":note_id", noteId);
+  query.bindValue(":content", content);
+  query.bindValue(":start_at", startAtMsecs);
+  query.bindValue(":frequency", frequency);
+  query.bindValue(":interval", interval);
+  query.bindValue(":weekdays", weekdays);
+  query.bindValue(":until_at",
+                  untilMsecs < 0 ? QVariant() : QVariant(untilMsecs));
+  if (!query.exec()) {
+    qDebug() << "Add recurrence rule error:" << query.lastError().text();
+    return -1;
+  }
+  int ruleId = query.lastInsertId().toInt();
+  publishChange({DBChangeEvent::RecurrenceRules, DBChangeEvent::Inserted,
+                 ruleId, noteId, {{"content", content}}});
+  return ruleId;
+}
+
+/**
+ * @brief Retrieves the recurrence rules of a note.
+ *
+ * @param noteId The note.
+ * @return QList<QVariantMap> The rules, with keys "rule_id", "note_id", "content", "start_at",
+ *         "frequency", "interval", "weekdays" and "until_at".
+ */
+QList<QVariantMap> DBManager::getRecurrenceRules(int noteId) {
+  QList<QVariantMap> rules;
+  QSqlQuery query(m_db);
+  query.prepare("SELECT * FROM RecurrenceRules WHERE note_id = :note_id "
+                "ORDER BY rule_id");
+  query.bindValue(":note_id", noteId);
+  query.exec();
+  while (query.next()) {
+    QVariantMap rule;
+    for (const char *column : {"rule_id", "note_id", "content", "start_at",
+                               "frequency", "interval", "weekdays",
+                               "until_at"})
+      rule[column] = query.value(column);
+    rules.append(rule);
+  }
+  return rules;
+}
+
+/**
+ * @brief Deletes a recurrence rule.
+ *
+ * Occurrences that were already materialized stay as ordinary tasks of the
+ * note, so completed history is kept; the ordering keys of the note are
+ * rewritten so they take a place in the list.
+ *
+ * @param ruleId The rule to delete.
+ * @return true if the deletion was successful, false otherwise.
+ */
+bool DBManager::deleteRecurrenceRule(int ruleId) {
+  if (!beginTransaction())
+    return false;
+  QSqlQuery query(m_db);
+  query.prepare("SELECT note_id FROM RecurrenceRules WHERE rule_id = :id");
+  query.bindValue(":id", ruleId);
+  const int noteId = query.exec() && query.next() ? query.value(0).toInt() : -1;
+  query.finish();
+  query.prepare("UPDATE NotesContents SET rule_id = NULL, occurrence_at = "
+                "NULL WHERE rule_id = :id");
+  query.bindValue(":id", ruleId);
+  bool ok = query.exec();
+  if (ok && query.numRowsAffected() > 0)
+    ok = rewriteSortKeys("NotesContents", "id",
+                         "WHERE note_id = :note_id AND parent_id IS NULL AND "
+                         "rule_id IS NULL ORDER BY sort_key IS NULL, sort_key, "
+                         "id",
+                         noteId);
+  if (ok) {
+    query.prepare("DELETE FROM RecurrenceRules WHERE rule_id = :id");
+    query.bindValue(":id", ruleId);
+    ok = query.exec();
+  }
+  if (!ok) {
+    qDebug() << "Delete recurrence rule error:" << query.lastError().text();
+    rollbackTransaction();
+    return false;
+  }
+  if (query.numRowsAffected() > 0)
+    publishChange({DBChangeEvent::RecurrenceRules, DBChangeEvent::Deleted,
+                   ruleId, noteId, {}});
+  return commitTransaction();
+}
+
+/**
+ * @brief Writes one occurrence of a recurring task as a NotesContents row.
+ *
+ * The row is linked to its rule and occurrence time (unique per rule), so
+ * models show it in place of the computed occurrence.
+ *
+ * @param ruleId The recurrence rule.
+ * @param occurrenceAtMsecs Time of the occurrence, in epoch milliseconds.
+ * @param completed Completion status of the occurrence.
+ * @return The ID of the new task, or -1 if an error occurred.
+ */
+int DBManager::materializeOccurrence(int ruleId, qint64 occurrenceAtMsecs,
+                                     bool completed) {
+  TRACE_SPAN(span, "db");
+  QSqlQuery query(m_db);
+  query.prepare("SELECT note_id, content FROM RecurrenceRules WHERE rule_id = "
+                ":id");
+  query.bindValue(":id", ruleId);
+  if (!query.exec() || !query.next())
+    return -1;
+  const int noteId = query.value(0).toInt();
+  const QString content = query.value(1).toString();
+  query.finish();
+
+  query.prepare("INSERT INTO NotesContents (note_id, content, completed, "
+                "created_at, rule_id, occurrence_at) VALUES (:note_id, "
+                ":content, :completed, :created_at, :rule_id, :occurrence_at)");
+  query.bindValue(":note_id", noteId);
+  query.bindValue(":content", content);
+  query.bindValue(":completed", completed);
+  query.bindValue(":created_at", QDateTime::currentMSecsSinceEpoch());
+  query.bindValue(":rule_id", ruleId);
+  query.bindValue(":occurrence_at", occurrenceAtMsecs);
+  const bool ok = query.exec();
+  span.setQuery(query);
+  if (!ok) {
+    qDebug() << "Materialize occurrence error:" << query.lastError().text();
+    return -1;
+  }
+  int contentId = query.lastInsertId().toInt();
+  publishChange({DBChangeEvent::NotesContents, DBChangeEvent::Inserted,
+                 contentId, noteId,
+                 {{"content", content},
+                  {"completed", completed},
+                  {"parent_id", -1},
+                  {"rule_id", ruleId},
+                  {"occurrence_at", occurrenceAtMsecs}}});
+  return contentId;
+}
+
+/**
+ * @brief Retrieves the materialized occurrences of a note in a time range.
+ *
+ * @param noteId The note.
+ * @param fromMsecs Start of the range (inclusive), in epoch milliseconds.
+ * @param toMsecs End of the range (exclusive), in epoch milliseconds.
+ * @return QList<QVariantMap> The occurrences, with keys "id", "rule_id", "occurrence_at",
+ *         "content", "completed" and "due_at".
+ */
+QList<QVariantMap> DBManager::getOccurrenceContents(int noteId,
+                                                    qint64 fromMsecs,
+                                                    qint64 toMsecs) {
+  TRACE_SPAN(span, "db");
+  QList<QVariantMap> contents;
+  QSqlQuery query(m_db);
+  query.prepare("SELECT c.id, c.rule_id, c.occurrence_at, c.content, "
+                "c.completed, c.due_at FROM NotesContents c JOIN "
+                "RecurrenceRules r ON r.rule_id = c.rule_id WHERE r.note_id = "
+                ":note_id AND c.occurrence_at >= :from AND c.occurrence_at < "
+                ":to");
+  query.bindValue(":note_id", noteId);
+  query.bindValue(":from", fromMsecs);
+  query.bindValue(":to", toMsecs);
+  query.exec();
+  while (query.next()) {
+    QVariantMap content;
+    content["id"] = query.value("id");
+    content["rule_id"] = query.value("rule_id");
+    content["occurrence_at"] = query.value("occurrence_at");
+    content["content"] = query.value("content");
+    content["completed"] = query.value("completed");
+    content["due_at"] = query.value("due_at");
+    contents.append(content);
+  }
+  span.setQuery(query, contents.size());
+  return contents;
+}
+
+/* ================== DUE DATES ================== */
+/**
+ * @brief Sets or clears the due date of a task.
+ *
+ * @param contentId The task.
+ * @param dueAtMsecs Due date in epoch milliseconds, or -1 to clear it.
+ * @return true if the update was successful, false otherwise.
+ */
+bool DBManager::setNoteContentDueAt(int contentId, qint64 dueAtMsecs) {
+  QSqlQuery query(m_db);
+  query.prepare("UPDATE NotesContents SET due_at = :due_at WHERE id = :id");
+  query.bindValue(":due_at",
+                  dueAtMsecs < 0 ? QVariant() : QVariant(dueAtMsecs));
+  query.bindValue(":id", contentId);
+  if (!query.exec())
+    return false;
+  if (query.numRowsAffected() > 0)
+    publishChange({DBChangeEvent::NotesContents, DBChangeEvent::Updated,
+                   contentId, -1, {{"due_at", dueAtMsecs}}});
+  return true;
+}
+
+/**
+ * @brief Retrieves the next deadlines of open tasks, in due date order.
+ *
+ * Pages are fetched by keyset on (due_at, id) over a partial index that only
+ * holds open tasks with a due date, so the cost of a page does not depend on
+ * how many tasks are scheduled.
+ *
+ * @param afterDueAt Due date of the last deadline of the previous page.
+ * @param afterId Task ID of the last deadline of the previous page (-1 to include every task due at @p afterDueAt).
+ * @param limit Maximum number of deadlines to return.
+ * @return QList<QVariantMap> The deadlines, with keys "id" and "due_at".
+ */
+QList<QVariantMap> DBManager::getUpcomingDeadlines(qint64 afterDueAt,
+                                                   int afterId, int limit) {
+  TRACE_SPAN(span, "db");
+  QList<QVariantMap> deadlines;
+  QSqlQuery query(m_db);
+  query.setForwardOnly(true);
+  query.prepare("SELECT id, due_at FROM NotesContents WHERE due_at IS NOT "
+                "NULL AND completed = 0 AND (due_at, id) > (:after_due, "
+                ":after_id) ORDER BY due_at, id LIMIT :limit");
+  query.bindValue(":after_due", afterDueAt);
+  query.bindValue(":after_id", afterId);
+  query.bindValue(":limit", limit);
+  query.exec();
+  while (query.next()) {
+    QVariantMap deadline;
+    deadline["id"] = query.value(0);
+    deadline["due_at"] = query.value(1);
+    deadlines.append(deadline);
+  }
+  span.setQuery(query, deadlines.size());
+  return deadlines;
+}
+
+/* ================== ORDERING ================== */
+/**
+ * @brief Moves a note by giving it a new ordering key.
+ *
+ * Only this row is written; the key is normally computed with
+ * OrderKey::between() from the keys of the new neighbours.
+ *
+ * @param noteId The note to move.
+ * @param sortKey Its new ordering key.
+ * @return true if the update was successful, false otherwise.
+ */
+bool DBManager::setNoteSortKey(int noteId, const QString &sortKey) {
+  QSqlQuery query(m_db);
+  query.prepare("UPDATE Notes SET sort_key = :sort_key WHERE note_id = :id");
+  query.bindValue(":sort_key", sortKey);
+  query.bindValue(":id", noteId);
+  if (!query.exec())
+    return false;
+  if (query.numRowsAffected() > 0)
+    publishChange({DBChangeEvent::Notes, DBChangeEvent::Updated, noteId,
+                   noteId, {{"sort_key", sortKey}}});
+  return true;
+}
+
+/**
+ * @brief Moves a task among its siblings by giving it a new ordering key.
+ *
+ * @param contentId The task to move.
+ * @param sortKey Its new ordering key.
+ * @return true if the update was successful, false otherwise.
+ */
+bool DBManager::setNoteContentSortKey(int contentId, const QString &sortKey) {
+  TRACE_SPAN(span, "db");
+  QSqlQuery query(m_db);
+  query.prepare(
+      "UPDATE NotesContents SET sort_key = :sort_key WHERE id = :id");
+  query.bindValue(":sort_key", sortKey);
+  query.bindValue(":id", contentId);
+  const bool ok = query.exec();
+  span.setQuery(query);
+  if (!ok)
+    return false;
+  if (query.numRowsAffected() > 0)
+    publishChange({DBChangeEvent::NotesContents, DBChangeEvent::Updated,
+                   contentId, -1, {{"sort_key", sortKey}}});
+  return true;
+}
+
+/**
+ * @brief Rewrites the ordering keys of all notes with short, evenly spaced keys.
+ *
+ * The order is unchanged. A single Updated event with rowId -1 is published,
+ * after which subscribers re-read the keys they hold.
+ *
+ * @return true if the keys were rewritten, false otherwise.
+ */
+bool DBManager::rebalanceNoteSortKeys() {
+  TRACE_SPAN(span, "db");
+  if (!beginTransaction())
+    return false;
+  if (!rewriteSortKeys("Notes", "note_id", "ORDER BY sort_key, note_id DESC")) {
+    rollbackTransaction();
+    return false;
+  }
+  publishChange({DBChangeEvent::Notes, DBChangeEvent::Updated, -1, -1,
+                 {{"sort_key", QVariant()}}});
+  return commitTransaction();
+}
+
+/**
+ * @brief Rewrites the ordering keys of the top-level tasks of a note.
+ *
+ * The order is unchanged. A single Updated event with rowId -1 and the note
+ * ID is published, after which subscribers re-read the keys they hold.
+ *
+ * @param noteId The note whose tasks are rebalanced.
+ * @return true if the keys were rewritten, false otherwise.
+ */
+bool DBManager::rebalanceNoteContentSortKeys(int noteId) {
+  TRACE_SPAN(span, "db");
+  if (!beginTransaction())
+    return false;
+  if (!rewriteSortKeys("NotesContents", "id",
+                       "WHERE note_id = :note_id AND parent_id IS NULL AND "
+                       "rule_id IS NULL ORDER BY sort_key, id",
+                       noteId)) {
+    rollbackTransaction();
+    return false;
+  }
+  publishChange({DBChangeEvent::NotesContents, DBChangeEvent::Updated, -1,
+                 noteId, {{"sort_key", QVariant()}}});
+  return commitTransaction();
+}
+
+/**
+ * @brief Assigns evenly spaced ordering keys to rows in the given order.
+ *
+ * Must be called inside a transaction.
+ *
+ * @param table The table to rewrite.
+ * @param idColumn Its primary key column.
+ * @param filterAndOrder WHERE and ORDER BY clauses selecting the rows, in their new order.
+ * @param noteId Value bound to ":note_id" in @p filterAndOrder, if any.
+ * @return true if every key was written, false otherwise.
+ */
+bool DBManager::rewriteSortKeys(const QString &table, const QString &idColumn,
+                                const QString &filterAndOrder, int noteId) {
+  QSqlQuery query(m_db);
+  query.setForwardOnly(true);
+  query.prepare(QStringLiteral("SELECT %1 FROM %2 %3")
+                    .arg(idColumn, table, filterAndOrder));
+  if (noteId >= 0)
+    query.bindValue(":note_id", noteId);
+  if (!query.exec())
+    return false;
+  QVector<int> ids;
+  while (query.next())
+    ids.append(query.value(0).toInt());
+  query.finish();
+
+  const QStringList keys = OrderKey::spread(ids.size());
+  query.prepare(QStringLiteral("UPDATE %1 SET sort_key = :sort_key WHERE %2 = "
+                               ":id")
+                    .arg(table, idColumn));
+  for (int i = 0; i < ids.size(); ++i) {
+    query.bindValue(":sort_key", keys.at(i));
+    query.bindValue(":id", ids.at(i));
+    if (!query.exec()) {
+      qDebug() << "Sort key error:" << table << query.lastError().text();
+      return false;
+    }
+  }
+  return true;
+}
+
+/* ================== TAGS ================== */
+/**
+ * @brief Adds a tag, or returns the existing one with the same name.
+ *
+ * @param name The tag name (e.g. "urgent").
+ * @return The ID of the tag, or -1 if an error occurred.
+ */
+int DBManager::addTag(const QString &name) {
+  const int existing = tagId(name);
+  if (existing >= 0)
+    return existing;
+  QSqlQuery query(m_db);
+  query.prepare("INSERT INTO Tags (name) VALUES (:name)");
+  query.bindValue(":name", name);
+  if (!query.exec()) {
+    qDebug() << "Add tag error:" << query.lastError().text();
+    return -1;
+  }
+  int tagId = query.lastInsertId().toInt();
+  publishChange(
+      {DBChangeEvent::Tags, DBChangeEvent::Inserted, tagId, -1, {{"name", name}}});
+  return tagId;
+}
+
+/**
+ * @brief Returns the ID of the tag with the given name.
+ *
+ * @param name The tag name.
+ * @return The ID of the tag, or -1 if there is no such tag.
+ */
+int DBManager::tagId(const QString &name) {
+  QSqlQuery query(m_db);
+  query.prepare("SELECT tag_id FROM Tags WHERE name = :name");
+  query.bindValue(":name", name);
+  if (query.exec() && query.next())
+    return query.value(0).toInt();
+  return -1;
+}
+
+/**
+ * @brief Retrieves all tags ordered by name.
+ *
+ * @return QList<QVariantMap> The tags, with keys "tag_id" and "name".
+ */
+QList<QVariantMap> DBManager::getAllTags() {
+  QList<QVariantMap> tags;
+  QSqlQuery query("SELECT tag_id, name FROM Tags ORDER BY name", m_db);
+  while (query.next()) {
+    QVariantMap tag;
+    tag["tag_id"] = query.value("tag_id");
+    tag["name"] = query.value("name");
+    tags.append(tag);
+  }
+  return tags;
+}
+
+/**
+ * @brief Deletes a tag and removes it from every task and note, in one transaction.
+ *
+ * @param tagId The ID of the tag to delete.
+ * @return true if the deletion was successful, false otherwise.
+ */
+bool DBManager::deleteTag(int tagId) {
+  if (!beginTransaction())
+    return false;
+  QSqlQuery query(m_db);
+  bool ok = true;
+  for (const char *table : {"TaskTags", "NoteTags", "Tags"}) {
+    query.prepare(
+        QStringLiteral("DELETE FROM %1 WHERE tag_id = :id").arg(table));
+    query.bindValue(":id", tagId);
+    ok = query.exec();
+    if (!ok)
+      break;
+  }
+  if (!ok) {
+    qDebug() << "Delete tag error:" << query.lastError().text();
+    rollbackTransaction();
+    return false;
+  }
+  if (query.numRowsAffected() > 0)
+    publishChange({DBChangeEvent::Tags, DBChangeEvent::Deleted, tagId, -1, {}});
+  return commitTransaction();
+}
+
+/**
+ * @brief Attaches a tag to a task.
+ *
+ * @param contentId The task to tag.
+ * @param tagId The tag to attach.
+ * @return true if the task carries the tag afterwards, false if an error occurred.
+ */
+bool DBManager::tagNoteContent(int contentId, int tagId) {
+  QSqlQuery query(m_db);
+  query.prepare("INSERT OR IGNORE INTO TaskTags (content_id, tag_id) VALUES "
+                "(:content_id, :tag_id)");
+  query.bindValue(":content_id", contentId);
+  query.bindValue(":tag_id", tagId);
+  if (!query.exec()) {
+    qDebug() << "Tag task error:" << query.lastError().text();
+    return false;
+  }
+  if (query.numRowsAffected() > 0)
+    publishChange({DBChangeEvent::TaskTags, DBChangeEvent::Inserted, contentId,
+                   -1, {{"tag_id", tagId}}});
+  return true;
+}
+
+/**
+ * @brief Removes a tag from a task.
+ *
+ * @param contentId The tagged task.
+ * @param tagId The tag to remove.
+ * @return true if the statement succeeded, false otherwise.
+ */
+bool DBManager::untagNoteContent(int contentId, int tagId) {
+  QSqlQuery query(m_db);
+  query.prepare("DELETE FROM TaskTags WHERE content_id = :content_id AND "
+                "tag_id = :tag_id");
+  query.bindValue(":content_id", contentId);
+  query.bindValue(":tag_id", tagId);
+  if (!query.exec())
+    return false;
+  if (query.numRowsAffected() > 0)
+    publishChange({DBChangeEvent::TaskTags, DBChangeEvent::Deleted, contentId,
+                   -1, {{"tag_id", tagId}}});
+  return true;
+}
+
+/**
+ * @brief Returns the IDs of the tags attached to a task.
+ */
+QList<int> DBManager::getNoteContentTags(int contentId) {
+  QList<int> tags;
+  QSqlQuery query(m_db);
+  query.prepare("SELECT tag_id FROM TaskTags WHERE content_id = :content_id");
+  query.bindValue(":content_id", contentId);
+  query.exec();
+  while (query.next())
+    tags.append(query.value(0).toInt());
+  return tags;
+}
+
+/**
+ * @brief Attaches a tag to a note.
+ *
+ * @param noteId The note to tag.
+ * @param tagId The tag to attach.
+ * @return true if the note carries the tag afterwards, false if an error occurred.
+ */
+bool DBManager::tagNote(int noteId, int tagId) {
+  QSqlQuery query(m_db);
+  query.prepare("INSERT OR IGNORE INTO NoteTags (note_id, tag_id) VALUES "
+                "(:note_id, :tag_id)");
+  query.bindValue(":note_id", noteId);
+  query.bindValue(":tag_id", tagId);
+  if (!query.exec()) {
+    qDebug() << "Tag note error:" << query.lastError().text();
+    return false;
+  }
+  if (query.numRowsAffected() > 0)
+    publishChange({DBChangeEvent::NoteTags, DBChangeEvent::Inserted, noteId,
+                   noteId, {{"tag_id", tagId}}});
+  return true;
+}
+
+/**
+ * @brief Removes a tag from a note.
+ *
+ * @param noteId The tagged note.
+ * @param tagId The tag to remove.
+ * @return true if the statement succeeded, false otherwise.
+ */
+bool DBManager::untagNote(int noteId, int tagId) {
+  QSqlQuery query(m_db);
+  query.prepare(
+      "DELETE FROM NoteTags WHERE note_id = :note_id AND tag_id = :tag_id");
+  query.bindValue(":note_id", noteId);
+  query.bindValue(":tag_id", tagId);
+  if (!query.exec())
+    return false;
+  if (query.numRowsAffected() > 0)
+    publishChange({DBChangeEvent::NoteTags, DBChangeEvent::Deleted, noteId,
+                   noteId, {{"tag_id", tagId}}});
+  return true;
+}
+
+/**
+ * @brief Returns the IDs of the tags attached to a note.
+ */
+QList<int> DBManager::getNoteTags(int noteId) {
+  QList<int> tags;
+  QSqlQuery query(m_db);
+  query.prepare("SELECT tag_id FROM NoteTags WHERE note_id = :note_id");
+  query.bindValue(":note_id", noteId);
+  query.exec();
+  while (query.next())
+    tags.append(query.value(0).toInt());
+  return tags;
+}
+
+/**
+ * @brief Returns the IDs of all tasks of existing notes in ascending order.
+ *
+ * Used to build the in-memory TagIndex; values are read positionally to keep
+ * loading a large database cheap. The join is the same as in
+ * getNoteContentsByIds(), so every ID of the index can be read back.
+ */
+QVector<int> DBManager::getAllNoteContentIds() {
+  QVector<int> ids;
+  QSqlQuery query(m_db);
+  query.setForwardOnly(true);
+  query.exec("SELECT c.id FROM NotesContents c JOIN Notes n ON n.note_id = "
+             "c.note_id ORDER BY c.id");
+  while (query.next())
+    ids.append(query.value(0).toInt());
+  return ids;
+}
+
+/**
+ * @brief Returns every (task, tag) pair, grouped by tag and ordered by task ID.
+ *
+ * Used to build the in-memory TagIndex.
+ */
+QVector<QPair<int, int>> DBManager::getAllTaskTags() {
+  QVector<QPair<int, int>> pairs;
+  QSqlQuery query(m_db);
+  query.setForwardOnly(true);
+  query.exec("SELECT content_id, tag_id FROM TaskTags ORDER BY tag_id, "
+             "content_id");
+  while (query.next())
+    pairs.append({query.value(0).toInt(), query.value(1).toInt()});
+  return pairs;
+}
+
+/**
+ * @brief Retrieves the given tasks with the title of their note.
+ *
+ * @param ids The task IDs (for example one page of a TagIndex query result).
+ * @return QList<QVariantMap> The tasks in ascending ID order, with keys "id", "note_id", "title",
+ *         "content", "completed" and "due_at". Unknown IDs are skipped.
+ */
+QList<QVariantMap> DBManager::getNoteContentsByIds(const QVector<int> &ids) {
+  TRACE_SPAN(span, "db");
+  QList<QVariantMap> contents;
+  if (ids.isEmpty())
+    return contents;
+  QStringList idList;
+  idList.reserve(ids.size());
+  for (int id : ids)
+    idList.append(QString::number(id));
+  QSqlQuery query(m_db);
+  query.exec(QStringLiteral("SELECT c.id, c.note_id, n.title, c.content, "
+                            "c.completed, c.due_at FROM NotesContents c JOIN "
+                            "Notes n ON n.note_id = c.note_id WHERE c.id IN "
+                            "(%1) ORDER BY c.id")
+                 .arg(idList.join(',')));
+  while (query.next()) {
+    QVariantMap content;
+    content["id"] = query.value("id");
+    content["note_id"] = query.value("note_id");
+    content["title"] = query.value("title");
+    content["content"] = query.value("content");
+    content["completed"] = query.value("completed");
+    content["due_at"] = query.value("due_at");
+    contents.append(content);
+  }
+  span.setQuery(query, contents.size());
+  return contents;
+}
+/* ================== EVENT LOGS ================== */
+/**
+ * @brief Adds a new event log entry to the database.
+ *
+ * Inserts a record into the `eventLogs` table with the specified event type and description,
+ * stamped with the current time in epoch milliseconds.
+ *
+ * @param eventType The type of the event to log.
+ * @param eventDescription A description of the event.
+ * @return The ID of the newly inserted event log entry on success, or -1 if the operation fails.
+ */
+int DBManager::addEventLog(const QString &eventType,
+                           const QString &eventDescription) {
+  TRACE_SPAN(span, "db");
+  QSqlQuery query(m_db);
+  query.prepare("INSERT INTO eventLogs (event_type, event_description, "
+                "created_at) VALUES (:type, :desc, :created_at)");
+  query.bindValue(":type", eventType);
+  query.bindValue(":desc", eventDescription);
+  query.bindValue(":created_at", QDateTime::currentMSecsSinceEpoch());
+  const bool ok = query.exec();
+  span.setQuery(query);
+  if (!ok) {
+    qDebug() << "Add log error:" << query.lastError().text();
+    return -1;
+  }
+  int logId = query.lastInsertId().toInt();
+  publishChange({DBChangeEvent::EventLogs, DBChangeEvent::Inserted, logId, -1,
+                 {{"event_type", eventType},
+                  {"event_description", eventDescription}}});
+  return logId;
+}
+
+/**
+ * @brief Retrieves the event logs created in a time range, newest first.
+ *
+ * Uses the index on eventLogs.created_at, so the cost depends on the number
+ * of entries in the range rather than on the size of the table.
+ *
+ * @param fromMsecs Start of the range (inclusive), in epoch milliseconds.
+ * @param toMsecs End of the range (exclusive), in epoch milliseconds.
+ * @return QList<QVariantMap> List of event logs, in the same format as getEventLogs().
+ */
+QList<QVariantMap> DBManager::getEventLogsBetween(qint64 fromMsecs,
+                                                  qint64 toMsecs) {
+  TRACE_SPAN(span, "db");
+  QList<QVariantMap> logs;
+  QSqlQuery query(m_db);
+  query.prepare("SELECT * FROM eventLogs WHERE created_at >= :from AND "
+                "created_at < :to ORDER BY created_at DESC, id DESC");
+  query.bindValue(":from", fromMsecs);
+  query.bindValue(":to", toMsecs);
+  query.exec();
+  while (query.next()) {
+    QVariantMap log;
+    log["id"] = query.value("id");
+    log["event_type"] = query.value("event_type");
+    log["event_description"] = query.value("event_description");
+    log["created_at"] = query.value("created_at");
+    logs.append(log);
+  }
+  span.setQuery(query, logs.size());
+  return logs;
+}
+
+/**
+ * @brief Retrieves a single event log entry from the database by its ID.
+ *
+ * @param logId The unique identifier of the event log entry.
+ * @return QVariantMap with keys "id", "event_type", "event_description" and "created_at", or an empty map if not found.
+ */
+QVariantMap DBManager::getEventLog(int logId) {
+  QVariantMap log;
+  QSqlQuery query(m_db);
+  query.prepare("SELECT * FROM eventLogs WHERE id = :id");
+  query.bindValue(":id", logId);
+  if (query.exec() && query.next()) {
+    log["id"] = query.value("id");
+    log["event_type"] = query.value("event_type");
+    log["event_description"] = query.value("event_description");
+    log["created_at"] = query.value("created_at");
+  }
+  return log;
+}
+
+/**
+ * @brief Retrieves all event logs from the database.
+ *
+ * Executes a SQL query to select all records from the eventLogs table,
+ * ordered by the creation timestamp in descending order. Each record is
+ * mapped to a QVariantMap containing the following keys: "id", "event_type",
+ * "event_description", and "created_at". The method returns a QList of these
+ * QVariantMap objects.
+ *
+ * @return QList<QVariantMap> List of event logs, each represented as a QVariantMap.
+ */
+QList<QVariantMap> DBManager::getEventLogs() {
+  TRACE_SPAN(span, "db");
+  QList<QVariantMap> logs;
+  QSqlQuery query("SELECT * FROM eventLogs ORDER BY created_at DESC, id DESC",
+                  m_db);
+  while (query.next()) {
+    QVariantMap log;
+    log["id"] = query.value("id");
+    log["event_type"] = query.value("event_type");
+    log["event_description"] = query.value("event_description");
+    log["created_at"] = query.value("created_at");
+    logs.append(log);
+  }
+  span.setQuery(query, logs.size());
+  return logs;
+}
+
+/**
+ * @brief Retrieves one page of event log entries, newest first.
+ *
+ * Pages are fetched by keyset on (created_at, id), so reading deep into a
+ * long history costs the same as reading its first page.
+ *
+ * @param beforeAt Creation time of the last entry of the previous page (-1 for the first page).
+ * @param beforeId ID of the last entry of the previous page.
+ * @param limit Maximum number of entries to return.
+ * @return A list of QVariantMap objects, each representing an event log entry.
+ */
+QList<QVariantMap> DBManager::getEventLogsBefore(qint64 beforeAt, int beforeId,
+                                                 int limit) {
+  TRACE_SPAN(span, "db");
+  QList<QVariantMap> logs;
+  QSqlQuery query(m_db);
+  query.prepare(QStringLiteral("SELECT * FROM eventLogs %1 ORDER BY "
+                               "created_at DESC, id DESC LIMIT :limit")
+                    .arg(beforeAt < 0 ? QString()
+                                      : "WHERE (created_at, id) < (:before_at, "
+                                        ":before_id)"));
+  if (beforeAt >= 0) {
+    query.bindValue(":before_at", beforeAt);
+    query.bindValue(":before_id", beforeId);
+  }
+  query.bindValue(":limit", limit);
+  query.exec();
+  while (query.next()) {
     QVariantMap log;
     log["id"] = query.value("id");
     log["event_type"] = query.value("event_type");
@@ -356,7 +2245,1630 @@ QList<QVariantMap> DBManager::getEventLogs() {
     log["created_at"] = query.value("created_at");
     logs.append(log);
   }
-  return logs;
+  span.setQuery(query, logs.size());
+  return logs;
+}
+
+/* ================== ANALYTICS ROLLUPS ================== */
+/**
+ * @brief Adds to the daily count of an event type for a note.
+ *
+ * Called by Logger next to every event log entry, so the rollups stay
+ * current without ever rescanning eventLogs. A single UPSERT on the primary
+ * key of (day, note_name, event_type).
+ *
+ * @param day The local day of the event.
+ * @param noteName The note the event belongs to.
+ * @param eventType The rollup type (see Logger::rollupType()).
+ * @param count The number of events to add.
+ * @return true if the count was written, false otherwise.
+ */
+bool DBManager::addEventRollup(const QDate &day, const QString &noteName,
+                               const QString &eventType, int count) {
+  TRACE_SPAN(span, "db");
+  QSqlQuery query(m_db);
+  query.prepare("INSERT INTO EventRollups (day, note_name, event_type, count) "
+                "VALUES (:day, :note_name, :event_type, :count) ON "
+                "CONFLICT (day, note_name, event_type) DO UPDATE SET count = "
+                "count + excluded.count");
+  query.bindValue(":day", day.toString(Qt::ISODate));
+  query.bindValue(":note_name", noteName);
+  query.bindValue(":event_type", eventType);
+  query.bindValue(":count", count);
+  const bool ok = query.exec();
+  span.setQuery(query);
+  if (!ok) {
+    qDebug() << "Add event rollup error:" << query.lastError().text();
+    return false;
+  }
+  publishChange({DBChangeEvent::EventRollups, DBChangeEvent::Updated, -1, -1,
+                 {{"day", day},
+                  {"note_name", noteName},
+                  {"event_type", eventType},
+                  {"count", count}}});
+  return true;
+}
+
+/**
+ * @brief Retrieves the daily event counts in a range of days.
+ *
+ * Reads one row per day, note and event type from the primary key, so a year
+ * of history costs a few hundred rows regardless of the number of events.
+ *
+ * @param from First day (inclusive).
+ * @param to Last day (inclusive).
+ * @param noteName Only count events of this note; empty for all notes.
+ * @return QList<QVariantMap> Rows with keys "day" (QDate), "event_type" and "count", ordered by day.
+ */
+QList<QVariantMap> DBManager::getEventRollups(const QDate &from,
+                                              const QDate &to,
+                                              const QString &noteName) {
+  QList<QVariantMap> rollups;
+  QSqlQuery query(m_db);
+  query.setForwardOnly(true);
+  query.prepare(QStringLiteral("SELECT day, event_type, SUM(count) FROM "
+                               "EventRollups WHERE day BETWEEN :from AND :to%1 "
+                               "GROUP BY day, event_type ORDER BY day")
+                    .arg(noteName.isEmpty() ? ""
+                                            : " AND note_name = :note_name"));
+  query.bindValue(":from", from.toString(Qt::ISODate));
+  query.bindValue(":to", to.toString(Qt::ISODate));
+  if (!noteName.isEmpty())
+    query.bindValue(":note_name", noteName);
+  query.exec();
+  while (query.next()) {
+    QVariantMap rollup;
+    rollup["day"] = QDate::fromString(query.value(0).toString(), Qt::ISODate);
+    rollup["event_type"] = query.value(1);
+    rollup["count"] = query.value(2);
+    rollups.append(rollup);
+  }
+  return rollups;
+}
+
+/**
+ * @brief Fills EventRollups from the existing event log (schema migration 6).
+ *
+ * Every entry is read and its JSON description parsed once, here, so that
+ * the rollups of a database created before they existed cover its whole
+ * history. Does nothing if the table already has rows.
+ *
+ * @return true if the rollups were written, false otherwise.
+ */
+bool DBManager::backfillEventRollups() {
+  QSqlQuery query(m_db);
+  if (!query.exec("SELECT 1 FROM EventRollups LIMIT 1"))
+    return false;
+  if (query.next())
+    return true;
+  query.finish();
+
+  QMap<QStringList, int> counts;
+  query.setForwardOnly(true);
+  if (!query.exec("SELECT event_type, event_description, created_at FROM "
+                  "eventLogs"))
+    return false;
+  while (query.next()) {
+    const QJsonObject description =
+        QJsonDocument::fromJson(query.value(1).toString().toUtf8()).object();
+    const QString day =
+        toDateTime(query.value(2)).date().toString(Qt::ISODate);
+    ++counts[{day, description.value("NoteName").toString(),
+              Logger::rollupType(query.value(0).toString(),
+                                 description.value("TaskName").toString())}];
+  }
+  query.finish();
+
+  query.prepare("INSERT INTO EventRollups (day, note_name, event_type, count) "
+                "VALUES (:day, :note_name, :event_type, :count)");
+  for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+    query.bindValue(":day", it.key().at(0));
+    query.bindValue(":note_name", it.key().at(1));
+    query.bindValue(":event_type", it.key().at(2));
+    query.bindValue(":count", it.value());
+    if (!query.exec()) {
+      qDebug() << "Rollup backfill error:" << query.lastError().text();
+      return false;
+    }
+  }
+  return true;
+}
+
+/* ================== REVISIONS ================== */
+/**
+ * @brief Installs the trigger that drops the revision history of deleted tasks (schema migration 9).
+ *
+ * The history goes with the task whichever write path deleted it, including
+ * sync. Existing tasks get their first revision when they are first edited.
+ *
+ * @return true if the trigger was installed, false otherwise.
+ */
+bool DBManager::installContentRevisions() {
+  QSqlQuery query(m_db);
+  const bool ok = query.exec(
+      "CREATE TRIGGER IF NOT EXISTS content_revisions_task_delete AFTER "
+      "DELETE ON NotesContents BEGIN DELETE FROM ContentRevisions WHERE "
+      "content_id = OLD.id; END");
+  if (!ok)
+    qDebug() << "Revision setup error:" << query.lastError().text();
+  return ok;
+}
+
+/**
+ * @brief Returns the checksum stored with a revision: the first 64 bits of the SHA-1 of its UTF-8 text.
+ */
+qint64 DBManager::revisionChecksum(const QString &text) {
+  return qFromBigEndian<qint64>(
+      QCryptographicHash::hash(text.toUtf8(), QCryptographicHash::Sha1)
+          .constData());
+}
+
+/**
+ * @brief Appends the edit from @p previous to @p content to the revision history of a task.
+ *
+ * Revisions are numbered from 0 per task. Each one stores either a TextDelta
+ * against the revision before it or, as a snapshot, the full text. A
+ * snapshot is written once the deltas since the last snapshot would add up to
+ * the size of the text, so a snapshot costs no more than the deltas it
+ * follows and the history grows with the size of the edits (at most twice
+ * that), not with the length of the text; rebuilding a revision reads at
+ * most one text's worth of deltas. The chain is also cut after
+ * maxRevisionChain deltas, which bounds the number of deltas to apply for
+ * long texts edited a character at a time.
+ *
+ * Each revision also stores the checksum of its text. If the last revision
+ * does not match @p previous (the task was never edited, or its text was
+ * changed by sync or a restore), @p previous is first recorded as a snapshot,
+ * so the chain is never applied to a text it was not made from.
+ *
+ * @param contentId The edited task.
+ * @param previous Its text before the edit.
+ * @param content Its text after the edit.
+ * @return true if the revision was recorded, false otherwise.
+ */
+bool DBManager::addContentRevision(int contentId, const QString &previous,
+                                   const QString &content) {
+  QSqlQuery query(m_db);
+  query.setForwardOnly(true);
+  query.prepare("SELECT revision, snapshot, checksum, length(data) FROM "
+                "ContentRevisions WHERE content_id = :id ORDER BY revision "
+                "DESC LIMIT :limit");
+  query.bindValue(":id", contentId);
+  query.bindValue(":limit", maxRevisionChain + 1);
+  if (!query.exec())
+    return false;
+  int revision = 0;
+  int chainLength = 0;
+  qint64 chainBytes = 0;
+  if (query.next()) {
+    revision = query.value(0).toInt() + 1;
+    if (query.value(2).toLongLong() == revisionChecksum(previous)) {
+      while (!query.value(1).toBool()) {
+        ++chainLength;
+        chainBytes += query.value(3).toLongLong();
+        if (!query.next())
+          break;
+      }
+    } else {
+      chainLength = -1;
+    }
+  } else {
+    chainLength = -1;
+  }
+  query.finish();
+
+  QSqlQuery insert(m_db);
+  insert.prepare("INSERT INTO ContentRevisions (content_id, revision, "
+                 "snapshot, data, checksum, created_at) VALUES (:id, "
+                 ":revision, :snapshot, :data, :checksum, :created_at)");
+  auto append = [&](bool snapshot, const QByteArray &data,
+                    const QString &text) {
+    insert.bindValue(":id", contentId);
+    insert.bindValue(":revision", revision++);
+    insert.bindValue(":snapshot", snapshot);
+    insert.bindValue(":data", data);
+    insert.bindValue(":checksum", revisionChecksum(text));
+    insert.bindValue(":created_at", QDateTime::currentMSecsSinceEpoch());
+    if (insert.exec())
+      return true;
+    qDebug() << "Add revision error:" << insert.lastError().text();
+    return false;
+  };
+  if (chainLength < 0) {
+    if (!append(true, previous.toUtf8(), previous))
+      return false;
+    chainLength = 0;
+  }
+  const QByteArray delta = TextDelta::encode(previous, content);
+  const QByteArray full = content.toUtf8();
+  if (chainLength >= maxRevisionChain ||
+      chainBytes + delta.size() >= full.size())
+    return append(true, full, content);
+  return append(false, delta, content);
+}
+
+/**
+ * @brief Retrieves the revision history of a task, oldest first.
+ *
+ * Each entry is a QVariantMap with the fields revision, snapshot (true if the
+ * full text is stored), size (bytes stored) and created_at. The last entry is
+ * the current text; a task that was never edited has no revisions.
+ *
+ * @param contentId The task.
+ * @return QList<QVariantMap> The revisions.
+ */
+QList<QVariantMap> DBManager::getContentRevisions(int contentId) {
+  TRACE_SPAN(span, "db");
+  QList<QVariantMap> revisions;
+  QSqlQuery query(m_db);
+  query.prepare("SELECT revision, snapshot, length(data), created_at FROM "
+                "ContentRevisions WHERE content_id = :id ORDER BY revision");
+  query.bindValue(":id", contentId);
+  query.exec();
+  while (query.next()) {
+    QVariantMap revision;
+    revision["revision"] = query.value(0);
+    revision["snapshot"] = query.value(1).toBool();
+    revision["size"] = query.value(2);
+    revision["created_at"] = query.value(3);
+    revisions.append(revision);
+  }
+  span.setQuery(query, revisions.size());
+  return revisions;
+}
+
+/**
+ * @brief Rebuilds the text of one revision of a task.
+ *
+ * Reads the nearest snapshot at or before @p revision and applies the deltas
+ * after it, at most maxRevisionChain of them. The result is checked against
+ * the checksum stored with the revision.
+ *
+ * @param contentId The task.
+ * @param revision The revision number, as returned by getContentRevisions().
+ * @return The text of the revision, or a null QString if it does not exist or cannot be rebuilt.
+ */
+QString DBManager::getContentRevisionText(int contentId, int revision) {
+  TRACE_SPAN(span, "db");
+  QSqlQuery query(m_db);
+  query.setForwardOnly(true);
+  query.prepare("SELECT revision, snapshot, data, checksum FROM "
+                "ContentRevisions WHERE content_id = :id AND revision <= "
+                ":revision ORDER BY revision DESC LIMIT :limit");
+  query.bindValue(":id", contentId);
+  query.bindValue(":revision", revision);
+  query.bindValue(":limit", maxRevisionChain + 1);
+  query.exec();
+  if (!query.next() || query.value(0).toInt() != revision)
+    return QString();
+  const qint64 checksum = query.value(3).toLongLong();
+  QList<QByteArray> deltas;
+  while (!query.value(1).toBool()) {
+    deltas.prepend(query.value(2).toByteArray());
+    if (!query.next()) {
+      qDebug() << "Revision" << revision << "of task" << contentId
+               << "has no snapshot";
+      return QString();
+    }
+  }
+  QString text = QString::fromUtf8(query.value(2).toByteArray());
+  span.setQuery(query, deltas.size() + 1);
+  for (const QByteArray &delta : qAsConst(deltas))
+    if (!TextDelta::apply(text, delta))
+      return QString();
+  if (checksum != revisionChecksum(text)) {
+    qDebug() << "Revision" << revision << "of task" << contentId
+             << "does not match its checksum";
+    return QString();
+  }
+  return text;
+}
+
+/* ================== ATTACHMENTS ================== */
+/**
+ * @brief Installs the triggers that keep blob reference counts (schema migration 8).
+ *
+ * Every attachment row holds one reference to its blob, and deleting a task
+ * deletes its attachments, whichever write path deleted the task (including
+ * sync). The counts of existing blobs are recomputed, so the migration is
+ * safe to run on a database that already has attachments.
+ *
+ * @return true if the triggers were installed, false otherwise.
+ */
+bool DBManager::installAttachmentRefCounts() {
+  QSqlQuery query(m_db);
+  const bool ok =
+      query.exec("CREATE TRIGGER IF NOT EXISTS attachments_ref_insert AFTER "
+                 "INSERT ON Attachments BEGIN UPDATE Blobs SET ref_count = "
+                 "ref_count + 1 WHERE hash = NEW.hash; END") &&
+      query.exec("CREATE TRIGGER IF NOT EXISTS attachments_ref_delete AFTER "
+                 "DELETE ON Attachments BEGIN UPDATE Blobs SET ref_count = "
+                 "ref_count - 1 WHERE hash = OLD.hash; END") &&
+      query.exec("CREATE TRIGGER IF NOT EXISTS attachments_task_delete AFTER "
+                 "DELETE ON NotesContents BEGIN DELETE FROM Attachments WHERE "
+                 "content_id = OLD.id; END") &&
+      query.exec("UPDATE Blobs SET ref_count = (SELECT COUNT(*) FROM "
+                 "Attachments a WHERE a.hash = Blobs.hash)");
+  if (!ok)
+    qDebug() << "Attachment setup error:" << query.lastError().text();
+  return ok;
+}
+
+/**
+ * @brief Returns the directory holding the attachment files of this database.
+ *
+ * Files live next to the database in "<database>.attachments", one per
+ * distinct content, named after the SHA-256 of the content and spread over
+ * 256 subdirectories by the first two hex digits.
+ */
+QString DBManager::attachmentDirectory() const {
+  return m_dbPath + QStringLiteral(".attachments");
+}
+
+/**
+ * @brief Returns the path of the file holding the blob with the given hash.
+ */
+QString DBManager::blobPath(const QString &hash) const {
+  return attachmentDirectory() + '/' + hash.left(2) + '/' + hash;
+}
+
+/**
+ * @brief Attaches the content of a device to a task.
+ *
+ * The content is streamed in chunks of attachmentChunkSize into a temporary
+ * file while it is hashed, so its size does not affect memory use, and then
+ * stored by insertAttachment() in one transaction. Only devices whose
+ * content can be read without waiting (files, buffers) are accepted, since
+ * waiting for a socket or process would block the event loop; large files
+ * are better attached with startAttachment(), which copies them on a pool
+ * thread.
+ *
+ * @param contentId The task to attach to.
+ * @param source Readable device positioned at the start of the content.
+ * @param name File name shown for the attachment.
+ * @return The ID of the new attachment, or -1 on error.
+ */
+int DBManager::addAttachment(int contentId, QIODevice *source,
+                             const QString &name) {
+  TRACE_SPAN(span, "db");
+  if (!source || !source->isReadable() || source->isSequential()) {
+    qDebug() << "Add attachment error: source must be a readable file";
+    return -1;
+  }
+  QTemporaryFile incoming(attachmentDirectory() +
+                          QStringLiteral("/incoming-XXXXXX"));
+  if (!QDir().mkpath(attachmentDirectory()) || !incoming.open()) {
+    qDebug() << "Add attachment error:" << incoming.errorString();
+    return -1;
+  }
+  QString digest;
+  qint64 size = 0;
+  if (!AttachmentCopyTask::copy(source, &incoming, attachmentChunkSize, digest,
+                                size)) {
+    qDebug() << "Add attachment error:" << source->errorString()
+             << incoming.errorString();
+    return -1;
+  }
+  incoming.close();
+  if (!beginTransaction())
+    return -1;
+  const int attachmentId =
+      insertAttachment(contentId, incoming.fileName(), digest, size, name);
+  if (attachmentId < 0) {
+    rollbackTransaction();
+    return -1;
+  }
+  return commitTransaction() ? attachmentId : -1;
+}
+
+/**
+ * @brief Attaches a file to a task under its file name.
+ *
+ * @param contentId The task to attach to.
+ * @param filePath Path of the file to attach.
+ * @return The ID of the new attachment, or -1 on error.
+ */
+int DBManager::addAttachment(int contentId, const QString &filePath) {
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    qDebug() << "Add attachment error:" << file.errorString();
+    return -1;
+  }
+  return addAttachment(contentId, &file, QFileInfo(filePath).fileName());
+}
+
+/**
+ * @brief Attaches a file to a task without blocking the event loop.
+ *
+ * The file is copied into the attachment directory and hashed by an
+ * AttachmentCopyTask on a pool thread; the blob and attachment rows are
+ * then written through queueWrite(), so a busy write lock delays the
+ * attachment instead of failing it. attachmentAdded() reports the outcome.
+ *
+ * @param contentId The task to attach to.
+ * @param filePath Path of the file to attach.
+ * @return true if the copy was started, false if the directory cannot be created.
+ */
+bool DBManager::startAttachment(int contentId, const QString &filePath) {
+  if (!QDir().mkpath(attachmentDirectory()))
+    return false;
+  const QString incomingPath =
+      attachmentDirectory() + QStringLiteral("/incoming-") +
+      QUuid::createUuid().toString(QUuid::WithoutBraces);
+  const QString name = QFileInfo(filePath).fileName();
+  AttachmentCopyTask *task =
+      new AttachmentCopyTask(filePath, incomingPath, attachmentChunkSize);
+  QObject::connect(
+      task, &AttachmentCopyTask::finished, this,
+      [this, contentId, name](const QString &path, bool ok,
+                              const QString &digest, qint64 size,
+                              const QString &message) {
+        if (!ok) {
+          qDebug() << "Add attachment error:" << message;
+          emit attachmentAdded(contentId, -1);
+          return;
+        }
+        int *attachmentId = new int(-1);
+        queueWrite(
+            [this, contentId, path, digest, size, name, attachmentId]() {
+              *attachmentId =
+                  insertAttachment(contentId, path, digest, size, name);
+              return *attachmentId >= 0;
+            },
+            [this, contentId, path, attachmentId](bool ok) {
+              QFile::remove(path);
+              emit attachmentAdded(contentId, ok ? *attachmentId : -1);
+              delete attachmentId;
+            });
+      },
+      Qt::QueuedConnection);
+  QThreadPool::globalInstance()->start(task);
+  return true;
+}
+
+/**
+ * @brief Stores a copied and hashed attachment; must be called inside a transaction.
+ *
+ * If no blob with the same SHA-256 has a file yet, the incoming file is
+ * renamed to become it. The rename happens under the write lock, so a
+ * concurrent garbage collection cannot remove the file between the check
+ * and the new reference (see collectAttachmentGarbage()). A file renamed
+ * here is removed again if a later statement fails.
+ *
+ * @param contentId The task to attach to.
+ * @param incomingPath The copied content; left in place if a blob is shared.
+ * @param digest SHA-256 of the content as hex.
+ * @param size Size of the content in bytes.
+ * @param name File name shown for the attachment.
+ * @return The ID of the new attachment, or -1 on error.
+ */
+int DBManager::insertAttachment(int contentId, const QString &incomingPath,
+                                const QString &digest, qint64 size,
+                                const QString &name) {
+  QSqlQuery query(m_db);
+  query.prepare("SELECT note_id FROM NotesContents WHERE id = :id");
+  query.bindValue(":id", contentId);
+  if (!query.exec() || !query.next()) {
+    qDebug() << "Add attachment error: no task" << contentId;
+    return -1;
+  }
+  const int noteId = query.value(0).toInt();
+  query.finish();
+
+  const QString path = blobPath(digest);
+  bool created = false;
+  if (!QFile::exists(path)) {
+    if (!QDir().mkpath(QFileInfo(path).absolutePath()) ||
+        !QFile::rename(incomingPath, path)) {
+      qDebug() << "Add attachment error: cannot store" << path;
+      return -1;
+    }
+    created = true;
+  }
+  query.prepare("INSERT INTO Blobs (hash, size) VALUES (:hash, :size) ON "
+                "CONFLICT (hash) DO NOTHING");
+  query.bindValue(":hash", digest);
+  query.bindValue(":size", size);
+  bool ok = query.exec();
+  int attachmentId = -1;
+  if (ok) {
+    query.prepare("INSERT INTO Attachments (content_id, hash, name) VALUES "
+                  "(:content_id, :hash, :name)");
+    query.bindValue(":content_id", contentId);
+    query.bindValue(":hash", digest);
+    query.bindValue(":name", name);
+    ok = query.exec();
+    attachmentId = query.lastInsertId().toInt();
+  }
+  if (!ok) {
+    qDebug() << "Add attachment error:" << query.lastError().text();
+    if (created)
+      QFile::remove(path);
+    return -1;
+  }
+  publishChange({DBChangeEvent::Attachments, DBChangeEvent::Inserted,
+                 attachmentId, noteId,
+                 {{"content_id", contentId},
+                  {"hash", digest},
+                  {"name", name},
+                  {"size", size}}});
+  return attachmentId;
+}
+
+/**
+ * @brief Retrieves the attachments of a task, oldest first.
+ *
+ * @param contentId The task.
+ * @return A list of QVariantMap with the keys "id", "content_id", "hash", "name", "size" and "created_at".
+ */
+QList<QVariantMap> DBManager::getAttachments(int contentId) {
+  QList<QVariantMap> attachments;
+  QSqlQuery query(m_db);
+  query.prepare("SELECT a.id, a.content_id, a.hash, a.name, a.created_at, "
+                "b.size FROM Attachments a JOIN Blobs b ON b.hash = a.hash "
+                "WHERE a.content_id = :id ORDER BY a.id");
+  query.bindValue(":id", contentId);
+  query.exec();
+  while (query.next()) {
+    QVariantMap attachment;
+    attachment["id"] = query.value("id");
+    attachment["content_id"] = query.value("content_id");
+    attachment["hash"] = query.value("hash");
+    attachment["name"] = query.value("name");
+    attachment["size"] = query.value("size");
+    attachment["created_at"] = query.value("created_at");
+    attachments.append(attachment);
+  }
+  return attachments;
+}
+
+/**
+ * @brief Opens the content of an attachment for streamed reading.
+ *
+ * @param attachmentId The attachment.
+ * @param parent Parent of the returned device.
+ * @return A device open for reading, owned by the caller (or @p parent), or nullptr on error.
+ */
+QIODevice *DBManager::openAttachment(int attachmentId, QObject *parent) {
+  QSqlQuery query(m_db);
+  query.prepare("SELECT hash FROM Attachments WHERE id = :id");
+  query.bindValue(":id", attachmentId);
+  if (!query.exec() || !query.next())
+    return nullptr;
+  QFile *file = new QFile(blobPath(query.value(0).toString()), parent);
+  if (!file->open(QIODevice::ReadOnly)) {
+    qDebug() << "Open attachment error:" << file->errorString();
+    delete file;
+    return nullptr;
+  }
+  return file;
+}
+
+/**
+ * @brief Copies the content of an attachment to a file, one chunk at a time.
+ *
+ * The destination is only replaced once the whole content has been written.
+ *
+ * @param attachmentId The attachment.
+ * @param destPath Path of the file to write.
+ * @return true if the content was written, false otherwise.
+ */
+bool DBManager::exportAttachment(int attachmentId, const QString &destPath) {
+  TRACE_SPAN(span, "db");
+  QIODevice *source = openAttachment(attachmentId);
+  if (!source)
+    return false;
+  QSaveFile dest(destPath);
+  bool ok = dest.open(QIODevice::WriteOnly);
+  QByteArray chunk(int(attachmentChunkSize), Qt::Uninitialized);
+  while (ok && !source->atEnd()) {
+    const qint64 read = source->read(chunk.data(), chunk.size());
+    ok = read >= 0 && dest.write(chunk.constData(), read) == read;
+  }
+  delete source;
+  ok = ok && dest.commit();
+  if (!ok)
+    qDebug() << "Export attachment error:" << dest.errorString();
+  return ok;
+}
+
+/**
+ * @brief Removes an attachment from its task.
+ *
+ * Its file is deleted by the next garbage collection if no other attachment
+ * shares it.
+ *
+ * @param attachmentId The attachment.
+ * @return true if the attachment was removed, false otherwise.
+ */
+bool DBManager::deleteAttachment(int attachmentId) {
+  QSqlQuery query(m_db);
+  query.prepare("SELECT a.content_id, c.note_id FROM Attachments a LEFT JOIN "
+                "NotesContents c ON c.id = a.content_id WHERE a.id = :id");
+  query.bindValue(":id", attachmentId);
+  if (!query.exec() || !query.next())
+    return false;
+  const int contentId = query.value(0).toInt();
+  const int noteId = query.value(1).isNull() ? -1 : query.value(1).toInt();
+  query.finish();
+  query.prepare("DELETE FROM Attachments WHERE id = :id");
+  query.bindValue(":id", attachmentId);
+  if (!query.exec())
+    return false;
+  publishChange({DBChangeEvent::Attachments, DBChangeEvent::Deleted,
+                 attachmentId, noteId, {{"content_id", contentId}}});
+  scheduleAttachmentGarbageCollection();
+  return true;
+}
+
+/**
+ * @brief Deletes the rows and files of the blobs no attachment refers to anymore.
+ *
+ * The unreferenced rows are selected and deleted in one write transaction,
+ * so no other connection can attach the same content in between, and their
+ * files are removed only once that has committed. Removing a file takes the
+ * write lock again and skips blobs that were attached anew meanwhile (by
+ * another process reusing the file, see addAttachment()); files that could
+ * not be removed yet are retried by the next collection. A file left behind
+ * by a crash is reused if the same content is attached again. Does nothing
+ * while a transaction is open, since its references are not final yet; it
+ * is scheduled again instead.
+ *
+ * @return The number of blobs deleted.
+ */
+int DBManager::collectAttachmentGarbage() {
+  TRACE_SPAN(span, "db");
+  if (m_transactionDepth > 0) {
+    scheduleAttachmentGarbageCollection();
+    return 0;
+  }
+  if (!beginTransaction())
+    return 0;
+  QSqlQuery query(m_db);
+  QStringList hashes;
+  bool ok = query.exec("SELECT hash FROM Blobs WHERE ref_count <= 0");
+  while (ok && query.next())
+    hashes.append(query.value(0).toString());
+  query.finish();
+  query.prepare("DELETE FROM Blobs WHERE hash = :hash");
+  for (const QString &hash : qAsConst(hashes)) {
+    query.bindValue(":hash", hash);
+    ok = ok && query.exec();
+  }
+  if (!ok) {
+    qDebug() << "Attachment collection error:" << query.lastError().text();
+    rollbackTransaction();
+    return 0;
+  }
+  if (!commitTransaction())
+    return 0;
+  m_unlinkedBlobs.append(hashes);
+  removeUnlinkedBlobs();
+  return hashes.size();
+}
+
+/**
+ * @brief Removes the files of blobs whose rows collectAttachmentGarbage() deleted.
+ *
+ * Runs under the write lock and keeps the file of a blob that has a row
+ * again. If the lock is busy the files wait for the next collection.
+ */
+void DBManager::removeUnlinkedBlobs() {
+  if (m_unlinkedBlobs.isEmpty() || !beginTransaction())
+    return;
+  QSqlQuery query(m_db);
+  query.prepare("SELECT 1 FROM Blobs WHERE hash = :hash");
+  QStringList kept;
+  for (const QString &hash : qAsConst(m_unlinkedBlobs)) {
+    query.bindValue(":hash", hash);
+    if (!query.exec())
+      kept.append(hash);
+    else if (!query.next() && QFile::exists(blobPath(hash)) &&
+             !QFile::remove(blobPath(hash)))
+      kept.append(hash);
+    query.finish();
+  }
+  m_unlinkedBlobs.swap(kept);
+  rollbackTransaction();
+}
+
+/**
+ * @brief Runs collectAttachmentGarbage() once control returns to the event loop.
+ *
+ * Several deletes in a row are collected in one pass.
+ */
+void DBManager::scheduleAttachmentGarbageCollection() {
+  m_attachmentGcTimer.start();
+}
+
+/* ================== SYNC ================== */
+namespace {
+// Triggers are silent while pullChanges() applies another site's changes.
+const char *const notApplying =
+    "(SELECT value FROM SyncMeta WHERE key = 'applying') = 0";
+const char *const nextClock =
+    "UPDATE SyncMeta SET value = value + 1 WHERE key = 'clock'";
+const char *const logHeader =
+    "INSERT INTO ChangeLog (site_id, clock, table_name, row_uuid, deleted";
+const char *const logSite = "(SELECT value FROM SyncMeta WHERE key = "
+                            "'site_id'), (SELECT value FROM SyncMeta WHERE "
+                            "key = 'clock')";
+} // namespace
+
+/**
+ * @brief Sets up the change log used by sync (schema migration 7).
+ *
+ * Gives every note and task a stable UUID, seeds SyncMeta with a random site
+ * ID and a Lamport clock, records the existing rows as the first changes of
+ * this site and installs the triggers that log every later insert, update
+ * and delete of Notes and NotesContents. A change of sort_key alone is
+ * logged as a change of its own (table_name "<table>.sort_key", holding only
+ * the key) and versioned apart from the rest of the row, so reordering on
+ * one side never overwrites a concurrent edit of the text or status on the
+ * other, and a rebalance logs only the keys. Logging in triggers covers every
+ * write path of DBManager, including ones added later. Materialized
+ * occurrences of recurring tasks are not logged while they are linked to
+ * their rule, since rules are not synced.
+ *
+ * @return true if the change log was set up, false otherwise.
+ */
+bool DBManager::installChangeLog() {
+  QSqlQuery query(m_db);
+  bool ok = true;
+  for (const char *table : {"Notes", "NotesContents"}) {
+    if (ok && !tableColumns("main", table).contains("uuid"))
+      ok = query.exec(
+          QStringLiteral("ALTER TABLE %1 ADD COLUMN uuid TEXT").arg(table));
+    ok = ok && query.exec(QStringLiteral("UPDATE %1 SET uuid = "
+                                         "lower(hex(randomblob(16))) WHERE "
+                                         "uuid IS NULL")
+                              .arg(table));
+  }
+  ok = ok &&
+       query.exec("CREATE UNIQUE INDEX IF NOT EXISTS idx_notes_uuid ON Notes "
+                  "(uuid)") &&
+       query.exec("CREATE UNIQUE INDEX IF NOT EXISTS idx_notescontents_uuid "
+                  "ON NotesContents (uuid)") &&
+       query.exec("INSERT OR IGNORE INTO SyncMeta (key, value) VALUES "
+                  "('site_id', lower(hex(randomblob(16)))), ('clock', 1), "
+                  "('applying', 0)");
+
+  const QString siteAndClock = QStringLiteral("(SELECT value FROM SyncMeta "
+                                              "WHERE key = 'site_id'), 1");
+  const QString noteColumns = QStringLiteral(", title, created_at, sort_key)");
+  const QString contentColumns = QStringLiteral(
+      ", content, completed, created_at, sort_key, due_at, note_uuid, "
+      "parent_uuid)");
+  const QString noteValues = QStringLiteral(
+      "'Notes', n.uuid, 0, n.title, n.created_at, n.sort_key FROM Notes n");
+  const QString contentValues = QStringLiteral(
+      "'NotesContents', c.uuid, 0, c.content, c.completed, c.created_at, "
+      "c.sort_key, c.due_at, (SELECT uuid FROM Notes WHERE note_id = "
+      "c.note_id), (SELECT uuid FROM NotesContents p WHERE p.id = "
+      "c.parent_id) FROM NotesContents c");
+  ok = ok && query.exec("SELECT 1 FROM ChangeLog LIMIT 1");
+  if (ok && !query.next()) {
+    query.finish();
+    ok = query.exec(QStringLiteral("%1%2 SELECT %3, %4 ORDER BY n.note_id")
+                        .arg(logHeader, noteColumns, siteAndClock,
+                             noteValues)) &&
+         query.exec(QStringLiteral("%1%2 SELECT %3, %4 WHERE c.rule_id IS "
+                                   "NULL ORDER BY c.id")
+                        .arg(logHeader, contentColumns, siteAndClock,
+                             contentValues));
+  }
+  query.finish();
+
+  const QString logNote =
+      QStringLiteral("%1; %2%3 SELECT %4, %5 WHERE n.note_id = NEW.note_id;")
+          .arg(nextClock, logHeader, noteColumns, logSite, noteValues);
+  const QString logContent =
+      QStringLiteral("%1; %2%3 SELECT %4, %5 WHERE c.id = NEW.id AND "
+                     "c.rule_id IS NULL;")
+          .arg(nextClock, logHeader, contentColumns, logSite, contentValues);
+  const QString logDelete =
+      QStringLiteral("%1; %2) VALUES (%3, '%4', OLD.uuid, 1);")
+          .arg(nextClock, logHeader, logSite);
+  const QString logOrder =
+      QStringLiteral("%1; %2, sort_key) VALUES (%3, '%4.sort_key', NEW.uuid, "
+                     "0, NEW.sort_key);")
+          .arg(nextClock, logHeader, logSite);
+  const QStringList triggers = {
+      QStringLiteral("CREATE TRIGGER IF NOT EXISTS changelog_notes_insert "
+                     "AFTER INSERT ON Notes WHEN %1 BEGIN UPDATE Notes SET "
+                     "uuid = lower(hex(randomblob(16))) WHERE note_id = "
+                     "NEW.note_id AND uuid IS NULL; %2 END")
+          .arg(notApplying, logNote),
+      QStringLiteral("CREATE TRIGGER IF NOT EXISTS changelog_notes_update "
+                     "AFTER UPDATE OF title ON Notes WHEN %1 BEGIN %2 END")
+          .arg(notApplying, logNote),
+      QStringLiteral("CREATE TRIGGER IF NOT EXISTS changelog_notes_order "
+                     "AFTER UPDATE OF sort_key ON Notes WHEN %1 AND "
+                     "NEW.sort_key IS NOT OLD.sort_key BEGIN %2 END")
+          .arg(notApplying, logOrder.arg("Notes")),
+      QStringLiteral("CREATE TRIGGER IF NOT EXISTS changelog_notes_delete "
+                     "AFTER DELETE ON Notes WHEN %1 AND OLD.uuid IS NOT NULL "
+                     "BEGIN %2 END")
+          .arg(notApplying, logDelete.arg("Notes")),
+      QStringLiteral("CREATE TRIGGER IF NOT EXISTS "
+                     "changelog_notescontents_insert AFTER INSERT ON "
+                     "NotesContents WHEN %1 BEGIN UPDATE NotesContents SET "
+                     "uuid = lower(hex(randomblob(16))) WHERE id = NEW.id AND "
+                     "uuid IS NULL; %2 END")
+          .arg(notApplying, logContent),
+      QStringLiteral("CREATE TRIGGER IF NOT EXISTS "
+                     "changelog_notescontents_update AFTER UPDATE OF content, "
+                     "completed, due_at, note_id, parent_id, rule_id ON "
+                     "NotesContents WHEN %1 BEGIN %2 END")
+          .arg(notApplying, logContent),
+      QStringLiteral("CREATE TRIGGER IF NOT EXISTS "
+                     "changelog_notescontents_order AFTER UPDATE OF sort_key "
+                     "ON NotesContents WHEN %1 AND NEW.rule_id IS NULL AND "
+                     "NEW.sort_key IS NOT OLD.sort_key BEGIN %2 END")
+          .arg(notApplying, logOrder.arg("NotesContents")),
+      QStringLiteral("CREATE TRIGGER IF NOT EXISTS "
+                     "changelog_notescontents_delete AFTER DELETE ON "
+                     "NotesContents WHEN %1 AND OLD.uuid IS NOT NULL AND "
+                     "OLD.rule_id IS NULL BEGIN %2 END")
+          .arg(notApplying, logDelete.arg("NotesContents"))};
+  for (const QString &trigger : triggers)
+    ok = ok && query.exec(trigger);
+  if (!ok)
+    qDebug() << "Change log setup error:" << query.lastError().text();
+  return ok;
+}
+
+/**
+ * @brief Gives the database a new site ID if it was copied or moved since it was last opened.
+ *
+ * SyncMeta keeps the canonical path the site ID belongs to. A copy of a
+ * database file would otherwise share the site ID of the original, and
+ * pullChanges() refuses to sync two databases with the same site ID (their
+ * changes would be taken for each other's own). The new ID is drawn before
+ * the copy writes anything, so every change it makes is told apart from the
+ * original's; peers simply pull its change log once more, as from a new
+ * site. The first open after an upgrade only records the path.
+ *
+ * @return true if the site ID is claimed for the current path, false otherwise.
+ */
+bool DBManager::claimSiteId() {
+  const QString path = QFileInfo(m_dbPath).canonicalFilePath();
+  QSqlQuery query(m_db);
+  if (!query.exec("SELECT value FROM SyncMeta WHERE key = 'site_path'"))
+    return false;
+  const bool known = query.next();
+  const QString sitePath = known ? query.value(0).toString() : QString();
+  query.finish();
+  if (known && sitePath == path)
+    return true;
+  bool ok = beginTransaction();
+  if (ok && known) {
+    qDebug() << "Database moved or copied from" << sitePath
+             << "- drawing a new site ID";
+    ok = query.exec("UPDATE SyncMeta SET value = lower(hex(randomblob(16))) "
+                    "WHERE key = 'site_id'");
+  }
+  query.prepare("INSERT INTO SyncMeta (key, value) VALUES ('site_path', "
+                ":path) ON CONFLICT (key) DO UPDATE SET value = "
+                "excluded.value");
+  query.bindValue(":path", path);
+  ok = ok && query.exec();
+  if (!ok) {
+    qDebug() << "Site ID error:" << query.lastError().text();
+    rollbackTransaction();
+    return false;
+  }
+  return commitTransaction();
+}
+
+/**
+ * @brief Returns the random ID that identifies this database in the change log.
+ */
+QString DBManager::siteId() {
+  QSqlQuery query(m_db);
+  if (query.exec("SELECT value FROM SyncMeta WHERE key = 'site_id'") &&
+      query.next())
+    return query.value(0).toString();
+  return QString();
+}
+
+/**
+ * @brief Applies the changes another database made since the last pull from it.
+ *
+ * The other database is attached and its ChangeLog read from the last
+ * sequence number pulled from its site (kept in SyncPeers), so the cost is
+ * proportional to the number of new changes, not to the size of either
+ * database. Changes that originated here are skipped. Every other change is
+ * applied if it is newer than the latest change of the same row and kind
+ * known here, comparing (Lamport clock, site ID) so that every database
+ * resolves a conflict the same way: last writer wins per row, with the
+ * ordering key versioned apart from the other columns (see
+ * installChangeLog()). Row changes set sort_key only when they create the
+ * row. Applied changes are
+ * copied into the local ChangeLog with their original site and clock, so
+ * they are passed on to third databases, and the local clock moves past the
+ * newest clock seen. How far the other database has pulled this one's
+ * ChangeLog is copied from its SyncPeers into acked_seq here, which bounds
+ * the change log compaction of the maintenance pass.
+ *
+ * A deleted note takes its tasks with it; a task whose note no longer
+ * exists here is dropped. Everything runs in one transaction, and
+ * databaseRestored() is emitted when rows changed so models reload.
+ *
+ * @param peerPath Path of the other database file, which must have been opened by DBManager once.
+ * @return The number of changes applied, or -1 on failure.
+ */
+int DBManager::pullChanges(const QString &peerPath) {
+  TRACE_SPAN(span, "db");
+  const QString localSite = siteId();
+  if (localSite.isEmpty() || !attachDatabase("syncpeer", peerPath))
+    return -1;
+  QSqlQuery query(m_db);
+  QString peerSite;
+  if (query.exec("SELECT value FROM syncpeer.SyncMeta WHERE key = 'site_id'") &&
+      query.next())
+    peerSite = query.value(0).toString();
+  query.finish();
+  if (peerSite.isEmpty() || peerSite == localSite) {
+    qDebug() << "Cannot sync with" << peerPath << "(no or same site ID)";
+    detachDatabase("syncpeer");
+    return -1;
+  }
+
+  int applied = 0;
+  qint64 lastSeq = 0;
+  qint64 ackedSeq = 0;
+  qint64 clock = 0;
+  bool ok = beginTransaction() &&
+            query.exec("UPDATE SyncMeta SET value = 1 WHERE key = 'applying'");
+  query.prepare("SELECT last_seq FROM SyncPeers WHERE site_id = :site");
+  query.bindValue(":site", peerSite);
+  if (ok && query.exec() && query.next())
+    lastSeq = query.value(0).toLongLong();
+  query.prepare("SELECT last_seq FROM syncpeer.SyncPeers WHERE site_id = "
+                ":site");
+  query.bindValue(":site", localSite);
+  if (ok && query.exec() && query.next())
+    ackedSeq = query.value(0).toLongLong();
+
+  QSqlQuery version(m_db);
+  version.prepare("SELECT clock, site_id FROM ChangeLog WHERE row_uuid = "
+                  ":uuid AND table_name = :table ORDER BY clock DESC, "
+                  "site_id DESC LIMIT 1");
+  QSqlQuery deleteNote(m_db);
+  deleteNote.prepare("DELETE FROM Notes WHERE uuid = :uuid");
+  QSqlQuery deleteNoteContents(m_db);
+  deleteNoteContents.prepare("DELETE FROM NotesContents WHERE note_id IN "
+                             "(SELECT note_id FROM Notes WHERE uuid = :uuid)");
+  QSqlQuery deleteContent(m_db);
+  deleteContent.prepare("DELETE FROM NotesContents WHERE uuid = :uuid");
+  QSqlQuery upsertNote(m_db);
+  // A row created (or re-created) here takes the newest ordering key known
+  // here, which may be newer than the one the row change carries.
+  upsertNote.prepare(
+      "INSERT INTO Notes (uuid, title, created_at, sort_key) VALUES (:uuid, "
+      ":title, :created_at, COALESCE((SELECT sort_key FROM ChangeLog WHERE "
+      "row_uuid = :order_uuid AND table_name = 'Notes.sort_key' ORDER BY "
+      "clock DESC, site_id DESC LIMIT 1), :sort_key)) ON CONFLICT (uuid) DO "
+      "UPDATE SET title = excluded.title, created_at = excluded.created_at");
+  QSqlQuery upsertContent(m_db);
+  upsertContent.prepare(
+      "INSERT INTO NotesContents (uuid, note_id, content, completed, "
+      "created_at, sort_key, due_at, parent_id) SELECT :uuid, n.note_id, "
+      ":content, :completed, :created_at, COALESCE((SELECT sort_key FROM "
+      "ChangeLog WHERE row_uuid = :order_uuid AND table_name = "
+      "'NotesContents.sort_key' ORDER BY clock DESC, site_id DESC LIMIT 1), "
+      ":sort_key), :due_at, (SELECT id FROM NotesContents WHERE uuid = "
+      ":parent_uuid) FROM Notes n WHERE "
+      "n.uuid = :note_uuid ON CONFLICT (uuid) DO UPDATE SET note_id = "
+      "excluded.note_id, content = excluded.content, completed = "
+      "excluded.completed, created_at = excluded.created_at, due_at = "
+      "excluded.due_at, parent_id = excluded.parent_id");
+  QSqlQuery orderNote(m_db);
+  orderNote.prepare("UPDATE Notes SET sort_key = :sort_key WHERE uuid = :uuid");
+  QSqlQuery orderContent(m_db);
+  orderContent.prepare("UPDATE NotesContents SET sort_key = :sort_key WHERE "
+                       "uuid = :uuid");
+  QSqlQuery log(m_db);
+  log.prepare("INSERT INTO ChangeLog (site_id, clock, table_name, row_uuid, "
+              "deleted, title, content, completed, created_at, sort_key, "
+              "due_at, note_uuid, parent_uuid) SELECT site_id, clock, "
+              "table_name, row_uuid, deleted, title, content, completed, "
+              "created_at, sort_key, due_at, note_uuid, parent_uuid FROM "
+              "syncpeer.ChangeLog WHERE seq = :seq");
+  QSqlQuery changes(m_db);
+  changes.setForwardOnly(true);
+  changes.prepare("SELECT * FROM syncpeer.ChangeLog WHERE seq > :seq ORDER "
+                  "BY seq");
+  changes.bindValue(":seq", lastSeq);
+  ok = ok && changes.exec();
+  while (ok && changes.next()) {
+    lastSeq = changes.value("seq").toLongLong();
+    const qint64 changeClock = changes.value("clock").toLongLong();
+    const QString changeSite = changes.value("site_id").toString();
+    const QString uuid = changes.value("row_uuid").toString();
+    clock = qMax(clock, changeClock);
+    if (changeSite == localSite)
+      continue;
+    const QString table = changes.value("table_name").toString();
+    version.bindValue(":uuid", uuid);
+    version.bindValue(":table", table);
+    if (!version.exec()) {
+      ok = false;
+      break;
+    }
+    if (version.next()) {
+      const qint64 localClock = version.value(0).toLongLong();
+      if (changeClock < localClock ||
+          (changeClock == localClock &&
+           changeSite <= version.value(1).toString()))
+        continue;
+    }
+
+    const bool isNote = table.section('.', 0, 0) == QLatin1String("Notes");
+    const bool isOrder = table.endsWith(QLatin1String(".sort_key"));
+    QSqlQuery *apply = nullptr;
+    if (isOrder) {
+      apply = isNote ? &orderNote : &orderContent;
+      apply->bindValue(":sort_key", changes.value("sort_key"));
+    } else if (changes.value("deleted").toBool()) {
+      if (isNote) {
+        deleteNoteContents.bindValue(":uuid", uuid);
+        ok = deleteNoteContents.exec();
+        apply = &deleteNote;
+      } else {
+        apply = &deleteContent;
+      }
+    } else if (isNote) {
+      apply = &upsertNote;
+      apply->bindValue(":title", changes.value("title"));
+      apply->bindValue(":created_at", changes.value("created_at"));
+      apply->bindValue(":sort_key", changes.value("sort_key"));
+    } else {
+      apply = &upsertContent;
+      for (const char *column : {"content", "completed", "created_at",
+                                 "sort_key", "due_at", "parent_uuid",
+                                 "note_uuid"})
+        apply->bindValue(QLatin1Char(':') + QLatin1String(column),
+                         changes.value(column));
+    }
+    apply->bindValue(":uuid", uuid);
+    if (apply == &upsertNote || apply == &upsertContent)
+      apply->bindValue(":order_uuid", uuid);
+    ok = ok && apply->exec();
+    if (!ok) {
+      qDebug() << "Sync apply error:" << apply->lastError().text();
+      break;
+    }
+    // A task whose note does not exist here inserts nothing. The key of a
+    // row that does not exist here is still logged, in case a later change
+    // re-creates the row.
+    if (apply == &upsertContent && apply->numRowsAffected() == 0)
+      continue;
+    log.bindValue(":seq", lastSeq);
+    ok = log.exec();
+    ++applied;
+  }
+  if (!ok)
+    qDebug() << "Sync error:" << changes.lastError().text()
+             << log.lastError().text();
+  changes.finish();
+
+  query.prepare("UPDATE SyncMeta SET value = max(value, :clock) WHERE key = "
+                "'clock'");
+  query.bindValue(":clock", clock);
+  ok = ok && query.exec();
+  query.prepare("INSERT INTO SyncPeers (site_id, last_seq, acked_seq) VALUES "
+                "(:site, :seq, :acked) ON CONFLICT (site_id) DO UPDATE SET "
+                "last_seq = excluded.last_seq, acked_seq = "
+                "excluded.acked_seq");
+  query.bindValue(":site", peerSite);
+  query.bindValue(":seq", lastSeq);
+  query.bindValue(":acked", ackedSeq);
+  ok = ok && query.exec() &&
+       query.exec("UPDATE SyncMeta SET value = 0 WHERE key = 'applying'");
+  if (ok)
+    ok = commitTransaction();
+  else
+    rollbackTransaction();
+  query.finish();
+  detachDatabase("syncpeer");
+  span.setQuery(changes, applied);
+  if (!ok)
+    return -1;
+  if (applied > 0) {
+    scheduleAttachmentGarbageCollection();
+    emit databaseRestored();
+  }
+  return applied;
+}
+
+/* ================== BACKUPS ================== */
+/**
+ * @brief Starts an online backup of the database on a background thread.
+ *
+ * The snapshot is written by a DBBackupTask using its own connection, so the UI
+ * keeps working while a large database is copied. backupFinished() is emitted
+ * when the snapshot has been written and verified (or has failed). The WAL
+ * grows while the backup runs, since its read transaction pins the pages the
+ * checkpoints would otherwise recycle; once it is done a passive checkpoint
+ * runs so the next write restarts the WAL, truncated to walSizeLimitBytes.
+ *
+ * @param destPath File to write the snapshot to. An existing file is replaced.
+ * @return true if the backup was started, false if one is already running or
+ *         the database is not open.
+ */
+bool DBManager::startBackup(const QString &destPath) {
+  if (m_backupRunning || !m_db.isOpen())
+    return false;
+  m_backupRunning = true;
+  DBBackupTask *task = new DBBackupTask(m_dbPath, destPath);
+  QObject::connect(
+      task, &DBBackupTask::finished, this,
+      [this](const QString &path, bool ok, const QString &message) {
+        m_backupRunning = false;
+        QSqlQuery checkpoint(m_db);
+        checkpoint.exec("PRAGMA wal_checkpoint(PASSIVE)");
+        if (!ok)
+          qDebug() << "Backup failed:" << path << message;
+        else if (!m_snapshotDir.isEmpty() &&
+                 QFileInfo(path).absolutePath() ==
+                     QDir(m_snapshotDir).absolutePath())
+          pruneSnapshots();
+        emit backupFinished(path, ok, message);
+      },
+      Qt::QueuedConnection);
+  QThreadPool::globalInstance()->start(task);
+  return true;
+}
+
+/**
+ * @brief Takes a snapshot of the database periodically, keeping the newest ones.
+ *
+ * Snapshots are written to @p directory as "database-yyyyMMdd-HHmmss.db".
+ * After every successful snapshot, all but the newest @p keepCount snapshots
+ * in the directory are deleted.
+ *
+ * @param directory Directory receiving the snapshots; created if missing.
+ * @param intervalMs Time between two snapshots in milliseconds.
+ * @param keepCount Number of snapshots to keep.
+ */
+void DBManager::startScheduledSnapshots(const QString &directory,
+                                        int intervalMs, int keepCount) {
+  QDir().mkpath(directory);
+  m_snapshotDir = directory;
+  m_snapshotKeep = qMax(1, keepCount);
+  m_snapshotTimer.start(intervalMs);
+}
+
+/**
+ * @brief Stops taking scheduled snapshots. A running backup is not cancelled.
+ */
+void DBManager::stopScheduledSnapshots() {
+  m_snapshotTimer.stop();
+  m_snapshotDir.clear();
+}
+
+/**
+ * @brief Starts a scheduled snapshot unless a backup is already running.
+ */
+void DBManager::takeSnapshot() {
+  const QString name =
+      QStringLiteral("database-%1.db")
+          .arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss"));
+  startBackup(QDir(m_snapshotDir).filePath(name));
+}
+
+/**
+ * @brief Deletes the oldest scheduled snapshots beyond the configured count.
+ */
+void DBManager::pruneSnapshots() {
+  QDir dir(m_snapshotDir);
+  const QStringList snapshots =
+      dir.entryList({"database-*.db"}, QDir::Files, QDir::Name | QDir::Reversed);
+  for (int i = m_snapshotKeep; i < snapshots.size(); ++i)
+    dir.remove(snapshots.at(i));
+}
+
+/* ================== MAINTENANCE ================== */
+namespace {
+/**
+ * @struct orphanSweep
+ * @brief One kind of row the maintenance pass reclaims once its owner is gone (or it is superseded).
+ *
+ * The scan statement reads the next :limit rows after :cursor and returns the
+ * cursor key, whether the row is orphaned, the row ID of its change event and
+ * the value named valueName. Orphaned rows are deleted by key with the remove
+ * statement; tasks (remove == nullptr) are deleted with their sub-tasks.
+ */
+struct orphanSweep {
+  const char *name;
+  DBChangeEvent::Table table;
+  bool publish;
+  const char *valueName;
+  const char *scan;
+  const char *remove;
+};
+
+const orphanSweep orphanSweeps[] = {
+    {"tasks", DBChangeEvent::NotesContents, true, nullptr,
+     "SELECT c.id, n.note_id IS NULL OR (c.parent_id IS NOT NULL AND p.id IS "
+     "NULL), c.id, NULL FROM NotesContents c LEFT JOIN Notes n ON n.note_id "
+     "= c.note_id LEFT JOIN NotesContents p ON p.id = c.parent_id WHERE c.id "
+     "> :cursor ORDER BY c.id LIMIT :limit",
+     nullptr},
+    {"task_tags", DBChangeEvent::TaskTags, true, "tag_id",
+     "SELECT t.rowid, c.id IS NULL, t.content_id, t.tag_id FROM TaskTags t "
+     "LEFT JOIN NotesContents c ON c.id = t.content_id WHERE t.rowid > "
+     ":cursor ORDER BY t.rowid LIMIT :limit",
+     "DELETE FROM TaskTags WHERE rowid = :key"},
+    {"note_tags", DBChangeEvent::NoteTags, true, "tag_id",
+     "SELECT t.rowid, n.note_id IS NULL, t.note_id, t.tag_id FROM NoteTags t "
+     "LEFT JOIN Notes n ON n.note_id = t.note_id WHERE t.rowid > :cursor "
+     "ORDER BY t.rowid LIMIT :limit",
+     "DELETE FROM NoteTags WHERE rowid = :key"},
+    {"recurrence_rules", DBChangeEvent::RecurrenceRules, true, nullptr,
+     "SELECT r.rule_id, n.note_id IS NULL, r.rule_id, NULL FROM "
+     "RecurrenceRules r LEFT JOIN Notes n ON n.note_id = r.note_id WHERE "
+     "r.rule_id > :cursor ORDER BY r.rule_id LIMIT :limit",
+     "DELETE FROM RecurrenceRules WHERE rule_id = :key"},
+    {"attachments", DBChangeEvent::Attachments, true, "content_id",
+     "SELECT a.id, c.id IS NULL, a.id, a.content_id FROM Attachments a LEFT "
+     "JOIN NotesContents c ON c.id = a.content_id WHERE a.id > :cursor ORDER "
+     "BY a.id LIMIT :limit",
+     "DELETE FROM Attachments WHERE id = :key"},
+    {"revisions", DBChangeEvent::NotesContents, false, nullptr,
+     "SELECT r.content_id, c.id IS NULL, r.content_id, NULL FROM (SELECT "
+     "DISTINCT content_id FROM ContentRevisions WHERE content_id > :cursor "
+     "ORDER BY content_id LIMIT :limit) r LEFT JOIN NotesContents c ON c.id "
+     "= r.content_id ORDER BY r.content_id",
+     "DELETE FROM ContentRevisions WHERE content_id = :key"},
+    // Change log entries every known peer has pulled that are neither the
+    // first of their row nor the latest of their row and kind (row or
+    // ordering key). The first one stays so that a new peer still creates
+    // each row before the rows that refer to it.
+    {"changelog", DBChangeEvent::NotesContents, false, nullptr,
+     "SELECT l.seq, l.seq <= (SELECT COALESCE(MIN(acked_seq), l.seq) FROM "
+     "SyncPeers) AND EXISTS (SELECT 1 FROM ChangeLog o WHERE o.row_uuid = "
+     "l.row_uuid AND o.seq < l.seq) AND EXISTS (SELECT 1 FROM ChangeLog n "
+     "WHERE n.row_uuid = l.row_uuid AND n.table_name = l.table_name AND "
+     "n.seq > l.seq), l.seq, NULL FROM ChangeLog l WHERE l.seq > :cursor "
+     "ORDER BY l.seq LIMIT :limit",
+     "DELETE FROM ChangeLog WHERE seq = :key"},
+};
+const int orphanSweepCount = sizeof(orphanSweeps) / sizeof(orphanSweeps[0]);
+} // namespace
+
+/**
+ * @brief Starts reclaiming orphaned rows and checking the database in the background.
+ *
+ * Rows can outlive their owner: tasks of notes deleted by older versions,
+ * tasks whose parent is gone, and tags, recurrence rules, attachments or
+ * revisions of deleted notes and tasks (for example after a crash or a write
+ * by another tool). The sync ChangeLog also grows with every write: an entry
+ * that a later entry of the same row supersedes is dropped once every known
+ * peer has pulled it, unless it is the first entry of its row. A maintenance
+ * pass walks every table holding such rows in keyset chunks of
+ * maintenanceChunkSize rows and deletes the orphans of a chunk in a short
+ * transaction of its own, so the write lock is never held for long. Each
+ * timer tick works for at most maintenanceStepBudgetMs and ticks are skipped
+ * while a transaction is open. The chunk transactions do not wait for the
+ * write lock: if another connection holds it, the rest of the tick is
+ * skipped and the chunk is swept again on the next one. A change
+ * event is published for every deleted row.
+ *
+ * After each pass, maintenanceFinished() reports the number of rows removed
+ * per kind and the next table is checked with "PRAGMA quick_check" on a pool
+ * thread (see DBCheckTask); integrityChecked() reports the result. The next
+ * pass starts @p passIntervalMs later.
+ *
+ * @param passIntervalMs Time between the end of a pass and the next one.
+ */
+void DBManager::startMaintenance(int passIntervalMs) {
+  m_maintenancePassIntervalMs = passIntervalMs;
+  m_maintenanceTimer.start(maintenanceStepIntervalMs);
+}
+
+/**
+ * @brief Stops the maintenance passes. A running integrity check is not cancelled.
+ */
+void DBManager::stopMaintenance() { m_maintenanceTimer.stop(); }
+
+/**
+ * @brief Sweeps chunks of the current maintenance pass until the step's time budget is spent.
+ */
+void DBManager::runMaintenanceStep() {
+  if (m_transactionDepth > 0 || !m_db.isOpen())
+    return;
+  TRACE_SPAN(span, "db");
+  if (m_maintenanceTimer.interval() != maintenanceStepIntervalMs)
+    m_maintenanceTimer.start(maintenanceStepIntervalMs);
+  QElapsedTimer budget;
+  budget.start();
+  while (budget.elapsed() < maintenanceStepBudgetMs) {
+    const int scanned = sweepOrphanChunk();
+    if (scanned < 0)
+      return;
+    if (scanned == maintenanceChunkSize)
+      continue;
+    m_maintenanceCursor = 0;
+    if (++m_maintenanceSweep == orphanSweepCount) {
+      finishMaintenancePass();
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Scans the next chunk of the current sweep and deletes its orphaned rows.
+ *
+ * The cursor only advances if the deletes were committed, so a failed chunk,
+ * or one whose write lock was busy, is scanned again on the next tick. A
+ * chunk deletes at most maintenanceChunkSize orphaned tasks with their
+ * subtrees; when an orphaned subtree is larger, its deepest tasks go first
+ * and the cursor stops before it, so the next chunk carries on with it.
+ *
+ * @return The number of rows scanned (fewer than maintenanceChunkSize once the table is done), or -1 on error.
+ */
+int DBManager::sweepOrphanChunk() {
+  const orphanSweep &sweep = orphanSweeps[m_maintenanceSweep];
+  QSqlQuery query(m_db);
+  query.prepare(sweep.scan);
+  query.bindValue(":cursor", m_maintenanceCursor);
+  query.bindValue(":limit", maintenanceChunkSize);
+  if (!query.exec()) {
+    qDebug() << "Maintenance scan error:" << sweep.name
+             << query.lastError().text();
+    return -1;
+  }
+  int scanned = 0;
+  qint64 cursor = m_maintenanceCursor;
+  QList<QPair<qint64, DBChangeEvent>> orphans;
+  while (query.next()) {
+    ++scanned;
+    cursor = query.value(0).toLongLong();
+    if (!query.value(1).toBool())
+      continue;
+    DBChangeEvent event{sweep.table, DBChangeEvent::Deleted,
+                        query.value(2).toInt(), -1, {}};
+    if (sweep.valueName)
+      event.values.insert(sweep.valueName, query.value(3));
+    orphans.append({cursor, event});
+  }
+  query.finish();
+  if (orphans.isEmpty()) {
+    m_maintenanceCursor = cursor;
+    return scanned;
+  }
+
+  if (!tryBeginTransaction())
+    return -1;
+  int removed = 0;
+  bool ok = true;
+  for (int i = 0; ok && i < orphans.size(); ++i) {
+    if (!sweep.remove) {
+      // At most maintenanceChunkSize tasks per chunk, however large the
+      // orphaned subtrees are; an unfinished one is scanned again next.
+      const int taskId = int(orphans.at(i).first);
+      QList<int> ids;
+      if (removed < maintenanceChunkSize)
+        ok = removeTaskSubtree(taskId, ids, maintenanceChunkSize - removed);
+      removed += ids.size();
+      const bool unfinished = ids.isEmpty()
+                                  ? removed >= maintenanceChunkSize
+                                  : ids.first() != taskId;
+      if (ok && unfinished) {
+        cursor = orphans.at(i).first - 1;
+        scanned = maintenanceChunkSize;
+        break;
+      }
+      continue;
+    }
+    query.prepare(sweep.remove);
+    query.bindValue(":key", orphans.at(i).first);
+    ok = query.exec();
+    if (ok && query.numRowsAffected() > 0) {
+      ++removed;
+      if (sweep.publish)
+        publishChange(orphans.at(i).second);
+    }
+  }
+  if (!ok) {
+    qDebug() << "Maintenance delete error:" << sweep.name
+             << query.lastError().text();
+    rollbackTransaction();
+    return -1;
+  }
+  if (!commitTransaction())
+    return -1;
+  m_maintenanceCursor = cursor;
+  if (removed > 0) {
+    m_maintenanceRemoved[sweep.name] =
+        m_maintenanceRemoved.value(sweep.name).toInt() + removed;
+    scheduleAttachmentGarbageCollection();
+  }
+  return scanned;
+}
+
+/**
+ * @brief Starts a transaction only if the write lock is free right away.
+ *
+ * The busy timeout is set to zero for the BEGIN, so background work never
+ * blocks the event loop waiting for another connection.
+ *
+ * @return true if the transaction is active, false otherwise.
+ */
+bool DBManager::tryBeginTransaction() {
+  QSqlQuery query(m_db);
+  query.exec("PRAGMA busy_timeout = 0");
+  const bool started = beginTransaction();
+  query.exec(QStringLiteral("PRAGMA busy_timeout = %1").arg(busyTimeoutMs));
+  return started;
+}
+
+/**
+ * @brief Reports a finished maintenance pass, starts the next integrity check and waits for the next pass.
+ */
+void DBManager::finishMaintenancePass() {
+  m_maintenanceSweep = 0;
+  const QVariantMap removed = m_maintenanceRemoved;
+  m_maintenanceRemoved.clear();
+  if (!removed.isEmpty())
+    qDebug() << "Maintenance removed orphaned rows:" << removed;
+  emit maintenanceFinished(removed);
+  startIntegrityCheck();
+  m_maintenanceTimer.start(m_maintenancePassIntervalMs);
+}
+
+/**
+ * @brief Checks the next table of the database on a pool thread, unless a check is still running.
+ *
+ * Tables are checked in name order, one per maintenance pass.
+ */
+void DBManager::startIntegrityCheck() {
+  if (m_checkRunning)
+    return;
+  QSqlQuery query(m_db);
+  QStringList tables;
+  query.exec("SELECT name FROM sqlite_master WHERE type = 'table' AND name "
+             "NOT LIKE 'sqlite_%' ORDER BY name");
+  while (query.next())
+    tables.append(query.value(0).toString());
+  if (tables.isEmpty())
+    return;
+  m_checkRunning = true;
+  DBCheckTask *task =
+      new DBCheckTask(m_dbPath, tables.at(m_checkedTables++ % tables.size()));
+  QObject::connect(
+      task, &DBCheckTask::finished, this,
+      [this](const QString &table, bool ok, const QString &message) {
+        m_checkRunning = false;
+        if (!ok)
+          qDebug() << "Integrity check failed:" << table << message;
+        emit integrityChecked(table, ok, message);
+      },
+      Qt::QueuedConnection);
+  QThreadPool::globalInstance()->start(task);
+}
+
+/**
+ * @brief Returns the column names of a table in the given schema.
+ *
+ * @param schema The schema name ("main" or an attached database).
+ * @param table The table name.
+ * @return The column names in declaration order, or an empty list if the table does not exist.
+ */
+QStringList DBManager::tableColumns(const QString &schema,
+                                    const QString &table) {
+  QStringList columns;
+  QSqlQuery query(m_db);
+  query.exec(QStringLiteral("PRAGMA %1.table_info(\"%2\")").arg(schema, table));
+  while (query.next())
+    columns.append(query.value("name").toString());
+  return columns;
+}
+
+/**
+ * @brief Restores the database contents from a snapshot file.
+ *
+ * The snapshot is attached to the open connection and every table present in
+ * both databases is replaced by the snapshot's rows inside a single
+ * transaction, so the restore either fully applies or leaves the database
+ * untouched. Only columns present in both tables are copied. Tables the
+ * snapshot does not have (it predates them) are emptied, since their rows
+ * refer to tasks and notes that are replaced. The AUTOINCREMENT counters are
+ * kept, so IDs handed out after the snapshot was taken are never reused for
+ * other rows. The sync tables (ChangeLog, SyncMeta, SyncPeers) are
+ * kept, so the restored rows are logged as changes of this site and reach
+ * other databases on the next sync. Attachment files are not part of
+ * snapshots: the snapshot's Blobs rows are merged into the current ones and
+ * the reference counts recomputed, so an attachment whose file was collected
+ * after the snapshot was taken cannot be opened. databaseRestored() is
+ * emitted on success so models can reload.
+ *
+ * @param snapshotPath Path to a snapshot written by startBackup().
+ * @return true if the restore was committed, false otherwise.
+ */
+bool DBManager::restoreFromBackup(const QString &snapshotPath) {
+  if (!m_db.isOpen() || !QFile::exists(snapshotPath))
+    return false;
+
+  QSqlQuery query(m_db);
+  query.prepare("ATTACH DATABASE :path AS snapshot");
+  query.bindValue(":path", snapshotPath);
+  if (!query.exec()) {
+    qDebug() << "Attach snapshot error:" << query.lastError().text();
+    return false;
+  }
+
+  // The sync tables stay: the restore is logged as local changes instead.
+  // Blobs are merged rather than replaced, so the files of current
+  // attachments are still known to the garbage collection.
+  const QStringList keptTables = {"ChangeLog", "SyncMeta", "SyncPeers",
+                                  "Blobs"};
+  QStringList tables;
+  query.exec("SELECT name FROM main.sqlite_master WHERE type = 'table' AND "
+             "name NOT LIKE 'sqlite_%'");
+  while (query.next())
+    if (!keptTables.contains(query.value(0).toString()))
+      tables.append(query.value(0).toString());
+
+  bool ok = beginTransaction();
+  for (const QString &table : qAsConst(tables)) {
+    if (!ok)
+      break;
+    const QStringList snapshotColumns = tableColumns("snapshot", table);
+    if (snapshotColumns.isEmpty()) {
+      // Older snapshots lack the table; keep none of its rows for the
+      // restored notes and tasks.
+      ok = query.exec(QStringLiteral("DELETE FROM main.\"%1\"").arg(table));
+      if (!ok)
+        qDebug() << "Restore error:" << table << query.lastError().text();
+      continue;
+    }
+    QStringList columns;
+    for (const QString &column : tableColumns("main", table))
+      if (snapshotColumns.contains(column))
+        columns.append("\"" + column + "\"");
+    const QString columnList = columns.join(", ");
+    ok = query.exec(QStringLiteral("DELETE FROM main.\"%1\"").arg(table)) &&
+         query.exec(QStringLiteral("INSERT INTO main.\"%1\" (%2) SELECT %2 "
+                                   "FROM snapshot.\"%1\"")
+                        .arg(table, columnList));
+    // Snapshots taken before ordering keys existed keep the creation order.
+    if (ok && !snapshotColumns.contains("sort_key")) {
+      if (table == "Notes")
+        ok = rewriteSortKeys("Notes", "note_id",
+                             "ORDER BY created_at DESC, note_id DESC");
+      else if (table == "NotesContents")
+        ok = rewriteSortKeys("NotesContents", "id", "ORDER BY created_at, id");
+    }
+    if (!ok)
+      qDebug() << "Restore error:" << table << query.lastError().text();
+  }
+  if (ok && !tableColumns("snapshot", "Blobs").isEmpty())
+    ok = query.exec("INSERT INTO main.Blobs (hash, size) SELECT hash, size "
+                    "FROM snapshot.Blobs WHERE true ON CONFLICT (hash) DO "
+                    "NOTHING");
+  if (ok)
+    ok = query.exec("UPDATE main.Blobs SET ref_count = (SELECT COUNT(*) FROM "
+                    "main.Attachments a WHERE a.hash = Blobs.hash)");
+  if (ok)
+    ok = commitTransaction();
+  else
+    rollbackTransaction();
+
+  query.finish();
+  query.exec("DETACH DATABASE snapshot");
+  if (ok) {
+    scheduleAttachmentGarbageCollection();
+    emit databaseRestored();
+  }
+  return ok;
 }
 
-DBManager::~DBManager() { closeDB(); }
+DBManager::~DBManager() {
+  closeDB();
+  m_db = QSqlDatabase();
+  QSqlDatabase::removeDatabase(m_connectionName);
+}
@@ -1,60 +1,274 @@
 #ifndef DBMANAGER_H
 #define DBMANAGER_H
 
+#include "dbchangeevent.h"
+#include <QDateTime>
 #include <QDebug>
-#include <QMutex>
 #include <QObject>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QTimer>
 #include <QVariant>
+#include <QVector>
 #include <QtSql/QSqlDatabase>
+#include <functional>
+
+class QIODevice;
+
+/**
+ * @struct queuedWrite
+ * @brief A write that DBManager::queueWrite() could not start because another connection held the write lock.
+ *
+ * @var queuedWrite::write
+ *   Runs the writes inside a transaction; returns false to roll them back.
+ * @var queuedWrite::done
+ *   Called with the outcome once the write has run (may be empty).
+ */
+struct queuedWrite {
+  std::function<bool()> write;
+  std::function<void(bool)> done;
+};
 
 /**
  * @class DBManager
- * @brief Singleton class for managing database operations related to notes, note contents, and event logs.
+ * @brief Manages database operations related to notes, note contents, and event logs for one database file.
  *
- * This class provides an interface to interact with the application's database, including opening/closing the database,
- * performing CRUD operations on notes and their contents, and logging events. It ensures thread safety and uses Qt's
- * SQL module for database access.
+ * This class provides an interface to interact with a workspace database, including opening/closing the database,
+ * performing CRUD operations on notes and their contents, and logging events. Each instance owns its own named
+ * connection and uses Qt's SQL module for database access.
  *
- * @note This class is implemented as a singleton. Use DBManager::instance() to access the instance.
+ * @note Instances are normally owned by the WorkspaceRegistry. DBManager::instance() returns the manager of the
+ *       current workspace.
  */
 class DBManager : public QObject {
   Q_OBJECT
 public:
+  explicit DBManager(
+      const QString &dbPath,
+      const QString &schemaPath = "./schema/databaseTemplate.sql",
+      QObject *parent = nullptr);
   static DBManager *instance();
   bool openDB(const QString &path);
   void closeDB();
+  const QString &databasePath() const;
+  static QDateTime toDateTime(const QVariant &value);
+
+  // Cross-workspace reads
+  static constexpr int maxAttachedDatabases = 10; // SQLITE_MAX_ATTACHED
+  bool attachDatabase(const QString &alias, const QString &path);
+  bool detachDatabase(const QString &alias);
+  QList<QVariantMap> findNoteContents(const QString &text,
+                                      const QStringList &schemas);
+
+  // Sync
+  QString siteId();
+  int pullChanges(const QString &peerPath);
+
+  // Transactions (nestable; only the outermost pair hits the database)
+  bool beginTransaction();
+  bool commitTransaction();
+  void rollbackTransaction();
+  bool queueWrite(const std::function<bool()> &write,
+                  const std::function<void(bool)> &done = nullptr);
+  bool writeLockBusy() const;
+  int commitCount() const;
+
+  // Changes made by other processes
+  void startExternalChangePolling(int intervalMs = externalPollIntervalMs);
 
   // Notes operations
   int addNote(const QString &title);
   bool updateNoteTitle(int noteId, const QString &newTitle);
   QList<QVariantMap> getAllNotes();
+  QVariantMap getNote(int noteId);
   bool deleteNote(int noteId);
 
   // NotesContents operations
-  int addNoteContent(int noteId, const QString &content);
+  int addNoteContent(int noteId, const QString &content, int parentId = -1);
   bool updateNoteContent(int contentId, bool completed);
+  bool updateNoteContentText(int contentId, const QString &content);
   QList<QVariantMap> getNoteContents(int noteId);
   bool deleteNoteContent(int contentId);
 
+  // Sub-tasks
+  QList<QVariantMap> getChildContents(int noteId, int parentId,
+                                      const QString &afterKey, int afterId,
+                                      int limit);
+  int countChildContents(int noteId, int parentId);
+  QVariantMap getChildContentKeyAt(int noteId, int parentId,
+                                   const QString &afterKey, int afterId,
+                                   int offset);
+  QVariantMap getSubtreeStats(int contentId);
+  QList<int> getTaskAncestors(int contentId);
+
+  // Recurring tasks
+  int addRecurrenceRule(int noteId, const QString &content,
+                        qint64 startAtMsecs, const QString &frequency,
+                        int interval, int weekdays, qint64 untilMsecs = -1);
+  QList<QVariantMap> getRecurrenceRules(int noteId);
+  bool deleteRecurrenceRule(int ruleId);
+  int materializeOccurrence(int ruleId, qint64 occurrenceAtMsecs,
+                            bool completed);
+  QList<QVariantMap> getOccurrenceContents(int noteId, qint64 fromMsecs,
+                                           qint64 toMsecs);
+
+  // Due dates
+  bool setNoteContentDueAt(int contentId, qint64 dueAtMsecs);
+  QList<QVariantMap> getUpcomingDeadlines(qint64 afterDueAt, int afterId,
+                                          int limit);
+
+  // Ordering
+  bool setNoteSortKey(int noteId, const QString &sortKey);
+  bool setNoteContentSortKey(int contentId, const QString &sortKey);
+  bool rebalanceNoteSortKeys();
+  bool rebalanceNoteContentSortKeys(int noteId);
+
+  // Tags
+  int addTag(const QString &name);
+  int tagId(const QString &name);
+  QList<QVariantMap> getAllTags();
+  bool deleteTag(int tagId);
+  bool tagNoteContent(int contentId, int tagId);
+  bool untagNoteContent(int contentId, int tagId);
+  QList<int> getNoteContentTags(int contentId);
+  bool tagNote(int noteId, int tagId);
+  bool untagNote(int noteId, int tagId);
+  QList<int> getNoteTags(int noteId);
+  QVector<int> getAllNoteContentIds();
+  QVector<QPair<int, int>> getAllTaskTags();
+  QList<QVariantMap> getNoteContentsByIds(const QVector<int> &ids);
+
   // Event logs
   int addEventLog(const QString &eventType, const QString &eventDescription);
   QList<QVariantMap> getEventLogs();
+  QList<QVariantMap> getEventLogsBetween(qint64 fromMsecs, qint64 toMsecs);
+  QList<QVariantMap> getEventLogsBefore(qint64 beforeAt, int beforeId,
+                                        int limit);
+  QVariantMap getEventLog(int logId);
+
+  // Analytics rollups
+  bool addEventRollup(const QDate &day, const QString &noteName,
+                      const QString &eventType, int count = 1);
+  QList<QVariantMap> getEventRollups(const QDate &from, const QDate &to,
+                                     const QString &noteName = QString());
+
+  // Revision history
+  QList<QVariantMap> getContentRevisions(int contentId);
+  QString getContentRevisionText(int contentId, int revision);
+
+  // Attachments
+  int addAttachment(int contentId, QIODevice *source, const QString &name);
+  int addAttachment(int contentId, const QString &filePath);
+  Q_INVOKABLE bool startAttachment(int contentId, const QString &filePath);
+  QList<QVariantMap> getAttachments(int contentId);
+  QIODevice *openAttachment(int attachmentId, QObject *parent = nullptr);
+  bool exportAttachment(int attachmentId, const QString &destPath);
+  bool deleteAttachment(int attachmentId);
+  int collectAttachmentGarbage();
+  QString attachmentDirectory() const;
   ~DBManager();
 
   bool deleteAllNoteContents(int noteID);
+
+  // Backups
+  Q_INVOKABLE bool startBackup(const QString &destPath);
+  void startScheduledSnapshots(const QString &directory, int intervalMs,
+                               int keepCount);
+  void stopScheduledSnapshots();
+  Q_INVOKABLE bool restoreFromBackup(const QString &snapshotPath);
+
+  // Maintenance
+  void startMaintenance(int passIntervalMs = maintenancePassIntervalMs);
+  void stopMaintenance();
 public slots:
   QString getNoteName(int noteId);
+signals:
+  void backupFinished(const QString &path, bool ok, const QString &message);
+  void databaseRestored();
+  void changed(const DBChangeEvent &event);
+  void maintenanceFinished(const QVariantMap &removed);
+  void integrityChecked(const QString &table, bool ok, const QString &message);
+  void attachmentAdded(int contentId, int attachmentId);
 private slots:
   bool createTablesFromFile(const QString &sqlFilePath);
+  void takeSnapshot();
+  void pollExternalChanges();
+  void runMaintenanceStep();
+  void retryQueuedWrites();
 
 private:
-  explicit DBManager(QObject *parent = nullptr);
-  static DBManager *m_instance;
-  static QMutex m_mutex;
+  static constexpr int currentSchemaVersion = 11;
+  static constexpr qint64 attachmentChunkSize = 1024 * 1024;
+  static constexpr int maxRevisionChain = 256;
+  static constexpr int externalPollIntervalMs = 100;
+  static constexpr int busyTimeoutMs = 250;
+  static constexpr qint64 walSizeLimitBytes = 64 * 1024 * 1024;
+  static constexpr int writeRetryDelayMs = 50;
+  static constexpr int maxExternalLogEvents = 256;
+  static constexpr int maintenancePassIntervalMs = 5 * 60 * 1000;
+  static constexpr int maintenanceStepIntervalMs = 50;
+  static constexpr int maintenanceStepBudgetMs = 4;
+  static constexpr int maintenanceChunkSize = 256;
+
+  bool migrateSchema();
+  static bool isBusy(const QSqlError &error);
+  void skipOwnChanges();
+  void publishChange(const DBChangeEvent &event);
+  void pruneSnapshots();
+  QStringList tableColumns(const QString &schema, const QString &table);
+  bool rewriteSortKeys(const QString &table, const QString &idColumn,
+                       const QString &filterAndOrder, int noteId = -1);
+  bool backfillEventRollups();
+  bool installChangeLog();
+  bool claimSiteId();
+  bool installAttachmentRefCounts();
+  bool installContentRevisions();
+  bool addContentRevision(int contentId, const QString &previous,
+                          const QString &content);
+  static qint64 revisionChecksum(const QString &text);
+  QString blobPath(const QString &hash) const;
+  void removeUnlinkedBlobs();
+  int insertAttachment(int contentId, const QString &incomingPath,
+                       const QString &digest, qint64 size,
+                       const QString &name);
+  void scheduleAttachmentGarbageCollection();
+  bool removeTaskSubtree(int contentId, QList<int> &removedIds,
+                         int limit = -1);
+  int sweepOrphanChunk();
+  bool tryBeginTransaction();
+  void finishMaintenancePass();
+  void startIntegrityCheck();
 
+  QString m_connectionName;
   QSqlDatabase m_db;
+  QString m_dbPath;
+  QStringList m_attached;
+  int m_transactionDepth = 0;
+  bool m_rollbackOnly = false;
+  bool m_writeLockBusy = false;
+  int m_commitCount = 0;
+  QList<queuedWrite> m_queuedWrites;
+  QTimer m_writeRetryTimer;
+  QList<DBChangeEvent> m_pendingChanges;
+  QTimer m_externalPollTimer;
+  qint64 m_dataVersion = -1;
+  qint64 m_changeSeq = 0;
+  int m_logId = 0;
+  QTimer m_attachmentGcTimer;
+  QStringList m_unlinkedBlobs;
+
+  bool m_backupRunning = false;
+  QTimer m_snapshotTimer;
+  QString m_snapshotDir;
+  int m_snapshotKeep = 0;
+
+  QTimer m_maintenanceTimer;
+  int m_maintenancePassIntervalMs = maintenancePassIntervalMs;
+  int m_maintenanceSweep = 0;
+  qint64 m_maintenanceCursor = 0;
+  QVariantMap m_maintenanceRemoved;
+  int m_checkedTables = 0;
+  bool m_checkRunning = false;
 };
 
 #endif // DBMANAGER_H
@@ -1,85 +1,56 @@
 #include "eventlogsmodel.h"
 #include "dbmanager.h"
+#include "tracer.h"
+#include "workspaceregistry.h"
+#include <QDateTime>
 #include <QJsonDocument>
 #include <QJsonObject>
 
-EventLogsModel::EventLogsModel(QObject *parent) : QAbstractListModel(parent) {
+EventLogsModel::EventLogsModel(QObject *parent) : eventLogsBase(parent) {
+  QObject::connect(&WorkspaceRegistry::instance(),
+                   &WorkspaceRegistry::currentWorkspaceChanged, this,
+                   &EventLogsModel::refresh);
+  QObject::connect(&WorkspaceRegistry::instance(), &WorkspaceRegistry::changed,
+                   this, &EventLogsModel::applyDatabaseChange);
   refresh();
 }
 
 /**
- * @brief Returns the number of rows in the model.
- *
- * This function provides the number of event log entries stored in the model.
- * If the given parent index is valid, it returns 0, indicating that this model
- * does not support hierarchical data.
- *
- * @param parent The parent index. Used to support hierarchical models.
- * @return The number of rows (event logs) in the model.
+ * @brief Role accessors of EventLogsModel.
  */
-int EventLogsModel::rowCount(const QModelIndex &parent) const {
-  if (parent.isValid())
-    return 0;
-  return m_logs.size();
+QVariant logIdField::get(const EventLogsModel &, const logElement &row) {
+  return row.id;
 }
 
-/**
- * @brief Returns the data stored under the given role for the item referred to by the index.
- *
- * This method retrieves data from the internal logs list based on the specified model index and role.
- * It supports custom roles such as IdRole, EventTypeRole, NoteNameRole, TaskNameRole, and TimestampRole.
- * For NoteNameRole and TaskNameRole, it parses the "event_description" field as JSON and extracts the respective values.
- *
- * @param index The model index specifying the row of the data to retrieve.
- * @param role The role for which the data is requested.
- * @return QVariant containing the requested data, or an invalid QVariant if the index is invalid or out of range.
- */
-QVariant EventLogsModel::data(const QModelIndex &index, int role) const {
-  if (!index.isValid() || index.row() < 0 || index.row() >= m_logs.size())
-    return QVariant();
+QVariant logEventTypeField::get(const EventLogsModel &model,
+                                const logElement &row) {
+  return model.m_eventTypes.at(row.eventType);
+}
 
-  const QVariantMap &log = m_logs[index.row()];
+QVariant logNoteNameField::get(const EventLogsModel &model,
+                               const logElement &row) {
+  return model.m_noteNames.at(row.noteName);
+}
 
-  switch (role) {
-  case IdRole:
-    return log.value("id");
-  case EventTypeRole:
-    return log.value("event_type");
-  case NoteNameRole: {
-    QJsonDocument doc = QJsonDocument::fromJson(
-        log.value("event_description").toString().toUtf8());
-    return doc.object().value("NoteName").toString();
-  }
-  case TaskNameRole: {
-    QJsonDocument doc = QJsonDocument::fromJson(
-        log.value("event_description").toString().toUtf8());
-    return doc.object().value("TaskName").toString();
-  }
-  case TimestampRole:
-    return log.value("created_at");
-  }
+QVariant logTaskNameField::get(const EventLogsModel &model,
+                               const logElement &row) {
+  return model.m_texts.text(row.taskName);
+}
 
-  return QVariant();
+QVariant logTimestampField::get(const EventLogsModel &, const logElement &row) {
+  return QDateTime::fromMSecsSinceEpoch(row.createdAt);
 }
 
 /**
- * @brief Returns a hash mapping custom role identifiers to their names for the model.
+ * @brief Returns the entry shown at @p row.
  *
- * This function defines the roles used in the EventLogsModel, associating each
- * role's integer identifier with its corresponding name as a QByteArray.
- * These roles are used for data retrieval in views and delegates, especially in
- * QML or when using custom models with Qt's Model/View framework.
+ * Row 0 is the newest entry, which is the last element of the internal vector.
  *
- * @return QHash<int, QByteArray> A hash containing role identifiers and their names.
+ * @param row The view row.
+ * @return The stored entry.
  */
-QHash<int, QByteArray> EventLogsModel::roleNames() const {
-  QHash<int, QByteArray> roles;
-  roles[IdRole] = "id";
-  roles[EventTypeRole] = "eventType";
-  roles[NoteNameRole] = "noteName";
-  roles[TaskNameRole] = "taskName";
-  roles[TimestampRole] = "timestamp";
-  return roles;
+const logElement &EventLogsModel::rowAt(int row) const {
+  return m_rows.at(m_rows.size() - 1 - row);
 }
 
 /**
@@ -90,7 +61,79 @@ QHash<int, QByteArray> EventLogsModel::roleNames() const {
  * is up-to-date and notifies any attached views of the change.
  */
 void EventLogsModel::refresh() {
+  TRACE_SPAN(span, "model");
+  const QList<QVariantMap> logs = DBManager::instance()->getEventLogs();
   beginResetModel();
-  m_logs = DBManager::instance()->getEventLogs(); // Uses your DB function
+  m_rows.clear();
+  m_eventTypes.clear();
+  m_noteNames.clear();
+  m_texts.clear();
+  m_rows.reserve(logs.size());
+  // getEventLogs() returns newest first; the vector is kept oldest first.
+  for (auto it = logs.crbegin(); it != logs.crend(); ++it)
+    m_rows.append(toElement(*it));
   endResetModel();
 }
+
+/**
+ * @brief Converts a database row into a logElement.
+ *
+ * Parses the JSON description once and interns the event type and note name.
+ *
+ * @param log Row as returned by DBManager::getEventLogs() or getEventLog().
+ * @return The compact row.
+ */
+logElement EventLogsModel::toElement(const QVariantMap &log) {
+  QJsonObject description =
+      QJsonDocument::fromJson(log.value("event_description").toString().toUtf8())
+          .object();
+  logElement element;
+  element.id = log.value("id").toInt();
+  element.eventType = m_eventTypes.intern(log.value("event_type").toString());
+  element.noteName =
+      m_noteNames.intern(description.value("NoteName").toString());
+  element.taskName = m_texts.append(description.value("TaskName").toString());
+  element.createdAt =
+      DBManager::toDateTime(log.value("created_at")).toMSecsSinceEpoch();
+  return element;
+}
+
+/**
+ * @brief Applies a committed database change to the model.
+ *
+ * New event log entries are inserted at the top of the list (the list is
+ * ordered newest first), so the logs page stays current without reloading.
+ * Entries written by another process are inserted at their place in the
+ * list, and entries already shown are skipped, since that process's writes
+ * can interleave with this one's. A Reloaded event reloads the list.
+ *
+ * @param event The change published by DBManager.
+ */
+void EventLogsModel::applyDatabaseChange(const DBChangeEvent &event) {
+  if (event.table != DBChangeEvent::EventLogs)
+    return;
+  if (event.operation == DBChangeEvent::Reloaded) {
+    refresh();
+    return;
+  }
+  if (event.operation != DBChangeEvent::Inserted)
+    return;
+  QVariantMap log = DBManager::instance()->getEventLog(event.rowId);
+  if (log.isEmpty())
+    return;
+  const qint64 createdAt =
+      DBManager::toDateTime(log.value("created_at")).toMSecsSinceEpoch();
+  // Storage is oldest first and shown reversed (see rowAt()), so a new
+  // entry is usually appended to storage and shown at the top.
+  int index = m_rows.size();
+  while (index > 0 && (m_rows.at(index - 1).createdAt > createdAt ||
+                       (m_rows.at(index - 1).createdAt == createdAt &&
+                        m_rows.at(index - 1).id > event.rowId)))
+    --index;
+  if (index > 0 && m_rows.at(index - 1).id == event.rowId)
+    return;
+  const int row = m_rows.size() - index;
+  beginInsertRows(QModelIndex(), row, row);
+  m_rows.insert(index, toElement(log));
+  endInsertRows();
+}
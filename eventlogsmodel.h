@@ -1,47 +1,115 @@
 #ifndef EVENTLOGSMODEL_H
 #define EVENTLOGSMODEL_H
 
-#include <QAbstractListModel>
-#include <QList>
+#include "dbchangeevent.h"
+#include "rowlistmodel.h"
+#include "stringpool.h"
+#include "textarena.h"
 #include <QVariantMap>
+#include <QVector>
+
+/**
+ * @struct logElement
+ * @brief Compact in-memory representation of one event log entry.
+ *
+ * The JSON description is parsed once when the row is loaded. Event types and note names repeat
+ * across thousands of entries and are stored as IDs in the model's StringPools; the task name is
+ * stored in the model's TextArena.
+ *
+ * @var logElement::id
+ *   Unique identifier of the log entry.
+ * @var logElement::eventType
+ *   Event type, as an ID in the model's event type pool.
+ * @var logElement::noteName
+ *   Note name, as an ID in the model's note name pool.
+ * @var logElement::taskName
+ *   Task name (empty for note events).
+ * @var logElement::createdAt
+ *   Creation timestamp in epoch milliseconds.
+ */
+struct logElement {
+  int id;
+  quint32 eventType;
+  quint32 noteName;
+  TextRef taskName;
+  qint64 createdAt;
+};
+
+class EventLogsModel;
+
+/**
+ * @brief Fields of EventLogsModel, one per role (see RowListModel).
+ */
+struct logIdField {
+  static constexpr const char *name = "id";
+  static QVariant get(const EventLogsModel &, const logElement &row);
+};
+struct logEventTypeField {
+  static constexpr const char *name = "eventType";
+  static QVariant get(const EventLogsModel &, const logElement &row);
+};
+struct logNoteNameField {
+  static constexpr const char *name = "noteName";
+  static QVariant get(const EventLogsModel &, const logElement &row);
+};
+struct logTaskNameField {
+  static constexpr const char *name = "taskName";
+  static QVariant get(const EventLogsModel &model, const logElement &row);
+};
+struct logTimestampField {
+  static constexpr const char *name = "timestamp";
+  static QVariant get(const EventLogsModel &, const logElement &row);
+};
+
+using eventLogsBase =
+    RowListModel<EventLogsModel, logElement, logIdField, logEventTypeField,
+                 logNoteNameField, logTaskNameField, logTimestampField>;
 
 /**
  * @class EventLogsModel
  * @brief Model for representing event logs in a Qt view.
  *
- * This class inherits from QAbstractListModel and provides a model for storing and displaying
- * event log entries. Each log entry is represented as a QVariantMap and contains fields such as
- * ID, event type, note name, task name, and timestamp. The model exposes custom roles for
+ * This class inherits from RowListModel and provides a model for storing and displaying
+ * event log entries. Each log entry is represented as a logElement and contains fields such as
+ * ID, event type, note name, task name, and timestamp. Entries are kept oldest first in a
+ * contiguous vector and exposed newest first, so new entries are appended. The model exposes custom roles for
  * accessing these fields and provides methods for refreshing the log data.
  *
  * @note This model is intended for use with Qt's Model/View framework.
  *
- * @see QAbstractListModel
+ * @see RowListModel
  */
-class EventLogsModel : public QAbstractListModel {
+class EventLogsModel : public eventLogsBase {
   Q_OBJECT
 public:
   enum Roles {
-    IdRole = Qt::UserRole + 1,
-    EventTypeRole,
-    NoteNameRole,
-    TaskNameRole,
-    TimestampRole
+    IdRole = roleOf<logIdField>(),
+    EventTypeRole = roleOf<logEventTypeField>(),
+    NoteNameRole = roleOf<logNoteNameField>(),
+    TaskNameRole = roleOf<logTaskNameField>(),
+    TimestampRole = roleOf<logTimestampField>()
   };
   Q_ENUM(Roles)
 
   explicit EventLogsModel(QObject *parent = nullptr);
 
-  // Basic overrides
-  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
-  QVariant data(const QModelIndex &index,
-                int role = Qt::DisplayRole) const override;
-  QHash<int, QByteArray> roleNames() const override;
+  const logElement &rowAt(int row) const;
 
   Q_INVOKABLE void refresh(); // To reload logs
 
+private slots:
+  void applyDatabaseChange(const DBChangeEvent &event);
+
 private:
-  QList<QVariantMap> m_logs;
+  friend struct logEventTypeField;
+  friend struct logNoteNameField;
+  friend struct logTaskNameField;
+
+  logElement toElement(const QVariantMap &log);
+
+  StringPool m_eventTypes;
+  StringPool m_noteNames;
+  TextArena m_texts;
 };
 
 #endif // EVENTLOGSMODEL_H
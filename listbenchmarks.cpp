@@ -0,0 +1,398 @@
+#include "benchmarks.h"
+#include "dbmanager.h"
+#include "todolistmodel.h"
+#include "tracer.h"
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <algorithm>
+
+namespace {
+/**
+ * @brief The hand-written ToDoListModel::data() that RowListModel replaced.
+ *
+ * Kept as the baseline of runDataBenchmark(): a switch over the roles,
+ * reading the same row and text storage as the model.
+ */
+QVariant handWrittenData(const QVector<listElement> &rows,
+                         const TextArena &texts, const QModelIndex &index,
+                         int role) {
+  if (!index.isValid() || index.row() >= rows.count())
+    return QVariant();
+  const listElement &item = rows.at(index.row());
+  switch (role) {
+  case ToDoListModel::IdRole:
+    return item.id;
+  case ToDoListModel::ItemNameRole:
+    return texts.text(item.itemName);
+  case ToDoListModel::StatusRole:
+    return item.completionStatus;
+  case ToDoListModel::DueAtRole:
+    return item.dueAt < 0 ? QVariant()
+                          : QVariant(QDateTime::fromMSecsSinceEpoch(item.dueAt));
+  case ToDoListModel::OccurrenceAtRole:
+    return item.occurrenceAt < 0
+               ? QVariant()
+               : QVariant(QDateTime::fromMSecsSinceEpoch(item.occurrenceAt));
+  case ToDoListModel::RecurringRole:
+    return item.ruleId >= 0;
+  default:
+    return QVariant();
+  }
+}
+} // namespace
+
+/**
+ * @brief Counts the statements and commits that task status clicks cost, before and after coalescing, and prints the result.
+ *
+ * Creates a note of 100 tasks in the current workspace, shows it in
+ * @p todoModel and clicks task checkboxes @p clickCount times; every fourth
+ * click undoes the one before it, as a user flicking a checkbox does. The
+ * clicks run twice. The first run replays the path before coalescing: per
+ * click, an autocommit UPDATE of the task, a SELECT of the note name and an
+ * autocommit INSERT of the event log entry. The second goes through
+ * ToDoListModel::toggleTaskStatus() in bursts of 20 clicks, each followed by
+ * the flush the debounce timer runs.
+ *
+ * Statements are counted from the "db" trace spans that ran a query (see
+ * Tracer::queryCount()) plus one COMMIT per committed transaction, so
+ * tracing is on during both runs. Each commit, autocommit writes included, is
+ * one sync of the write-ahead log at SQLite's default synchronous level.
+ * Reports statements, commits, event log entries and time per 1000 clicks.
+ *
+ * @param todoModel The model the clicks go through.
+ * @param clickCount Number of clicks per run.
+ */
+void Benchmarks::runToggleBenchmark(ToDoListModel &todoModel, int clickCount) {
+  constexpr int taskCount = 100;
+  constexpr int burstClicks = 20;
+  QTextStream out(stdout);
+  DBManager *db = DBManager::instance();
+  const int noteId = db->addNote("Toggle benchmark");
+  db->beginTransaction();
+  for (int i = 0; i < taskCount; ++i)
+    db->addNoteContent(noteId, QStringLiteral("Task %1").arg(i));
+  db->commitTransaction();
+  todoModel.setNoteID(noteId);
+  const int rows = todoModel.rowCount();
+  if (rows == 0 || clickCount <= 0)
+    return;
+
+  Tracer &tracer = Tracer::instance();
+  const bool tracing = Tracer::isEnabled();
+  tracer.setEnabled(true);
+  auto measure = [&](const char *label, bool coalesced) {
+    const int logs = db->getEventLogs().size();
+    const quint64 queries = tracer.queryCount();
+    const int commits = db->commitCount();
+    int autocommits = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < clickCount; ++i) {
+      const QModelIndex index = todoModel.index((i - i / 4) % rows);
+      const bool status =
+          !todoModel.data(index, ToDoListModel::StatusRole).toBool();
+      if (coalesced) {
+        todoModel.toggleTaskStatus(index.row(), status);
+        if ((i + 1) % burstClicks == 0 || i + 1 == clickCount)
+          todoModel.flushPendingStatusChanges();
+        continue;
+      }
+      // The published change updates the model's status for the next click.
+      if (db->updateNoteContent(
+              todoModel.data(index, ToDoListModel::IdRole).toInt(), status))
+        ++autocommits;
+      QJsonObject description;
+      description["NoteName"] = db->getNoteName(noteId);
+      description["TaskName"] =
+          todoModel.data(index, ToDoListModel::ItemNameRole).toString() +
+          QString(":%1").arg(status);
+      if (db->addEventLog("TASK_STATUS_TOGGLED",
+                          QString::fromUtf8(QJsonDocument(description).toJson(
+                              QJsonDocument::Compact))) != -1)
+        ++autocommits;
+    }
+    const qint64 elapsedMs = timer.elapsed();
+    const int transactions = db->commitCount() - commits;
+    const qint64 statements =
+        qint64(tracer.queryCount() - queries) + transactions;
+    const double scale = 1000.0 / clickCount;
+    out << label << ": " << QString::number(statements * scale, 'f', 1)
+        << " statements, "
+        << QString::number((transactions + autocommits) * scale, 'f', 1)
+        << " commits, "
+        << QString::number((db->getEventLogs().size() - logs) * scale, 'f', 1)
+        << " event log entries, "
+        << QString::number(elapsedMs * scale, 'f', 1)
+        << " ms per 1000 clicks\n";
+  };
+  measure("Before coalescing", false);
+  measure("Coalesced", true);
+  tracer.setEnabled(tracing);
+  out.flush();
+}
+
+/**
+ * @brief Measures drag-and-drop moves per second on a large note and prints the result to stdout.
+ *
+ * Creates a note with @p taskCount tasks in the current workspace (which
+ * should be a fresh database), shows it in @p todoModel and performs
+ * @p moveCount random single-task moves through ToDoListModel::moveItem(),
+ * each of which writes one row. The key rebalance that long keys schedule
+ * runs on the event loop and is therefore not part of the measurement; the
+ * longest key reached is reported instead.
+ *
+ * @param todoModel The model the moves go through.
+ * @param taskCount Number of tasks in the note.
+ * @param moveCount Number of moves to time.
+ */
+void Benchmarks::runMoveBenchmark(ToDoListModel &todoModel, int taskCount,
+                                  int moveCount) {
+  QTextStream out(stdout);
+  DBManager *db = DBManager::instance();
+  const int noteId = db->addNote("Move benchmark");
+  db->beginTransaction();
+  for (int i = 0; i < taskCount; ++i)
+    db->addNoteContent(noteId, QStringLiteral("Task %1").arg(i));
+  db->commitTransaction();
+  todoModel.setNoteID(noteId);
+  const int rows = todoModel.rowCount();
+
+  QRandomGenerator random(7);
+  QElapsedTimer timer;
+  int longestKey = 0;
+  int moved = 0;
+  timer.start();
+  for (int i = 0; i < moveCount && rows > 1; ++i) {
+    const int from = random.bounded(rows);
+    int to = random.bounded(rows - 1);
+    if (to >= from)
+      ++to;
+    if (todoModel.moveItem(from, to))
+      ++moved;
+  }
+  const qint64 elapsedNs = qMax<qint64>(1, timer.nsecsElapsed());
+  for (const QVariantMap &content : db->getNoteContents(noteId))
+    longestKey = qMax(longestKey, content["sort_key"].toString().size());
+
+  out << "Moved " << moved << " of " << moveCount << " tasks in a note of "
+      << rows << " tasks in " << elapsedNs / 1000000 << " ms, "
+      << QString::number(moved * 1e9 / elapsedNs, 'f', 1) << " moves/s\n";
+  out << "Longest ordering key: " << longestKey << " characters\n";
+  out.flush();
+}
+
+/**
+ * @brief Compares ToDoListModel::data() with the hand-written switch it replaced and prints the result.
+ *
+ * Creates a note with @p taskCount tasks (every other one with a due date)
+ * in the current workspace, shows it in @p todoModel and reads every role of
+ * every row repeatedly, once through the model and once through a
+ * hand-written switch over an identical copy of the rows.
+ *
+ * @param todoModel The model under test.
+ * @param taskCount Number of tasks in the note.
+ */
+void Benchmarks::runDataBenchmark(ToDoListModel &todoModel, int taskCount) {
+  QTextStream out(stdout);
+  DBManager *db = DBManager::instance();
+  const int noteId = db->addNote("Data benchmark");
+  const qint64 now = QDateTime::currentMSecsSinceEpoch();
+  db->beginTransaction();
+  for (int i = 0; i < taskCount; ++i) {
+    const int id = db->addNoteContent(noteId, QStringLiteral("Task %1").arg(i));
+    if (i % 2 == 0)
+      db->setNoteContentDueAt(id, now + i * 60000);
+  }
+  db->commitTransaction();
+  todoModel.setNoteID(noteId);
+  const int rows = todoModel.rowCount();
+  if (rows == 0)
+    return;
+
+  QVector<listElement> copy;
+  TextArena texts;
+  for (const QVariantMap &content : db->getNoteContents(noteId))
+    copy.append({content["id"].toInt(),
+                 texts.append(content["content"].toString()),
+                 content["completed"].toBool(), TextRef{0, 0},
+                 content["due_at"].isNull() ? -1
+                                            : content["due_at"].toLongLong(),
+                 -1, -1});
+
+  const int roles = ToDoListModel::fieldCount;
+  const int passes = qMax(1, 2000000 / (rows * roles));
+  auto measure = [&](auto &&read) {
+    int valid = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int pass = 0; pass < passes; ++pass)
+      for (int row = 0; row < rows; ++row) {
+        const QModelIndex index = todoModel.index(row);
+        for (int role = ToDoListModel::firstRole;
+             role < ToDoListModel::firstRole + roles; ++role)
+          valid += read(index, role).isValid();
+      }
+    const double nsPerCall =
+        double(timer.nsecsElapsed()) / (double(passes) * rows * roles);
+    return qMakePair(nsPerCall, valid);
+  };
+  const auto model = measure([&todoModel](const QModelIndex &index, int role) {
+    return todoModel.data(index, role);
+  });
+  const auto baseline =
+      measure([&copy, &texts](const QModelIndex &index, int role) {
+        return handWrittenData(copy, texts, index, role);
+      });
+
+  out << "data() over " << rows << " rows x " << roles << " roles x " << passes
+      << " passes\n";
+  out << "RowListModel:  " << QString::number(model.first, 'f', 1)
+      << " ns/call\n";
+  out << "hand-written:  " << QString::number(baseline.first, 'f', 1)
+      << " ns/call\n";
+  if (model.second != baseline.second)
+    out << "Mismatch: " << model.second << " vs " << baseline.second
+        << " valid values\n";
+  out.flush();
+}
+
+/**
+ * @brief Measures note switch latency with and without the task list cache and prints the result.
+ *
+ * Creates @p noteCount notes with @p taskCount tasks each in the current
+ * workspace, then switches @p todoModel through them once to read every list
+ * from the database (cold) and @p rounds more times, when the lists come from
+ * the task list cache (warm) as long as they fit its budget.
+ *
+ * @param todoModel The model under test.
+ * @param noteCount Number of notes switched between.
+ * @param taskCount Number of tasks per note.
+ * @param rounds Number of warm passes over the notes.
+ */
+void Benchmarks::runSwitchBenchmark(ToDoListModel &todoModel, int noteCount,
+                                    int taskCount, int rounds) {
+  QTextStream out(stdout);
+  DBManager *db = DBManager::instance();
+  QVector<int> noteIds;
+  db->beginTransaction();
+  for (int n = 0; n < noteCount; ++n) {
+    const int noteId = db->addNote(QStringLiteral("Switch benchmark %1").arg(n));
+    for (int i = 0; i < taskCount; ++i)
+      db->addNoteContent(noteId, QStringLiteral("Task %1").arg(i));
+    noteIds.append(noteId);
+  }
+  db->commitTransaction();
+  if (noteIds.size() < 2)
+    return;
+
+  auto measure = [&todoModel, &noteIds](int passes) {
+    QVector<qint64> samples;
+    QElapsedTimer timer;
+    for (int pass = 0; pass < passes; ++pass)
+      for (int noteId : noteIds) {
+        timer.start();
+        todoModel.setNoteID(noteId);
+        samples.append(timer.nsecsElapsed());
+      }
+    std::sort(samples.begin(), samples.end());
+    return samples;
+  };
+  const QVector<qint64> cold = measure(1);
+  const QVector<qint64> warm = measure(qMax(1, rounds));
+  auto report = [&out](const char *label, const QVector<qint64> &samples) {
+    auto percentile = [&samples](double p) {
+      const int index = qMin(samples.size() - 1, int(p * samples.size()));
+      return QString::number(samples.at(index) / 1000.0, 'f', 1);
+    };
+    out << label << QString::number(samples.size()).rightJustified(7)
+        << percentile(0.50).rightJustified(11)
+        << percentile(0.90).rightJustified(11)
+        << QString::number(samples.last() / 1000.0, 'f', 1).rightJustified(11)
+        << "\n";
+  };
+
+  out << "Switching between " << noteIds.size() << " notes of " << taskCount
+      << " tasks\n";
+  out << "switch       count     p50 us     p90 us     max us\n";
+  report("cold      ", cold);
+  report("warm      ", warm);
+  out.flush();
+}
+
+/**
+ * @brief Measures scrolling through a note too large to load and prints the result.
+ *
+ * Creates a note with @p taskCount tasks in the current workspace (committed
+ * in batches so the published changes do not pile up), shows it in
+ * @p todoModel and reads a viewport of rows at a time, first scrolling
+ * forward and then jumping to random positions. Reports the viewport read
+ * latency of both and the number of rows the model held in memory.
+ *
+ * @param todoModel The model under test.
+ * @param taskCount Number of tasks in the note.
+ */
+void Benchmarks::runWindowBenchmark(ToDoListModel &todoModel, int taskCount) {
+  constexpr int batchSize = 10000;
+  constexpr int viewportRows = 40;
+  constexpr int scrolledViewports = 5000;
+  constexpr int jumps = 200;
+  QTextStream out(stdout);
+  DBManager *db = DBManager::instance();
+  const int noteId = db->addNote("Window benchmark");
+  for (int i = 0; i < taskCount; i += batchSize) {
+    db->beginTransaction();
+    for (int j = i; j < qMin(taskCount, i + batchSize); ++j)
+      db->addNoteContent(noteId, QStringLiteral("Task %1").arg(j));
+    db->commitTransaction();
+  }
+  QElapsedTimer timer;
+  timer.start();
+  todoModel.setNoteID(noteId);
+  const qint64 openNs = timer.nsecsElapsed();
+  const int rows = todoModel.rowCount();
+  if (rows <= viewportRows)
+    return;
+
+  int residentRows = 0;
+  auto readViewport = [&todoModel, &residentRows](int first) {
+    QElapsedTimer viewport;
+    viewport.start();
+    for (int row = first; row < first + viewportRows; ++row) {
+      const QModelIndex index = todoModel.index(row);
+      todoModel.data(index, ToDoListModel::ItemNameRole);
+      todoModel.data(index, ToDoListModel::StatusRole);
+    }
+    residentRows = qMax(residentRows, todoModel.residentRowCount());
+    return viewport.nsecsElapsed();
+  };
+  QVector<qint64> scrolled;
+  for (int i = 0; i < scrolledViewports && (i + 1) * viewportRows <= rows; ++i)
+    scrolled.append(readViewport(i * viewportRows));
+  QVector<qint64> jumped;
+  QRandomGenerator random(7);
+  for (int i = 0; i < jumps; ++i)
+    jumped.append(readViewport(random.bounded(rows - viewportRows)));
+  auto report = [&out](const char *label, QVector<qint64> &samples) {
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+      const int index = qMin(samples.size() - 1, int(p * samples.size()));
+      return QString::number(samples.at(index) / 1000.0, 'f', 1);
+    };
+    out << label << QString::number(samples.size()).rightJustified(7)
+        << percentile(0.50).rightJustified(11)
+        << percentile(0.99).rightJustified(11)
+        << QString::number(samples.last() / 1000.0, 'f', 1).rightJustified(11)
+        << "\n";
+  };
+
+  out << "Opened a note of " << rows << " tasks in " << openNs / 1000000
+      << " ms\n";
+  out << "viewport     count     p50 us     p99 us     max us\n";
+  report("scroll    ", scrolled);
+  report("jump      ", jumped);
+  out << "Most rows in memory: " << residentRows << "\n";
+  out.flush();
+}
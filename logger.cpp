@@ -1,5 +1,7 @@
 #include "logger.h"
 #include "dbmanager.h"
+#include "tracer.h"
+#include <QDate>
 
 Logger::Logger(QObject *parent) : QObject(parent) {}
 
@@ -38,7 +40,10 @@ QString Logger::eventTypeToString(Logger::EventType type) {
  *
  * This function prepares a JSON object containing the note name and, if provided,
  * the task name. It then converts the event type to a string and calls the database
- * manager to add the event log. The result of the operation is output to the debug log.
+ * manager to add the event log and, in the same transaction, to count it in today's
+ * rollup. The write goes through DBManager::queueWrite(): it joins the caller's
+ * transaction if one is open, and is retried later if the write lock is busy.
+ * The result of the operation is output to the debug log once it has run.
  *
  * @param type The type of the event to log.
  * @param noteName The name of the note associated with the event.
@@ -46,6 +51,7 @@ QString Logger::eventTypeToString(Logger::EventType type) {
  */
 void Logger::logEvent(EventType type, const QString &noteName,
                       const QString &taskName) {
+  TRACE_SPAN(span, "log");
   // Prepare JSON description
   QJsonObject jsonObj;
   jsonObj["NoteName"] = noteName;
@@ -58,12 +64,36 @@ void Logger::logEvent(EventType type, const QString &noteName,
   // Get event type as string
   QString eventTypeStr = eventTypeToString(type);
 
-  // Call DB function
-  int result = DBManager::instance()->addEventLog(eventTypeStr, jsonString);
+  // Write the entry and its rollup together; if another connection holds the
+  // write lock, DBManager queues them instead of dropping the event.
+  DBManager *db = DBManager::instance();
+  const QString rollup = rollupType(eventTypeStr, taskName);
+  db->queueWrite(
+      [db, eventTypeStr, jsonString, noteName, rollup]() {
+        return db->addEventLog(eventTypeStr, jsonString) != -1 &&
+               db->addEventRollup(QDate::currentDate(), noteName, rollup);
+      },
+      [eventTypeStr, jsonString](bool ok) {
+        if (ok)
+          qDebug() << "Event logged:" << eventTypeStr << jsonString;
+        else
+          qDebug() << "Failed to log event:" << eventTypeStr << jsonString;
+      });
+}
 
-  if (result == -1) {
-    qDebug() << "Failed to log event:" << eventTypeStr << jsonString;
-  } else {
-    qDebug() << "Event logged:" << eventTypeStr << jsonString;
-  }
+/**
+ * @brief Returns the event type an event is counted under in the analytics rollups.
+ *
+ * Status toggles are split by their ":1"/":0" suffix into TASK_COMPLETED and
+ * TASK_REOPENED; every other event is counted under its own type.
+ *
+ * @param eventType The logged event type.
+ * @param taskName The logged task name.
+ * @return The rollup event type.
+ */
+QString Logger::rollupType(const QString &eventType, const QString &taskName) {
+  if (eventType == QLatin1String("TASK_STATUS_TOGGLED"))
+    return taskName.endsWith(QLatin1String(":1")) ? "TASK_COMPLETED"
+                                                   : "TASK_REOPENED";
+  return eventType;
 }
@@ -12,7 +12,8 @@
  * @brief Singleton class for logging note and task events within the application.
  *
  * The Logger class provides functionality to log various events related to notes and tasks,
- * such as creation, deletion, updates, and status changes. It uses Qt's QObject for signal-slot
+ * such as creation, deletion, updates, and status changes. Every entry also increments the daily
+ * rollup of its note and event type (see DBManager::addEventRollup()). It uses Qt's QObject for signal-slot
  * capabilities and supports event type enumeration for easy event identification.
  *
  * Usage:
@@ -29,7 +30,8 @@ public:
     NOTE_UPDATED,
     TASK_ADDED,
     TASK_DELETED,
-    TASK_STATUS_TOGGLED
+    TASK_STATUS_TOGGLED,
+    TASK_UPDATED
   };
   Q_ENUM(EventType)
 
@@ -37,6 +39,7 @@ public:
 
   void logEvent(EventType type, const QString &noteName,
                 const QString &taskName = QString());
+  static QString rollupType(const QString &eventType, const QString &taskName);
 
 private:
   explicit Logger(QObject *parent = nullptr);
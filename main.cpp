@@ -1,17 +1,49 @@
+#include "analyticsmodel.h"
+#include "apiloadtest.h"
+#include "apiserver.h"
+#include "benchmarks.h"
 #include "dbmanager.h"
 #include "eventlogsmodel.h"
+#include "quickswitchermodel.h"
+#include "reminderscheduler.h"
+#include "syncengine.h"
+#include "tagfiltermodel.h"
+#include "tasktreemodel.h"
 #include "todolistmodel.h"
 #include "todonotesmodel.h"
+#include "tracer.h"
+#include "workloadreplayer.h"
+#include "workspaceregistry.h"
+#include <QCommandLineParser>
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QTextStream>
 
 /**
  * @brief Entry point for the MVCPatternExample Qt application.
  *
  * Initializes the Qt application, sets up high DPI scaling for Qt versions below 6,
  * creates and initializes the database manager, models for ToDo list, notes, and event logs,
- * and fetches all notes from the database. Sets up the QML application engine,
+ * and fetches all notes from the database. Optionally restores the database from
+ * a snapshot (--restore), opens extra workspaces (--workspace name=path, the last
+ * one becomes current), syncs it with another database file (--sync),
+ * takes hourly rotating snapshots in a directory (--snapshots) and schedules
+ * background maintenance (orphaned rows, integrity checks).
+ * With --replay, the eventLogs history of another database is replayed against a
+ * fresh database through the models and a latency report is printed instead of
+ * showing the UI. The benchmark and stress modes (--tag-benchmark,
+ * --toggle-benchmark, --backup-stress and the others listed by --help; see
+ * Benchmarks) also run instead of the UI, in a fresh database at
+ * --replay-target when they write to one, and their result is the exit code.
+ * --api-port serves the local automation API (see ApiServer) on the given
+ * loopback port and prints the token clients must send; --api-load-test
+ * sends the given number of requests with that token (--api-token) to an
+ * application already serving it on that port and prints a report.
+ * --trace records trace spans, writes a Chrome trace to the given
+ * directory whenever the GUI thread stalls for longer than --stall-threshold
+ * and on exit.
+ * Sets up the QML application engine,
  * exposes the models to QML context, and loads the main QML file.
  * Handles application exit if the QML root object fails to load.
  *
@@ -24,16 +56,159 @@ int main(int argc, char *argv[]) {
   QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
 #endif
   QGuiApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.addHelpOption();
+  QCommandLineOption restoreOption(
+      "restore", "Restore the database from a snapshot file.", "snapshot");
+  parser.addOption(restoreOption);
+  QCommandLineOption snapshotsOption(
+      "snapshots", "Take hourly rotating snapshots in a directory.",
+      "directory");
+  parser.addOption(snapshotsOption);
+  QCommandLineOption workspaceOption(
+      "workspace", "Open a workspace database and make it current.",
+      "name=path");
+  parser.addOption(workspaceOption);
+  QCommandLineOption replayOption(
+      "replay", "Replay the event logs of a database and print a report.",
+      "source");
+  parser.addOption(replayOption);
+  QCommandLineOption replayTargetOption(
+      "replay-target",
+      "Fresh database the replay or benchmarks write to.", "path",
+      "./replay.db");
+  parser.addOption(replayTargetOption);
+  QCommandLineOption replaySpeedOption(
+      "replay-speed",
+      "Replay pace relative to the recording; 0 replays back to back.",
+      "factor", "0");
+  parser.addOption(replaySpeedOption);
+  QCommandLineOption syncOption(
+      "sync", "Sync the current workspace with another database file.",
+      "path");
+  parser.addOption(syncOption);
+  QCommandLineOption apiPortOption(
+      "api-port", "Serve the local automation API on a loopback port.",
+      "port", "8765");
+  parser.addOption(apiPortOption);
+  QCommandLineOption apiLoadTestOption(
+      "api-load-test",
+      "Send the given number of requests to a running API server and print a "
+      "report.",
+      "requests");
+  parser.addOption(apiLoadTestOption);
+  QCommandLineOption apiTokenOption(
+      "api-token", "Token printed by the application serving the API.",
+      "token");
+  parser.addOption(apiTokenOption);
+  QCommandLineOption traceOption(
+      "trace", "Record trace spans and write Chrome traces to a directory.",
+      "directory");
+  parser.addOption(traceOption);
+  QCommandLineOption stallThresholdOption(
+      "stall-threshold",
+      "GUI stall in milliseconds that triggers a trace dump with --trace.",
+      "ms", "500");
+  parser.addOption(stallThresholdOption);
+  Benchmarks::addOptions(parser);
+  parser.process(app);
+
+  Tracer &tracer = Tracer::instance();
+  if (parser.isSet(traceOption)) {
+    tracer.setOutputDirectory(parser.value(traceOption));
+    tracer.startStallWatchdog(parser.value(stallThresholdOption).toInt());
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, &tracer, [&tracer]() {
+      tracer.stopStallWatchdog();
+      qDebug() << "Trace written to" << tracer.dump();
+    });
+  }
+
+  if (parser.isSet(apiLoadTestOption)) {
+    ApiLoadTest::run(parser.value(apiPortOption).toUShort(),
+                     parser.value(apiTokenOption).toUtf8(),
+                     parser.value(apiLoadTestOption).toInt());
+    return 0;
+  }
+  if (Benchmarks::isRequested(parser))
+    return Benchmarks::run(parser, parser.value(replayTargetOption));
+  if (parser.isSet(replayOption)) {
+    if (!Benchmarks::openTarget(parser.value(replayTargetOption), true))
+      return 1;
+    ToDoListModel todoModel;
+    TODONotesModel todoNotesModel;
+    WorkloadReplayer replayer(todoNotesModel, todoModel);
+    if (!replayer.loadEvents(parser.value(replayOption)))
+      return 1;
+    QObject::connect(&replayer, &WorkloadReplayer::finished, &app,
+                     &QCoreApplication::quit);
+    replayer.start(parser.value(replaySpeedOption).toDouble());
+    return app.exec();
+  }
+
+  WorkspaceRegistry &workspaces = WorkspaceRegistry::instance();
+  for (const QString &workspace : parser.values(workspaceOption)) {
+    const QString name = workspace.section('=', 0, 0);
+    const QString path = workspace.section('=', 1);
+    if (!workspaces.openWorkspace(name, path) ||
+        !workspaces.setCurrentWorkspace(name))
+      qDebug() << "Failed to open workspace:" << workspace;
+  }
+
   DBManager *dbManager = DBManager::instance();
-  Q_UNUSED(dbManager);
+  if (parser.isSet(restoreOption) &&
+      !dbManager->restoreFromBackup(parser.value(restoreOption)))
+    qDebug() << "Restore failed:" << parser.value(restoreOption);
+  if (parser.isSet(snapshotsOption))
+    dbManager->startScheduledSnapshots(parser.value(snapshotsOption),
+                                       60 * 60 * 1000, 24);
+  dbManager->startMaintenance();
+  SyncEngine syncEngine;
+  if (parser.isSet(syncOption) &&
+      !syncEngine.syncWith(parser.value(syncOption)))
+    qDebug() << "Sync failed:" << parser.value(syncOption);
+
   ToDoListModel todoModel;
   TODONotesModel todoNotesModel;
   EventLogsModel logsModel;
+  TaskTreeModel taskTreeModel;
+  TagFilterModel tagFilterModel;
+  ReminderScheduler reminders;
+  AnalyticsModel analyticsModel;
+  QuickSwitcherModel quickSwitcherModel;
+  constexpr int prefetchedNotes = 10;
   todoNotesModel.fetchAllNotesFromDB();
+  todoModel.prefetchNotes(todoNotesModel.noteIds(prefetchedNotes));
+  QObject::connect(&todoNotesModel, &QAbstractItemModel::modelReset, &todoModel,
+                   [&todoModel, &todoNotesModel]() {
+                     todoModel.prefetchNotes(
+                         todoNotesModel.noteIds(prefetchedNotes));
+                   });
+  QObject::connect(&todoModel, &ToDoListModel::noteIDChanged, &taskTreeModel,
+                   [&todoModel, &taskTreeModel]() {
+                     taskTreeModel.setNoteID(todoModel.getNoteID());
+                   });
+  ApiServer apiServer;
+  if (parser.isSet(apiPortOption)) {
+    if (apiServer.listen(parser.value(apiPortOption).toUShort()))
+      QTextStream(stdout) << "API token: " << apiServer.token() << "\n";
+    else
+      qDebug() << "API server not started on port"
+               << parser.value(apiPortOption);
+  }
   QQmlApplicationEngine engine;
   engine.rootContext()->setContextProperty("todoModel", &todoModel);
   engine.rootContext()->setContextProperty("todoNotesModel", &todoNotesModel);
   engine.rootContext()->setContextProperty("eventLogsModel", &logsModel);
+  engine.rootContext()->setContextProperty("taskTreeModel", &taskTreeModel);
+  engine.rootContext()->setContextProperty("tagFilterModel", &tagFilterModel);
+  engine.rootContext()->setContextProperty("reminders", &reminders);
+  engine.rootContext()->setContextProperty("analyticsModel", &analyticsModel);
+  engine.rootContext()->setContextProperty("quickSwitcherModel",
+                                           &quickSwitcherModel);
+  engine.rootContext()->setContextProperty("workspaces", &workspaces);
+  engine.rootContext()->setContextProperty("tracer", &tracer);
+  engine.rootContext()->setContextProperty("syncEngine", &syncEngine);
   const QUrl url(QStringLiteral("qrc:/main.qml"));
   QObject::connect(
       &engine, &QQmlApplicationEngine::objectCreated, &app,
@@ -22,11 +22,10 @@ Window {
                 pageSwitcher.currentIndex = 0
             }
         }
-        // Logs button: switches to logs page and refreshes logs
+        // Logs button: switches to logs page (the logs model updates itself on new events)
         logsButton{
             onClicked: {
                 pageSwitcher.currentIndex = 2
-                eventLogsModel.refresh()
             }
         }
     }
@@ -60,4 +59,42 @@ Window {
             Layout.fillHeight: true
         }
     }
+
+    // Reminder banner: shown when a task reaches its due date
+    Rectangle{
+        id:reminderBanner
+        property string message: ""
+        width: parent.width * 0.9
+        height: 60
+        anchors{
+            horizontalCenter: parent.horizontalCenter
+            bottom: parent.bottom
+            bottomMargin: 20
+        }
+        radius: height*0.2
+        color: "#7ADAA5"
+        visible: false
+        Text {
+            anchors.fill: parent
+            anchors.margins: 10
+            text: reminderBanner.message
+            elide: Text.ElideRight
+            horizontalAlignment: Text.AlignHCenter
+            verticalAlignment: Text.AlignVCenter
+        }
+        Timer{
+            id:reminderHideTimer
+            interval: 5000
+            onTriggered: reminderBanner.visible = false
+        }
+    }
+
+    Connections{
+        target: reminders
+        function onReminderDue(contentId, noteId, content, dueAt) {
+            reminderBanner.message = qsTr("Due: %1").arg(content)
+            reminderBanner.visible = true
+            reminderHideTimer.restart()
+        }
+    }
 }
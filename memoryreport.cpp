@@ -0,0 +1,55 @@
+#include "benchmarks.h"
+#include "dbmanager.h"
+#include "eventlogsmodel.h"
+#include "logger.h"
+#include "todolistmodel.h"
+#include <QTextStream>
+
+/**
+ * @brief Measures the resident memory that large task and event log models take and prints the result.
+ *
+ * Adds a note of @p rowCount tasks and @p rowCount event log entries, spread
+ * over 20 note names and the task event types, to the current workspace.
+ * Then loads them into @p todoModel and a new EventLogsModel and reports the
+ * growth of the resident set size, in total and per 100k rows of each model.
+ *
+ * @param todoModel The model the tasks are loaded into.
+ * @param rowCount Number of tasks and of event log entries.
+ */
+void Benchmarks::runMemoryReport(ToDoListModel &todoModel, int rowCount) {
+  QTextStream out(stdout);
+  DBManager *db = DBManager::instance();
+  const int noteId = db->addNote("Memory report");
+  const Logger::EventType types[] = {
+      Logger::TASK_ADDED, Logger::TASK_STATUS_TOGGLED, Logger::TASK_UPDATED,
+      Logger::TASK_DELETED};
+  db->beginTransaction();
+  for (int i = 0; i < rowCount; ++i) {
+    const QString task = QStringLiteral("Task %1").arg(i);
+    db->addNoteContent(noteId, task);
+    Logger::instance().logEvent(types[i % 4],
+                                QStringLiteral("Note %1").arg(i % 20), task);
+  }
+  db->commitTransaction();
+  if (rowCount <= 0)
+    return;
+
+  const qint64 before = residentKiB();
+  todoModel.setNoteID(noteId);
+  const qint64 afterTasks = residentKiB();
+  EventLogsModel logsModel;
+  const qint64 afterLogs = residentKiB();
+  if (before < 0) {
+    out << "Resident memory is not known on this platform\n";
+    return;
+  }
+  auto per100k = [rowCount](qint64 kib) {
+    return QString::number(kib * 100000.0 / rowCount / 1024, 'f', 1);
+  };
+  out << "Resident memory: " << before / 1024 << " MiB before, "
+      << afterLogs / 1024 << " MiB with " << todoModel.rowCount()
+      << " tasks and " << logsModel.rowCount() << " event log entries\n";
+  out << "Per 100k rows: tasks " << per100k(afterTasks - before)
+      << " MiB, event logs " << per100k(afterLogs - afterTasks) << " MiB\n";
+  out.flush();
+}
@@ -0,0 +1,65 @@
+#include "orderkey.h"
+
+namespace {
+const QString digits =
+    QStringLiteral("0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz");
+const int base = 62;
+} // namespace
+
+/**
+ * @brief Returns a key that sorts strictly between two keys.
+ *
+ * @param before The key of the previous row, or an empty string for the start of the list.
+ * @param after The key of the next row, or an empty string for the end of the list.
+ * @return A new key; @p before must sort before @p after.
+ */
+QString OrderKey::between(const QString &before, const QString &after) {
+  if (!after.isEmpty()) {
+    int common = 0;
+    while (common < after.size() &&
+           (common < before.size() ? before.at(common) : digits.at(0)) ==
+               after.at(common))
+      ++common;
+    if (common > 0)
+      return after.left(common) +
+             between(before.mid(common), after.mid(common));
+  }
+  const int low = before.isEmpty() ? 0 : digits.indexOf(before.at(0));
+  const int high = after.isEmpty() ? base : digits.indexOf(after.at(0));
+  if (high - low > 1)
+    return QString(digits.at((low + high) / 2));
+  // Adjacent first digits: shorten the upper bound, or extend the lower one.
+  if (after.size() > 1)
+    return after.left(1);
+  return digits.at(low) + between(before.mid(1), QString());
+}
+
+/**
+ * @brief Returns @p count evenly spaced keys in ascending order.
+ *
+ * Keys have the smallest width that leaves room for about one base-62 digit of
+ * inserts between neighbours, so a rebalanced list starts with short keys.
+ *
+ * @param count Number of keys.
+ * @return The keys.
+ */
+QStringList OrderKey::spread(int count) {
+  int width = 1;
+  qint64 range = base;
+  while (range < qint64(count + 1) * base) {
+    range *= base;
+    ++width;
+  }
+  QStringList keys;
+  keys.reserve(count);
+  for (int i = 1; i <= count; ++i) {
+    qint64 value = range / (count + 1) * i;
+    QString key(width, digits.at(0));
+    for (int d = width - 1; d >= 0; --d, value /= base)
+      key[d] = digits.at(int(value % base));
+    while (key.endsWith(digits.at(0)))
+      key.chop(1);
+    keys.append(key);
+  }
+  return keys;
+}
@@ -0,0 +1,30 @@
+#ifndef ORDERKEY_H
+#define ORDERKEY_H
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * @class OrderKey
+ * @brief Fractional-index ordering keys for user-ordered rows.
+ *
+ * Rows are sorted by a string key compared byte-wise (SQLite's default collation). A key can
+ * always be generated strictly between two neighbours, so moving a row only rewrites that row's
+ * key instead of renumbering every position after it. Keys use base-62 digits ("0-9A-Za-z", in
+ * ASCII order) and never end with '0', which guarantees there is always room before any key.
+ *
+ * Repeated inserts at the same spot make keys grow by about one digit per six inserts; once a key
+ * exceeds rebalanceLength, the owning model rewrites the keys of the list with spread().
+ *
+ * Usage:
+ *   QString key = OrderKey::between(previousKey, nextKey);
+ */
+class OrderKey {
+public:
+  static constexpr int rebalanceLength = 12;
+
+  static QString between(const QString &before, const QString &after);
+  static QStringList spread(int count);
+};
+
+#endif // ORDERKEY_H
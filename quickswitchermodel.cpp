@@ -0,0 +1,60 @@
+#include "quickswitchermodel.h"
+#include "tracer.h"
+#include "trigramindex.h"
+
+QuickSwitcherModel::QuickSwitcherModel(QObject *parent)
+    : quickSwitcherBase(parent) {
+  QObject::connect(&TrigramIndex::instance(), &TrigramIndex::indexChanged,
+                   this, &QuickSwitcherModel::refresh);
+}
+
+/**
+ * @brief Role accessors of QuickSwitcherModel.
+ */
+QVariant switcherNoteIdField::get(const QuickSwitcherModel &,
+                                  const switcherElement &row) {
+  return row.noteId;
+}
+
+QVariant switcherNoteNameField::get(const QuickSwitcherModel &,
+                                    const switcherElement &row) {
+  return row.title;
+}
+
+/**
+ * @brief Sets the text typed so far and shows its best matches.
+ *
+ * @param query The typed text; an empty text clears the results.
+ */
+void QuickSwitcherModel::setQuery(const QString &query) {
+  TRACE_SPAN(span, "qml");
+  if (query == m_query)
+    return;
+  m_query = query;
+  refresh();
+}
+
+/**
+ * @brief Returns the note ID of a result row, or -1 if the row does not exist.
+ */
+int QuickSwitcherModel::noteIdAt(int row) const {
+  return row >= 0 && row < m_rows.size() ? m_rows.at(row).noteId : -1;
+}
+
+/**
+ * @brief Searches the index for the current query and replaces the results.
+ */
+void QuickSwitcherModel::refresh() {
+  TRACE_SPAN(span, "model");
+  const QVector<trigramMatch> matches =
+      m_query.isEmpty() ? QVector<trigramMatch>()
+                        : TrigramIndex::instance().search(m_query, maxResults);
+  if (matches.isEmpty() && m_rows.isEmpty())
+    return;
+  beginResetModel();
+  m_rows.clear();
+  m_rows.reserve(matches.size());
+  for (const trigramMatch &match : matches)
+    m_rows.append({match.noteId, match.title});
+  endResetModel();
+}
@@ -0,0 +1,70 @@
+#ifndef QUICKSWITCHERMODEL_H
+#define QUICKSWITCHERMODEL_H
+
+#include "rowlistmodel.h"
+#include <QObject>
+
+/**
+ * @struct switcherElement
+ * @brief One result row of QuickSwitcherModel.
+ *
+ * @var switcherElement::noteId
+ *   The matching note.
+ * @var switcherElement::title
+ *   Its title.
+ */
+struct switcherElement {
+  int noteId;
+  QString title;
+};
+class QuickSwitcherModel;
+
+/**
+ * @brief Fields of QuickSwitcherModel, one per role (see RowListModel).
+ */
+struct switcherNoteIdField {
+  static constexpr const char *name = "NoteID";
+  static QVariant get(const QuickSwitcherModel &, const switcherElement &row);
+};
+struct switcherNoteNameField {
+  static constexpr const char *name = "NoteName";
+  static QVariant get(const QuickSwitcherModel &, const switcherElement &row);
+};
+
+using quickSwitcherBase =
+    RowListModel<QuickSwitcherModel, switcherElement, switcherNoteIdField,
+                 switcherNoteNameField>;
+
+/**
+ * @class QuickSwitcherModel
+ * @brief List model of the notes best matching the text typed into the quick switcher.
+ *
+ * Each call to setQuery() (one per keystroke) searches the shared TrigramIndex, so results are
+ * ranked, tolerate typos and never query the database. The results are searched again whenever
+ * the index changes, e.g. when a note is added or renamed while the switcher is open.
+ *
+ * @see TrigramIndex
+ */
+class QuickSwitcherModel : public quickSwitcherBase {
+  Q_OBJECT
+public:
+  static constexpr int maxResults = 10;
+
+  explicit QuickSwitcherModel(QObject *parent = nullptr);
+  enum roleEnums {
+    noteIDRole = roleOf<switcherNoteIdField>(),
+    ItemNameRole = roleOf<switcherNoteNameField>()
+  };
+  Q_ENUM(roleEnums);
+
+  Q_INVOKABLE void setQuery(const QString &query);
+  Q_INVOKABLE int noteIdAt(int row) const;
+
+private slots:
+  void refresh();
+
+private:
+  QString m_query;
+};
+
+#endif // QUICKSWITCHERMODEL_H
@@ -0,0 +1,106 @@
+#include "recurrencerule.h"
+
+/**
+ * @brief Builds a rule from a row returned by DBManager::getRecurrenceRules().
+ *
+ * @param map The row; unknown frequencies are read as daily.
+ * @return The rule.
+ */
+RecurrenceRule RecurrenceRule::fromMap(const QVariantMap &map) {
+  RecurrenceRule rule;
+  rule.ruleId = map.value("rule_id", -1).toInt();
+  rule.noteId = map.value("note_id", -1).toInt();
+  rule.content = map.value("content").toString();
+  rule.start = QDateTime::fromMSecsSinceEpoch(map.value("start_at").toLongLong());
+  const QString frequency = map.value("frequency").toString();
+  if (frequency == frequencyName(Weekly))
+    rule.frequency = Weekly;
+  else if (frequency == frequencyName(Monthly))
+    rule.frequency = Monthly;
+  rule.interval = qMax(1, map.value("interval", 1).toInt());
+  rule.weekdays = map.value("weekdays").toInt() & 0x7f;
+  if (!map.value("until_at").isNull())
+    rule.until =
+        QDateTime::fromMSecsSinceEpoch(map.value("until_at").toLongLong());
+  return rule;
+}
+
+/**
+ * @brief Returns the name a frequency is stored under ("DAILY", "WEEKLY" or "MONTHLY").
+ */
+QString RecurrenceRule::frequencyName(Frequency frequency) {
+  switch (frequency) {
+  case Weekly:
+    return QStringLiteral("WEEKLY");
+  case Monthly:
+    return QStringLiteral("MONTHLY");
+  default:
+    return QStringLiteral("DAILY");
+  }
+}
+
+/**
+ * @brief Returns the occurrences of the rule in a time range, in ascending order.
+ *
+ * Periods before @p from are skipped arithmetically rather than stepped
+ * through, so the cost depends on the size of the range and not on how long
+ * ago the rule started.
+ *
+ * @param from Start of the range (inclusive).
+ * @param to End of the range (exclusive).
+ * @param limit Maximum number of occurrences returned.
+ * @return The occurrences.
+ */
+QVector<QDateTime> RecurrenceRule::occurrences(const QDateTime &from,
+                                               const QDateTime &to,
+                                               int limit) const {
+  QVector<QDateTime> result;
+  if (!start.isValid() || !from.isValid() || from >= to)
+    return result;
+  const QDateTime end = until.isValid() && until.addMSecs(1) < to
+                            ? until.addMSecs(1)
+                            : to;
+  const QDate startDate = start.date();
+  const QTime time = start.time();
+  const QDate fromDate = qMax(from, start).date();
+  auto accept = [&](const QDate &date) {
+    const QDateTime occurrence(date, time);
+    if (occurrence >= from && occurrence >= start && occurrence < end)
+      result.append(occurrence);
+    return occurrence < end && result.size() < limit;
+  };
+
+  switch (frequency) {
+  case Daily: {
+    qint64 step = qMax<qint64>(0, startDate.daysTo(fromDate) / interval - 1);
+    for (QDate date = startDate.addDays(step * interval); accept(date);
+         date = date.addDays(interval))
+      ;
+    break;
+  }
+  case Weekly: {
+    const int mask = weekdays ? weekdays : 1 << (startDate.dayOfWeek() - 1);
+    const QDate monday = startDate.addDays(1 - startDate.dayOfWeek());
+    qint64 week = qMax<qint64>(0, monday.daysTo(fromDate) / 7 / interval - 1);
+    for (;; ++week) {
+      const QDate weekStart = monday.addDays(week * interval * 7);
+      bool more = true;
+      for (int day = 0; more && day < 7; ++day)
+        if (mask & (1 << day))
+          more = accept(weekStart.addDays(day));
+      if (!more)
+        break;
+    }
+    break;
+  }
+  case Monthly: {
+    const int months = (fromDate.year() - startDate.year()) * 12 +
+                       fromDate.month() - startDate.month();
+    int step = qMax(0, months / interval - 1);
+    while (accept(startDate.addMonths(step * interval)))
+      ++step;
+    break;
+  }
+  }
+  return result;
+}
@@ -0,0 +1,46 @@
+#ifndef RECURRENCERULE_H
+#define RECURRENCERULE_H
+
+#include <QDateTime>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+/**
+ * @class RecurrenceRule
+ * @brief A row of the RecurrenceRules table and the occurrences it produces.
+ *
+ * A recurring task is stored once, as a rule. Its occurrences are computed on
+ * demand for the time window a model shows, so an "every day" task costs one
+ * row no matter how far the calendar is scrolled. Only occurrences the user
+ * changes are written to NotesContents (DBManager::materializeOccurrence()).
+ *
+ * Occurrences keep the local time of day of the start, across daylight saving
+ * changes. Monthly rules on the 29th-31st fall on the last day of shorter
+ * months.
+ *
+ * Usage:
+ *   RecurrenceRule rule = RecurrenceRule::fromMap(map);
+ *   QVector<QDateTime> days = rule.occurrences(from, to);
+ */
+class RecurrenceRule {
+public:
+  enum Frequency { Daily, Weekly, Monthly };
+
+  static RecurrenceRule fromMap(const QVariantMap &map);
+  static QString frequencyName(Frequency frequency);
+
+  QVector<QDateTime> occurrences(const QDateTime &from, const QDateTime &to,
+                                 int limit = 1000) const;
+
+  int ruleId = -1;
+  int noteId = -1;
+  QString content;
+  QDateTime start;
+  Frequency frequency = Daily;
+  int interval = 1;
+  int weekdays = 0; ///< Weekly only: Monday = 1, Tuesday = 2 ... Sunday = 64; 0 means the start day.
+  QDateTime until;  ///< Invalid when the rule never ends.
+};
+
+#endif // RECURRENCERULE_H
@@ -0,0 +1,246 @@
+#include "reminderscheduler.h"
+#include "dbmanager.h"
+#include "workspaceregistry.h"
+#include <algorithm>
+
+ReminderScheduler::ReminderScheduler(QObject *parent) : QObject(parent) {
+  m_timer.setSingleShot(true);
+  QObject::connect(&m_timer, &QTimer::timeout, this,
+                   &ReminderScheduler::fireDueReminders);
+  QObject::connect(&WorkspaceRegistry::instance(),
+                   &WorkspaceRegistry::currentWorkspaceChanged, this,
+                   &ReminderScheduler::reload);
+  QObject::connect(&WorkspaceRegistry::instance(), &WorkspaceRegistry::changed,
+                   this, &ReminderScheduler::applyDatabaseChange);
+  reload();
+}
+
+/**
+ * @brief Returns the number of deadlines currently held in memory.
+ */
+int ReminderScheduler::pendingCount() const { return m_heap.size(); }
+
+/**
+ * @brief Drops the window and loads the first deadlines from now on.
+ */
+void ReminderScheduler::reload() {
+  m_heap.clear();
+  m_positions.clear();
+  m_loadedUntil = {QDateTime::currentMSecsSinceEpoch(), -1};
+  m_exhausted = false;
+  loadMore();
+  armTimer();
+}
+
+/**
+ * @brief Keeps the window in step with committed task changes.
+ *
+ * @param event The change published by DBManager.
+ */
+void ReminderScheduler::applyDatabaseChange(const DBChangeEvent &event) {
+  if (event.table != DBChangeEvent::NotesContents)
+    return;
+  switch (event.operation) {
+  case DBChangeEvent::Inserted:
+    return;
+  case DBChangeEvent::Updated:
+    if (event.values.contains("due_at")) {
+      unschedule(event.rowId);
+      const qint64 dueAt = event.values.value("due_at").toLongLong();
+      if (dueAt >= 0)
+        schedule(event.rowId, dueAt);
+    } else if (event.values.contains("completed")) {
+      if (event.values.value("completed").toBool()) {
+        unschedule(event.rowId);
+      } else {
+        // Reopened: it is due again if it still has a due date.
+        const QList<QVariantMap> rows =
+            DBManager::instance()->getNoteContentsByIds({event.rowId});
+        if (!rows.isEmpty() && !rows.first()["due_at"].isNull())
+          schedule(event.rowId, rows.first()["due_at"].toLongLong());
+      }
+    } else {
+      return;
+    }
+    break;
+  case DBChangeEvent::Deleted:
+    if (event.rowId < 0) {
+      reload();
+      return;
+    }
+    unschedule(event.rowId);
+    break;
+  case DBChangeEvent::Reloaded:
+    reload();
+    return;
+  }
+  armTimer();
+}
+
+/**
+ * @brief Emits reminderDue() for every deadline that has passed and re-arms the timer.
+ *
+ * A due date set on a task that is already completed is dropped here rather
+ * than looked up when it is scheduled.
+ */
+void ReminderScheduler::fireDueReminders() {
+  const qint64 now = QDateTime::currentMSecsSinceEpoch();
+  QVector<int> dueIds;
+  while (!m_heap.isEmpty() && m_heap.first().dueAt <= now) {
+    dueIds.append(m_heap.first().id);
+    removeAt(0);
+  }
+  if (!dueIds.isEmpty()) {
+    std::sort(dueIds.begin(), dueIds.end());
+    const QList<QVariantMap> rows =
+        DBManager::instance()->getNoteContentsByIds(dueIds);
+    for (const QVariantMap &row : rows)
+      if (!row["completed"].toBool())
+        emit reminderDue(row["id"].toInt(), row["note_id"].toInt(),
+                         row["content"].toString(),
+                         QDateTime::fromMSecsSinceEpoch(
+                             row["due_at"].toLongLong()));
+  }
+  if (m_heap.size() < windowSize / 4)
+    loadMore();
+  armTimer();
+}
+
+/**
+ * @brief Orders deadlines by due date, then task ID.
+ */
+bool ReminderScheduler::before(const reminderEntry &a, const reminderEntry &b) {
+  return a.dueAt < b.dueAt || (a.dueAt == b.dueAt && a.id < b.id);
+}
+
+/**
+ * @brief Returns whether a deadline falls inside the part of the timeline loaded so far.
+ */
+bool ReminderScheduler::inWindow(const reminderEntry &entry) const {
+  return m_exhausted || !before(m_loadedUntil, entry);
+}
+
+/**
+ * @brief Loads the next deadlines after the loaded window from the database.
+ */
+void ReminderScheduler::loadMore() {
+  if (m_exhausted)
+    return;
+  const QList<QVariantMap> rows = DBManager::instance()->getUpcomingDeadlines(
+      m_loadedUntil.dueAt, m_loadedUntil.id, windowSize);
+  for (const QVariantMap &row : rows) {
+    const reminderEntry entry{row["due_at"].toLongLong(), row["id"].toInt()};
+    if (!m_positions.contains(entry.id))
+      push(entry);
+    m_loadedUntil = entry;
+  }
+  m_exhausted = rows.size() < windowSize;
+}
+
+/**
+ * @brief Adds a deadline if it falls inside the loaded window.
+ *
+ * Later deadlines are left to the database and loaded when the window gets there.
+ */
+void ReminderScheduler::schedule(int contentId, qint64 dueAt) {
+  const reminderEntry entry{dueAt, contentId};
+  if (!inWindow(entry))
+    return;
+  push(entry);
+  trimWindow();
+}
+
+/**
+ * @brief Removes the deadline of a task, if it is held in memory.
+ */
+void ReminderScheduler::unschedule(int contentId) {
+  auto found = m_positions.constFind(contentId);
+  if (found != m_positions.constEnd())
+    removeAt(found.value());
+}
+
+/**
+ * @brief Shrinks the window back to windowSize deadlines once edits have doubled it.
+ *
+ * The latest deadlines are dropped and the loaded window ends before them, so
+ * they are reloaded from the database in due course.
+ */
+void ReminderScheduler::trimWindow() {
+  if (m_heap.size() <= 2 * windowSize)
+    return;
+  QVector<reminderEntry> entries = m_heap;
+  std::sort(entries.begin(), entries.end(), &ReminderScheduler::before);
+  entries.resize(windowSize);
+  m_heap.clear();
+  m_positions.clear();
+  for (const reminderEntry &entry : qAsConst(entries))
+    push(entry);
+  m_loadedUntil = entries.last();
+  m_exhausted = false;
+}
+
+/**
+ * @brief Arms the timer for the earliest deadline, or stops it if there is none.
+ *
+ * Long waits are split into maxTimerIntervalMs steps, which also bounds the
+ * drift after a system clock change.
+ */
+void ReminderScheduler::armTimer() {
+  if (m_heap.isEmpty()) {
+    m_timer.stop();
+    return;
+  }
+  const qint64 wait =
+      m_heap.first().dueAt - QDateTime::currentMSecsSinceEpoch();
+  m_timer.start(int(qBound<qint64>(0, wait, maxTimerIntervalMs)));
+}
+
+void ReminderScheduler::push(const reminderEntry &entry) {
+  m_heap.append(entry);
+  m_positions.insert(entry.id, m_heap.size() - 1);
+  siftUp(m_heap.size() - 1);
+}
+
+void ReminderScheduler::removeAt(int position) {
+  m_positions.remove(m_heap.at(position).id);
+  const reminderEntry last = m_heap.takeLast();
+  if (position == m_heap.size())
+    return;
+  place(position, last);
+  siftUp(position);
+  siftDown(m_positions.value(last.id));
+}
+
+void ReminderScheduler::siftUp(int position) {
+  const reminderEntry entry = m_heap.at(position);
+  while (position > 0) {
+    const int parent = (position - 1) / 2;
+    if (!before(entry, m_heap.at(parent)))
+      break;
+    place(position, m_heap.at(parent));
+    position = parent;
+  }
+  place(position, entry);
+}
+
+void ReminderScheduler::siftDown(int position) {
+  const reminderEntry entry = m_heap.at(position);
+  const int size = m_heap.size();
+  while (true) {
+    int child = 2 * position + 1;
+    if (child >= size)
+      break;
+    if (child + 1 < size && before(m_heap.at(child + 1), m_heap.at(child)))
+      ++child;
+    if (!before(m_heap.at(child), entry))
+      break;
+    place(position, m_heap.at(child));
+    position = child;
+  }
+  place(position, entry);
+}
+
+void ReminderScheduler::place(int position, const reminderEntry &entry) {
+  m_heap[position] = entry;
+  m_positions.insert(entry.id, position);
+}
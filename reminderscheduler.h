@@ -0,0 +1,81 @@
+#ifndef REMINDERSCHEDULER_H
+#define REMINDERSCHEDULER_H
+
+#include "dbchangeevent.h"
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+/**
+ * @struct reminderEntry
+ * @brief One pending deadline held by the ReminderScheduler.
+ *
+ * @var reminderEntry::dueAt
+ *   Due date in epoch milliseconds.
+ * @var reminderEntry::id
+ *   Task the deadline belongs to.
+ */
+struct reminderEntry {
+  qint64 dueAt;
+  int id;
+};
+
+/**
+ * @class ReminderScheduler
+ * @brief Emits reminderDue() when open tasks of the current workspace reach their due date.
+ *
+ * Only a window of the next deadlines is kept in memory, in an indexed min-heap (a hash maps each
+ * task to its heap slot, so a task whose due date changes or that is completed is moved or removed
+ * in O(log n)). A single timer is armed for the earliest deadline, so an idle application does no
+ * work however many tasks are scheduled. When the window runs low, the following deadlines are
+ * loaded by keyset from the due date index. Deadlines that change beyond the loaded window are
+ * left to the database and picked up when the window reaches them.
+ *
+ * Deadlines that passed while the application was closed are not announced.
+ */
+class ReminderScheduler : public QObject {
+  Q_OBJECT
+public:
+  explicit ReminderScheduler(QObject *parent = nullptr);
+
+  Q_INVOKABLE int pendingCount() const;
+
+public slots:
+  void reload();
+
+signals:
+  void reminderDue(int contentId, int noteId, const QString &content,
+                   const QDateTime &dueAt);
+
+private slots:
+  void applyDatabaseChange(const DBChangeEvent &event);
+  void fireDueReminders();
+
+private:
+  static constexpr int windowSize = 256;
+  static constexpr int maxTimerIntervalMs = 60 * 60 * 1000;
+
+  static bool before(const reminderEntry &a, const reminderEntry &b);
+  bool inWindow(const reminderEntry &entry) const;
+  void loadMore();
+  void schedule(int contentId, qint64 dueAt);
+  void unschedule(int contentId);
+  void trimWindow();
+  void armTimer();
+
+  void push(const reminderEntry &entry);
+  void removeAt(int position);
+  void siftUp(int position);
+  void siftDown(int position);
+  void place(int position, const reminderEntry &entry);
+
+  QVector<reminderEntry> m_heap;
+  QHash<int, int> m_positions;
+  reminderEntry m_loadedUntil{0, -1};
+  bool m_exhausted = false;
+  QTimer m_timer;
+};
+
+#endif // REMINDERSCHEDULER_H
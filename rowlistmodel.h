@@ -0,0 +1,149 @@
+#ifndef ROWLISTMODEL_H
+#define ROWLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @class RowListModel
+ * @brief Flat list model whose roles are generated at compile time from a row description.
+ *
+ * A model stores its rows in m_rows and describes each role by a field type with a role name
+ * and a static accessor:
+ *
+ *   struct todoIdField {
+ *     static constexpr const char *name = "id";
+ *     static QVariant get(const ToDoListModel &model, const listElement &row);
+ *   };
+ *   class ToDoListModel
+ *       : public RowListModel<ToDoListModel, listElement, todoIdField, ...> { ... };
+ *
+ * Roles are numbered from Qt::UserRole + 1 in field order, and roleOf<Field>() gives the role
+ * of a field as a constant expression, so models declare their role enums from it. data() is a
+ * bounds check and one call through a constexpr table of accessors, with no switch over roles
+ * and no copy of the row. roleNames() is built from the same table.
+ *
+ * rowCount() and data() reach the rows only through viewRowCount() and viewRow(), which a model
+ * hides to show something other than m_rows as it is: a model whose view order differs from its
+ * storage order hides rowAt(), and a model that pages its rows in from the database hides both
+ * (ToDoListModel shows a large note through a TaskWindow this way). The protected helpers wrap
+ * the begin/end notifications of single-row updates so derived models apply database changes
+ * with the narrowest notification.
+ *
+ * @tparam Model The derived model (CRTP).
+ * @tparam Row The row struct stored in m_rows.
+ * @tparam Fields One field type per role, in role order.
+ */
+template <typename Model, typename Row, typename... Fields>
+class RowListModel : public QAbstractListModel {
+public:
+  static constexpr int firstRole = Qt::UserRole + 1;
+  static constexpr int fieldCount = int(sizeof...(Fields));
+
+  /**
+   * @brief Returns the role of @p Field; fails to compile if it is not a field of the model.
+   */
+  template <typename Field> static constexpr int roleOf() {
+    static_assert((std::is_same<Field, Fields>::value || ...),
+                  "Field is not a field of this model");
+    constexpr bool matches[] = {std::is_same<Field, Fields>::value...};
+    int index = 0;
+    while (!matches[index])
+      ++index;
+    return firstRole + index;
+  }
+
+  explicit RowListModel(QObject *parent = nullptr)
+      : QAbstractListModel(parent) {}
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override {
+    return parent.isValid() ? 0
+                            : static_cast<const Model &>(*this).viewRowCount();
+  }
+
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override {
+    const unsigned field = unsigned(role - firstRole);
+    const Model &model = static_cast<const Model &>(*this);
+    if (!index.isValid() || index.row() >= model.viewRowCount() ||
+        field >= unsigned(fieldCount))
+      return QVariant();
+    const Row *row = model.viewRow(index.row());
+    return row ? accessors[field](model, *row) : QVariant();
+  }
+
+  QHash<int, QByteArray> roleNames() const override {
+    QHash<int, QByteArray> names;
+    for (int i = 0; i < fieldCount; ++i)
+      names.insert(firstRole + i, QByteArray(fieldNames[i]));
+    return names;
+  }
+
+  /**
+   * @brief Returns the stored row shown at view row @p row.
+   */
+  const Row &rowAt(int row) const { return m_rows.at(row); }
+
+  /**
+   * @brief Returns the number of rows views see.
+   */
+  int viewRowCount() const { return m_rows.size(); }
+
+  /**
+   * @brief Returns the row shown at view row @p row, or nullptr if it cannot be read.
+   */
+  const Row *viewRow(int row) const {
+    return &static_cast<const Model &>(*this).rowAt(row);
+  }
+
+protected:
+  using Accessor = QVariant (*)(const Model &, const Row &);
+  static constexpr Accessor accessors[] = {&Fields::get...};
+  static constexpr const char *fieldNames[] = {Fields::name...};
+
+  /**
+   * @brief Inserts @p value so that it becomes row @p row.
+   */
+  void insertRowAt(int row, const Row &value) {
+    beginInsertRows(QModelIndex(), row, row);
+    m_rows.insert(row, value);
+    endInsertRows();
+  }
+
+  /**
+   * @brief Removes row @p row.
+   */
+  void removeRowAt(int row) {
+    beginRemoveRows(QModelIndex(), row, row);
+    m_rows.removeAt(row);
+    endRemoveRows();
+  }
+
+  /**
+   * @brief Moves row @p from so that it ends up at row @p to.
+   */
+  void moveRowTo(int from, int to) {
+    if (from == to)
+      return;
+    beginMoveRows(QModelIndex(), from, from, QModelIndex(),
+                  to > from ? to + 1 : to);
+    m_rows.move(from, to);
+    endMoveRows();
+  }
+
+  /**
+   * @brief Notifies views that the given fields of row @p row changed.
+   */
+  template <typename... Changed> void rowChanged(int row) {
+    const QModelIndex changed = index(row);
+    emit dataChanged(changed, changed, {roleOf<Changed>()...});
+  }
+
+  QVector<Row> m_rows;
+};
+
+#endif // ROWLISTMODEL_H
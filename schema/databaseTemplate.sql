@@ -1,7 +1,9 @@
 CREATE TABLE IF NOT EXISTS Notes (
     note_id INTEGER PRIMARY KEY AUTOINCREMENT,
     title VARCHAR(255) NOT NULL,
-    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+    created_at INTEGER NOT NULL DEFAULT (CAST((julianday('now') - 2440587.5) * 86400000 AS INTEGER)),
+    sort_key TEXT,
+    uuid TEXT
 );
 
 CREATE TABLE IF NOT EXISTS NotesContents (
@@ -9,12 +11,125 @@ CREATE TABLE IF NOT EXISTS NotesContents (
     note_id INT NOT NULL,
     content TEXT NOT NULL,
     completed BOOLEAN DEFAULT FALSE,
-    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+    created_at INTEGER NOT NULL DEFAULT (CAST((julianday('now') - 2440587.5) * 86400000 AS INTEGER)),
+    parent_id INTEGER,
+    sort_key TEXT,
+    due_at INTEGER,
+    rule_id INTEGER,
+    occurrence_at INTEGER,
+    uuid TEXT
 );
 
 CREATE TABLE IF NOT EXISTS eventLogs (
     id INTEGER PRIMARY KEY AUTOINCREMENT,
     event_type VARCHAR(50) NOT NULL,
     event_description TEXT NOT NULL,
-    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+    created_at INTEGER NOT NULL DEFAULT (CAST((julianday('now') - 2440587.5) * 86400000 AS INTEGER))
 );
+
+CREATE TABLE IF NOT EXISTS RecurrenceRules (
+    rule_id INTEGER PRIMARY KEY AUTOINCREMENT,
+    note_id INTEGER NOT NULL,
+    content TEXT NOT NULL,
+    start_at INTEGER NOT NULL,
+    frequency VARCHAR(16) NOT NULL,
+    interval INTEGER NOT NULL DEFAULT 1,
+    weekdays INTEGER NOT NULL DEFAULT 0,
+    until_at INTEGER,
+    created_at INTEGER NOT NULL DEFAULT (CAST((julianday('now') - 2440587.5) * 86400000 AS INTEGER))
+);
+
+CREATE INDEX IF NOT EXISTS idx_notes_created_at ON Notes (created_at);
+
+CREATE INDEX IF NOT EXISTS idx_notescontents_note_created ON NotesContents (note_id, created_at);
+
+CREATE INDEX IF NOT EXISTS idx_eventlogs_created_at ON eventLogs (created_at);
+
+CREATE INDEX IF NOT EXISTS idx_recurrencerules_note ON RecurrenceRules (note_id);
+
+CREATE TABLE IF NOT EXISTS Tags (
+    tag_id INTEGER PRIMARY KEY AUTOINCREMENT,
+    name VARCHAR(64) NOT NULL UNIQUE
+);
+
+CREATE TABLE IF NOT EXISTS TaskTags (
+    content_id INTEGER NOT NULL,
+    tag_id INTEGER NOT NULL,
+    PRIMARY KEY (content_id, tag_id)
+);
+
+CREATE TABLE IF NOT EXISTS NoteTags (
+    note_id INTEGER NOT NULL,
+    tag_id INTEGER NOT NULL,
+    PRIMARY KEY (note_id, tag_id)
+);
+
+CREATE INDEX IF NOT EXISTS idx_tasktags_tag ON TaskTags (tag_id, content_id);
+
+CREATE INDEX IF NOT EXISTS idx_notetags_tag ON NoteTags (tag_id, note_id);
+
+CREATE TABLE IF NOT EXISTS EventRollups (
+    day TEXT NOT NULL,
+    note_name TEXT NOT NULL,
+    event_type VARCHAR(64) NOT NULL,
+    count INTEGER NOT NULL DEFAULT 0,
+    PRIMARY KEY (day, note_name, event_type)
+) WITHOUT ROWID;
+
+CREATE TABLE IF NOT EXISTS SyncMeta (
+    key TEXT PRIMARY KEY,
+    value
+) WITHOUT ROWID;
+
+CREATE TABLE IF NOT EXISTS SyncPeers (
+    site_id TEXT PRIMARY KEY,
+    last_seq INTEGER NOT NULL DEFAULT 0,
+    acked_seq INTEGER NOT NULL DEFAULT 0
+) WITHOUT ROWID;
+
+CREATE TABLE IF NOT EXISTS ChangeLog (
+    seq INTEGER PRIMARY KEY AUTOINCREMENT,
+    site_id TEXT NOT NULL,
+    clock INTEGER NOT NULL,
+    table_name VARCHAR(32) NOT NULL,
+    row_uuid TEXT NOT NULL,
+    deleted INTEGER NOT NULL DEFAULT 0,
+    title TEXT,
+    content TEXT,
+    completed INTEGER,
+    created_at INTEGER,
+    sort_key TEXT,
+    due_at INTEGER,
+    note_uuid TEXT,
+    parent_uuid TEXT
+);
+
+CREATE INDEX IF NOT EXISTS idx_changelog_row ON ChangeLog (row_uuid, clock, site_id);
+
+CREATE TABLE IF NOT EXISTS Blobs (
+    hash TEXT PRIMARY KEY,
+    size INTEGER NOT NULL,
+    ref_count INTEGER NOT NULL DEFAULT 0
+) WITHOUT ROWID;
+
+CREATE INDEX IF NOT EXISTS idx_blobs_unreferenced ON Blobs (hash) WHERE ref_count <= 0;
+
+CREATE TABLE IF NOT EXISTS Attachments (
+    id INTEGER PRIMARY KEY AUTOINCREMENT,
+    content_id INTEGER NOT NULL,
+    hash TEXT NOT NULL,
+    name TEXT NOT NULL,
+    created_at INTEGER NOT NULL DEFAULT (CAST((julianday('now') - 2440587.5) * 86400000 AS INTEGER))
+);
+
+CREATE INDEX IF NOT EXISTS idx_attachments_content ON Attachments (content_id);
+
+CREATE TABLE IF NOT EXISTS ContentRevisions (
+    content_id INTEGER NOT NULL,
+    revision INTEGER NOT NULL,
+    snapshot INTEGER NOT NULL DEFAULT 0,
+    data BLOB NOT NULL,
+    checksum INTEGER NOT NULL,
+    created_at INTEGER NOT NULL DEFAULT (CAST((julianday('now') - 2440587.5) * 86400000 AS INTEGER)),
+    PRIMARY KEY (content_id, revision)
+) WITHOUT ROWID;
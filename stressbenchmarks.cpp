@@ -0,0 +1,306 @@
+#include "benchmarks.h"
+#include "dbmanager.h"
+#include "todolistmodel.h"
+#include "workspaceregistry.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QProcess>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <QUuid>
+#include <algorithm>
+
+/**
+ * @brief Writes continuously while an online backup runs and checks the snapshot.
+ *
+ * Creates a note with @p taskCount tasks in the current workspace, starts
+ * DBManager::startBackup() next to it and adds one task per event loop pass,
+ * each in its own transaction, until the backup has finished. The snapshot
+ * is then opened read-only and must pass "PRAGMA integrity_check" and hold
+ * a consistent point in time: all seeded tasks and some prefix of the tasks
+ * added during the backup. Prints the writes made during the backup, the
+ * slowest of them, the largest size the WAL reached, its size once a write
+ * has followed the backup, and the result of both checks.
+ *
+ * @param taskCount Number of tasks in the note before the backup starts.
+ * @return 0 if the backup succeeded, no write failed and the snapshot passed
+ *         both checks, 1 otherwise.
+ */
+int Benchmarks::runBackupStress(int taskCount) {
+  QTextStream out(stdout);
+  DBManager *db = DBManager::instance();
+  const int noteId = db->addNote("Backup stress");
+  db->beginTransaction();
+  for (int i = 0; i < taskCount; ++i)
+    db->addNoteContent(noteId, QStringLiteral("seed %1").arg(i));
+  db->commitTransaction();
+
+  const QString snapshotPath = db->databasePath() + ".snapshot";
+  bool backupOk = false;
+  QString backupMessage;
+  int written = 0;
+  int pending = 0;
+  int failed = 0;
+  qint64 slowestNs = 0;
+  qint64 peakWalBytes = 0;
+  const QString walPath = db->databasePath() + "-wal";
+  QEventLoop loop;
+  QTimer writeTimer;
+  writeTimer.setInterval(0);
+  QObject::connect(&writeTimer, &QTimer::timeout, &loop, [&]() {
+    QElapsedTimer write;
+    write.start();
+    addTaskAlone(db, noteId, QStringLiteral("during %1").arg(written), pending,
+                 failed);
+    slowestNs = qMax(slowestNs, write.nsecsElapsed());
+    peakWalBytes = qMax(peakWalBytes, QFileInfo(walPath).size());
+    ++written;
+  });
+  QObject::connect(
+      db, &DBManager::backupFinished, &loop,
+      [&](const QString &, bool ok, const QString &message) {
+        backupOk = ok;
+        backupMessage = message;
+        writeTimer.stop();
+        loop.quit();
+      });
+  QElapsedTimer timer;
+  timer.start();
+  if (!db->startBackup(snapshotPath)) {
+    qDebug() << "Cannot start the backup:" << snapshotPath;
+    return 1;
+  }
+  writeTimer.start();
+  loop.exec();
+  const qint64 backupMs = timer.elapsed();
+  waitForWrites(pending);
+  // The write after the checkpoint restarts the WAL at its size limit.
+  addTaskAlone(db, noteId, QStringLiteral("after"), pending, failed);
+  waitForWrites(pending);
+  const qint64 walAfterBytes = QFileInfo(walPath).size();
+
+  const QString connectionName =
+      QStringLiteral("backup-stress-") + QUuid::createUuid().toString();
+  QString integrity;
+  int seeded = -1;
+  int during = -1;
+  int lastDuring = -1;
+  {
+    QSqlDatabase snapshot =
+        QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    snapshot.setConnectOptions("QSQLITE_OPEN_READONLY");
+    snapshot.setDatabaseName(snapshotPath);
+    if (backupOk && snapshot.open()) {
+      QSqlQuery query(snapshot);
+      if (query.exec("PRAGMA integrity_check") && query.next())
+        integrity = query.value(0).toString();
+      query.prepare("SELECT SUM(content LIKE 'seed %'), "
+                    "SUM(content LIKE 'during %'), "
+                    "MAX(CASE WHEN content LIKE 'during %' THEN "
+                    "CAST(SUBSTR(content, 8) AS INTEGER) END) "
+                    "FROM NotesContents WHERE note_id = :note_id");
+      query.bindValue(":note_id", noteId);
+      if (query.exec() && query.next()) {
+        seeded = query.value(0).toInt();
+        during = query.value(1).toInt();
+        lastDuring = query.value(2).isNull() ? -1 : query.value(2).toInt();
+      }
+      snapshot.close();
+    }
+  }
+  QSqlDatabase::removeDatabase(connectionName);
+  // The snapshot is one read transaction: it holds the writes committed
+  // before it started, which are the first ones.
+  const bool consistent = seeded == taskCount && during == lastDuring + 1 &&
+                          during <= written;
+
+  out << "Backup of " << taskCount << " tasks took " << backupMs << " ms: "
+      << (backupOk ? QStringLiteral("ok") : backupMessage) << "\n";
+  out << "Writes during the backup: " << written << " (" << failed
+      << " failed), slowest " << slowestNs / 1000 << " us\n";
+  out << "WAL size: " << peakWalBytes / 1024 << " KiB at most, "
+      << walAfterBytes / 1024 << " KiB after the backup\n";
+  out << "Snapshot integrity_check: "
+      << (integrity.isEmpty() ? QStringLiteral("not run") : integrity)
+      << "; " << seeded << " seeded and " << during
+      << " later tasks, consistent: " << (consistent ? "yes" : "no") << "\n";
+  out.flush();
+  return backupOk && failed == 0 && integrity == QLatin1String("ok") &&
+                 consistent
+             ? 0
+             : 1;
+}
+
+/**
+ * @brief Checks that two processes writing to one database lose no writes and prints how soon each sees the other's.
+ *
+ * Starts a copy of the application as a second process (see
+ * runStressWriter()) that adds @p taskCount tasks to a new note of the
+ * current workspace, one transaction each, while this process adds as many
+ * to the same note and shows it in @p todoModel. Every time the model has
+ * refreshed after a change of the other process, the tasks of the other
+ * process that became visible are timed from their commit (their text holds
+ * the commit time). Finally all tasks of both processes are checked to be
+ * stored exactly once and listed by the model.
+ *
+ * @param todoModel The model showing the note.
+ * @param taskCount Number of tasks each process adds.
+ * @return 0 if no write failed, was lost or was stored twice, 1 otherwise.
+ */
+int Benchmarks::runMultiProcessStress(ToDoListModel &todoModel, int taskCount) {
+  constexpr int settleTimeoutMs = 10000;
+  QTextStream out(stdout);
+  DBManager *db = DBManager::instance();
+  const int noteId = db->addNote("Stress test");
+  todoModel.setNoteID(noteId);
+
+  QVector<qint64> latencies;
+  int scannedRows = 0;
+  // Connected after the model, so the model has refreshed when this runs.
+  QObject::connect(
+      &WorkspaceRegistry::instance(), &WorkspaceRegistry::changed, &todoModel,
+      [&](const DBChangeEvent &event) {
+        if (event.table != DBChangeEvent::NotesContents ||
+            event.operation != DBChangeEvent::Reloaded)
+          return;
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        for (; scannedRows < todoModel.rowCount(); ++scannedRows) {
+          const QStringList parts =
+              todoModel
+                  .data(todoModel.index(scannedRows),
+                        ToDoListModel::ItemNameRole)
+                  .toString()
+                  .split(' ');
+          if (parts.value(0) == QLatin1String("other"))
+            latencies.append(now - parts.value(2).toLongLong());
+        }
+      });
+
+  QProcess writer;
+  writer.setProcessChannelMode(QProcess::ForwardedChannels);
+  writer.start(QCoreApplication::applicationFilePath(),
+               {"--replay-target", db->databasePath(), "--stress-writer",
+                QString::number(taskCount)});
+  if (!writer.waitForStarted()) {
+    qDebug() << "Cannot start the writer process:" << writer.errorString();
+    return 1;
+  }
+
+  int written = 0;
+  int pending = 0;
+  int failed = 0;
+  QEventLoop loop;
+  QTimer writeTimer;
+  writeTimer.setInterval(1);
+  QObject::connect(&writeTimer, &QTimer::timeout, &loop, [&]() {
+    if (written == taskCount) {
+      writeTimer.stop();
+      if (writer.state() == QProcess::NotRunning)
+        loop.quit();
+      return;
+    }
+    addTaskAlone(db, noteId, QStringLiteral("own %1").arg(written), pending,
+                 failed);
+    ++written;
+  });
+  QObject::connect(
+      &writer, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+      &loop, [&]() {
+        if (written == taskCount)
+          loop.quit();
+      });
+  QElapsedTimer timer;
+  timer.start();
+  writeTimer.start();
+  loop.exec();
+  waitForWrites(pending);
+  const qint64 writeMs = timer.elapsed();
+  // Let the last changes of the other process arrive.
+  QTimer settle;
+  settle.setInterval(10);
+  QObject::connect(&settle, &QTimer::timeout, &loop, [&]() {
+    if (todoModel.rowCount() >= 2 * taskCount ||
+        timer.elapsed() - writeMs > settleTimeoutMs)
+      loop.quit();
+  });
+  settle.start();
+  loop.exec();
+
+  QSet<QString> stored;
+  int storedRows = 0;
+  for (const QVariantMap &task : db->getNoteContents(noteId)) {
+    stored.insert(task["content"].toString().section(' ', 0, 1));
+    ++storedRows;
+  }
+  int missing = 0;
+  for (int i = 0; i < taskCount; ++i)
+    for (const char *origin : {"own", "other"})
+      if (!stored.contains(QStringLiteral("%1 %2").arg(origin).arg(i)))
+        ++missing;
+  const int otherFailed =
+      writer.exitStatus() == QProcess::NormalExit ? writer.exitCode() : -1;
+
+  out << "Two processes added " << taskCount << " tasks each in " << writeMs
+      << " ms\n";
+  out << "Failed writes: " << failed << " here, "
+      << (otherFailed < 0 ? QStringLiteral("crashed")
+                          : QString::number(otherFailed))
+      << " in the other process\n";
+  const int duplicated = storedRows - stored.size();
+  out << "Stored " << storedRows << " tasks, " << missing << " missing, "
+      << duplicated << " duplicated; the model lists "
+      << todoModel.rowCount() << "\n";
+  if (!latencies.isEmpty()) {
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+      return latencies.at(
+          qMin(latencies.size() - 1, int(p * latencies.size())));
+    };
+    out << "Refresh latency over " << latencies.size()
+        << " tasks of the other process: p50 " << percentile(0.50)
+        << " ms, p99 " << percentile(0.99) << " ms, max " << latencies.last()
+        << " ms\n";
+  }
+  out.flush();
+  return failed == 0 && otherFailed == 0 && missing == 0 && duplicated == 0 &&
+                 todoModel.rowCount() == storedRows
+             ? 0
+             : 1;
+}
+
+/**
+ * @brief The second process of runMultiProcessStress(): adds tasks to the first note of the current workspace.
+ *
+ * Each task is added in its own transaction, and its text holds its index
+ * and the time just before the commit, so the other process can time how
+ * soon it shows it.
+ *
+ * @param taskCount Number of tasks to add.
+ * @return The number of writes that failed.
+ */
+int Benchmarks::runStressWriter(int taskCount) {
+  DBManager *db = DBManager::instance();
+  const QList<QVariantMap> notes = db->getAllNotes();
+  if (notes.isEmpty())
+    return taskCount;
+  const int noteId = notes.first()["note_id"].toInt();
+  int pending = 0;
+  int failed = 0;
+  for (int i = 0; i < taskCount; ++i) {
+    addTaskAlone(db, noteId,
+                 QStringLiteral("other %1 %2")
+                     .arg(i)
+                     .arg(QDateTime::currentMSecsSinceEpoch()),
+                 pending, failed);
+    QThread::msleep(1);
+  }
+  waitForWrites(pending);
+  return failed;
+}
@@ -0,0 +1,38 @@
+#include "stringpool.h"
+
+/**
+ * @brief Returns the ID of @p value, adding it to the pool if it is not known yet.
+ *
+ * @param value The string to intern.
+ * @return The ID of the string.
+ */
+quint32 StringPool::intern(const QString &value) {
+  auto it = m_ids.constFind(value);
+  if (it != m_ids.constEnd())
+    return it.value();
+  quint32 id = quint32(m_strings.size());
+  m_strings.append(value);
+  m_ids.insert(m_strings.last(), id);
+  return id;
+}
+
+/**
+ * @brief Returns the string with the given ID.
+ *
+ * @param id An ID returned by intern().
+ * @return Reference to the interned string, valid until the pool is cleared.
+ */
+const QString &StringPool::at(quint32 id) const { return m_strings.at(int(id)); }
+
+/**
+ * @brief Removes all strings. Existing IDs become invalid.
+ */
+void StringPool::clear() {
+  m_ids.clear();
+  m_strings.clear();
+}
+
+/**
+ * @brief Returns the number of distinct strings in the pool.
+ */
+int StringPool::size() const { return m_strings.size(); }
@@ -0,0 +1,36 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/**
+ * @class StringPool
+ * @brief Interning table mapping frequently repeated strings to small integer IDs.
+ *
+ * Rows of the in-memory models store a quint32 ID instead of a QString for values that repeat
+ * across many rows (note names, event types), so each distinct value is allocated once no matter
+ * how many rows refer to it. Each model owns its pools and clears them when it reloads, which
+ * drops the values no row refers to any more (renamed notes, removed rows); IDs are stable until
+ * then.
+ *
+ * Usage:
+ *   quint32 id = m_noteNames.intern(title);
+ *   const QString &title = m_noteNames.at(id);
+ *
+ * @note A pool is not thread-safe; it is used from the thread of its model.
+ */
+class StringPool {
+public:
+  quint32 intern(const QString &value);
+  const QString &at(quint32 id) const;
+  void clear();
+  int size() const;
+
+private:
+  QHash<QString, quint32> m_ids;
+  QVector<QString> m_strings;
+};
+
+#endif // STRINGPOOL_H
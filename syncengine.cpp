@@ -0,0 +1,184 @@
+#include "syncengine.h"
+#include "dbmanager.h"
+#include "workspaceregistry.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+
+SyncEngine::SyncEngine(QObject *parent) : QObject(parent) {}
+
+/**
+ * @brief Syncs the current workspace with a database file.
+ *
+ * If the file is open as a workspace, its DBManager is used so that its
+ * models reload too; otherwise the file is opened (and created or migrated)
+ * for the duration of the sync. Emits synced() on success. If another
+ * process holds the write lock of either database, the sync is retried every
+ * syncRetryDelayMs, up to maxSyncRetries times, instead of failing.
+ *
+ * @param peerPath Path of the other database file.
+ * @return true if both directions were synced or a retry is scheduled, false otherwise.
+ */
+bool SyncEngine::syncWith(const QString &peerPath) {
+  return trySync(peerPath, 0);
+}
+
+/**
+ * @brief Runs attempt @p attempt of syncWith() and schedules the next one if a database was busy.
+ */
+bool SyncEngine::trySync(const QString &peerPath, int attempt) {
+  WorkspaceRegistry &workspaces = WorkspaceRegistry::instance();
+  DBManager *local = workspaces.current();
+  DBManager *peer = nullptr;
+  for (const QString &name : workspaces.workspaceNames())
+    if (workspaces.workspace(name)->databasePath() == peerPath)
+      peer = workspaces.workspace(name);
+  if (!local || peer == local)
+    return false;
+  bool busy = false;
+  if (peer) {
+    if (syncAndNotify(*local, *peer))
+      return true;
+    busy = local->writeLockBusy() || peer->writeLockBusy();
+  } else {
+    DBManager opened(peerPath);
+    if (opened.databasePath().isEmpty())
+      return false;
+    if (syncAndNotify(*local, opened))
+      return true;
+    busy = local->writeLockBusy() || opened.writeLockBusy();
+  }
+  if (!busy || attempt >= maxSyncRetries)
+    return false;
+  QTimer::singleShot(syncRetryDelayMs, this, [this, peerPath, attempt]() {
+    if (!trySync(peerPath, attempt + 1))
+      qDebug() << "Sync failed:" << peerPath;
+  });
+  return true;
+}
+
+/**
+ * @brief Syncs two databases and emits synced() on success.
+ */
+bool SyncEngine::syncAndNotify(DBManager &local, DBManager &peer) {
+  int pulled = 0;
+  int pushed = 0;
+  if (!sync(local, peer, &pulled, &pushed))
+    return false;
+  emit synced(pulled, pushed);
+  return true;
+}
+
+/**
+ * @brief Pulls the changes of @p peer into @p local, then those of @p local into @p peer.
+ *
+ * After both pulls the two databases hold the same notes and tasks.
+ *
+ * @param local The first database.
+ * @param peer The second database.
+ * @param pulled Receives the number of changes applied to @p local, if not null.
+ * @param pushed Receives the number of changes applied to @p peer, if not null.
+ * @return true if both pulls succeeded, false otherwise.
+ */
+bool SyncEngine::sync(DBManager &local, DBManager &peer, int *pulled,
+                      int *pushed) {
+  const int in = local.pullChanges(peer.databasePath());
+  if (in < 0)
+    return false;
+  const int out = peer.pullChanges(local.databasePath());
+  if (out < 0)
+    return false;
+  if (pulled)
+    *pulled = in;
+  if (pushed)
+    *pushed = out;
+  return true;
+}
+
+/**
+ * @brief Measures a delta sync between two large databases and prints the result to stdout.
+ *
+ * Creates a database with one note of @p rowCount tasks in a temporary
+ * directory and syncs it into a second, empty one (the full initial sync).
+ * Then both databases make @p changeCount changes, one of which edits the
+ * same task on both sides, and are synced again. Reports both sync times,
+ * the number of changes exchanged and whether the databases converged.
+ * Finally copies the first database file and checks that the copy draws a
+ * site ID of its own.
+ *
+ * @param rowCount Number of tasks in the first database.
+ * @param changeCount Number of changes made on each side before the delta sync.
+ * @return 0 if both syncs succeeded and the databases converged, 1 otherwise.
+ */
+int SyncEngine::runBenchmark(int rowCount, int changeCount) {
+  constexpr int batchSize = 10000;
+  QTextStream out(stdout);
+  QTemporaryDir directory;
+  if (!directory.isValid())
+    return 1;
+  DBManager first(directory.filePath("first.db"));
+  DBManager second(directory.filePath("second.db"));
+  const int noteId = first.addNote("Sync benchmark");
+  QVector<int> ids;
+  ids.reserve(rowCount);
+  for (int i = 0; i < rowCount; i += batchSize) {
+    first.beginTransaction();
+    for (int j = i; j < qMin(rowCount, i + batchSize); ++j)
+      ids.append(first.addNoteContent(noteId, QStringLiteral("Task %1").arg(j)));
+    first.commitTransaction();
+  }
+  if (ids.isEmpty())
+    return 1;
+
+  QElapsedTimer timer;
+  int pulled = 0;
+  int pushed = 0;
+  timer.start();
+  const bool initial = sync(second, first, &pulled, &pushed);
+  out << "Initial sync of " << rowCount << " tasks: " << timer.elapsed()
+      << " ms, " << pulled << " changes pulled\n";
+  if (!initial)
+    return 1;
+
+  // Both sides edit the first task; the other changes are disjoint.
+  const int secondNoteId = second.getAllNotes().value(0)["note_id"].toInt();
+  const int shared =
+      second.getNoteContents(secondNoteId).value(0)["id"].toInt();
+  first.updateNoteContent(ids.first(), true);
+  second.updateNoteContent(shared, true);
+  second.updateNoteContent(shared, false);
+  for (int i = 1; i < changeCount; ++i) {
+    first.updateNoteContent(ids.at(i * (ids.size() / changeCount)), true);
+    second.addNoteContent(secondNoteId, QStringLiteral("Added %1").arg(i));
+  }
+  timer.start();
+  const bool delta = sync(first, second, &pulled, &pushed);
+  out << "Delta sync: " << timer.elapsed() << " ms, " << pulled
+      << " changes pulled, " << pushed << " pushed\n";
+  if (!delta)
+    return 1;
+
+  const QList<QVariantMap> left = first.getNoteContents(noteId);
+  const QList<QVariantMap> right = second.getNoteContents(secondNoteId);
+  bool converged = left.size() == right.size();
+  for (int i = 0; converged && i < left.size(); ++i)
+    converged = left.at(i)["content"] == right.at(i)["content"] &&
+                left.at(i)["completed"] == right.at(i)["completed"];
+  out << "Converged: " << (converged ? "yes" : "no") << " (" << left.size()
+      << " tasks)\n";
+
+  const QString copyPath = directory.filePath("copy.db");
+  first.closeDB();
+  const bool copied = QFile::copy(directory.filePath("first.db"), copyPath);
+  DBManager original(directory.filePath("first.db"));
+  DBManager copy(copyPath);
+  const bool ownSite = copied && !copy.siteId().isEmpty() &&
+                       copy.siteId() != original.siteId();
+  out << "Copied database has its own site ID: " << (ownSite ? "yes" : "no")
+      << "\n";
+  out.flush();
+  return converged && ownSite ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+#ifndef SYNCENGINE_H
+#define SYNCENGINE_H
+
+#include <QObject>
+
+class DBManager;
+
+/**
+ * @class SyncEngine
+ * @brief Merges two database files by exchanging the changes each made since they last synced.
+ *
+ * Every write to Notes and NotesContents is recorded in the database's ChangeLog with the row's
+ * UUID, the site ID of the database and a Lamport clock (see DBManager::installChangeLog()). A
+ * sync pulls the other database's new changes into this one and then the other way round (see
+ * DBManager::pullChanges()), so its cost depends on the number of changes since the last sync,
+ * not on the size of the databases. Conflicting changes of the same row are resolved the same way
+ * on both sides: the change with the higher (clock, site ID) wins. Ordering keys are versioned
+ * apart from the other columns, so a reorder and a concurrent edit of the same task both survive.
+ *
+ * A copied database file draws a new site ID the first time it is opened at its new path (see
+ * DBManager::claimSiteId()), so it can be synced with the original. Tags, recurrence rules and the
+ * event log are not synced.
+ *
+ * Usage:
+ *   SyncEngine engine;
+ *   engine.syncWith("/media/usb/database.db");
+ */
+class SyncEngine : public QObject {
+  Q_OBJECT
+public:
+  explicit SyncEngine(QObject *parent = nullptr);
+
+  Q_INVOKABLE bool syncWith(const QString &peerPath);
+
+  static bool sync(DBManager &local, DBManager &peer, int *pulled = nullptr,
+                   int *pushed = nullptr);
+  static int runBenchmark(int rowCount, int changeCount);
+
+signals:
+  void synced(int pulled, int pushed);
+
+private:
+  static constexpr int syncRetryDelayMs = 500;
+  static constexpr int maxSyncRetries = 20;
+
+  bool trySync(const QString &peerPath, int attempt);
+  bool syncAndNotify(DBManager &local, DBManager &peer);
+};
+
+#endif // SYNCENGINE_H
@@ -0,0 +1,310 @@
+#include "tagfiltermodel.h"
+#include "dbmanager.h"
+#include "tagindex.h"
+#include "tracer.h"
+#include "workspaceregistry.h"
+#include <algorithm>
+#include <iterator>
+
+TagFilterModel::TagFilterModel(QObject *parent) : QAbstractListModel(parent) {
+  QObject::connect(&TagIndex::instance(), &TagIndex::indexChanged, this,
+                   &TagFilterModel::applyIndexChange);
+  QObject::connect(&WorkspaceRegistry::instance(), &WorkspaceRegistry::changed,
+                   this, &TagFilterModel::applyDatabaseChange);
+}
+
+/**
+ * @brief Returns the number of matching tasks loaded so far.
+ */
+int TagFilterModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid())
+    return 0;
+  return m_rows.size();
+}
+
+/**
+ * @brief Returns the data stored under the given role for the task referred to by the index.
+ *
+ * @param index The QModelIndex identifying the task.
+ * @param role The role for which the data is requested.
+ * @return QVariant containing the requested data, or an empty QVariant if the role is not supported.
+ */
+QVariant TagFilterModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= m_rows.size())
+    return QVariant();
+  const taggedTask &item = m_rows.at(index.row());
+  switch (role) {
+  case IdRole:
+    return item.id;
+  case ItemNameRole:
+    return item.content;
+  case StatusRole:
+    return item.completed;
+  case NoteIdRole:
+    return item.noteId;
+  case NoteNameRole:
+    return m_noteNames.at(item.noteName);
+  default:
+    return QVariant();
+  }
+}
+
+/**
+ * @brief Returns the role names used by QML delegates.
+ */
+QHash<int, QByteArray> TagFilterModel::roleNames() const {
+  QHash<int, QByteArray> hashMap;
+  hashMap[IdRole] = "id";
+  hashMap[ItemNameRole] = "ItemName";
+  hashMap[StatusRole] = "StatusRole";
+  hashMap[NoteIdRole] = "noteId";
+  hashMap[NoteNameRole] = "noteName";
+  return hashMap;
+}
+
+/**
+ * @brief Returns whether matching tasks remain to be loaded.
+ */
+bool TagFilterModel::canFetchMore(const QModelIndex &parent) const {
+  return !parent.isValid() && m_rows.size() < m_matches.size();
+}
+
+/**
+ * @brief Loads the next page of matching tasks from the database.
+ */
+void TagFilterModel::fetchMore(const QModelIndex &parent) {
+  if (parent.isValid())
+    return;
+  const int first = m_rows.size();
+  const int last = std::min(first + fetchBatchSize, int(m_matches.size()));
+  QVector<int> ids;
+  ids.reserve(last - first);
+  for (int i = first; i < last; ++i)
+    ids.append(int(m_matches.at(i)));
+  const QList<QVariantMap> rows =
+      DBManager::instance()->getNoteContentsByIds(ids);
+  if (rows.size() != ids.size()) {
+    // The index is ahead of the database; drop the tasks that are gone so
+    // that the loaded rows stay a prefix of the matches.
+    int kept = first;
+    int next = 0;
+    for (int i = first; i < last; ++i) {
+      if (next < rows.size() &&
+          rows.at(next)["id"].toInt() == ids.at(i - first)) {
+        m_matches[kept++] = m_matches.at(i);
+        ++next;
+      }
+    }
+    m_matches.remove(kept, last - kept);
+    emit matchCountChanged();
+  }
+  if (rows.isEmpty())
+    return;
+  beginInsertRows(QModelIndex(), first, first + rows.size() - 1);
+  for (const QVariantMap &row : rows)
+    m_rows.append(toTaggedTask(row));
+  endInsertRows();
+}
+
+/**
+ * @brief Sets the tag filter by tag names and recomputes the result.
+ *
+ * @param allOf Tags a task must all carry.
+ * @param anyOf Tags of which a task must carry at least one; ignored if empty.
+ * @param noneOf Tags a task must not carry.
+ */
+void TagFilterModel::setFilter(const QStringList &allOf,
+                               const QStringList &anyOf,
+                               const QStringList &noneOf) {
+  TRACE_SPAN(span, "qml");
+  m_allOf = allOf;
+  m_anyOf = anyOf;
+  m_noneOf = noneOf;
+  refresh();
+}
+
+/**
+ * @brief Returns the total number of matching tasks, loaded or not.
+ */
+int TagFilterModel::matchCount() const { return m_matches.size(); }
+
+/**
+ * @brief Returns the names of all tags of the current workspace.
+ */
+QStringList TagFilterModel::tagNames() const {
+  QStringList names;
+  for (const QVariantMap &tag : DBManager::instance()->getAllTags())
+    names.append(tag["name"].toString());
+  return names;
+}
+
+/**
+ * @brief Attaches a tag to a task, creating the tag if needed.
+ */
+bool TagFilterModel::tagTask(int contentId, const QString &tagName) {
+  DBManager *db = DBManager::instance();
+  return db->queueWrite([db, contentId, tagName]() {
+    const int tagId = db->addTag(tagName);
+    return tagId >= 0 && db->tagNoteContent(contentId, tagId);
+  });
+}
+
+/**
+ * @brief Removes a tag from a task.
+ */
+bool TagFilterModel::untagTask(int contentId, const QString &tagName) {
+  DBManager *db = DBManager::instance();
+  return db->queueWrite([db, contentId, tagName]() {
+    const int tagId = db->tagId(tagName);
+    return tagId >= 0 && db->untagNoteContent(contentId, tagId);
+  });
+}
+
+/**
+ * @brief Re-runs the filter against TagIndex and resets the loaded rows.
+ */
+void TagFilterModel::refresh() {
+  beginResetModel();
+  if (m_allOf.isEmpty() && m_anyOf.isEmpty() && m_noneOf.isEmpty())
+    m_matches.clear();
+  else
+    m_matches = TagIndex::instance()
+                    .query(tagIds(m_allOf), tagIds(m_anyOf), tagIds(m_noneOf))
+                    .toVector();
+  m_rows.clear();
+  m_noteNames.clear();
+  endResetModel();
+  emit matchCountChanged();
+}
+
+/**
+ * @brief Applies a change of TagIndex to the matches as row removals and insertions.
+ *
+ * The new matches are compared with the current ones (both sorted by ID).
+ * Tasks that no longer match are removed, in runs of adjacent rows; tasks
+ * that now match and fall among the loaded rows are read from the database
+ * and inserted, and those after them are left for fetchMore(). Views keep
+ * their scroll position and selection. When no match is left over, as after
+ * a switch of workspace, the model is reset instead.
+ */
+void TagFilterModel::applyIndexChange() {
+  if (m_allOf.isEmpty() && m_anyOf.isEmpty() && m_noneOf.isEmpty())
+    return;
+  const QVector<quint32> matches =
+      TagIndex::instance()
+          .query(tagIds(m_allOf), tagIds(m_anyOf), tagIds(m_noneOf))
+          .toVector();
+  QVector<quint32> removed;
+  QVector<quint32> added;
+  std::set_difference(m_matches.cbegin(), m_matches.cend(), matches.cbegin(),
+                      matches.cend(), std::back_inserter(removed));
+  std::set_difference(matches.cbegin(), matches.cend(), m_matches.cbegin(),
+                      m_matches.cend(), std::back_inserter(added));
+  if (removed.isEmpty() && added.isEmpty())
+    return;
+  if (!m_matches.isEmpty() && removed.size() == m_matches.size()) {
+    refresh();
+    return;
+  }
+  auto position = [this](quint32 id) {
+    return int(std::lower_bound(m_matches.cbegin(), m_matches.cend(), id) -
+               m_matches.cbegin());
+  };
+
+  // From the back, so that the positions of earlier runs stay valid.
+  for (int i = removed.size() - 1; i >= 0; --i) {
+    const int last = position(removed.at(i));
+    int first = last;
+    while (i > 0 && position(removed.at(i - 1)) == first - 1) {
+      --first;
+      --i;
+    }
+    const int loadedEnd = std::min(last + 1, int(m_rows.size()));
+    if (first < loadedEnd) {
+      beginRemoveRows(QModelIndex(), first, loadedEnd - 1);
+      m_rows.remove(first, loadedEnd - first);
+    }
+    m_matches.remove(first, last - first + 1);
+    if (first < loadedEnd)
+      endRemoveRows();
+  }
+
+  QVector<int> loadIds;
+  QVector<quint32> unloaded;
+  for (quint32 id : qAsConst(added)) {
+    if (position(id) < m_rows.size())
+      loadIds.append(int(id));
+    else
+      unloaded.append(id);
+  }
+  if (!loadIds.isEmpty()) {
+    // Tasks the database no longer has are skipped, as in fetchMore().
+    const QList<QVariantMap> rows =
+        DBManager::instance()->getNoteContentsByIds(loadIds);
+    QVector<QPair<int, QVector<taggedTask>>> runs;
+    for (const QVariantMap &row : rows) {
+      const int at = position(quint32(row["id"].toInt()));
+      if (runs.isEmpty() || runs.last().first != at)
+        runs.append(qMakePair(at, QVector<taggedTask>()));
+      runs.last().second.append(toTaggedTask(row));
+    }
+    for (int i = runs.size() - 1; i >= 0; --i) {
+      const int at = runs.at(i).first;
+      const QVector<taggedTask> &tasks = runs.at(i).second;
+      beginInsertRows(QModelIndex(), at, at + tasks.size() - 1);
+      for (int j = 0; j < tasks.size(); ++j) {
+        m_rows.insert(at + j, tasks.at(j));
+        m_matches.insert(at + j, quint32(tasks.at(j).id));
+      }
+      endInsertRows();
+    }
+  }
+  if (!unloaded.isEmpty()) {
+    // All of them sort after the loaded rows, which keep their positions.
+    QVector<quint32> merged;
+    merged.reserve(m_matches.size() + unloaded.size());
+    std::merge(m_matches.cbegin(), m_matches.cend(), unloaded.cbegin(),
+               unloaded.cend(), std::back_inserter(merged));
+    m_matches.swap(merged);
+  }
+  emit matchCountChanged();
+}
+
+/**
+ * @brief Updates the status of a loaded task in place.
+ *
+ * Membership changes arrive through TagIndex::indexChanged().
+ */
+void TagFilterModel::applyDatabaseChange(const DBChangeEvent &event) {
+  if (event.table != DBChangeEvent::NotesContents ||
+      event.operation != DBChangeEvent::Updated ||
+      !event.values.contains("completed"))
+    return;
+  auto it = std::lower_bound(m_matches.cbegin(), m_matches.cend(),
+                             quint32(event.rowId));
+  const int row = int(it - m_matches.cbegin());
+  if (it == m_matches.cend() || *it != quint32(event.rowId) ||
+      row >= m_rows.size())
+    return;
+  m_rows[row].completed = event.values.value("completed").toBool();
+  emit dataChanged(index(row), index(row), {StatusRole});
+}
+
+/**
+ * @brief Converts a row of DBManager::getNoteContentsByIds() to a loaded row.
+ */
+taggedTask TagFilterModel::toTaggedTask(const QVariantMap &row) {
+  return {row["id"].toInt(), row["note_id"].toInt(),
+          m_noteNames.intern(row["title"].toString()),
+          row["content"].toString(), row["completed"].toBool()};
+}
+
+/**
+ * @brief Resolves tag names to IDs; unknown names map to -1, which matches no task.
+ */
+QList<int> TagFilterModel::tagIds(const QStringList &names) {
+  QList<int> ids;
+  for (const QString &name : names)
+    ids.append(DBManager::instance()->tagId(name));
+  return ids;
+}
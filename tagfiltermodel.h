@@ -0,0 +1,95 @@
+#ifndef TAGFILTERMODEL_H
+#define TAGFILTERMODEL_H
+
+#include "dbchangeevent.h"
+#include "stringpool.h"
+#include <QAbstractListModel>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @struct taggedTask
+ * @brief One loaded row of the TagFilterModel.
+ *
+ * @var taggedTask::id
+ *   Unique identifier of the task.
+ * @var taggedTask::noteId
+ *   Note the task belongs to.
+ * @var taggedTask::noteName
+ *   Title of the note, as an ID in the model's note name pool.
+ * @var taggedTask::content
+ *   Text of the task.
+ * @var taggedTask::completed
+ *   Completion status of the task.
+ */
+struct taggedTask {
+  int id;
+  int noteId;
+  quint32 noteName;
+  QString content;
+  bool completed;
+};
+
+/**
+ * @class TagFilterModel
+ * @brief List model of the tasks, across all notes, matching a tag filter.
+ *
+ * The filter is given as three lists of tag names: tasks must carry all tags of the first, at
+ * least one of the second (if any) and none of the third. Matching IDs come from TagIndex; task
+ * rows are then read from the database in pages as views scroll (canFetchMore()/fetchMore()), so
+ * a filter matching a million tasks only loads what is shown. The result is recomputed whenever
+ * the index changes, and applied to views as row removals and insertions.
+ *
+ * @see TagIndex
+ */
+class TagFilterModel : public QAbstractListModel {
+  Q_OBJECT
+public:
+  explicit TagFilterModel(QObject *parent = nullptr);
+  enum roleEnums {
+    IdRole = Qt::UserRole + 1,
+    ItemNameRole,
+    StatusRole,
+    NoteIdRole,
+    NoteNameRole
+  };
+  Q_ENUM(roleEnums);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+  QHash<int, QByteArray> roleNames() const override;
+  bool canFetchMore(const QModelIndex &parent) const override;
+  void fetchMore(const QModelIndex &parent) override;
+
+  Q_INVOKABLE void setFilter(const QStringList &allOf,
+                             const QStringList &anyOf,
+                             const QStringList &noneOf);
+  Q_INVOKABLE int matchCount() const;
+  Q_INVOKABLE QStringList tagNames() const;
+  Q_INVOKABLE bool tagTask(int contentId, const QString &tagName);
+  Q_INVOKABLE bool untagTask(int contentId, const QString &tagName);
+
+signals:
+  void matchCountChanged();
+
+private slots:
+  void refresh();
+  void applyIndexChange();
+  void applyDatabaseChange(const DBChangeEvent &event);
+
+private:
+  static constexpr int fetchBatchSize = 100;
+
+  static QList<int> tagIds(const QStringList &names);
+  taggedTask toTaggedTask(const QVariantMap &row);
+
+  QStringList m_allOf;
+  QStringList m_anyOf;
+  QStringList m_noneOf;
+  QVector<quint32> m_matches;
+  QVector<taggedTask> m_rows;
+  StringPool m_noteNames;
+};
+
+#endif // TAGFILTERMODEL_H
@@ -0,0 +1,255 @@
+#include "tagindex.h"
+#include "dbmanager.h"
+#include "workspaceregistry.h"
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <algorithm>
+#include <set>
+#include <vector>
+
+/**
+ * @brief Returns the index of the current workspace.
+ */
+TagIndex &TagIndex::instance() {
+  static TagIndex index(true);
+  return index;
+}
+
+/**
+ * @brief Creates an empty index.
+ *
+ * @param followCurrentWorkspace If true, the index loads itself from the current workspace and
+ *        follows its change events; otherwise it only holds what is passed to load().
+ * @param parent Parent QObject.
+ */
+TagIndex::TagIndex(bool followCurrentWorkspace, QObject *parent)
+    : QObject(parent), m_followCurrentWorkspace(followCurrentWorkspace) {
+  if (!m_followCurrentWorkspace)
+    return;
+  QObject::connect(&WorkspaceRegistry::instance(),
+                   &WorkspaceRegistry::currentWorkspaceChanged, this,
+                   &TagIndex::invalidate);
+  QObject::connect(&WorkspaceRegistry::instance(), &WorkspaceRegistry::changed,
+                   this, &TagIndex::applyDatabaseChange);
+}
+
+/**
+ * @brief Replaces the contents of the index.
+ *
+ * @param taskIds IDs of all tasks.
+ * @param taskTags (task ID, tag ID) pairs.
+ */
+void TagIndex::load(const QVector<int> &taskIds,
+                    const QVector<QPair<int, int>> &taskTags) {
+  m_allTasks = CompressedBitmap();
+  m_tags.clear();
+  for (int id : taskIds)
+    m_allTasks.add(quint32(id));
+  for (const QPair<int, int> &pair : taskTags)
+    m_tags[pair.second].add(quint32(pair.first));
+  m_loaded = true;
+}
+
+/**
+ * @brief Returns the IDs of the tasks matching a tag filter.
+ *
+ * A task matches when it carries every tag of @p allOf, at least one tag of
+ * @p anyOf (if not empty) and none of @p noneOf. With no positive condition
+ * the filter starts from all tasks. Unknown tag IDs (e.g. -1) carry no tasks.
+ *
+ * @param allOf Tags the task must all carry.
+ * @param anyOf Tags of which the task must carry at least one.
+ * @param noneOf Tags the task must not carry.
+ * @return The matching task IDs.
+ */
+CompressedBitmap TagIndex::query(const QList<int> &allOf,
+                                 const QList<int> &anyOf,
+                                 const QList<int> &noneOf) {
+  ensureLoaded();
+  CompressedBitmap result;
+  if (!allOf.isEmpty()) {
+    // Intersect the smallest sets first so intermediate results stay small.
+    QList<int> ordered = allOf;
+    std::sort(ordered.begin(), ordered.end(), [this](int a, int b) {
+      return taskCount(a) < taskCount(b);
+    });
+    result = m_tags.value(ordered.first());
+    for (int i = 1; i < ordered.size() && !result.isEmpty(); ++i)
+      result &= m_tags.value(ordered.at(i));
+  }
+  if (!anyOf.isEmpty()) {
+    CompressedBitmap any;
+    for (int tagId : anyOf)
+      any |= m_tags.value(tagId);
+    if (allOf.isEmpty())
+      result = any;
+    else
+      result &= any;
+  } else if (allOf.isEmpty()) {
+    result = m_allTasks;
+  }
+  for (int tagId : noneOf) {
+    if (result.isEmpty())
+      break;
+    result -= m_tags.value(tagId);
+  }
+  return result;
+}
+
+/**
+ * @brief Returns the number of tasks carrying a tag.
+ */
+int TagIndex::taskCount(int tagId) {
+  ensureLoaded();
+  auto found = m_tags.constFind(tagId);
+  return found == m_tags.constEnd() ? 0 : found.value().cardinality();
+}
+
+/**
+ * @brief Applies a committed database change to the index.
+ *
+ * Bulk deletes (rowId -1) do not say which tasks went away, and tasks
+ * written by another process are not listed at all, so in both cases the
+ * index is simply rebuilt on next use.
+ *
+ * @param event The change published by DBManager.
+ */
+void TagIndex::applyDatabaseChange(const DBChangeEvent &event) {
+  if (!m_loaded)
+    return;
+  switch (event.table) {
+  case DBChangeEvent::NotesContents:
+    if (event.operation == DBChangeEvent::Inserted) {
+      m_allTasks.add(quint32(event.rowId));
+    } else if (event.operation == DBChangeEvent::Reloaded) {
+      invalidate();
+      return;
+    } else if (event.operation == DBChangeEvent::Deleted) {
+      if (event.rowId < 0) {
+        invalidate();
+        return;
+      }
+      m_allTasks.remove(quint32(event.rowId));
+      for (CompressedBitmap &tasks : m_tags)
+        tasks.remove(quint32(event.rowId));
+    } else {
+      return;
+    }
+    break;
+  case DBChangeEvent::TaskTags: {
+    const int tagId = event.values.value("tag_id").toInt();
+    if (event.operation == DBChangeEvent::Inserted)
+      m_tags[tagId].add(quint32(event.rowId));
+    else if (event.operation == DBChangeEvent::Deleted)
+      m_tags[tagId].remove(quint32(event.rowId));
+    break;
+  }
+  case DBChangeEvent::Tags:
+    if (event.operation != DBChangeEvent::Deleted)
+      return;
+    m_tags.remove(event.rowId);
+    break;
+  default:
+    return;
+  }
+  emit indexChanged();
+}
+
+/**
+ * @brief Drops the index so it is rebuilt from the database on next use.
+ */
+void TagIndex::invalidate() {
+  m_loaded = false;
+  m_allTasks = CompressedBitmap();
+  m_tags.clear();
+  emit indexChanged();
+}
+
+/**
+ * @brief Builds the index from the current workspace if needed.
+ */
+void TagIndex::ensureLoaded() {
+  if (m_loaded || !m_followCurrentWorkspace)
+    return;
+  DBManager *db = DBManager::instance();
+  load(db->getAllNoteContentIds(), db->getAllTaskTags());
+}
+
+/**
+ * @brief Times multi-tag queries over a synthetic index and prints the results to stdout.
+ *
+ * Builds an index of @p taskCount tasks and 32 tags with skewed popularity
+ * (tag k is carried by about one task in k + 2) from a fixed seed, then runs
+ * a few AND/OR/NOT filters repeatedly and prints the average time per query
+ * and the number of matching tasks. Each result is checked against the same
+ * filter evaluated over plain std::set tag memberships.
+ *
+ * @param taskCount Number of synthetic tasks.
+ * @return 0 if every result matched the std::set one, 1 otherwise.
+ */
+int TagIndex::runBenchmark(int taskCount) {
+  constexpr int tagCount = 32;
+  constexpr int iterations = 100;
+  QTextStream out(stdout);
+  QRandomGenerator random(42);
+
+  QVector<int> taskIds;
+  QVector<QPair<int, int>> taskTags;
+  std::vector<std::set<int>> tagged(tagCount);
+  taskIds.reserve(taskCount);
+  for (int id = 1; id <= taskCount; ++id) {
+    taskIds.append(id);
+    for (int tag = 0; tag < tagCount; ++tag)
+      if (random.bounded(tag + 2) == 0) {
+        taskTags.append({id, tag});
+        tagged[tag].insert(id);
+      }
+  }
+  TagIndex index(false);
+  QElapsedTimer timer;
+  timer.start();
+  index.load(taskIds, taskTags);
+  out << "Indexed " << taskCount << " tasks and " << taskTags.size()
+      << " tags in " << timer.elapsed() << " ms\n";
+
+  struct benchmarkQuery {
+    const char *name;
+    QList<int> allOf, anyOf, noneOf;
+  };
+  const QList<benchmarkQuery> queries = {
+      {"0 AND 1", {0, 1}, {}, {}},
+      {"2 AND 8 AND 30", {2, 8, 30}, {}, {}},
+      {"10 OR 20 OR 30", {}, {10, 20, 30}, {}},
+      {"0 AND (5 OR 6) AND NOT 1", {0}, {5, 6}, {1}},
+      {"NOT 0", {}, {}, {0}}};
+  auto carries = [&tagged](int id, const QList<int> &tags, bool all) {
+    for (int tag : tags)
+      if ((tagged[tag].count(id) != 0) != all)
+        return !all;
+    return all;
+  };
+  int mismatches = 0;
+  for (const benchmarkQuery &q : queries) {
+    int matches = 0;
+    timer.restart();
+    for (int i = 0; i < iterations; ++i)
+      matches = index.query(q.allOf, q.anyOf, q.noneOf).cardinality();
+    const double micros = timer.nsecsElapsed() / 1000.0 / iterations;
+    QVector<quint32> expected;
+    for (int id : qAsConst(taskIds))
+      if (carries(id, q.allOf, true) &&
+          (q.anyOf.isEmpty() || carries(id, q.anyOf, false)) &&
+          !carries(id, q.noneOf, false))
+        expected.append(quint32(id));
+    const bool same =
+        index.query(q.allOf, q.anyOf, q.noneOf).toVector() == expected;
+    if (!same)
+      ++mismatches;
+    out << QString(q.name).leftJustified(28) << QString::number(micros, 'f', 1)
+        << " us/query, " << matches << " matches"
+        << (same ? "" : ", MISMATCH with std::set") << "\n";
+  }
+  out.flush();
+  return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+#ifndef TAGINDEX_H
+#define TAGINDEX_H
+
+#include "compressedbitmap.h"
+#include "dbchangeevent.h"
+#include <QHash>
+#include <QObject>
+
+/**
+ * @class TagIndex
+ * @brief In-memory index of task IDs per tag, answering multi-tag filters with bitmap set operations.
+ *
+ * Every tag maps to a CompressedBitmap of the IDs of the tasks carrying it, and one more bitmap
+ * holds all task IDs (the universe for filters that only exclude tags). A filter such as
+ * "urgent AND ops AND NOT q3" is then an intersection and a difference of bitmaps, independent of
+ * how tasks are spread over notes.
+ *
+ * The shared index follows the current workspace: it is built from the database on first use and
+ * kept up to date from DBManager change events (task inserts and deletes, tag attach/detach, tag
+ * deletion). indexChanged() is emitted after each applied change.
+ *
+ * Usage:
+ *   CompressedBitmap ids = TagIndex::instance().query({urgentId}, {}, {q3Id});
+ */
+class TagIndex : public QObject {
+  Q_OBJECT
+public:
+  static TagIndex &instance(); // Index of the current workspace
+
+  explicit TagIndex(bool followCurrentWorkspace, QObject *parent = nullptr);
+
+  void load(const QVector<int> &taskIds,
+            const QVector<QPair<int, int>> &taskTags);
+  CompressedBitmap query(const QList<int> &allOf, const QList<int> &anyOf,
+                         const QList<int> &noneOf);
+  int taskCount(int tagId);
+
+  static int runBenchmark(int taskCount);
+
+signals:
+  void indexChanged();
+
+private slots:
+  void applyDatabaseChange(const DBChangeEvent &event);
+  void invalidate();
+
+private:
+  void ensureLoaded();
+
+  bool m_followCurrentWorkspace;
+  bool m_loaded = false;
+  CompressedBitmap m_allTasks;
+  QHash<int, CompressedBitmap> m_tags;
+};
+
+#endif // TAGINDEX_H
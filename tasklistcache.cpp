@@ -0,0 +1,142 @@
+#include "tasklistcache.h"
+#include "workspaceregistry.h"
+
+/**
+ * @brief Returns the approximate memory used by the list, in bytes.
+ */
+int cachedTaskList::byteSize() const {
+  return int(sizeof(cachedTaskList)) + rows.size() * int(sizeof(listElement)) +
+         texts.size() * int(sizeof(QChar));
+}
+
+TaskListCache::TaskListCache(int budgetBytes, QObject *parent)
+    : QObject(parent), m_budget(budgetBytes), m_bytes(0) {
+  QObject::connect(&WorkspaceRegistry::instance(),
+                   &WorkspaceRegistry::currentWorkspaceChanged, this,
+                   &TaskListCache::clear);
+  QObject::connect(&WorkspaceRegistry::instance(), &WorkspaceRegistry::changed,
+                   this, &TaskListCache::applyDatabaseChange);
+}
+
+/**
+ * @brief Stores the list of a note as the most recently used one.
+ *
+ * Older lists are evicted until the cache fits its budget again. A list
+ * larger than the whole budget is not stored.
+ *
+ * @param noteId The note.
+ * @param list Its rows, with an arena holding only their text.
+ * @return true if the list was stored, false otherwise.
+ */
+bool TaskListCache::insert(int noteId, cachedTaskList list) {
+  remove(noteId);
+  const int size = list.byteSize();
+  if (size > m_budget)
+    return false;
+  while (m_bytes + size > m_budget && !m_recency.isEmpty())
+    remove(m_recency.first());
+  m_lists.insert(noteId, std::move(list));
+  m_sizes.insert(noteId, size);
+  m_recency.append(noteId);
+  m_bytes += size;
+  return true;
+}
+
+/**
+ * @brief Moves the cached list of a note out of the cache.
+ *
+ * The list leaves the cache while the note is shown, since the model keeps
+ * it current itself; it is put back when the model moves on.
+ *
+ * @param noteId The note.
+ * @param list Receives the list.
+ * @return true if the note was cached, false otherwise.
+ */
+bool TaskListCache::take(int noteId, cachedTaskList &list) {
+  auto it = m_lists.find(noteId);
+  if (it == m_lists.end())
+    return false;
+  list = std::move(it.value());
+  remove(noteId);
+  return true;
+}
+
+/**
+ * @brief Returns whether the list of a note is cached.
+ */
+bool TaskListCache::contains(int noteId) const {
+  return m_lists.contains(noteId);
+}
+
+/**
+ * @brief Returns whether @p bytes more fit in the budget without evicting anything.
+ */
+bool TaskListCache::fits(int bytes) const { return m_bytes + bytes <= m_budget; }
+
+/**
+ * @brief Drops the cached list of a note, if any.
+ */
+void TaskListCache::remove(int noteId) {
+  if (!m_lists.remove(noteId))
+    return;
+  m_bytes -= m_sizes.take(noteId);
+  m_recency.removeOne(noteId);
+}
+
+/**
+ * @brief Drops every cached list.
+ */
+void TaskListCache::clear() {
+  m_lists.clear();
+  m_sizes.clear();
+  m_recency.clear();
+  m_bytes = 0;
+}
+
+/**
+ * @brief Returns the number of cached lists.
+ */
+int TaskListCache::count() const { return m_lists.size(); }
+
+/**
+ * @brief Returns the approximate memory used by the cached lists, in bytes.
+ */
+int TaskListCache::bytes() const { return m_bytes; }
+
+/**
+ * @brief Drops the cached lists a committed write makes stale.
+ *
+ * @param event The change published by DBManager.
+ */
+void TaskListCache::applyDatabaseChange(const DBChangeEvent &event) {
+  if (m_lists.isEmpty())
+    return;
+  switch (event.table) {
+  case DBChangeEvent::Notes:
+    if (event.operation == DBChangeEvent::Deleted)
+      remove(event.rowId);
+    break;
+  case DBChangeEvent::NotesContents:
+  case DBChangeEvent::RecurrenceRules:
+    if (event.noteId >= 0)
+      remove(event.noteId);
+    else if (event.rowId >= 0)
+      remove(noteContaining(event.rowId));
+    else
+      clear();
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief Returns the cached note that lists the task @p contentId, or -1.
+ */
+int TaskListCache::noteContaining(int contentId) const {
+  for (auto it = m_lists.cbegin(); it != m_lists.cend(); ++it)
+    for (const listElement &row : it->rows)
+      if (row.id == contentId)
+        return it.key();
+  return -1;
+}
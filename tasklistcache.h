@@ -0,0 +1,71 @@
+#ifndef TASKLISTCACHE_H
+#define TASKLISTCACHE_H
+
+#include "dbchangeevent.h"
+#include "todolistmodel.h"
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+/**
+ * @struct cachedTaskList
+ * @brief The rows of one note as ToDoListModel shows them.
+ *
+ * @var cachedTaskList::rows
+ *   Ordinary tasks followed by the occurrences of recurring tasks.
+ * @var cachedTaskList::texts
+ *   Arena holding the text of the rows, and nothing else.
+ * @var cachedTaskList::taskCount
+ *   Number of ordinary tasks at the start of rows.
+ */
+struct cachedTaskList {
+  QVector<listElement> rows;
+  TextArena texts;
+  int taskCount = 0;
+
+  int byteSize() const;
+};
+
+/**
+ * @class TaskListCache
+ * @brief Memory-budgeted LRU cache of the task lists of recently shown notes.
+ *
+ * ToDoListModel puts the list of the note it leaves into the cache and takes it back when the note is
+ * opened again, so switching between recently used notes does not touch SQLite. Lists are evicted
+ * least recently used first once their total size exceeds the budget.
+ *
+ * The cache stays coherent by listening to the change bus: any write to a task, recurrence rule or
+ * note drops the cached list of that note (found by scanning the cached task IDs when the event
+ * does not name the note), and switching workspaces clears the cache.
+ */
+class TaskListCache : public QObject {
+  Q_OBJECT
+public:
+  static constexpr int defaultBudgetBytes = 8 * 1024 * 1024;
+
+  explicit TaskListCache(int budgetBytes = defaultBudgetBytes,
+                         QObject *parent = nullptr);
+
+  bool insert(int noteId, cachedTaskList list);
+  bool take(int noteId, cachedTaskList &list);
+  bool contains(int noteId) const;
+  bool fits(int bytes) const;
+  void remove(int noteId);
+  void clear();
+  int count() const;
+  int bytes() const;
+
+private slots:
+  void applyDatabaseChange(const DBChangeEvent &event);
+
+private:
+  int noteContaining(int contentId) const;
+
+  QHash<int, cachedTaskList> m_lists;
+  QHash<int, int> m_sizes;
+  QList<int> m_recency; // least recently used first
+  int m_budget;
+  int m_bytes;
+};
+
+#endif // TASKLISTCACHE_H
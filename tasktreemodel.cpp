@@ -0,0 +1,518 @@
+#include "tasktreemodel.h"
+#include "dbmanager.h"
+#include "logger.h"
+#include "tracer.h"
+#include "workspaceregistry.h"
+
+namespace {
+/**
+ * @brief Stores in each node of @p nodes[from..to] its position in the vector.
+ */
+void renumber(QVector<taskNode *> &nodes, int from, int to) {
+  for (int i = from; i <= to && i < nodes.size(); ++i)
+    nodes[i]->row = i;
+}
+} // namespace
+
+TaskTreeModel::TaskTreeModel(QObject *parent) : QAbstractItemModel(parent) {
+  QObject::connect(&WorkspaceRegistry::instance(),
+                   &WorkspaceRegistry::currentWorkspaceChanged, this,
+                   [this]() { setNoteID(-1); });
+  QObject::connect(&WorkspaceRegistry::instance(), &WorkspaceRegistry::changed,
+                   this, &TaskTreeModel::applyDatabaseChange);
+}
+
+TaskTreeModel::~TaskTreeModel() {}
+
+/**
+ * @brief Returns the index of the child at @p row under @p parent.
+ */
+QModelIndex TaskTreeModel::index(int row, int column,
+                                 const QModelIndex &parent) const {
+  if (!hasIndex(row, column, parent))
+    return QModelIndex();
+  return createIndex(row, column, nodeFor(parent)->children.at(row));
+}
+
+/**
+ * @brief Returns the parent index of @p child, or an invalid index for top-level tasks.
+ */
+QModelIndex TaskTreeModel::parent(const QModelIndex &child) const {
+  if (!child.isValid())
+    return QModelIndex();
+  return indexFor(nodeFor(child)->parent);
+}
+
+/**
+ * @brief Returns the number of children loaded so far under @p parent.
+ *
+ * Children that have not been fetched yet are not counted; see canFetchMore().
+ */
+int TaskTreeModel::rowCount(const QModelIndex &parent) const {
+  if (parent.column() > 0)
+    return 0;
+  return nodeFor(parent)->children.size();
+}
+
+/**
+ * @brief The tree has a single column.
+ */
+int TaskTreeModel::columnCount(const QModelIndex &parent) const {
+  Q_UNUSED(parent);
+  return 1;
+}
+
+/**
+ * @brief Returns whether the task has children in the database, loaded or not.
+ */
+bool TaskTreeModel::hasChildren(const QModelIndex &parent) const {
+  return nodeFor(parent)->childCount > 0;
+}
+
+/**
+ * @brief Returns whether some children of @p parent have not been loaded yet.
+ */
+bool TaskTreeModel::canFetchMore(const QModelIndex &parent) const {
+  taskNode *node = nodeFor(parent);
+  return node->children.size() < node->childCount;
+}
+
+/**
+ * @brief Loads the next page of children of @p parent.
+ *
+ * Pages are fetched by keyset after the last loaded child, so only the
+ * expanded part of the tree is ever read from the database.
+ *
+ * @param parent The node whose children are loaded.
+ */
+void TaskTreeModel::fetchMore(const QModelIndex &parent) {
+  TRACE_SPAN(span, "model");
+  taskNode *node = nodeFor(parent);
+  const taskNode *last =
+      node->children.isEmpty() ? nullptr : node->children.last();
+  const QList<QVariantMap> rows = DBManager::instance()->getChildContents(
+      m_noteID, node->id, last ? last->sortKey : QString(""),
+      last ? last->id : -1, fetchBatchSize);
+  if (rows.isEmpty()) {
+    node->childCount = node->children.size();
+    return;
+  }
+  const int first = node->children.size();
+  beginInsertRows(parent, first, first + rows.size() - 1);
+  for (const QVariantMap &row : rows) {
+    taskNode *child = new taskNode;
+    child->id = row["id"].toInt();
+    child->content = row["content"].toString();
+    child->completed = row["completed"].toBool();
+    child->sortKey = row["sort_key"].toString();
+    child->childCount = row["child_count"].toInt();
+    child->parent = node;
+    child->row = node->children.size();
+    node->children.append(child);
+    m_nodes.insert(child->id, child);
+  }
+  endInsertRows();
+}
+
+/**
+ * @brief Returns the data stored under the given role for the task referred to by the index.
+ *
+ * The roll-up roles (DescendantCountRole, CompletedDescendantsRole and
+ * RollupStatusRole) are computed from the database on first use and cached.
+ * RollupStatusRole is true when the task and all of its sub-tasks are completed.
+ *
+ * @param index The QModelIndex identifying the task.
+ * @param role The role for which the data is requested.
+ * @return QVariant containing the requested data, or an empty QVariant if the role is not supported.
+ */
+QVariant TaskTreeModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid())
+    return QVariant();
+  taskNode *node = nodeFor(index);
+  switch (role) {
+  case Qt::DisplayRole:
+  case ItemNameRole:
+    return node->content;
+  case IdRole:
+    return node->id;
+  case StatusRole:
+    return node->completed;
+  case ChildCountRole:
+    return node->childCount;
+  case DescendantCountRole:
+    ensureStats(node);
+    return node->descendantCount;
+  case CompletedDescendantsRole:
+    ensureStats(node);
+    return node->completedDescendants;
+  case RollupStatusRole:
+    ensureStats(node);
+    return node->completed &&
+           node->completedDescendants == node->descendantCount;
+  default:
+    return QVariant();
+  }
+}
+
+/**
+ * @brief Returns the role names used by QML delegates.
+ */
+QHash<int, QByteArray> TaskTreeModel::roleNames() const {
+  QHash<int, QByteArray> hashMap;
+  hashMap[IdRole] = "id";
+  hashMap[ItemNameRole] = "ItemName";
+  hashMap[StatusRole] = "StatusRole";
+  hashMap[ChildCountRole] = "childCount";
+  hashMap[DescendantCountRole] = "descendantCount";
+  hashMap[CompletedDescendantsRole] = "completedDescendants";
+  hashMap[RollupStatusRole] = "rollupStatus";
+  return hashMap;
+}
+
+/**
+ * @brief Adds a sub-task under @p parent (or a top-level task for an invalid index).
+ *
+ * The row appears through the published insert.
+ *
+ * @param parent The parent task.
+ * @param data The text of the new task.
+ */
+void TaskTreeModel::addSubTask(const QModelIndex &parent, const QString &data) {
+  TRACE_SPAN(span, "qml");
+  if (m_noteID < 0)
+    return;
+  DBManager *db = DBManager::instance();
+  const int noteId = m_noteID;
+  const int parentId = nodeFor(parent)->id;
+  db->queueWrite([db, noteId, parentId, data]() {
+    if (db->addNoteContent(noteId, data, parentId) < 0)
+      return false;
+    Logger::instance().logEvent(Logger::TASK_ADDED, db->getNoteName(noteId),
+                                data);
+    return true;
+  });
+}
+
+/**
+ * @brief Sets the completion status of a task. The row updates through the published change.
+ */
+void TaskTreeModel::toggleTaskStatus(const QModelIndex &index, bool status) {
+  TRACE_SPAN(span, "qml");
+  if (!index.isValid())
+    return;
+  taskNode *node = nodeFor(index);
+  if (node->completed == status)
+    return;
+  const QString itemName = node->content;
+  const int id = node->id;
+  const int noteId = m_noteID;
+  DBManager *db = DBManager::instance();
+  db->queueWrite([db, id, noteId, status, itemName]() {
+    if (!db->updateNoteContent(id, status))
+      return false;
+    Logger::instance().logEvent(Logger::TASK_STATUS_TOGGLED,
+                                db->getNoteName(noteId),
+                                itemName + QString(":%1").arg(status));
+    return true;
+  });
+}
+
+/**
+ * @brief Deletes a task and its whole subtree. The rows disappear through the published deletes.
+ */
+void TaskTreeModel::removeTask(const QModelIndex &index) {
+  TRACE_SPAN(span, "qml");
+  if (!index.isValid())
+    return;
+  const QString itemName = nodeFor(index)->content;
+  const int id = nodeFor(index)->id;
+  const int noteId = m_noteID;
+  DBManager *db = DBManager::instance();
+  db->queueWrite([db, id, noteId, itemName]() {
+    if (!db->deleteNoteContent(id))
+      return false;
+    Logger::instance().logEvent(Logger::TASK_DELETED, db->getNoteName(noteId),
+                                itemName);
+    return true;
+  });
+}
+
+/**
+ * @brief Shows the tasks of another note.
+ *
+ * @param noteId The note to show, or -1 for none.
+ */
+void TaskTreeModel::setNoteID(int noteId) {
+  if (noteId == m_noteID)
+    return;
+  m_noteID = noteId;
+  reload();
+}
+
+/**
+ * @brief Drops every loaded node and re-reads the number of top-level tasks.
+ *
+ * Top-level tasks are then loaded through fetchMore() as views ask for them.
+ */
+void TaskTreeModel::reload() {
+  beginResetModel();
+  qDeleteAll(m_root.children);
+  m_root.children.clear();
+  m_nodes.clear();
+  m_root.childCount =
+      m_noteID < 0 ? 0 : DBManager::instance()->countChildContents(m_noteID, -1);
+  endResetModel();
+}
+
+/**
+ * @brief Applies a committed database change to the loaded part of the tree.
+ *
+ * Inserts under a parent whose children are fully loaded become new rows;
+ * otherwise only the parent's child count grows and the row is loaded by the
+ * next fetchMore(). Reordered tasks are moved among their loaded siblings
+ * and edited texts are copied into their node.
+ * Changes to tasks that are not loaded only invalidate the roll-up totals
+ * of their nearest loaded ancestor and above (see invalidateLoadedAncestor());
+ * a deleted subtree also lowers the child count of its loaded parent. Tasks
+ * of the note changed by another process reload the tree.
+ *
+ * @param event The change published by DBManager.
+ */
+void TaskTreeModel::applyDatabaseChange(const DBChangeEvent &event) {
+  if (event.table != DBChangeEvent::NotesContents || m_noteID < 0)
+    return;
+  switch (event.operation) {
+  case DBChangeEvent::Inserted: {
+    // Occurrences of recurring tasks are listed by ToDoListModel only.
+    if (event.noteId != m_noteID || event.values.contains("rule_id"))
+      return;
+    const int parentId = event.values.value("parent_id", -1).toInt();
+    taskNode *parentNode = parentId < 0 ? &m_root : m_nodes.value(parentId);
+    if (!parentNode) {
+      invalidateLoadedAncestor(parentId);
+      return;
+    }
+    const bool fullyLoaded =
+        parentNode->children.size() == parentNode->childCount;
+    const QModelIndex parentIndex = indexFor(parentNode);
+    if (fullyLoaded) {
+      const int row = parentNode->children.size();
+      beginInsertRows(parentIndex, row, row);
+      taskNode *child = new taskNode;
+      child->id = event.rowId;
+      child->content = event.values.value("content").toString();
+      child->completed = event.values.value("completed").toBool();
+      child->sortKey = event.values.value("sort_key").toString();
+      child->parent = parentNode;
+      child->row = row;
+      parentNode->children.append(child);
+      parentNode->childCount++;
+      m_nodes.insert(child->id, child);
+      endInsertRows();
+    } else {
+      parentNode->childCount++;
+    }
+    if (parentIndex.isValid())
+      emit dataChanged(parentIndex, parentIndex, {ChildCountRole});
+    invalidateStats(parentNode);
+    break;
+  }
+  case DBChangeEvent::Updated: {
+    if (event.values.contains("sort_key")) {
+      if (event.rowId < 0) {
+        if (event.noteId == m_noteID)
+          reload();
+        return;
+      }
+      taskNode *node = m_nodes.value(event.rowId);
+      const QString sortKey = event.values.value("sort_key").toString();
+      if (node && node->sortKey != sortKey)
+        moveToSortedPosition(node, sortKey);
+      return;
+    }
+    taskNode *node = m_nodes.value(event.rowId);
+    if (node && event.values.contains("content")) {
+      node->content = event.values.value("content").toString();
+      const QModelIndex nodeIndex = indexFor(node);
+      emit dataChanged(nodeIndex, nodeIndex, {ItemNameRole});
+      return;
+    }
+    if (!event.values.contains("completed"))
+      return;
+    if (!node) {
+      invalidateLoadedAncestor(event.rowId);
+      return;
+    }
+    node->completed = event.values.value("completed").toBool();
+    const QModelIndex nodeIndex = indexFor(node);
+    emit dataChanged(nodeIndex, nodeIndex, {StatusRole, RollupStatusRole});
+    invalidateStats(node->parent);
+    break;
+  }
+  case DBChangeEvent::Deleted: {
+    if (event.rowId < 0) {
+      if (event.noteId == m_noteID)
+        reload();
+      return;
+    }
+    taskNode *node = m_nodes.value(event.rowId);
+    if (!node) {
+      // Only the top task of a deleted subtree carries its parent; the
+      // events of its descendants change nothing that is loaded.
+      if (!event.values.contains("parent_id"))
+        return;
+      const int parentId = event.values.value("parent_id").toInt();
+      taskNode *parentNode = m_nodes.value(parentId);
+      if (!parentNode) {
+        invalidateLoadedAncestor(parentId);
+        return;
+      }
+      parentNode->childCount--;
+      const QModelIndex parentIndex = indexFor(parentNode);
+      emit dataChanged(parentIndex, parentIndex, {ChildCountRole});
+      invalidateStats(parentNode);
+      return;
+    }
+    taskNode *parentNode = node->parent;
+    const int row = node->row;
+    beginRemoveRows(indexFor(parentNode), row, row);
+    parentNode->children.removeAt(row);
+    renumber(parentNode->children, row, parentNode->children.size() - 1);
+    parentNode->childCount--;
+    forgetSubtree(node);
+    delete node;
+    endRemoveRows();
+    invalidateStats(parentNode);
+    break;
+  }
+  case DBChangeEvent::Reloaded:
+    if (event.noteId == m_noteID || event.noteId < 0)
+      reload();
+    break;
+  }
+}
+
+/**
+ * @brief Returns the node behind @p index, or the root for an invalid index.
+ */
+taskNode *TaskTreeModel::nodeFor(const QModelIndex &index) const {
+  if (index.isValid())
+    return static_cast<taskNode *>(index.internalPointer());
+  return const_cast<taskNode *>(&m_root);
+}
+
+/**
+ * @brief Returns the model index of a loaded node, or an invalid index for the root.
+ */
+QModelIndex TaskTreeModel::indexFor(taskNode *node) const {
+  if (!node || node == &m_root)
+    return QModelIndex();
+  return createIndex(node->row, 0, node);
+}
+
+/**
+ * @brief Computes the roll-up totals of a node if they are not cached.
+ */
+void TaskTreeModel::ensureStats(taskNode *node) const {
+  if (node->statsValid)
+    return;
+  if (node->childCount == 0) {
+    node->descendantCount = 0;
+    node->completedDescendants = 0;
+  } else {
+    QVariantMap stats = DBManager::instance()->getSubtreeStats(node->id);
+    node->descendantCount = stats["total"].toInt();
+    node->completedDescendants = stats["completed"].toInt();
+  }
+  node->statsValid = true;
+}
+
+/**
+ * @brief Invalidates the cached roll-up totals of @p node and all of its ancestors.
+ *
+ * Views are notified so they request the totals again.
+ */
+void TaskTreeModel::invalidateStats(taskNode *node) {
+  for (; node && node != &m_root; node = node->parent) {
+    node->statsValid = false;
+    const QModelIndex nodeIndex = indexFor(node);
+    emit dataChanged(nodeIndex, nodeIndex,
+                     {DescendantCountRole, CompletedDescendantsRole,
+                      RollupStatusRole});
+  }
+}
+
+/**
+ * @brief Invalidates the roll-up totals above a task that is not loaded.
+ *
+ * The nearest loaded ancestor of @p contentId is looked up in the database
+ * and invalidated with its own ancestors. Nothing is read while no task is
+ * loaded.
+ *
+ * @param contentId The unloaded task, or -1 for none.
+ */
+void TaskTreeModel::invalidateLoadedAncestor(int contentId) {
+  if (contentId < 0 || m_nodes.isEmpty())
+    return;
+  const QList<int> ancestors =
+      DBManager::instance()->getTaskAncestors(contentId);
+  for (int id : ancestors) {
+    if (taskNode *node = m_nodes.value(id)) {
+      invalidateStats(node);
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Removes a node and its loaded descendants from the ID lookup table.
+ */
+void TaskTreeModel::forgetSubtree(taskNode *node) {
+  m_nodes.remove(node->id);
+  for (taskNode *child : qAsConst(node->children))
+    forgetSubtree(child);
+}
+
+/**
+ * @brief Moves a loaded task whose ordering key changed to its new place among its siblings.
+ *
+ * If the new place lies beyond the loaded children of a partially loaded
+ * parent, the task is unloaded instead; the next fetchMore() brings it back
+ * in the right place.
+ *
+ * @param node The reordered task.
+ * @param sortKey Its new ordering key.
+ */
+void TaskTreeModel::moveToSortedPosition(taskNode *node,
+                                         const QString &sortKey) {
+  taskNode *parentNode = node->parent;
+  QVector<taskNode *> &siblings = parentNode->children;
+  const int row = node->row;
+  node->sortKey = sortKey;
+  int target = 0;
+  for (int i = 0; i < siblings.size(); ++i) {
+    const taskNode *sibling = siblings.at(i);
+    if (sibling != node &&
+        (sibling->sortKey < sortKey ||
+         (sibling->sortKey == sortKey && sibling->id < node->id)))
+      ++target;
+  }
+  const QModelIndex parentIndex = indexFor(parentNode);
+  if (target == siblings.size() - 1 &&
+      siblings.size() < parentNode->childCount) {
+    beginRemoveRows(parentIndex, row, row);
+    siblings.removeAt(row);
+    renumber(siblings, row, siblings.size() - 1);
+    forgetSubtree(node);
+    delete node;
+    endRemoveRows();
+    return;
+  }
+  if (target == row)
+    return;
+  beginMoveRows(parentIndex, row, row, parentIndex,
+                target > row ? target + 1 : target);
+  siblings.move(row, target);
+  renumber(siblings, qMin(row, target), qMax(row, target));
+  endMoveRows();
+}
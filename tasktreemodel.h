@@ -0,0 +1,121 @@
+#ifndef TASKTREEMODEL_H
+#define TASKTREEMODEL_H
+
+#include "dbchangeevent.h"
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QVector>
+
+/**
+ * @struct taskNode
+ * @brief One loaded task in the TaskTreeModel.
+ *
+ * @var taskNode::id
+ *   Unique identifier of the task (-1 for the invisible root).
+ * @var taskNode::content
+ *   Text of the task.
+ * @var taskNode::completed
+ *   Completion status of the task itself.
+ * @var taskNode::sortKey
+ *   Ordering key among its siblings (see OrderKey).
+ * @var taskNode::childCount
+ *   Number of direct children stored in the database.
+ * @var taskNode::parent
+ *   Parent node (nullptr for the root).
+ * @var taskNode::row
+ *   Position of the node among the loaded children of its parent.
+ * @var taskNode::children
+ *   Children loaded so far, in sort key order. Collapsed subtrees stay empty.
+ * @var taskNode::statsValid
+ *   Whether descendantCount and completedDescendants are up to date.
+ * @var taskNode::descendantCount
+ *   Number of tasks in the subtree below this node.
+ * @var taskNode::completedDescendants
+ *   Number of completed tasks in the subtree below this node.
+ */
+struct taskNode {
+  int id = -1;
+  QString content;
+  bool completed = false;
+  QString sortKey;
+  int childCount = 0;
+  taskNode *parent = nullptr;
+  int row = 0;
+  QVector<taskNode *> children;
+  bool statsValid = false;
+  int descendantCount = 0;
+  int completedDescendants = 0;
+
+  ~taskNode() { qDeleteAll(children); }
+};
+
+/**
+ * @class TaskTreeModel
+ * @brief Tree model of the tasks and sub-tasks of one note, loaded on demand.
+ *
+ * Only the children of expanded nodes are ever loaded: every node knows how many children it has
+ * (so views can show an expander) and canFetchMore()/fetchMore() load its children from DBManager
+ * in pages of fetchBatchSize. Sub-tree totals for the roll-up roles are computed with one recursive
+ * query when first requested and cached until a change below the node is published.
+ *
+ * The model follows the note selected in ToDoListModel and applies DBManager change events to the
+ * loaded part of the tree.
+ *
+ * @see QAbstractItemModel
+ */
+class TaskTreeModel : public QAbstractItemModel {
+  Q_OBJECT
+public:
+  explicit TaskTreeModel(QObject *parent = nullptr);
+  virtual ~TaskTreeModel();
+  enum roleEnums {
+    IdRole = Qt::UserRole + 1,
+    ItemNameRole,
+    StatusRole,
+    ChildCountRole,
+    DescendantCountRole,
+    CompletedDescendantsRole,
+    RollupStatusRole
+  };
+  Q_ENUM(roleEnums);
+
+  QModelIndex index(int row, int column,
+                    const QModelIndex &parent = QModelIndex()) const override;
+  QModelIndex parent(const QModelIndex &child) const override;
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+  bool canFetchMore(const QModelIndex &parent) const override;
+  void fetchMore(const QModelIndex &parent) override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+  QHash<int, QByteArray> roleNames() const override;
+
+  Q_INVOKABLE void addSubTask(const QModelIndex &parent, const QString &data);
+  Q_INVOKABLE void toggleTaskStatus(const QModelIndex &index, bool status);
+  Q_INVOKABLE void removeTask(const QModelIndex &index);
+
+public slots:
+  void setNoteID(int noteId);
+  void reload();
+
+private slots:
+  void applyDatabaseChange(const DBChangeEvent &event);
+
+private:
+  static constexpr int fetchBatchSize = 200;
+
+  taskNode *nodeFor(const QModelIndex &index) const;
+  QModelIndex indexFor(taskNode *node) const;
+  void ensureStats(taskNode *node) const;
+  void invalidateStats(taskNode *node);
+  void invalidateLoadedAncestor(int contentId);
+  void forgetSubtree(taskNode *node);
+  void moveToSortedPosition(taskNode *node, const QString &sortKey);
+
+  int m_noteID = -1;
+  taskNode m_root;
+  QHash<int, taskNode *> m_nodes;
+};
+
+#endif // TASKTREEMODEL_H
@@ -0,0 +1,310 @@
+#include "taskwindow.h"
+#include "dbmanager.h"
+#include "tracer.h"
+
+TaskWindow::TaskWindow(const QHash<int, pendingStatusChange> &pending,
+                       QObject *parent)
+    : QObject(parent), m_pending(pending), m_noteId(-1), m_count(0),
+      m_liveChars(0) {}
+
+/**
+ * @brief Points the window at a note and drops everything fetched so far.
+ *
+ * @param noteId The note.
+ * @param count Number of ordinary tasks of the note.
+ */
+void TaskWindow::reset(int noteId, int count) {
+  clear();
+  m_noteId = noteId;
+  m_count = count;
+}
+
+/**
+ * @brief Drops all pages, known page positions and text, and the note.
+ */
+void TaskWindow::clear() {
+  m_noteId = -1;
+  m_count = 0;
+  invalidateFrom(0);
+}
+
+/**
+ * @brief Returns the number of tasks of the note.
+ */
+int TaskWindow::count() const { return m_count; }
+
+/**
+ * @brief Updates the number of tasks after one was added or removed.
+ *
+ * The caller invalidates the pages the change shifted.
+ */
+void TaskWindow::setCount(int count) { m_count = count; }
+
+/**
+ * @brief Drops the pages and remembered positions from the page holding @p row onwards.
+ *
+ * Called when rows were inserted or moved at @p row, which shifts every
+ * later row. Pages before it are still valid.
+ *
+ * @param row First row whose page is stale.
+ */
+void TaskWindow::invalidateFrom(int row) {
+  auto anchor = m_anchors.lowerBound(qMax(0, row));
+  while (anchor != m_anchors.end())
+    anchor = m_anchors.erase(anchor);
+  dropPagesFrom(row);
+}
+
+/**
+ * @brief Removes row @p row after its task was deleted.
+ *
+ * The remembered keys of later rows move up by one row; the pages from the
+ * row on are dropped.
+ */
+void TaskWindow::removeRow(int row) {
+  QMap<int, QPair<QString, int>> anchors;
+  for (auto it = m_anchors.cbegin(); it != m_anchors.cend(); ++it)
+    if (it.key() != row)
+      anchors.insert(it.key() < row ? it.key() : it.key() - 1, *it);
+  m_anchors.swap(anchors);
+  m_count = qMax(0, m_count - 1);
+  dropPagesFrom(row);
+}
+
+/**
+ * @brief Drops the pages and page positions from the page holding @p row onwards.
+ */
+void TaskWindow::dropPagesFrom(int row) {
+  const int first = qMax(0, row) / pageSize;
+  for (const int page : m_pages.keys())
+    if (page >= first)
+      dropPage(page);
+  // The position before page first is the last row of page first - 1; keep it.
+  auto start = m_starts.upperBound(first);
+  while (start != m_starts.end())
+    start = m_starts.erase(start);
+  if (m_pages.isEmpty()) {
+    m_texts.clear();
+    m_liveChars = 0;
+  }
+}
+
+/**
+ * @brief Returns row @p row, fetching its page if it is not resident.
+ *
+ * @return The row, or nullptr if it is out of range or could not be read.
+ */
+listElement *TaskWindow::row(int row) {
+  if (row < 0 || row >= m_count)
+    return nullptr;
+  const int page = row / pageSize;
+  if (!m_pages.contains(page) && !loadPage(page))
+    return nullptr;
+  if (m_recency.last() != page) {
+    m_recency.removeOne(page);
+    m_recency.append(page);
+  }
+  QVector<listElement> &rows = m_pages[page];
+  const int offset = row % pageSize;
+  return offset < rows.size() ? &rows[offset] : nullptr;
+}
+
+/**
+ * @brief Returns row @p row if its page is resident, without touching the database.
+ */
+listElement *TaskWindow::residentRow(int row) {
+  auto it = m_pages.find(row / pageSize);
+  if (row < 0 || it == m_pages.end() || row % pageSize >= it->size())
+    return nullptr;
+  return &(*it)[row % pageSize];
+}
+
+/**
+ * @brief Returns the row of the task with the given ID if its page is resident, or -1.
+ */
+int TaskWindow::residentRowForId(int id) const {
+  for (auto it = m_pages.cbegin(); it != m_pages.cend(); ++it)
+    for (int offset = 0; offset < it->size(); ++offset)
+      if (it->at(offset).id == id)
+        return it.key() * pageSize + offset;
+  return -1;
+}
+
+/**
+ * @brief Returns the number of rows held in memory.
+ */
+int TaskWindow::residentRows() const {
+  int rows = 0;
+  for (const QVector<listElement> &page : m_pages)
+    rows += page.size();
+  return rows;
+}
+
+/**
+ * @brief Returns the text referenced by a resident row.
+ */
+QString TaskWindow::text(const TextRef &ref) const { return m_texts.text(ref); }
+
+/**
+ * @brief Stores text for a resident row.
+ */
+TextRef TaskWindow::appendText(const QString &text) {
+  m_liveChars += text.size();
+  return m_texts.append(text);
+}
+
+/**
+ * @brief Fetches page @p page and evicts the least recently read page if too many are resident.
+ *
+ * @return true if the page was fetched, false otherwise.
+ */
+bool TaskWindow::loadPage(int page) {
+  TRACE_SPAN(span, "model");
+  QPair<QString, int> start;
+  if (!pageStart(page, start))
+    return false;
+  const QList<QVariantMap> contents = DBManager::instance()->getChildContents(
+      m_noteId, -1, start.first, start.second, pageSize);
+  if (contents.isEmpty())
+    return false;
+
+  QVector<listElement> rows;
+  rows.reserve(contents.size());
+  for (const QVariantMap &content : contents) {
+    listElement element;
+    element.id = content["id"].toInt();
+    element.itemName = appendText(content["content"].toString());
+    element.completionStatus = content["completed"].toBool();
+    const auto pending = m_pending.constFind(element.id);
+    if (pending != m_pending.cend())
+      element.completionStatus = pending->newStatus;
+    element.sortKey = appendText(content["sort_key"].toString());
+    element.dueAt =
+        content["due_at"].isNull() ? -1 : content["due_at"].toLongLong();
+    element.ruleId = -1;
+    element.occurrenceAt = -1;
+    rows.append(element);
+  }
+  if (rows.size() == pageSize)
+    m_starts.insert(page + 1, {contents.last()["sort_key"].toString(),
+                               rows.last().id});
+  m_pages.insert(page, rows);
+  m_recency.append(page);
+  if (m_pages.size() > maxResidentPages) {
+    dropPage(m_recency.first());
+    compactTexts();
+  }
+  return true;
+}
+
+/**
+ * @brief Finds the keyset position just before page @p page.
+ *
+ * Uses the remembered position if there is one, walks forward from a nearby
+ * known page, or looks up the row before the page (see rowKey()).
+ *
+ * @param page The page.
+ * @param start Receives the (sort_key, id) of the last row before the page.
+ * @return true if the position was found, false otherwise.
+ */
+bool TaskWindow::pageStart(int page, QPair<QString, int> &start) {
+  if (page == 0) {
+    start = {QString(""), -1};
+    return true;
+  }
+  auto known = m_starts.constFind(page);
+  if (known != m_starts.cend()) {
+    start = *known;
+    return true;
+  }
+  auto below = m_starts.lowerBound(page);
+  const int nearest = below == m_starts.begin() ? 0 : (--below).key();
+  if (page - nearest <= maxWalkPages) {
+    for (int walked = nearest; walked < page; ++walked)
+      if (!m_pages.contains(walked) && !loadPage(walked))
+        return false;
+    known = m_starts.constFind(page);
+    if (known == m_starts.cend())
+      return false;
+    start = *known;
+    return true;
+  }
+  if (!rowKey(page * pageSize - 1, start))
+    return false;
+  m_starts.insert(page, start);
+  return true;
+}
+
+/**
+ * @brief Finds the (sort_key, id) of row @p row.
+ *
+ * Starts from the nearest remembered key at or before the row and steps
+ * forward at most anchorRows rows per lookup, remembering the key of every
+ * anchorRows-th row it reaches.
+ *
+ * @param row The row.
+ * @param key Receives its (sort_key, id).
+ * @return true if the row was found, false otherwise.
+ */
+bool TaskWindow::rowKey(int row, QPair<QString, int> &key) {
+  int from = -1;
+  key = {QString(""), -1};
+  auto anchor = m_anchors.upperBound(row);
+  if (anchor != m_anchors.begin()) {
+    --anchor;
+    from = anchor.key();
+    key = *anchor;
+  }
+  auto start = m_starts.upperBound((row + 1) / pageSize);
+  if (start != m_starts.begin() && (--start).key() * pageSize - 1 > from) {
+    from = start.key() * pageSize - 1;
+    key = *start;
+  }
+  DBManager *db = DBManager::instance();
+  while (from < row) {
+    const int next = qMin(row, ((from + 1) / anchorRows + 1) * anchorRows - 1);
+    const QVariantMap found = db->getChildContentKeyAt(
+        m_noteId, -1, key.first, key.second, next - from - 1);
+    if (found.isEmpty())
+      return false;
+    key = {found["sort_key"].toString(), found["id"].toInt()};
+    from = next;
+    if ((from + 1) % anchorRows == 0) {
+      // Keys shifted here by removeRow() are superseded by this one.
+      auto shifted = m_anchors.upperBound(from - anchorRows);
+      while (shifted != m_anchors.end() && shifted.key() < from)
+        shifted = m_anchors.erase(shifted);
+      m_anchors.insert(from, key);
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Evicts page @p page.
+ */
+void TaskWindow::dropPage(int page) {
+  auto it = m_pages.find(page);
+  if (it == m_pages.end())
+    return;
+  for (const listElement &row : *it)
+    m_liveChars -= int(row.itemName.length + row.sortKey.length);
+  m_pages.erase(it);
+  m_recency.removeOne(page);
+}
+
+/**
+ * @brief Copies the text of the resident rows into a fresh arena once evicted text makes up half of it.
+ */
+void TaskWindow::compactTexts() {
+  if (m_texts.size() < 2 * m_liveChars)
+    return;
+  TextArena texts;
+  texts.reserve(m_liveChars);
+  for (QVector<listElement> &rows : m_pages)
+    for (listElement &row : rows) {
+      row.itemName = texts.append(m_texts.view(row.itemName));
+      row.sortKey = texts.append(m_texts.view(row.sortKey));
+    }
+  m_texts = texts;
+}
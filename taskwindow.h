@@ -0,0 +1,78 @@
+#ifndef TASKWINDOW_H
+#define TASKWINDOW_H
+
+#include "todolistmodel.h"
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QPair>
+
+/**
+ * @class TaskWindow
+ * @brief Sliding window over the ordinary tasks of a note too large to load at once.
+ *
+ * ToDoListModel switches to a TaskWindow for notes with more than windowThreshold tasks. The window
+ * knows the true number of tasks but keeps only the pages of pageSize rows that views read most
+ * recently, at most maxResidentPages of them; older pages are evicted and their text is dropped
+ * from the arena once it makes up half of it. Memory therefore stays bounded whatever the size of
+ * the note.
+ *
+ * Pages are fetched by keyset on (sort_key, id) from the last row of the previous page, which is
+ * remembered for every page fetched so far. A page far from any known one (a jump of the scroll
+ * bar) is located by offset lookups that start from the nearest known position and step
+ * anchorRows rows at a time, remembering the key of every anchorRows-th row on the way. The
+ * first jump to a row costs time proportional to its distance from the nearest known position;
+ * later jumps skip at most anchorRows rows. Removing a row shifts the remembered keys instead of
+ * dropping them.
+ *
+ * Rows with a pending (not yet flushed) status change keep their in-memory status when their page
+ * is fetched again.
+ */
+class TaskWindow : public QObject {
+public:
+  static constexpr int windowThreshold = 50000;
+  static constexpr int pageSize = 256;
+  static constexpr int maxResidentPages = 16;
+
+  explicit TaskWindow(const QHash<int, pendingStatusChange> &pending,
+                      QObject *parent = nullptr);
+
+  void reset(int noteId, int count);
+  void clear();
+  int count() const;
+  void setCount(int count);
+  void invalidateFrom(int row);
+  void removeRow(int row);
+
+  listElement *row(int row);
+  listElement *residentRow(int row);
+  int residentRowForId(int id) const;
+  int residentRows() const;
+  QString text(const TextRef &ref) const;
+  TextRef appendText(const QString &text);
+
+private:
+  bool loadPage(int page);
+  bool pageStart(int page, QPair<QString, int> &start);
+  bool rowKey(int row, QPair<QString, int> &key);
+  void dropPagesFrom(int row);
+  void dropPage(int page);
+  void compactTexts();
+
+  // Jumps up to this many pages past a known page walk there by keyset.
+  static constexpr int maxWalkPages = 4;
+  static constexpr int anchorRows = 16 * pageSize;
+
+  const QHash<int, pendingStatusChange> &m_pending;
+  int m_noteId;
+  int m_count;
+  QHash<int, QVector<listElement>> m_pages;
+  QList<int> m_recency; // least recently read first
+  QMap<int, QPair<QString, int>> m_starts; // (sort_key, id) before each page
+  QMap<int, QPair<QString, int>> m_anchors; // (sort_key, id) of sparse rows
+  TextArena m_texts;
+  int m_liveChars;
+};
+
+#endif // TASKWINDOW_H
@@ -0,0 +1,65 @@
+#include "textarena.h"
+
+/**
+ * @brief Copies @p text into the arena.
+ *
+ * @param text The string to store; may be a view into another arena.
+ * @return Handle used to read the string back with view() or text().
+ */
+TextRef TextArena::append(QStringView text) {
+  TextRef ref{quint32(m_buffer.size()), quint32(text.size())};
+  m_buffer.append(text.data(), int(text.size()));
+  return ref;
+}
+
+/**
+ * @brief Returns the string referenced by @p ref without copying it.
+ *
+ * The view is invalidated by the next append(), clear() or reserve().
+ */
+QStringView TextArena::view(const TextRef &ref) const {
+  return QStringView(m_buffer).mid(qsizetype(ref.offset),
+                                   qsizetype(ref.length));
+}
+
+/**
+ * @brief Returns the string referenced by @p ref as a QString.
+ *
+ * A string built recently is returned from the cache, which costs a
+ * reference count instead of an allocation and a copy.
+ */
+QString TextArena::text(const TextRef &ref) const {
+  if (ref.length == 0)
+    return QString();
+  if (m_cache.isEmpty()) {
+    m_cache.resize(cacheSlots);
+    m_cacheOffsets.fill(quint32(-1), cacheSlots);
+  }
+  const int slot = int((ref.offset * 2654435761u) >> 26);
+  QString &cached = m_cache[slot];
+  if (m_cacheOffsets.at(slot) != ref.offset ||
+      cached.size() != int(ref.length)) {
+    cached = view(ref).toString();
+    m_cacheOffsets[slot] = ref.offset;
+  }
+  return cached;
+}
+
+/**
+ * @brief Releases all stored strings. Existing TextRef handles become invalid.
+ */
+void TextArena::clear() {
+  m_buffer.clear();
+  m_cache.clear();
+  m_cacheOffsets.clear();
+}
+
+/**
+ * @brief Reserves space for @p characters UTF-16 code units.
+ */
+void TextArena::reserve(int characters) { m_buffer.reserve(characters); }
+
+/**
+ * @brief Returns the number of UTF-16 code units stored in the arena.
+ */
+int TextArena::size() const { return m_buffer.size(); }
@@ -0,0 +1,55 @@
+#ifndef TEXTARENA_H
+#define TEXTARENA_H
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+/**
+ * @struct TextRef
+ * @brief Location of a string stored in a TextArena.
+ *
+ * @var TextRef::offset
+ *   Index of the first character in the arena.
+ * @var TextRef::length
+ *   Number of UTF-16 code units.
+ */
+struct TextRef {
+  quint32 offset;
+  quint32 length;
+};
+
+/**
+ * @class TextArena
+ * @brief Append-only contiguous storage for the text of many model rows.
+ *
+ * Storing every row's text as its own QString costs a heap allocation and a 24-byte header per
+ * row. The arena keeps all characters in one growing buffer and hands out 8-byte TextRef handles
+ * instead. Strings are never freed individually; the owning model replaces the arena when it
+ * reloads and copies the text of its live rows into a fresh one (see append(QStringView)) once
+ * replaced or removed text makes up most of it.
+ *
+ * view() reads a string without copying it. text() returns an owning QString for QVariant and
+ * keeps the last strings it built in a small cache, so the repeated data() calls of a delegate
+ * share one allocation per row.
+ *
+ * @note text() updates the cache and must not be called from two threads at once.
+ */
+class TextArena {
+public:
+  TextRef append(QStringView text);
+  QStringView view(const TextRef &ref) const;
+  QString text(const TextRef &ref) const;
+  void clear();
+  void reserve(int characters);
+  int size() const;
+
+private:
+  static constexpr int cacheSlots = 64; // Indexed by the top 6 bits of a hash.
+
+  QString m_buffer;
+  mutable QVector<QString> m_cache;
+  mutable QVector<quint32> m_cacheOffsets;
+};
+
+#endif // TEXTARENA_H
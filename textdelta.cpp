@@ -0,0 +1,74 @@
+#include "textdelta.h"
+
+namespace {
+void appendNumber(QByteArray &out, quint32 value) {
+  while (value >= 0x80) {
+    out.append(char(value | 0x80));
+    value >>= 7;
+  }
+  out.append(char(value));
+}
+
+bool readNumber(const QByteArray &in, int &pos, quint32 &value) {
+  value = 0;
+  for (int shift = 0; pos < in.size() && shift < 32; shift += 7) {
+    const quint8 byte = quint8(in.at(pos++));
+    value |= quint32(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+} // namespace
+
+/**
+ * @brief Returns the delta that turns @p from into @p to.
+ *
+ * The shared prefix and suffix are never split inside a surrogate pair, so
+ * the inserted text is always valid UTF-16.
+ *
+ * @param from The previous version of the text.
+ * @param to The new version of the text.
+ * @return The encoded delta.
+ */
+QByteArray TextDelta::encode(const QString &from, const QString &to) {
+  const int shorter = qMin(from.size(), to.size());
+  int prefix = 0;
+  while (prefix < shorter && from.at(prefix) == to.at(prefix))
+    ++prefix;
+  if (prefix > 0 && prefix < shorter && to.at(prefix - 1).isHighSurrogate())
+    --prefix;
+  int suffix = 0;
+  while (suffix < shorter - prefix &&
+         from.at(from.size() - 1 - suffix) == to.at(to.size() - 1 - suffix))
+    ++suffix;
+  if (suffix > 0 && suffix < to.size() - prefix &&
+      to.at(to.size() - suffix).isLowSurrogate())
+    --suffix;
+
+  QByteArray delta;
+  appendNumber(delta, quint32(prefix));
+  appendNumber(delta, quint32(from.size() - prefix - suffix));
+  delta.append(
+      QStringView(to).mid(prefix, to.size() - prefix - suffix).toUtf8());
+  return delta;
+}
+
+/**
+ * @brief Applies a delta made by encode() to @p text in place.
+ *
+ * @param text The version the delta was made from; becomes the new version.
+ * @param delta The encoded delta.
+ * @return true if the delta was applied, false if it is malformed or does not fit @p text.
+ */
+bool TextDelta::apply(QString &text, const QByteArray &delta) {
+  int pos = 0;
+  quint32 prefix = 0;
+  quint32 removed = 0;
+  if (!readNumber(delta, pos, prefix) || !readNumber(delta, pos, removed) ||
+      qint64(prefix) + removed > text.size())
+    return false;
+  text.replace(int(prefix), int(removed),
+               QString::fromUtf8(delta.constData() + pos, delta.size() - pos));
+  return true;
+}
@@ -0,0 +1,28 @@
+#ifndef TEXTDELTA_H
+#define TEXTDELTA_H
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * @class TextDelta
+ * @brief Compact binary deltas between two versions of a text.
+ *
+ * A delta describes the edit as one splice: the length of the prefix both texts share, the number
+ * of characters removed after it and the text inserted in their place; the rest of the text is
+ * kept. Lengths are stored as variable-length integers and the inserted text as UTF-8, so a
+ * delta costs a few bytes plus the inserted text, whatever the length of the edited text. Edits
+ * at several places in one go cost the span between the first and the last of them.
+ *
+ * Usage:
+ *   QByteArray delta = TextDelta::encode(oldText, newText);
+ *   QString text = oldText;
+ *   TextDelta::apply(text, delta); // text == newText
+ */
+class TextDelta {
+public:
+  static QByteArray encode(const QString &from, const QString &to);
+  static bool apply(QString &text, const QByteArray &delta);
+};
+
+#endif // TEXTDELTA_H
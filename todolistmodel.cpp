@@ -1,59 +1,98 @@
 #include "todolistmodel.h"
 #include "dbmanager.h"
 #include "logger.h"
+#include "orderkey.h"
+#include "recurrencerule.h"
+#include "tasklistcache.h"
+#include "taskwindow.h"
+#include "tracer.h"
+#include "workspaceregistry.h"
+#include <QPointer>
+#include <algorithm>
 ToDoListModel::ToDoListModel(QObject *parent)
-    : QAbstractListModel{parent}, m_noteID{-1} {
+    : todoListBase{parent}, m_cache{new TaskListCache(
+                                TaskListCache::defaultBudgetBytes, this)},
+      m_window{new TaskWindow(m_pendingStatus, this)}, m_windowed{false},
+      m_noteID{-1}, m_taskCount{0}, m_compactedTexts{0} {
   Q_UNUSED(parent);
+  m_windowFrom = QDateTime(QDate::currentDate(), QTime(0, 0));
+  m_windowTo = m_windowFrom.addDays(7);
+  m_statusFlushTimer.setSingleShot(true);
+  m_statusFlushTimer.setInterval(statusFlushDelayMs);
+  QObject::connect(&m_statusFlushTimer, &QTimer::timeout, this,
+                   &ToDoListModel::flushPendingStatusChanges);
+  m_rebalanceTimer.setSingleShot(true);
+  m_rebalanceTimer.setInterval(rebalanceDelayMs);
+  QObject::connect(&m_rebalanceTimer, &QTimer::timeout, this,
+                   &ToDoListModel::rebalanceSortKeys);
+  m_prefetchTimer.setInterval(prefetchIntervalMs);
+  QObject::connect(&m_prefetchTimer, &QTimer::timeout, this,
+                   &ToDoListModel::prefetchNext);
   QObject::connect(this, &ToDoListModel::noteIDChanged, this,
-                   &ToDoListModel::fetchListFromDB);
+                   &ToDoListModel::showCurrentNote);
+  QObject::connect(&WorkspaceRegistry::instance(),
+                   &WorkspaceRegistry::currentWorkspaceAboutToChange, this,
+                   &ToDoListModel::flushPendingStatusChanges);
+  QObject::connect(&WorkspaceRegistry::instance(),
+                   &WorkspaceRegistry::currentWorkspaceChanged, this,
+                   [this]() {
+                     m_noteID = -1;
+                     fetchListFromDB();
+                   });
+  QObject::connect(&WorkspaceRegistry::instance(), &WorkspaceRegistry::changed,
+                   this, &ToDoListModel::applyDatabaseChange);
 }
 
-ToDoListModel::~ToDoListModel() {}
+ToDoListModel::~ToDoListModel() { flushPendingStatusChanges(); }
 
 /**
- * @brief Returns the number of rows in the model.
+ * @brief Role accessors of ToDoListModel.
  *
- * This function returns the number of items in the to-do list model.
- * If the provided parent index is valid, it returns 0, indicating that
- * this model does not support hierarchical data.
- *
- * @param parent The parent index. Used to support hierarchical models.
- * @return The number of rows in the model.
+ * DueAtRole is undefined when the task has no due date and OccurrenceAtRole
+ * is undefined for ordinary tasks.
  */
-int ToDoListModel::rowCount(const QModelIndex &parent) const {
-  if (parent.isValid())
-    return 0;
-  return modelData.count();
+QVariant todoIdField::get(const ToDoListModel &, const listElement &row) {
+  return row.id;
+}
+
+QVariant todoNameField::get(const ToDoListModel &model,
+                            const listElement &row) {
+  return model.textOf(row.itemName);
+}
+
+QVariant todoStatusField::get(const ToDoListModel &, const listElement &row) {
+  return row.completionStatus;
+}
+
+QVariant todoDueAtField::get(const ToDoListModel &, const listElement &row) {
+  return row.dueAt < 0 ? QVariant()
+                       : QVariant(QDateTime::fromMSecsSinceEpoch(row.dueAt));
+}
+
+QVariant todoOccurrenceAtField::get(const ToDoListModel &,
+                                    const listElement &row) {
+  return row.occurrenceAt < 0
+             ? QVariant()
+             : QVariant(QDateTime::fromMSecsSinceEpoch(row.occurrenceAt));
+}
+
+QVariant todoRecurringField::get(const ToDoListModel &,
+                                 const listElement &row) {
+  return row.ruleId >= 0;
 }
 
 /**
- * @brief Returns the data stored under the given role for the item referred to by the index.
- *
- * This function retrieves the data for a specific item in the model based on the provided index and role.
- * It supports custom roles such as IdRole, ItemNameRole, and StatusRole, returning the corresponding
- * item properties. If the index is invalid or out of bounds, it returns 0. For unsupported roles, it returns
- * an empty QVariant.
- *
- * @param index The QModelIndex identifying the item in the model.
- * @param role The role for which the data is requested.
- * @return QVariant containing the requested data, or an empty QVariant if the role is not supported.
+ * @brief Returns the number of rows views see, which for a windowed note is its true number of tasks.
  */
-QVariant ToDoListModel::data(const QModelIndex &index, int role) const {
-  if (!index.isValid() || index.row() >= modelData.count()) {
-    return 0;
-  }
-  listElement item = modelData.at(index.row());
-  switch (role) {
-  case IdRole:
-    return item.id;
-  case ItemNameRole:
-    return item.itemName;
-  case StatusRole:
-    return item.completionStatus;
-  default:
-    return QVariant();
-    break;
-  }
+int ToDoListModel::viewRowCount() const {
+  return m_windowed ? m_window->count() : m_rows.size();
+}
+
+/**
+ * @brief Returns row @p row; a windowed note fetches the row's page if it is not resident.
+ */
+const listElement *ToDoListModel::viewRow(int row) const {
+  return m_windowed ? m_window->row(row) : &m_rows.at(row);
 }
 
 /**
@@ -86,79 +125,398 @@ QVariant ToDoListModel::headerData(int section, Qt::Orientation orientation,
 }
 
 /**
- * @brief Returns a hash map of custom role names used in the model.
+ * @brief Moves tasks to another position in the list.
+ *
+ * The rows are moved in memory first, then each moved task gets a new
+ * ordering key between its new neighbours, so a move writes exactly one row
+ * per moved task no matter how long the list is. If the write fails, the list
+ * is reloaded. When keys grow longer than OrderKey::rebalanceLength, the keys
+ * of the note are rewritten once the user has stopped moving tasks for
+ * rebalanceDelayMs. Occurrences of recurring tasks are in time order and
+ * cannot be moved.
+ *
+ * @param sourceParent Must be invalid (flat list).
+ * @param sourceRow First row to move.
+ * @param count Number of rows to move.
+ * @param destinationParent Must be invalid (flat list).
+ * @param destinationChild Row before which the rows are inserted, counted before the move.
+ * @return true if the rows were moved, false otherwise.
+ */
+bool ToDoListModel::moveRows(const QModelIndex &sourceParent, int sourceRow,
+                             int count, const QModelIndex &destinationParent,
+                             int destinationChild) {
+  if (sourceParent.isValid() || destinationParent.isValid() || count <= 0 ||
+      sourceRow < 0 || sourceRow + count > taskCount() ||
+      destinationChild < 0 || destinationChild > taskCount() ||
+      (destinationChild >= sourceRow && destinationChild <= sourceRow + count))
+    return false;
+  if (m_windowed)
+    return moveWindowedRows(sourceRow, count, destinationChild);
+  const QString after =
+      destinationChild < m_taskCount ? sortKeyAt(destinationChild) : QString();
+  QString previous = destinationChild > 0 ? sortKeyAt(destinationChild - 1)
+                                          : QString();
+  bool needsRebalance = false;
+  for (int i = 0; i < count; ++i) {
+    previous = OrderKey::between(previous, after);
+    m_rows[sourceRow + i].sortKey = m_texts.append(previous);
+    needsRebalance =
+        needsRebalance || previous.size() > OrderKey::rebalanceLength;
+  }
+
+  beginMoveRows(QModelIndex(), sourceRow, sourceRow + count - 1, QModelIndex(),
+                destinationChild);
+  const QVector<listElement> moved = m_rows.mid(sourceRow, count);
+  m_rows.remove(sourceRow, count);
+  const int target =
+      destinationChild > sourceRow ? destinationChild - count : destinationChild;
+  QVector<int> ids;
+  QStringList keys;
+  for (int i = 0; i < count; ++i) {
+    m_rows.insert(target + i, moved.at(i));
+    ids.append(moved.at(i).id);
+    keys.append(m_texts.text(moved.at(i).sortKey));
+  }
+  endMoveRows();
+  compactTexts();
+
+  if (!writeSortKeys(ids, keys))
+    return false;
+  if (needsRebalance)
+    m_rebalanceTimer.start();
+  return true;
+}
+
+/**
+ * @brief Writes the new ordering keys of moved tasks, reloading the list if that fails.
  *
- * This function provides a mapping between integer role identifiers and their corresponding
- * string names. These roles are used to access specific data fields in the model, such as
- * the item's ID, name, and status.
+ * The write is queued while another connection holds the write lock (see
+ * DBManager::queueWrite()).
  *
- * @return QHash<int, QByteArray> A hash map where the key is the role identifier and the value is the role name.
+ * @param ids IDs of the moved tasks.
+ * @param keys Their new ordering keys.
+ * @return false if the write failed right away, true otherwise.
  */
-QHash<int, QByteArray> ToDoListModel::roleNames() const {
-  QHash<int, QByteArray> hashMap;
-  hashMap[IdRole] = "id";
-  hashMap[ItemNameRole] = "ItemName";
-  hashMap[StatusRole] = "StatusRole";
-  return hashMap;
+bool ToDoListModel::writeSortKeys(const QVector<int> &ids,
+                                  const QStringList &keys) {
+  DBManager *db = DBManager::instance();
+  QPointer<ToDoListModel> model(this);
+  return db->queueWrite(
+      [db, ids, keys]() {
+        for (int i = 0; i < ids.size(); ++i)
+          if (!db->setNoteContentSortKey(ids.at(i), keys.at(i)))
+            return false;
+        return true;
+      },
+      [model](bool ok) {
+        if (ok || !model)
+          return;
+        qDebug() << "Failed to write task order, reloading list";
+        model->fetchListFromDB();
+      });
+}
+
+/**
+ * @brief Moves one task so that it ends up at row @p to (drag-and-drop from QML).
+ *
+ * @param from Current row of the task.
+ * @param to Row the task should occupy after the move.
+ * @return true if the task was moved, false otherwise.
+ */
+bool ToDoListModel::moveItem(int from, int to) {
+  TRACE_SPAN(span, "qml");
+  return moveRows(QModelIndex(), from, 1, QModelIndex(),
+                  to > from ? to + 1 : to);
 }
 
 /**
  * @brief Adds a new item to the to-do list and updates the model.
  *
- * This method inserts a new note content into the database for the current note ID,
- * logs the addition event, and refreshes the list from the database.
+ * This method inserts a new note content into the database for the current note ID
+ * and logs the addition event. The row itself is appended by applyDatabaseChange()
+ * when the insert is published, so the list is not reloaded.
  *
  * @param data The content of the item to be added to the to-do list.
  */
 void ToDoListModel::addItemToList(const QString &data) {
-  DBManager::instance()->addNoteContent(m_noteID, data);
-  QString noteName = DBManager::instance()->getNoteName(m_noteID);
-  Logger::instance().logEvent(Logger::TASK_ADDED, noteName, data);
-  fetchListFromDB();
+  TRACE_SPAN(span, "qml");
+  DBManager *db = DBManager::instance();
+  const int noteId = m_noteID;
+  db->queueWrite([db, noteId, data]() {
+    if (db->addNoteContent(noteId, data) < 0)
+      return false;
+    Logger::instance().logEvent(Logger::TASK_ADDED, db->getNoteName(noteId),
+                                data);
+    return true;
+  });
 }
 
 /**
  * @brief Removes an item from the to-do list at the specified index.
  *
- * This function deletes the note content from the database, logs the deletion event,
- * and removes the item from the internal model data. If the index is out of bounds,
- * the function returns without making any changes.
+ * This function deletes the note content from the database and logs the deletion
+ * event. The row is removed from the model by applyDatabaseChange() when the delete
+ * is published. If the index is out of bounds or refers to an occurrence of a
+ * recurring task (see removeRecurrence()), the function returns without making
+ * any changes.
  *
  * @param index The index of the item to be removed from the list.
  */
 void ToDoListModel::removeItemFromList(const int &index) {
-  int eventID = modelData.at(index).id;
-  DBManager::instance()->deleteNoteContent(eventID);
-  QString noteName = DBManager::instance()->getNoteName(m_noteID);
-  Logger::instance().logEvent(Logger::TASK_DELETED, noteName,
-                              modelData.at(index).itemName);
-  if (index < 0 || index >= modelData.size())
+  TRACE_SPAN(span, "qml");
+  if (index < 0 || index >= taskCount())
     return;
-  beginRemoveRows(QModelIndex(), index, index);
-  modelData.removeAt(index);
-  endRemoveRows();
+  flushPendingStatusChanges();
+  const listElement *task = taskAt(index);
+  if (!task)
+    return;
+  const int id = task->id;
+  const int noteId = m_noteID;
+  const QString itemName = textOf(task->itemName);
+  DBManager *db = DBManager::instance();
+  db->queueWrite([db, id, noteId, itemName]() {
+    if (!db->deleteNoteContent(id))
+      return false;
+    Logger::instance().logEvent(Logger::TASK_DELETED, db->getNoteName(noteId),
+                                itemName);
+    return true;
+  });
 }
 
 /**
  * @brief Toggles the completion status of a task at the specified index.
  *
- * Updates the task's status both in the local model and the database.
- * Logs the status change event and emits a signal to notify views of the data change.
+ * The task's status is updated in the local model immediately and the view is
+ * notified, but the database write is deferred: changes are coalesced per task
+ * ID and written by flushPendingStatusChanges() once no toggle has happened for
+ * statusFlushDelayMs. Toggling a task back and forth inside that window
+ * therefore costs no database work at all.
+ *
+ * An occurrence of a recurring task that is not stored yet is materialized
+ * right away instead, since it has no ID to coalesce on; its row receives
+ * the new ID from the published insert.
  *
  * @param index The index of the task in the model.
  * @param status The new completion status to set for the task.
  */
 void ToDoListModel::toggleTaskStatus(const int &index, const bool &status) {
-  int eventID = modelData.at(index).id;
-  DBManager::instance()->updateNoteContent(eventID, status);
-  QString noteName = DBManager::instance()->getNoteName(m_noteID);
-  Logger::instance().logEvent(Logger::TASK_STATUS_TOGGLED, noteName,
-                              modelData.at(index).itemName +
-                                  QString(":%1").arg(status));
-  if (index < 0 || index >= modelData.size())
+  TRACE_SPAN(span, "qml");
+  listElement *task = taskAt(index);
+  if (!task)
+    return;
+  listElement &item = *task;
+  if (item.completionStatus == status)
+    return;
+  if (item.id < 0) {
+    item.completionStatus = status;
+    rowChanged<todoStatusField>(index);
+    const QString itemName = textOf(item.itemName);
+    const int ruleId = item.ruleId;
+    const qint64 occurrenceAt = item.occurrenceAt;
+    const int noteId = m_noteID;
+    DBManager *db = DBManager::instance();
+    QPointer<ToDoListModel> model(this);
+    db->queueWrite(
+        [db, ruleId, occurrenceAt, status, noteId, itemName]() {
+          if (db->materializeOccurrence(ruleId, occurrenceAt, status) < 0)
+            return false;
+          Logger::instance().logEvent(Logger::TASK_STATUS_TOGGLED,
+                                      db->getNoteName(noteId),
+                                      itemName + QString(":%1").arg(status));
+          return true;
+        },
+        [model](bool ok) {
+          if (!ok && model)
+            model->fetchListFromDB();
+        });
+    return;
+  }
+  auto pending = m_pendingStatus.find(item.id);
+  if (pending == m_pendingStatus.end())
+    m_pendingStatus.insert(item.id,
+                           {item.completionStatus, status,
+                            textOf(item.itemName)});
+  else
+    pending->newStatus = status;
+  item.completionStatus = status;
+  rowChanged<todoStatusField>(index);
+  m_statusFlushTimer.start();
+}
+
+/**
+ * @brief Sets or clears the due date of the task at the specified index.
+ *
+ * The row updates through the published change, and ReminderScheduler picks
+ * up the new deadline the same way. Occurrences that are not stored yet have
+ * no due date of their own and are left unchanged.
+ *
+ * @param index The index of the task in the model.
+ * @param dueAt The new due date, or an invalid QDateTime to clear it.
+ */
+void ToDoListModel::setDueDate(int index, const QDateTime &dueAt) {
+  TRACE_SPAN(span, "qml");
+  const listElement *item = taskAt(index);
+  if (!item || item->id < 0)
     return;
-  modelData[index].completionStatus = status;
-  emit dataChanged(this->index(index), this->index(index), {StatusRole});
+  DBManager *db = DBManager::instance();
+  const int id = item->id;
+  const qint64 dueAtMsecs = dueAt.isValid() ? dueAt.toMSecsSinceEpoch() : -1;
+  db->queueWrite([db, id, dueAtMsecs]() {
+    return db->setNoteContentDueAt(id, dueAtMsecs);
+  });
+}
+
+/**
+ * @brief Changes the text of the task at the specified index.
+ *
+ * The edit is kept in the task's revision history and logged as TASK_UPDATED
+ * with the old and the new text separated by a newline; the row updates
+ * through the published change. Occurrences that are not stored yet take
+ * their text from the rule and are left unchanged.
+ *
+ * @param index The index of the task in the model.
+ * @param text The new text; leading and trailing whitespace is dropped.
+ */
+void ToDoListModel::setTaskText(int index, const QString &text) {
+  TRACE_SPAN(span, "qml");
+  const listElement *item = taskAt(index);
+  const QString content = text.trimmed();
+  if (!item || item->id < 0 || content.isEmpty())
+    return;
+  const QString itemName = textOf(item->itemName);
+  if (itemName == content)
+    return;
+  DBManager *db = DBManager::instance();
+  const int id = item->id;
+  const int noteId = m_noteID;
+  db->queueWrite([db, id, noteId, itemName, content]() {
+    if (!db->updateNoteContentText(id, content))
+      return false;
+    Logger::instance().logEvent(Logger::TASK_UPDATED, db->getNoteName(noteId),
+                                itemName + QLatin1Char('\n') + content);
+    return true;
+  });
+}
+
+/**
+ * @brief Adds a recurring task to the current note.
+ *
+ * Only the rule is stored; the list is refetched when the rule is published
+ * and shows the occurrences that fall in the occurrence window.
+ *
+ * @param content The text of every occurrence.
+ * @param start The first occurrence; its time of day is kept by later ones.
+ * @param frequency "DAILY", "WEEKLY" or "MONTHLY".
+ * @param interval Repeat every @p interval days, weeks or months.
+ * @param weekdays For weekly rules, bit mask of weekdays (Monday = 1 ... Sunday = 64); 0 for the start day.
+ */
+void ToDoListModel::addRecurringTask(const QString &content,
+                                     const QDateTime &start,
+                                     const QString &frequency, int interval,
+                                     int weekdays) {
+  TRACE_SPAN(span, "qml");
+  if (m_noteID < 0 || !start.isValid())
+    return;
+  DBManager *db = DBManager::instance();
+  const int noteId = m_noteID;
+  const qint64 startMsecs = start.toMSecsSinceEpoch();
+  const QString rule = frequency.toUpper();
+  db->queueWrite(
+      [db, noteId, content, startMsecs, rule, interval, weekdays]() {
+        if (db->addRecurrenceRule(noteId, content, startMsecs, rule, interval,
+                                  weekdays) < 0)
+          return false;
+        Logger::instance().logEvent(Logger::TASK_ADDED,
+                                    db->getNoteName(noteId), content);
+        return true;
+      });
+}
+
+/**
+ * @brief Stops the recurring task that the occurrence at @p index belongs to.
+ *
+ * Occurrences that were already stored are kept as ordinary tasks.
+ *
+ * @param index The index of an occurrence in the model.
+ */
+void ToDoListModel::removeRecurrence(int index) {
+  TRACE_SPAN(span, "qml");
+  if (index < m_taskCount || index >= m_rows.size())
+    return;
+  flushPendingStatusChanges();
+  const int ruleId = m_rows.at(index).ruleId;
+  const int noteId = m_noteID;
+  const QString itemName = m_texts.text(m_rows.at(index).itemName);
+  DBManager *db = DBManager::instance();
+  db->queueWrite([db, ruleId, noteId, itemName]() {
+    if (!db->deleteRecurrenceRule(ruleId))
+      return false;
+    Logger::instance().logEvent(Logger::TASK_DELETED, db->getNoteName(noteId),
+                                itemName);
+    return true;
+  });
+}
+
+/**
+ * @brief Sets the time range whose occurrences of recurring tasks are listed.
+ *
+ * @param from Start of the range (inclusive).
+ * @param to End of the range (exclusive).
+ */
+void ToDoListModel::setOccurrenceWindow(const QDateTime &from,
+                                        const QDateTime &to) {
+  if (!from.isValid() || !to.isValid() || from >= to ||
+      (from == m_windowFrom && to == m_windowTo))
+    return;
+  m_windowFrom = from;
+  m_windowTo = to;
+  m_cache->clear();
+  m_prefetchQueue.clear();
+  fetchListFromDB();
+}
+
+/**
+ * @brief Writes all pending task status changes to the database.
+ *
+ * Only tasks whose status differs from the value stored before the first
+ * pending toggle are written. All updates and their event log entries are
+ * committed in a single transaction, which DBManager::queueWrite() keeps
+ * queued while another connection holds the write lock. If the write fails,
+ * the list is reloaded so the view reflects what is actually stored.
+ */
+void ToDoListModel::flushPendingStatusChanges() {
+  TRACE_SPAN(span, "model");
+  m_statusFlushTimer.stop();
+  QVector<QPair<int, pendingStatusChange>> changes;
+  for (auto it = m_pendingStatus.cbegin(); it != m_pendingStatus.cend(); ++it)
+    if (it->newStatus != it->originalStatus)
+      changes.append({it.key(), it.value()});
+  m_pendingStatus.clear();
+  if (changes.isEmpty())
+    return;
+
+  DBManager *db = DBManager::instance();
+  const int noteId = m_noteID;
+  QPointer<ToDoListModel> model(this);
+  db->queueWrite(
+      [db, noteId, changes]() {
+        const QString noteName = db->getNoteName(noteId);
+        for (const auto &change : changes) {
+          if (!db->updateNoteContent(change.first, change.second.newStatus))
+            return false;
+          Logger::instance().logEvent(
+              Logger::TASK_STATUS_TOGGLED, noteName,
+              change.second.itemName +
+                  QString(":%1").arg(change.second.newStatus));
+        }
+        return true;
+      },
+      [model](bool ok) {
+        if (ok || !model)
+          return;
+        qDebug() << "Failed to write task status changes, reloading list";
+        model->fetchListFromDB();
+      });
 }
 /**
  * @brief Fetches the to-do list items from the database and updates the model.
@@ -166,34 +524,247 @@ void ToDoListModel::toggleTaskStatus(const int &index, const bool &status) {
  * This function retrieves the list of to-do items associated with the current note ID
  * from the database using DBManager. It resets the model, clears the existing data,
  * and populates the model with the fetched items. Each item includes its ID, content,
- * and completion status.
+ * and completion status. The task texts are stored in the model's TextArena, which
+ * is rebuilt on every fetch. The occurrences of recurring tasks in the
+ * occurrence window are appended after the ordinary tasks.
+ *
+ * Pending status changes are flushed first so the reload sees them. The task
+ * list cache is not consulted; use it through setNoteID(). A note with more
+ * than TaskWindow::windowThreshold tasks is not loaded but shown through the
+ * task window (see showWindow()).
  *
  * The model is reset before and after updating to ensure proper notification of views.
  */
 void ToDoListModel::fetchListFromDB() {
-  QList<QVariantMap> list = DBManager::instance()->getNoteContents(m_noteID);
+  TRACE_SPAN(span, "model");
+  flushPendingStatusChanges();
+  m_cache->remove(m_noteID);
+  const int count =
+      m_noteID < 0 ? 0
+                   : DBManager::instance()->countChildContents(m_noteID, -1);
+  if (count > TaskWindow::windowThreshold)
+    showWindow(count);
+  else
+    showTaskList(loadTaskList(m_noteID));
+}
+
+/**
+ * @brief Shows the current note's list, from the task list cache if possible.
+ *
+ * Called when the note ID changes. A cached list is shown without touching
+ * the database; otherwise the list is fetched.
+ */
+void ToDoListModel::showCurrentNote() {
+  TRACE_SPAN(span, "model");
+  cachedTaskList list;
+  if (m_cache->take(m_noteID, list))
+    showTaskList(std::move(list));
+  else
+    fetchListFromDB();
+}
+
+/**
+ * @brief Replaces the rows of the model with @p list.
+ *
+ * @param list The rows to show, with the arena holding their text.
+ */
+void ToDoListModel::showTaskList(cachedTaskList list) {
+  beginResetModel();
+  m_windowed = false;
+  m_window->clear();
+  m_rows = std::move(list.rows);
+  m_texts = std::move(list.texts);
+  m_compactedTexts = m_texts.size();
+  m_taskCount = list.taskCount;
+  endResetModel();
+}
+
+/**
+ * @brief Shows the current note through the task window.
+ *
+ * Only the number of tasks is known up front; rows are fetched page by page
+ * as views read them.
+ *
+ * @param count Number of ordinary tasks of the note.
+ */
+void ToDoListModel::showWindow(int count) {
   beginResetModel();
-  modelData.clear();
+  m_rows.clear();
+  m_texts.clear();
+  m_compactedTexts = 0;
+  m_taskCount = 0;
+  m_windowed = true;
+  m_window->reset(m_noteID, count);
+  endResetModel();
+}
+
+/**
+ * @brief Returns the number of rows held in memory, which is below rowCount() for a windowed note.
+ */
+int ToDoListModel::residentRowCount() const {
+  return m_windowed ? m_window->residentRows() : m_rows.size();
+}
+
+/**
+ * @brief Reads the list of a note from the database.
+ *
+ * @param noteId The note.
+ * @return Its ordinary tasks followed by the occurrences in the occurrence window.
+ */
+cachedTaskList ToDoListModel::loadTaskList(int noteId) const {
+  TRACE_SPAN(span, "model");
+  const QList<QVariantMap> list = DBManager::instance()->getNoteContents(noteId);
+  cachedTaskList result;
+  result.rows.reserve(list.size());
   for (const auto &a : list) {
     listElement element;
     element.id = a["id"].toInt();
-    element.itemName = a["content"].toString();
+    element.itemName = result.texts.append(a["content"].toString());
     element.completionStatus = a["completed"].toBool();
-    modelData.append(element);
+    element.sortKey = result.texts.append(a["sort_key"].toString());
+    element.dueAt = a["due_at"].isNull() ? -1 : a["due_at"].toLongLong();
+    element.ruleId = -1;
+    element.occurrenceAt = -1;
+    result.rows.append(element);
   }
-  endResetModel();
+  result.taskCount = result.rows.size();
+  appendOccurrences(result, noteId);
+  return result;
+}
+
+/**
+ * @brief Copies the shown rows into a list that owns only their text.
+ *
+ * The model's arena also holds the text of rows removed or renamed since the
+ * last fetch; the copy leaves it behind so the cache does not pay for it.
+ *
+ * @return The shown list.
+ */
+cachedTaskList ToDoListModel::snapshotTaskList() const {
+  cachedTaskList result;
+  result.rows.reserve(m_rows.size());
+  for (listElement element : m_rows) {
+    element.itemName = result.texts.append(m_texts.view(element.itemName));
+    element.sortKey = result.texts.append(m_texts.view(element.sortKey));
+    result.rows.append(element);
+  }
+  result.taskCount = m_taskCount;
+  return result;
+}
+
+/**
+ * @brief Appends the occurrences of the note's recurring tasks in the occurrence window.
+ *
+ * Occurrences are computed from the rules; the ones that were materialized
+ * replace their computed counterpart so they show their stored ID and status.
+ *
+ * @param list The list of the note, receiving the occurrences.
+ * @param noteId The note.
+ */
+void ToDoListModel::appendOccurrences(cachedTaskList &list, int noteId) const {
+  DBManager *db = DBManager::instance();
+  const QList<QVariantMap> rules = db->getRecurrenceRules(noteId);
+  if (rules.isEmpty())
+    return;
+  QHash<QPair<int, qint64>, QVariantMap> stored;
+  for (const QVariantMap &content : db->getOccurrenceContents(
+           noteId, m_windowFrom.toMSecsSinceEpoch(),
+           m_windowTo.toMSecsSinceEpoch()))
+    stored.insert({content["rule_id"].toInt(),
+                   content["occurrence_at"].toLongLong()},
+                  content);
+
+  QVector<listElement> occurrences;
+  for (const QVariantMap &map : rules) {
+    const RecurrenceRule rule = RecurrenceRule::fromMap(map);
+    const TextRef name = list.texts.append(rule.content);
+    for (const QDateTime &at : rule.occurrences(m_windowFrom, m_windowTo)) {
+      listElement element;
+      element.id = -1;
+      element.itemName = name;
+      element.completionStatus = false;
+      element.sortKey = TextRef{0, 0};
+      element.dueAt = -1;
+      element.ruleId = rule.ruleId;
+      element.occurrenceAt = at.toMSecsSinceEpoch();
+      const auto it = stored.constFind({rule.ruleId, element.occurrenceAt});
+      if (it != stored.cend()) {
+        element.id = it->value("id").toInt();
+        element.itemName = list.texts.append(it->value("content").toString());
+        element.completionStatus = it->value("completed").toBool();
+        element.dueAt =
+            it->value("due_at").isNull() ? -1 : it->value("due_at").toLongLong();
+      }
+      occurrences.append(element);
+    }
+  }
+  std::sort(occurrences.begin(), occurrences.end(),
+            [](const listElement &a, const listElement &b) {
+              return a.occurrenceAt != b.occurrenceAt
+                         ? a.occurrenceAt < b.occurrenceAt
+                         : a.ruleId < b.ruleId;
+            });
+  list.rows += occurrences;
+}
+
+/**
+ * @brief Queues notes whose lists are read into the task list cache while the application is idle.
+ *
+ * One note is read per prefetch tick so the GUI thread is never blocked for
+ * long. Notes that are shown or cached already and notes too large to load
+ * (see TaskWindow) are skipped, and prefetching stops once the cache is full
+ * rather than evicting recently viewed lists.
+ *
+ * @param noteIds The notes, most likely to be opened first.
+ */
+void ToDoListModel::prefetchNotes(const QVariantList &noteIds) {
+  m_prefetchQueue.clear();
+  for (const QVariant &id : noteIds)
+    m_prefetchQueue.append(id.toInt());
+  if (!m_prefetchQueue.isEmpty())
+    m_prefetchTimer.start();
+}
+
+/**
+ * @brief Reads the next queued note into the task list cache.
+ */
+void ToDoListModel::prefetchNext() {
+  TRACE_SPAN(span, "model");
+  while (!m_prefetchQueue.isEmpty()) {
+    const int noteId = m_prefetchQueue.takeFirst();
+    if (noteId < 0 || noteId == m_noteID || m_cache->contains(noteId) ||
+        DBManager::instance()->countChildContents(noteId, -1) >
+            TaskWindow::windowThreshold)
+      continue;
+    cachedTaskList list = loadTaskList(noteId);
+    if (!m_cache->fits(list.byteSize()))
+      m_prefetchQueue.clear();
+    else
+      m_cache->insert(noteId, std::move(list));
+    break;
+  }
+  if (m_prefetchQueue.isEmpty())
+    m_prefetchTimer.stop();
 }
 
 /**
  * @brief Sets the note ID for the ToDoListModel.
  *
  * If the provided value is different from the current note ID,
- * updates the note ID and emits the noteIDChanged() signal.
+ * flushes pending status changes and any scheduled key rebalance of the current note, keeps its list
+ * in the task list cache, updates the note ID and emits the noteIDChanged() signal.
  *
  * @param val The new note ID to set.
  */
 void ToDoListModel::setNoteID(const int &val) {
   if (val != m_noteID) {
+    flushPendingStatusChanges();
+    if (m_rebalanceTimer.isActive()) {
+      m_rebalanceTimer.stop();
+      rebalanceSortKeys();
+    }
+    if (m_noteID >= 0 && !m_windowed)
+      m_cache->insert(m_noteID, snapshotTaskList());
     m_noteID = val;
     emit noteIDChanged();
   }
@@ -205,3 +776,421 @@ void ToDoListModel::setNoteID(const int &val) {
  * @return Reference to the integer representing the note ID.
  */
 const int &ToDoListModel::getNoteID() { return m_noteID; }
+
+/**
+ * @brief Applies a committed database change to the model.
+ *
+ * Top-level tasks inserted into the current note are appended after the other
+ * ordinary tasks (sub-tasks are shown by TaskTreeModel only), materialized
+ * occurrences take over their computed row, status and text updates are
+ * copied into the matching row, reordered tasks are moved and deleted tasks
+ * are removed (a deleted occurrence falls back to its computed row), each
+ * with the narrowest model notification. Changed recurrence rules of the
+ * current note reload the list, as do tasks another process changed in the
+ * current note (or deleted anywhere, if the number of tasks changed). Rows
+ * with a pending (not yet flushed) status change keep their in-memory
+ * status. Windowed notes are handled by applyWindowedChange().
+ *
+ * @param event The change published by DBManager.
+ */
+void ToDoListModel::applyDatabaseChange(const DBChangeEvent &event) {
+  if (event.table == DBChangeEvent::RecurrenceRules) {
+    if (event.noteId == m_noteID)
+      fetchListFromDB();
+    return;
+  }
+  if (event.table != DBChangeEvent::NotesContents)
+    return;
+  if (event.operation == DBChangeEvent::Reloaded) {
+    if (m_noteID >= 0 &&
+        (event.noteId == m_noteID ||
+         (event.noteId < 0 &&
+          DBManager::instance()->countChildContents(m_noteID, -1) !=
+              taskCount())))
+      fetchListFromDB();
+    return;
+  }
+  if (m_windowed) {
+    applyWindowedChange(event);
+    return;
+  }
+  switch (event.operation) {
+  case DBChangeEvent::Inserted: {
+    if (event.noteId != m_noteID ||
+        event.values.value("parent_id", -1).toInt() >= 0)
+      return;
+    if (event.values.contains("rule_id")) {
+      const int ruleId = event.values.value("rule_id").toInt();
+      const qint64 occurrenceAt =
+          event.values.value("occurrence_at").toLongLong();
+      for (int row = m_taskCount; row < m_rows.size(); ++row) {
+        listElement &item = m_rows[row];
+        if (item.ruleId != ruleId || item.occurrenceAt != occurrenceAt)
+          continue;
+        item.id = event.rowId;
+        item.completionStatus = event.values.value("completed").toBool();
+        rowChanged<todoIdField, todoStatusField>(row);
+        break;
+      }
+      return;
+    }
+    listElement element;
+    element.id = event.rowId;
+    element.itemName = m_texts.append(event.values.value("content").toString());
+    element.completionStatus = event.values.value("completed").toBool();
+    element.sortKey = m_texts.append(event.values.value("sort_key").toString());
+    element.dueAt = -1;
+    element.ruleId = -1;
+    element.occurrenceAt = -1;
+    insertRowAt(m_taskCount++, element);
+    compactTexts();
+    break;
+  }
+  case DBChangeEvent::Updated: {
+    if (event.values.contains("sort_key")) {
+      if (event.rowId < 0) {
+        if (event.noteId == m_noteID)
+          reloadSortKeys();
+        return;
+      }
+      int row = rowForId(event.rowId);
+      const QString sortKey = event.values.value("sort_key").toString();
+      if (row >= 0 && row < m_taskCount && sortKeyAt(row) != sortKey)
+        moveToSortedPosition(row, sortKey);
+      return;
+    }
+    if (event.values.contains("due_at")) {
+      int row = rowForId(event.rowId);
+      if (row < 0)
+        return;
+      m_rows[row].dueAt = event.values.value("due_at").toLongLong();
+      rowChanged<todoDueAtField>(row);
+      return;
+    }
+    if (event.values.contains("content")) {
+      int row = rowForId(event.rowId);
+      if (row < 0)
+        return;
+      m_rows[row].itemName =
+          m_texts.append(event.values.value("content").toString());
+      rowChanged<todoNameField>(row);
+      compactTexts();
+      return;
+    }
+    int row = rowForId(event.rowId);
+    if (row < 0 || m_pendingStatus.contains(event.rowId) ||
+        !event.values.contains("completed"))
+      return;
+    bool completed = event.values.value("completed").toBool();
+    if (m_rows.at(row).completionStatus == completed)
+      return;
+    m_rows[row].completionStatus = completed;
+    rowChanged<todoStatusField>(row);
+    break;
+  }
+  case DBChangeEvent::Deleted: {
+    if (event.rowId < 0) {
+      if (event.noteId == m_noteID && !m_rows.isEmpty()) {
+        // Computed occurrences survive; reload to drop the stored ones.
+        m_pendingStatus.clear();
+        fetchListFromDB();
+      }
+      return;
+    }
+    int row = rowForId(event.rowId);
+    if (row < 0)
+      return;
+    m_pendingStatus.remove(event.rowId);
+    if (row >= m_taskCount) {
+      listElement &item = m_rows[row];
+      item.id = -1;
+      item.completionStatus = false;
+      item.dueAt = -1;
+      rowChanged<todoIdField, todoStatusField, todoDueAtField>(row);
+      return;
+    }
+    --m_taskCount;
+    removeRowAt(row);
+    break;
+  }
+  case DBChangeEvent::Reloaded:
+    break; // Handled above
+  }
+}
+
+/**
+ * @brief Applies a committed database change to a windowed note.
+ *
+ * Status, due date and text updates are copied into resident rows; rows
+ * that are not resident are read fresh when their page is fetched. An inserted task
+ * is appended and a deleted resident task is removed, dropping the pages
+ * from that row on. Key changes made by moveWindowedRows() are already
+ * applied; any other reorder drops every page, as does a task deleted
+ * outside the resident pages if the number of tasks changed.
+ *
+ * @param event The change published by DBManager.
+ */
+void ToDoListModel::applyWindowedChange(const DBChangeEvent &event) {
+  switch (event.operation) {
+  case DBChangeEvent::Inserted: {
+    if (event.noteId != m_noteID ||
+        event.values.value("parent_id", -1).toInt() >= 0 ||
+        event.values.contains("rule_id"))
+      return;
+    const int row = m_window->count();
+    beginInsertRows(QModelIndex(), row, row);
+    m_window->setCount(row + 1);
+    m_window->invalidateFrom(row);
+    endInsertRows();
+    break;
+  }
+  case DBChangeEvent::Updated: {
+    if (event.rowId < 0) {
+      if (event.noteId == m_noteID && event.values.contains("sort_key"))
+        reloadSortKeys();
+      return;
+    }
+    const int row = m_window->residentRowForId(event.rowId);
+    listElement *item = m_window->residentRow(row);
+    if (event.values.contains("sort_key")) {
+      if (!item || m_window->text(item->sortKey) !=
+                       event.values.value("sort_key").toString())
+        invalidateWindow();
+      return;
+    }
+    if (!item)
+      return;
+    if (event.values.contains("due_at")) {
+      item->dueAt = event.values.value("due_at").toLongLong();
+      rowChanged<todoDueAtField>(row);
+      return;
+    }
+    if (event.values.contains("content")) {
+      item->itemName =
+          m_window->appendText(event.values.value("content").toString());
+      rowChanged<todoNameField>(row);
+      return;
+    }
+    if (m_pendingStatus.contains(event.rowId) ||
+        !event.values.contains("completed"))
+      return;
+    item->completionStatus = event.values.value("completed").toBool();
+    rowChanged<todoStatusField>(row);
+    break;
+  }
+  case DBChangeEvent::Deleted: {
+    if (event.rowId < 0) {
+      if (event.noteId == m_noteID) {
+        m_pendingStatus.clear();
+        fetchListFromDB();
+      }
+      return;
+    }
+    m_pendingStatus.remove(event.rowId);
+    const int row = m_window->residentRowForId(event.rowId);
+    if (row < 0) {
+      if (DBManager::instance()->countChildContents(m_noteID, -1) !=
+          m_window->count())
+        fetchListFromDB();
+      return;
+    }
+    beginRemoveRows(QModelIndex(), row, row);
+    m_window->removeRow(row);
+    endRemoveRows();
+    break;
+  }
+  case DBChangeEvent::Reloaded:
+    break; // Handled by applyDatabaseChange()
+  }
+}
+
+/**
+ * @brief Drops every page of a windowed note and tells views that any row may have changed.
+ */
+void ToDoListModel::invalidateWindow() {
+  m_window->invalidateFrom(0);
+  if (m_window->count() > 0)
+    emit dataChanged(index(0), index(m_window->count() - 1));
+}
+
+/**
+ * @brief Moves tasks of a windowed note (see moveRows()).
+ *
+ * The new keys are stored in the resident rows before they are written, so
+ * the published key changes are recognised as already applied. The pages
+ * from the first affected row on are dropped once the move is committed.
+ *
+ * @return true if the rows were moved, false otherwise.
+ */
+bool ToDoListModel::moveWindowedRows(int sourceRow, int count,
+                                     int destinationChild) {
+  const QString after = destinationChild < m_window->count()
+                            ? sortKeyAt(destinationChild)
+                            : QString();
+  QString previous = destinationChild > 0 ? sortKeyAt(destinationChild - 1)
+                                          : QString();
+  QVector<int> ids;
+  QStringList keys;
+  bool needsRebalance = false;
+  for (int i = 0; i < count; ++i) {
+    listElement *item = m_window->row(sourceRow + i);
+    if (!item)
+      return false;
+    previous = OrderKey::between(previous, after);
+    item->sortKey = m_window->appendText(previous);
+    ids.append(item->id);
+    keys.append(previous);
+    needsRebalance =
+        needsRebalance || previous.size() > OrderKey::rebalanceLength;
+  }
+
+  if (!writeSortKeys(ids, keys))
+    return false;
+  beginMoveRows(QModelIndex(), sourceRow, sourceRow + count - 1, QModelIndex(),
+                destinationChild);
+  m_window->invalidateFrom(qMin(sourceRow, destinationChild));
+  endMoveRows();
+  if (needsRebalance)
+    m_rebalanceTimer.start();
+  return true;
+}
+
+/**
+ * @brief Returns the row of the task with the given ID, or -1 if it is not in the model.
+ */
+int ToDoListModel::rowForId(int id) const {
+  if (id < 0)
+    return -1;
+  for (int row = 0; row < m_rows.size(); ++row)
+    if (m_rows.at(row).id == id)
+      return row;
+  return -1;
+}
+
+/**
+ * @brief Returns the ordering key of the task at @p row.
+ */
+QString ToDoListModel::sortKeyAt(int row) const {
+  if (m_windowed) {
+    const listElement *item = m_window->row(row);
+    return item ? m_window->text(item->sortKey) : QString();
+  }
+  return m_texts.text(m_rows.at(row).sortKey);
+}
+
+/**
+ * @brief Returns the number of ordinary tasks of the current note.
+ */
+int ToDoListModel::taskCount() const {
+  return m_windowed ? m_window->count() : m_taskCount;
+}
+
+/**
+ * @brief Returns the row at @p row, fetching its page for a windowed note, or nullptr if out of range.
+ */
+listElement *ToDoListModel::taskAt(int row) {
+  if (m_windowed)
+    return m_window->row(row);
+  if (row < 0 || row >= m_rows.size())
+    return nullptr;
+  return &m_rows[row];
+}
+
+/**
+ * @brief Returns the text of a row of the current note.
+ */
+QString ToDoListModel::textOf(const TextRef &ref) const {
+  return m_windowed ? m_window->text(ref) : m_texts.text(ref);
+}
+
+/**
+ * @brief Moves a task whose ordering key was changed elsewhere to its new position.
+ *
+ * @param row Current row of the task.
+ * @param sortKey Its new ordering key.
+ */
+void ToDoListModel::moveToSortedPosition(int row, const QString &sortKey) {
+  // Binary search over the other ordinary tasks, which are still sorted.
+  int low = 0;
+  int high = m_taskCount - 1;
+  while (low < high) {
+    const int middle = (low + high) / 2;
+    if (sortKeyAt(middle < row ? middle : middle + 1) < sortKey)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  m_rows[row].sortKey = m_texts.append(sortKey);
+  moveRowTo(row, low);
+  compactTexts();
+}
+
+/**
+ * @brief Re-reads the ordering keys after the note's keys were rebalanced.
+ *
+ * The order does not change, so views are not notified unless the list no
+ * longer matches the database, in which case it is reloaded. A windowed note
+ * just drops its pages. The keys go into a fresh arena together with the
+ * task names, which leaves the old keys and any dropped text behind.
+ */
+void ToDoListModel::reloadSortKeys() {
+  if (m_windowed) {
+    m_window->invalidateFrom(0);
+    return;
+  }
+  const QList<QVariantMap> list =
+      DBManager::instance()->getNoteContents(m_noteID);
+  if (list.size() != m_taskCount) {
+    fetchListFromDB();
+    return;
+  }
+  for (int row = 0; row < list.size(); ++row) {
+    if (list.at(row)["id"].toInt() != m_rows.at(row).id) {
+      fetchListFromDB();
+      return;
+    }
+  }
+  TextArena texts;
+  texts.reserve(m_texts.size());
+  for (int row = 0; row < m_rows.size(); ++row) {
+    listElement &element = m_rows[row];
+    element.itemName = texts.append(m_texts.view(element.itemName));
+    element.sortKey =
+        row < list.size()
+            ? texts.append(list.at(row)["sort_key"].toString())
+            : texts.append(m_texts.view(element.sortKey));
+  }
+  m_texts = std::move(texts);
+  m_compactedTexts = m_texts.size();
+}
+
+/**
+ * @brief Copies the text of the rows into a fresh arena once the arena has doubled since the last load.
+ *
+ * Renames, inserts and moves append new text and leave the old text in the
+ * arena. Compacting after the arena doubles keeps it below about twice the
+ * live text at an amortized constant cost per change.
+ */
+void ToDoListModel::compactTexts() {
+  if (m_texts.size() < 2 * m_compactedTexts + compactSlackChars)
+    return;
+  TextArena texts;
+  for (listElement &element : m_rows) {
+    element.itemName = texts.append(m_texts.view(element.itemName));
+    element.sortKey = texts.append(m_texts.view(element.sortKey));
+  }
+  m_texts = std::move(texts);
+  m_compactedTexts = m_texts.size();
+}
+
+/**
+ * @brief Rewrites the ordering keys of the current note once they have grown long.
+ */
+void ToDoListModel::rebalanceSortKeys() {
+  if (m_noteID < 0)
+    return;
+  DBManager *db = DBManager::instance();
+  const int noteId = m_noteID;
+  db->queueWrite(
+      [db, noteId]() { return db->rebalanceNoteContentSortKeys(noteId); });
+}
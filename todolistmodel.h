@@ -1,67 +1,180 @@
 #ifndef TODOLISTMODEL_H
 #define TODOLISTMODEL_H
 
-#include <QAbstractListModel>
+#include "dbchangeevent.h"
+#include "rowlistmodel.h"
+#include "textarena.h"
+#include <QDateTime>
+#include <QHash>
 #include <QObject>
+#include <QTimer>
 #include <QVector>
 /**
  * @struct listElement
  * @brief Represents a single item in the to-do list.
  *
  * This structure holds the information for a to-do list element,
- * including its unique identifier, name, and completion status.
+ * including its unique identifier, name, and completion status. The name
+ * lives in the owning model's TextArena, so the struct itself is a small
+ * fixed-size value stored contiguously in the model's vector.
  *
  * @var listElement::id
  * Unique identifier for the to-do list item.
  *
  * @var listElement::itemName
- * Name or description of the to-do list item.
+ * Name or description of the to-do list item, stored in the model's TextArena.
  *
  * @var listElement::completionStatus
  * Indicates whether the item has been completed (true) or not (false).
+ *
+ * @var listElement::sortKey
+ * Ordering key of the item (see OrderKey), stored in the model's TextArena.
+ *
+ * @var listElement::dueAt
+ * Due date in epoch milliseconds, or -1 if the item has none.
+ *
+ * @var listElement::ruleId
+ * Recurrence rule the item is an occurrence of, or -1 for an ordinary task.
+ * Occurrences that are not stored yet have an id of -1.
+ *
+ * @var listElement::occurrenceAt
+ * Time of the occurrence in epoch milliseconds, or -1 for an ordinary task.
  */
 struct listElement {
   int id;
-  QString itemName;
+  TextRef itemName;
   bool completionStatus;
+  TextRef sortKey;
+  qint64 dueAt;
+  int ruleId;
+  qint64 occurrenceAt;
+};
+
+/**
+ * @struct pendingStatusChange
+ * @brief A task status change that has been applied in memory but not yet written to the database.
+ *
+ * @var pendingStatusChange::originalStatus
+ * Status stored in the database before the first pending toggle.
+ *
+ * @var pendingStatusChange::newStatus
+ * Latest status requested by the user.
+ *
+ * @var pendingStatusChange::itemName
+ * Name of the task, used for the event log entry.
+ */
+struct pendingStatusChange {
+  bool originalStatus;
+  bool newStatus;
+  QString itemName;
+};
+
+class ToDoListModel;
+class TaskListCache;
+class TaskWindow;
+struct cachedTaskList;
+
+/**
+ * @brief Fields of ToDoListModel, one per role (see RowListModel).
+ */
+struct todoIdField {
+  static constexpr const char *name = "id";
+  static QVariant get(const ToDoListModel &, const listElement &row);
+};
+struct todoNameField {
+  static constexpr const char *name = "ItemName";
+  static QVariant get(const ToDoListModel &model, const listElement &row);
+};
+struct todoStatusField {
+  static constexpr const char *name = "StatusRole";
+  static QVariant get(const ToDoListModel &, const listElement &row);
+};
+struct todoDueAtField {
+  static constexpr const char *name = "dueAt";
+  static QVariant get(const ToDoListModel &, const listElement &row);
+};
+struct todoOccurrenceAtField {
+  static constexpr const char *name = "occurrenceAt";
+  static QVariant get(const ToDoListModel &, const listElement &row);
+};
+struct todoRecurringField {
+  static constexpr const char *name = "recurring";
+  static QVariant get(const ToDoListModel &, const listElement &row);
 };
 
+using todoListBase =
+    RowListModel<ToDoListModel, listElement, todoIdField, todoNameField,
+                 todoStatusField, todoDueAtField, todoOccurrenceAtField,
+                 todoRecurringField>;
+
 /**
  * @class ToDoListModel
  * @brief Model class for managing a list of to-do items in a Qt MVC application.
  *
- * Inherits from QAbstractListModel and provides an interface for storing,
+ * Inherits from RowListModel and provides an interface for storing,
  * retrieving, and manipulating to-do list items. Supports custom roles for
- * item ID, name, and status. Exposes methods for adding, removing, toggling
- * task status, and fetching data from a database. Integrates with Qt's
+ * item ID, name, and status, generated from the todo*Field types. Exposes methods for adding, removing, toggling
+ * task status, and fetching data from a database.
+ *
+ * The ordinary tasks of the note come first, in their user-defined order.
+ * They are followed by the occurrences of the note's recurring tasks that fall
+ * in the occurrence window (today and the next six days by default), in time
+ * order. Occurrences are computed from their RecurrenceRule when the list is
+ * fetched and only stored once the user toggles them. The lists of recently
+ * shown and prefetched notes are kept in a TaskListCache, so switching back to
+ * them does not read the database. Notes with more than
+ * TaskWindow::windowThreshold tasks are shown through a TaskWindow instead,
+ * which keeps only the pages around the viewport in memory; recurring tasks
+ * are not listed for them. Integrates with Qt's
  * meta-object system for use in QML and signal-slot communication.
  *
  * @note This class is intended to be used as the model in a Model-View-Controller
  * (MVC) pattern, typically with a QListView or similar view component.
  *
- * @see QAbstractListModel
+ * @see RowListModel
  */
-class ToDoListModel : public QAbstractListModel {
+class ToDoListModel : public todoListBase {
   Q_OBJECT
 public:
   explicit ToDoListModel(QObject *parent = nullptr);
   virtual ~ToDoListModel();
-  enum roleEnums { IdRole = Qt::UserRole + 1, ItemNameRole, StatusRole };
+  enum roleEnums {
+    IdRole = roleOf<todoIdField>(),
+    ItemNameRole = roleOf<todoNameField>(),
+    StatusRole = roleOf<todoStatusField>(),
+    DueAtRole = roleOf<todoDueAtField>(),
+    OccurrenceAtRole = roleOf<todoOccurrenceAtField>(),
+    RecurringRole = roleOf<todoRecurringField>()
+  };
   Q_ENUM(roleEnums);
-  Q_INVOKABLE virtual int
-  rowCount(const QModelIndex &parent = QModelIndex()) const override;
-  Q_INVOKABLE virtual QVariant data(const QModelIndex &index,
-                                    int role = Qt::DisplayRole) const override;
+  int viewRowCount() const;
+  const listElement *viewRow(int row) const;
   Q_INVOKABLE virtual QVariant
   headerData(int section, Qt::Orientation orientation,
              int role = Qt::DisplayRole) const override;
-  Q_INVOKABLE virtual QHash<int, QByteArray> roleNames() const override;
+  bool moveRows(const QModelIndex &sourceParent, int sourceRow, int count,
+                const QModelIndex &destinationParent,
+                int destinationChild) override;
+  Q_INVOKABLE bool moveItem(int from, int to);
   Q_INVOKABLE void addItemToList(const QString &data);
   Q_INVOKABLE void removeItemFromList(const int &index);
 
   Q_INVOKABLE void toggleTaskStatus(const int &index, const bool &status);
+  Q_INVOKABLE void setDueDate(int index, const QDateTime &dueAt);
+  Q_INVOKABLE void setTaskText(int index, const QString &text);
+
+  Q_INVOKABLE void addRecurringTask(const QString &content,
+                                    const QDateTime &start,
+                                    const QString &frequency, int interval = 1,
+                                    int weekdays = 0);
+  Q_INVOKABLE void removeRecurrence(int index);
+  Q_INVOKABLE void setOccurrenceWindow(const QDateTime &from,
+                                       const QDateTime &to);
 
   Q_INVOKABLE void fetchListFromDB();
+  Q_INVOKABLE void prefetchNotes(const QVariantList &noteIds);
+  Q_INVOKABLE void flushPendingStatusChanges();
+  int residentRowCount() const;
 
 public slots:
   void setNoteID(const int &val);
@@ -70,9 +183,52 @@ public slots:
 signals:
   void noteIDChanged();
 
+private slots:
+  void applyDatabaseChange(const DBChangeEvent &event);
+  void rebalanceSortKeys();
+  void showCurrentNote();
+  void prefetchNext();
+
 private:
-  QVector<listElement> modelData;
+  friend struct todoNameField;
+
+  int rowForId(int id) const;
+  int taskCount() const;
+  listElement *taskAt(int row);
+  QString textOf(const TextRef &ref) const;
+  QString sortKeyAt(int row) const;
+  void moveToSortedPosition(int row, const QString &sortKey);
+  void reloadSortKeys();
+  void compactTexts();
+  cachedTaskList loadTaskList(int noteId) const;
+  cachedTaskList snapshotTaskList() const;
+  void showTaskList(cachedTaskList list);
+  void appendOccurrences(cachedTaskList &list, int noteId) const;
+  void showWindow(int count);
+  bool moveWindowedRows(int sourceRow, int count, int destinationChild);
+  bool writeSortKeys(const QVector<int> &ids, const QStringList &keys);
+  void applyWindowedChange(const DBChangeEvent &event);
+  void invalidateWindow();
+
+  static constexpr int statusFlushDelayMs = 300;
+  static constexpr int rebalanceDelayMs = 2000;
+  static constexpr int prefetchIntervalMs = 20;
+  static constexpr int compactSlackChars = 4096;
+
+  TaskListCache *m_cache;
+  TaskWindow *m_window;
+  bool m_windowed;
+  TextArena m_texts;
   int m_noteID;
+  int m_taskCount;
+  int m_compactedTexts;
+  QDateTime m_windowFrom;
+  QDateTime m_windowTo;
+  QHash<int, pendingStatusChange> m_pendingStatus;
+  QTimer m_statusFlushTimer;
+  QTimer m_rebalanceTimer;
+  QList<int> m_prefetchQueue;
+  QTimer m_prefetchTimer;
 };
 
 #endif // TODOLISTMODEL_H
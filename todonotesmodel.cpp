@@ -1,59 +1,42 @@
 #include "todonotesmodel.h"
 #include "dbmanager.h"
 #include "logger.h"
+#include "orderkey.h"
+#include "tracer.h"
+#include "workspaceregistry.h"
 #include <QDateTime>
+#include <QPointer>
 TODONotesModel::TODONotesModel(QAbstractListModel *parent)
-    : QAbstractListModel{parent} {
+    : todoNotesBase{parent} {
   Q_UNUSED(parent)
+  m_rebalanceTimer.setSingleShot(true);
+  m_rebalanceTimer.setInterval(rebalanceDelayMs);
+  QObject::connect(&m_rebalanceTimer, &QTimer::timeout, this,
+                   &TODONotesModel::rebalanceSortKeys);
+  QObject::connect(&WorkspaceRegistry::instance(),
+                   &WorkspaceRegistry::currentWorkspaceChanged, this,
+                   &TODONotesModel::fetchAllNotesFromDB);
+  QObject::connect(&WorkspaceRegistry::instance(), &WorkspaceRegistry::changed,
+                   this, &TODONotesModel::applyDatabaseChange);
 }
 
 TODONotesModel::~TODONotesModel() {}
 
 /**
- * @brief Returns the number of rows in the model.
- *
- * This function provides the number of items in the model, which is used by views
- * to determine how many rows to display. If the given parent index is valid,
- * indicating a request for child items, the function returns 0, as this model
- * does not support hierarchical data.
- *
- * @param parent The parent index. If valid, indicates a request for child items.
- * @return The number of rows in the model, or 0 if the parent index is valid.
+ * @brief Role accessors of TODONotesModel.
  */
-int TODONotesModel::rowCount(const QModelIndex &parent) const {
-  if (parent.isValid())
-    return 0;
-  return modelData.count();
+QVariant noteIdField::get(const TODONotesModel &, const notesElement &row) {
+  return row.id;
 }
 
-/**
- * @brief Returns the data stored under the given role for the item referred to by the index.
- *
- * This function retrieves the data for a specific row and role from the model.
- * It checks if the index is valid and within bounds, then returns the corresponding
- * value from the notesElement item. Supported roles include noteIDRole, ItemNameRole,
- * and TimeStampRole.
- *
- * @param index The QModelIndex specifying the row and column of the item.
- * @param role The role for which the data is requested.
- * @return QVariant containing the requested data, or an invalid QVariant if the index is not valid or the role is not recognized.
- */
-QVariant TODONotesModel::data(const QModelIndex &index, int role) const {
-  if (!index.isValid() || index.row() >= modelData.count()) {
-    return 0;
-  }
-  notesElement item = modelData.at(index.row());
-  switch (role) {
-  case noteIDRole:
-    return item.id;
-  case ItemNameRole:
-    return item.itemName;
-  case TimeStampRole:
-    return item.creationTime;
-  default:
-    return QVariant();
-    break;
-  }
+QVariant noteNameField::get(const TODONotesModel &model,
+                            const notesElement &row) {
+  return model.m_noteNames.at(row.itemName);
+}
+
+QVariant noteCreatedAtField::get(const TODONotesModel &,
+                                 const notesElement &row) {
+  return row.creationTime;
 }
 
 /**
@@ -85,65 +68,144 @@ QVariant TODONotesModel::headerData(int section, Qt::Orientation orientation,
 }
 
 /**
- * @brief Returns a hash mapping custom role integers to their corresponding names for the model.
+ * @brief Moves notes to another position in the list.
+ *
+ * Works like ToDoListModel::moveRows(): the rows are moved in memory, then
+ * each moved note gets a new ordering key between its new neighbours, so
+ * only the moved rows are written. Long keys trigger a deferred rebalance.
  *
- * This function defines the role names used in the TODONotesModel, which are utilized
- * for data retrieval in views and delegates. The roles include:
- * - noteIDRole: Maps to "NoteID"
- * - ItemNameRole: Maps to "NoteName"
- * - TimeStampRole: Maps to "CreatedAt"
+ * @param sourceParent Must be invalid (flat list).
+ * @param sourceRow First row to move.
+ * @param count Number of rows to move.
+ * @param destinationParent Must be invalid (flat list).
+ * @param destinationChild Row before which the rows are inserted, counted before the move.
+ * @return true if the rows were moved, false otherwise.
+ */
+bool TODONotesModel::moveRows(const QModelIndex &sourceParent, int sourceRow,
+                              int count, const QModelIndex &destinationParent,
+                              int destinationChild) {
+  if (sourceParent.isValid() || destinationParent.isValid() || count <= 0 ||
+      sourceRow < 0 || sourceRow + count > m_rows.size() ||
+      destinationChild < 0 || destinationChild > m_rows.size() ||
+      (destinationChild >= sourceRow && destinationChild <= sourceRow + count))
+    return false;
+  const QString after = destinationChild < m_rows.size()
+                            ? m_rows.at(destinationChild).sortKey
+                            : QString();
+  QString previous =
+      destinationChild > 0 ? m_rows.at(destinationChild - 1).sortKey
+                           : QString();
+  bool needsRebalance = false;
+  for (int i = 0; i < count; ++i) {
+    previous = OrderKey::between(previous, after);
+    m_rows[sourceRow + i].sortKey = previous;
+    needsRebalance =
+        needsRebalance || previous.size() > OrderKey::rebalanceLength;
+  }
+
+  beginMoveRows(QModelIndex(), sourceRow, sourceRow + count - 1, QModelIndex(),
+                destinationChild);
+  const QVector<notesElement> moved = m_rows.mid(sourceRow, count);
+  m_rows.remove(sourceRow, count);
+  const int target =
+      destinationChild > sourceRow ? destinationChild - count : destinationChild;
+  for (int i = 0; i < count; ++i)
+    m_rows.insert(target + i, moved.at(i));
+  endMoveRows();
+
+  DBManager *db = DBManager::instance();
+  QPointer<TODONotesModel> model(this);
+  const bool ok = db->queueWrite(
+      [db, moved]() {
+        for (const notesElement &note : moved)
+          if (!db->setNoteSortKey(note.id, note.sortKey))
+            return false;
+        return true;
+      },
+      [model](bool ok) {
+        if (ok || !model)
+          return;
+        qDebug() << "Failed to write note order, reloading notes";
+        model->fetchAllNotesFromDB();
+      });
+  if (!ok)
+    return false;
+  if (needsRebalance)
+    m_rebalanceTimer.start();
+  return true;
+}
+
+/**
+ * @brief Moves one note so that it ends up at row @p to (drag-and-drop from QML).
  *
- * @return QHash<int, QByteArray> A hash containing the role integer as key and the role name as value.
+ * @param from Current row of the note.
+ * @param to Row the note should occupy after the move.
+ * @return true if the note was moved, false otherwise.
  */
-QHash<int, QByteArray> TODONotesModel::roleNames() const {
-  QHash<int, QByteArray> roleNameHash;
-  roleNameHash[noteIDRole] = "NoteID";
-  roleNameHash[ItemNameRole] = "NoteName";
-  roleNameHash[TimeStampRole] = "CreatedAt";
-  return roleNameHash;
+bool TODONotesModel::moveNote(int from, int to) {
+  TRACE_SPAN(span, "qml");
+  return moveRows(QModelIndex(), from, 1, QModelIndex(),
+                  to > from ? to + 1 : to);
 }
 
 /**
  * @brief Adds a new note to the list and updates the model.
  *
  * This function creates a new note with the given data by inserting it into the database.
- * After insertion, it refreshes the model data from the database to reflect the changes.
- * Additionally, it logs the creation event for auditing purposes.
+ * The new row is inserted into the model by applyDatabaseChange() when the insert is
+ * published. Additionally, it logs the creation event for auditing purposes.
  *
  * @param data The content of the note to be added.
  */
 void TODONotesModel::addNoteToList(const QString &data) {
-  int eventID = DBManager::instance()->addNote(data);
-  //  beginInsertRows(QModelIndex(), rowCount(), rowCount());
-  //  notesElement element;
-  //  element.id = eventID;
-  //  element.itemName = data;
-  //  element.creationTime = QDateTime::currentDateTime();
-  //  modelData.append(element);
-  //  endInsertRows();
-  fetchAllNotesFromDB();
-  Logger::instance().logEvent(Logger::NOTE_CREATED, data);
+  TRACE_SPAN(span, "qml");
+  DBManager *db = DBManager::instance();
+  db->queueWrite([db, data]() {
+    if (db->addNote(data) < 0)
+      return false;
+    Logger::instance().logEvent(Logger::NOTE_CREATED, data);
+    return true;
+  });
 }
 
 
 /**
  * @brief Removes a note from the model and the database.
  *
- * This function deletes the note at the specified index from both the internal model data
- * and the persistent database. It also logs the deletion event. The function emits the necessary
- * signals to update any views associated with the model.
+ * This function deletes the note at the specified index and its tasks from the persistent
+ * database in one transaction and logs the deletion event. The row is removed from the model
+ * by applyDatabaseChange() when the delete is published.
  *
  * @param index The index of the note to be removed.
  */
 void TODONotesModel::removeNoteFromList(const int &index) {
-  int eventID = modelData.at(index).id;
-  Logger::instance().logEvent(Logger::NOTE_DELETED,
-                              modelData.at(index).itemName);
-  DBManager::instance()->deleteNote(eventID);
-  DBManager::instance()->getNoteContents(eventID);
-  beginRemoveRows(QModelIndex(), index, index);
-  modelData.removeAt(index);
-  endRemoveRows();
+  TRACE_SPAN(span, "qml");
+  if (index < 0 || index >= m_rows.size())
+    return;
+  const int noteId = m_rows.at(index).id;
+  const QString noteName = m_noteNames.at(m_rows.at(index).itemName);
+  DBManager *db = DBManager::instance();
+  db->queueWrite([db, noteId, noteName]() {
+    if (!db->deleteAllNoteContents(noteId) || !db->deleteNote(noteId))
+      return false;
+    Logger::instance().logEvent(Logger::NOTE_DELETED, noteName);
+    return true;
+  });
+}
+
+/**
+ * @brief Returns the IDs of the first notes in list order.
+ *
+ * Used to prefetch the task lists the user is most likely to open next.
+ *
+ * @param count Maximum number of IDs to return.
+ * @return The note IDs.
+ */
+QVariantList TODONotesModel::noteIds(int count) const {
+  QVariantList ids;
+  for (int row = 0; row < m_rows.size() && row < count; ++row)
+    ids.append(m_rows.at(row).id);
+  return ids;
 }
 
 /**
@@ -155,16 +217,181 @@ void TODONotesModel::removeNoteFromList(const int &index) {
  * of changes to any attached views.
  */
 void TODONotesModel::fetchAllNotesFromDB() {
+  TRACE_SPAN(span, "model");
   QList<QVariantMap> list;
   beginResetModel();
-  modelData.clear();
+  m_rows.clear();
+  m_noteNames.clear();
   list = DBManager::instance()->getAllNotes();
+  m_rows.reserve(list.size());
   for (const auto &a : list) {
     notesElement element;
     element.id = a["note_id"].toInt();
-    element.itemName = a["title"].toString();
-    element.creationTime = QDateTime::fromString(a["created_at"].toString());
-    modelData.append(element);
+    element.itemName = m_noteNames.intern(a["title"].toString());
+    element.creationTime = DBManager::toDateTime(a["created_at"]);
+    element.sortKey = a["sort_key"].toString();
+    m_rows.append(element);
   }
   endResetModel();
 }
+
+/**
+ * @brief Applies a committed database change to the model.
+ *
+ * New notes are inserted at the top (the list is ordered newest first),
+ * renamed notes get their name updated in place and deleted notes are
+ * removed, each with the narrowest model notification. A note another
+ * process changed is read again and inserted, renamed, moved or removed;
+ * notes it deleted reload the list.
+ *
+ * @param event The change published by DBManager.
+ */
+void TODONotesModel::applyDatabaseChange(const DBChangeEvent &event) {
+  if (event.table != DBChangeEvent::Notes)
+    return;
+  switch (event.operation) {
+  case DBChangeEvent::Inserted: {
+    QVariantMap note = DBManager::instance()->getNote(event.rowId);
+    if (note.isEmpty())
+      return;
+    notesElement element;
+    element.id = event.rowId;
+    element.itemName = m_noteNames.intern(note["title"].toString());
+    element.creationTime = DBManager::toDateTime(note["created_at"]);
+    element.sortKey = note["sort_key"].toString();
+    insertRowAt(0, element);
+    break;
+  }
+  case DBChangeEvent::Updated: {
+    if (event.values.contains("sort_key")) {
+      if (event.rowId < 0) {
+        reloadSortKeys();
+        return;
+      }
+      int row = rowForId(event.rowId);
+      const QString sortKey = event.values.value("sort_key").toString();
+      if (row >= 0 && m_rows.at(row).sortKey != sortKey)
+        moveToSortedPosition(row, sortKey);
+      return;
+    }
+    int row = rowForId(event.rowId);
+    if (row < 0 || !event.values.contains("title"))
+      return;
+    m_rows[row].itemName =
+        m_noteNames.intern(event.values.value("title").toString());
+    rowChanged<noteNameField>(row);
+    compactNoteNames();
+    break;
+  }
+  case DBChangeEvent::Deleted: {
+    int row = rowForId(event.rowId);
+    if (row < 0)
+      return;
+    removeRowAt(row);
+    compactNoteNames();
+    break;
+  }
+  case DBChangeEvent::Reloaded: {
+    if (event.rowId < 0) {
+      fetchAllNotesFromDB();
+      return;
+    }
+    const QVariantMap note = DBManager::instance()->getNote(event.rowId);
+    int row = rowForId(event.rowId);
+    if (note.isEmpty()) {
+      if (row >= 0)
+        removeRowAt(row);
+      return;
+    }
+    if (row < 0) {
+      notesElement element;
+      element.id = event.rowId;
+      element.creationTime = DBManager::toDateTime(note["created_at"]);
+      insertRowAt(0, element);
+      row = 0;
+    }
+    m_rows[row].itemName = m_noteNames.intern(note["title"].toString());
+    rowChanged<noteNameField>(row);
+    compactNoteNames();
+    const QString sortKey = note["sort_key"].toString();
+    if (m_rows.at(row).sortKey != sortKey)
+      moveToSortedPosition(row, sortKey);
+    break;
+  }
+  }
+}
+
+/**
+ * @brief Returns the row of the note with the given ID, or -1 if it is not in the model.
+ */
+int TODONotesModel::rowForId(int id) const {
+  for (int row = 0; row < m_rows.size(); ++row)
+    if (m_rows.at(row).id == id)
+      return row;
+  return -1;
+}
+
+/**
+ * @brief Moves a note whose ordering key was changed elsewhere to its new position.
+ *
+ * @param row Current row of the note.
+ * @param sortKey Its new ordering key.
+ */
+void TODONotesModel::moveToSortedPosition(int row, const QString &sortKey) {
+  // Binary search over the other rows, which are still sorted.
+  int low = 0;
+  int high = m_rows.size() - 1;
+  while (low < high) {
+    const int middle = (low + high) / 2;
+    if (m_rows.at(middle < row ? middle : middle + 1).sortKey < sortKey)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  m_rows[row].sortKey = sortKey;
+  moveRowTo(row, low);
+}
+
+/**
+ * @brief Re-reads the ordering keys after they were rebalanced.
+ *
+ * The order does not change, so views are not notified unless the list no
+ * longer matches the database, in which case it is reloaded.
+ */
+void TODONotesModel::reloadSortKeys() {
+  const QList<QVariantMap> list = DBManager::instance()->getAllNotes();
+  if (list.size() != m_rows.size()) {
+    fetchAllNotesFromDB();
+    return;
+  }
+  for (int row = 0; row < list.size(); ++row) {
+    if (list.at(row)["note_id"].toInt() != m_rows.at(row).id) {
+      fetchAllNotesFromDB();
+      return;
+    }
+    m_rows[row].sortKey = list.at(row)["sort_key"].toString();
+  }
+}
+
+/**
+ * @brief Interns the names of the rows into a fresh pool once most of the pool is unused.
+ *
+ * Renamed and deleted notes leave their old names in the pool until the
+ * next reload; this bounds the pool to about twice the shown names.
+ */
+void TODONotesModel::compactNoteNames() {
+  if (m_noteNames.size() <= 2 * m_rows.size() + compactSlackNames)
+    return;
+  StringPool names;
+  for (notesElement &row : m_rows)
+    row.itemName = names.intern(m_noteNames.at(row.itemName));
+  m_noteNames = names;
+}
+
+/**
+ * @brief Rewrites the ordering keys of all notes once they have grown long.
+ */
+void TODONotesModel::rebalanceSortKeys() {
+  DBManager *db = DBManager::instance();
+  db->queueWrite([db]() { return db->rebalanceNoteSortKeys(); });
+}
@@ -1,9 +1,12 @@
 #ifndef TODONOTESMODEL_H
 #define TODONOTESMODEL_H
 
-#include <QAbstractListModel>
+#include "dbchangeevent.h"
+#include "rowlistmodel.h"
+#include "stringpool.h"
 #include <QDateTime>
 #include <QObject>
+#include <QTimer>
 /**
  * @struct notesElement
  * @brief Represents a single note item with an identifier, name, and creation timestamp.
@@ -14,48 +17,92 @@
  * @var notesElement::id
  *   Unique identifier for the note.
  * @var notesElement::itemName
- *   Name or description of the note item.
+ *   Name or description of the note item, as an ID in the model's note name pool.
  * @var notesElement::creationTime
  *   Timestamp indicating when the note was created.
+ * @var notesElement::sortKey
+ *   Ordering key of the note (see OrderKey).
  */
 struct notesElement {
   int id;
-  QString itemName;
+  quint32 itemName;
   QDateTime creationTime;
+  QString sortKey;
 };
+class TODONotesModel;
+
+/**
+ * @brief Fields of TODONotesModel, one per role (see RowListModel).
+ */
+struct noteIdField {
+  static constexpr const char *name = "NoteID";
+  static QVariant get(const TODONotesModel &, const notesElement &row);
+};
+struct noteNameField {
+  static constexpr const char *name = "NoteName";
+  static QVariant get(const TODONotesModel &, const notesElement &row);
+};
+struct noteCreatedAtField {
+  static constexpr const char *name = "CreatedAt";
+  static QVariant get(const TODONotesModel &, const notesElement &row);
+};
+
+using todoNotesBase = RowListModel<TODONotesModel, notesElement, noteIdField,
+                                   noteNameField, noteCreatedAtField>;
+
 /**
  * @class TODONotesModel
  * @brief Model class for managing a list of TODO notes in a Qt MVC application.
  *
- * This class inherits from QAbstractListModel and provides an interface for storing,
+ * This class inherits from RowListModel and provides an interface for storing,
  * retrieving, and manipulating TODO notes. It supports custom roles for note ID, item name,
- * and timestamp, and exposes methods for adding, removing, and fetching notes.
+ * and timestamp, generated from the note*Field types, and exposes methods for adding, removing,
+ * and fetching notes.
  *
- * @note The model uses a QVector of notesElement to store its data.
+ * @note The model uses a QVector of notesElement (RowListModel::m_rows) to store its data.
  *
- * @see QAbstractListModel
+ * @see RowListModel
  */
-class TODONotesModel : public QAbstractListModel {
+class TODONotesModel : public todoNotesBase {
   Q_OBJECT
 public:
   explicit TODONotesModel(QAbstractListModel *parent = nullptr);
   virtual ~TODONotesModel();
-  enum roleEnums { noteIDRole = Qt::UserRole + 1, ItemNameRole, TimeStampRole };
+  enum roleEnums {
+    noteIDRole = roleOf<noteIdField>(),
+    ItemNameRole = roleOf<noteNameField>(),
+    TimeStampRole = roleOf<noteCreatedAtField>()
+  };
   Q_ENUM(roleEnums);
-  Q_INVOKABLE virtual int
-  rowCount(const QModelIndex &parent = QModelIndex()) const override;
-  Q_INVOKABLE virtual QVariant data(const QModelIndex &index,
-                                    int role = Qt::DisplayRole) const override;
   Q_INVOKABLE virtual QVariant
   headerData(int section, Qt::Orientation orientation,
              int role = Qt::DisplayRole) const override;
-  Q_INVOKABLE virtual QHash<int, QByteArray> roleNames() const override;
+  bool moveRows(const QModelIndex &sourceParent, int sourceRow, int count,
+                const QModelIndex &destinationParent,
+                int destinationChild) override;
+  Q_INVOKABLE bool moveNote(int from, int to);
   Q_INVOKABLE void addNoteToList(const QString &data);
   Q_INVOKABLE void removeNoteFromList(const int &index);
   Q_INVOKABLE void fetchAllNotesFromDB();
+  Q_INVOKABLE QVariantList noteIds(int count) const;
+
+private slots:
+  void applyDatabaseChange(const DBChangeEvent &event);
+  void rebalanceSortKeys();
 
 private:
-  QVector<notesElement> modelData;
+  friend struct noteNameField;
+
+  int rowForId(int id) const;
+  void moveToSortedPosition(int row, const QString &sortKey);
+  void reloadSortKeys();
+  void compactNoteNames();
+
+  static constexpr int rebalanceDelayMs = 2000;
+  static constexpr int compactSlackNames = 64;
+
+  QTimer m_rebalanceTimer;
+  StringPool m_noteNames;
 };
 
 #endif // TODONOTESMODEL_H
@@ -0,0 +1,257 @@
+#include "tracer.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QThread>
+#include <chrono>
+
+std::atomic<bool> Tracer::s_enabled{false};
+
+namespace {
+quint64 currentThreadId() {
+  return reinterpret_cast<quintptr>(QThread::currentThreadId());
+}
+} // namespace
+
+Tracer::Tracer(QObject *parent)
+    : QObject(parent), m_next(0), m_queryCount(0), m_nextSlot(0),
+      m_outputDirectory("."),
+      m_guiThreadId(currentThreadId()), m_heartbeatUs(0),
+      m_watchdogRunning(false) {
+  m_clock.start();
+  m_ring.reserve(ringCapacity);
+  QObject::connect(&m_heartbeatTimer, &QTimer::timeout, this,
+                   [this]() { m_heartbeatUs.store(nowUs()); });
+}
+
+Tracer::~Tracer() { stopStallWatchdog(); }
+
+/**
+ * @brief Returns the singleton instance of the Tracer class.
+ *
+ * @return Reference to the singleton Tracer instance.
+ */
+Tracer &Tracer::instance() {
+  static Tracer tracer;
+  return tracer;
+}
+
+/**
+ * @brief Turns span recording on or off.
+ *
+ * Spans that are already open when tracing is turned on are not recorded.
+ *
+ * @param enabled true to record spans.
+ */
+void Tracer::setEnabled(bool enabled) {
+  s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Sets the directory dump() and the stall watchdog write traces to.
+ *
+ * @param directory The directory; it is created when the first trace is written.
+ */
+void Tracer::setOutputDirectory(const QString &directory) {
+  QMutexLocker locker(&m_mutex);
+  m_outputDirectory = directory;
+}
+
+/**
+ * @brief Returns the number of recorded spans that ran a query (see TraceSpan::setQuery()).
+ *
+ * Counts every such span since the tracer was created, including the ones
+ * the ring buffer has already dropped, so benchmarks can count statements.
+ */
+quint64 Tracer::queryCount() {
+  QMutexLocker locker(&m_mutex);
+  return m_queryCount;
+}
+
+/**
+ * @brief Writes the recorded spans to a new file in the output directory.
+ *
+ * @return The path of the trace file, or an empty string if it could not be written.
+ */
+QString Tracer::dump() {
+  QString directory;
+  {
+    QMutexLocker locker(&m_mutex);
+    directory = m_outputDirectory;
+  }
+  QDir().mkpath(directory);
+  const QString path = QDir(directory).filePath(
+      QString("trace-%1.json")
+          .arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss-zzz")));
+  return writeTrace(path) ? path : QString();
+}
+
+/**
+ * @brief Writes the recorded spans to @p path in the Chrome trace event format.
+ *
+ * Finished spans are written as complete ("X") events with their SQL text and
+ * row count as arguments. Spans that are still open are written up to now and
+ * marked with an "open" argument, so a trace taken during a stall shows what
+ * the thread is stuck in.
+ *
+ * @param path The file to write.
+ * @return true if the file was written, false otherwise.
+ */
+bool Tracer::writeTrace(const QString &path) {
+  QVector<traceEvent> events;
+  {
+    QMutexLocker locker(&m_mutex);
+    events.reserve(m_ring.size() + m_open.size());
+    for (int i = 0; i < m_ring.size(); ++i)
+      events.append(m_ring.at((m_next + i) % m_ring.size()));
+    const qint64 now = nowUs();
+    for (traceEvent open : qAsConst(m_open)) {
+      open.durationUs = now - open.startUs;
+      open.rows = -2;
+      events.append(open);
+    }
+  }
+
+  QJsonArray traceEvents;
+  QJsonObject threadName;
+  threadName["name"] = "thread_name";
+  threadName["ph"] = "M";
+  threadName["pid"] = 1;
+  threadName["tid"] = QString::number(m_guiThreadId);
+  threadName["args"] = QJsonObject{{"name", "GUI"}};
+  traceEvents.append(threadName);
+  for (const traceEvent &event : events) {
+    QJsonObject object;
+    object["name"] = QString::fromUtf8(event.name);
+    object["cat"] = QString::fromLatin1(event.category);
+    object["ph"] = "X";
+    object["ts"] = event.startUs;
+    object["dur"] = event.durationUs;
+    object["pid"] = 1;
+    object["tid"] = QString::number(event.threadId);
+    QJsonObject args;
+    if (!event.detail.isEmpty())
+      args["sql"] = event.detail;
+    if (event.rows >= 0)
+      args["rows"] = event.rows;
+    if (event.rows == -2)
+      args["open"] = true;
+    if (!args.isEmpty())
+      object["args"] = args;
+    traceEvents.append(object);
+  }
+  QJsonObject root;
+  root["traceEvents"] = traceEvents;
+  root["displayTimeUnit"] = "ms";
+
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    qDebug() << "Trace write error:" << path << file.errorString();
+    return false;
+  }
+  file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+  return true;
+}
+
+/**
+ * @brief Dumps a trace whenever the calling (GUI) thread stalls for @p stallMs.
+ *
+ * A timer on the calling thread records a heartbeat four times per period; a
+ * watchdog thread writes one trace per stall when the heartbeat is older than
+ * @p stallMs. Tracing is enabled as well, since a trace without spans would
+ * not help.
+ *
+ * @param stallMs Time without processed events that counts as a stall.
+ */
+void Tracer::startStallWatchdog(int stallMs) {
+  stopStallWatchdog();
+  setEnabled(true);
+  m_heartbeatUs.store(nowUs());
+  m_heartbeatTimer.start(qMax(1, stallMs / 4));
+  m_watchdogRunning.store(true);
+  m_watchdog = std::thread(&Tracer::watchdogLoop, this, stallMs);
+}
+
+/**
+ * @brief Stops the stall watchdog and waits for its thread to finish.
+ */
+void Tracer::stopStallWatchdog() {
+  m_heartbeatTimer.stop();
+  m_watchdogRunning.store(false);
+  if (m_watchdog.joinable())
+    m_watchdog.join();
+}
+
+/**
+ * @brief Body of the watchdog thread.
+ */
+void Tracer::watchdogLoop(int stallMs) {
+  const qint64 stallUs = qint64(stallMs) * 1000;
+  qint64 dumpedHeartbeat = -1;
+  while (m_watchdogRunning.load()) {
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(qBound(10, stallMs / 4, 250)));
+    const qint64 heartbeat = m_heartbeatUs.load();
+    if (heartbeat != dumpedHeartbeat && nowUs() - heartbeat > stallUs) {
+      dumpedHeartbeat = heartbeat;
+      const QString path = dump();
+      qDebug() << "GUI thread stalled for more than" << stallMs
+               << "ms, trace written to" << path;
+    }
+  }
+}
+
+/**
+ * @brief Registers a span that has just been opened; called only when tracing is enabled.
+ *
+ * @return The slot the span is kept in until closeSpan().
+ */
+int Tracer::openSpan(const char *category, const char *name) {
+  const traceEvent event{category, name, QString(), nowUs(), 0, -1,
+                         currentThreadId()};
+  QMutexLocker locker(&m_mutex);
+  const int slot = m_nextSlot;
+  m_nextSlot = (m_nextSlot + 1) & 0x7fffffff;
+  m_open.insert(slot, event);
+  return slot;
+}
+
+/**
+ * @brief Stores the SQL text and row count of @p query in an open span.
+ */
+void Tracer::setSpanQuery(int slot, const QSqlQuery &query, int rows) {
+  const QString sql = query.lastQuery();
+  if (rows < 0 && !query.isSelect())
+    rows = query.numRowsAffected();
+  QMutexLocker locker(&m_mutex);
+  auto it = m_open.find(slot);
+  if (it == m_open.end())
+    return;
+  it->detail = sql;
+  it->rows = rows;
+}
+
+/**
+ * @brief Moves a closed span into the ring buffer, replacing the oldest one when full.
+ */
+void Tracer::closeSpan(int slot) {
+  const qint64 endUs = nowUs();
+  QMutexLocker locker(&m_mutex);
+  traceEvent event = m_open.take(slot);
+  if (!event.category)
+    return;
+  event.durationUs = endUs - event.startUs;
+  if (!event.detail.isEmpty())
+    ++m_queryCount;
+  if (m_ring.size() < ringCapacity) {
+    m_ring.append(event);
+  } else {
+    m_ring[m_next] = event;
+    m_next = (m_next + 1) % ringCapacity;
+  }
+}
@@ -0,0 +1,156 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSqlQuery>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+#include <thread>
+
+class TraceSpan;
+
+/**
+ * @struct traceEvent
+ * @brief A finished span kept in the Tracer ring buffer.
+ *
+ * @var traceEvent::category
+ *   Span category ("db", "model", "log" or "qml").
+ * @var traceEvent::name
+ *   Function the span measured.
+ * @var traceEvent::detail
+ *   SQL text of the measured query, if any.
+ * @var traceEvent::startUs
+ *   Start time in microseconds since the tracer was created.
+ * @var traceEvent::durationUs
+ *   Duration in microseconds.
+ * @var traceEvent::rows
+ *   Rows returned or affected by the query, or -1.
+ * @var traceEvent::threadId
+ *   Thread the span ran on.
+ */
+struct traceEvent {
+  const char *category;
+  const char *name;
+  QString detail;
+  qint64 startUs;
+  qint64 durationUs;
+  int rows;
+  quint64 threadId;
+};
+
+/**
+ * @class Tracer
+ * @brief Collects scoped trace spans and exports them as a Chrome trace.
+ *
+ * Spans are opened with TRACE_SPAN and stored in a fixed-size ring buffer
+ * when they close, so only the last ringCapacity spans are kept. dump()
+ * writes the buffer, plus the spans that are still open, in the Chrome trace
+ * event format that chrome://tracing and ui.perfetto.dev load.
+ *
+ * Tracing is off by default. A disabled span holds a single int: opening it
+ * is one relaxed atomic load and one branch, and closing it tests that int.
+ * The SQL text of a recording span is copied into the tracer only when
+ * setQuery() is called, so disabled spans never build a string. The stall
+ * watchdog dumps a trace automatically when the GUI thread has not processed
+ * events for a while, which catches freezes while the offending span is
+ * still open.
+ *
+ * Usage:
+ *   Tracer::instance().setEnabled(true);
+ *   TRACE_SPAN(span, "db");
+ *   ...
+ *   span.setQuery(query, rows);
+ *
+ * @note This class follows the singleton pattern. Use Tracer::instance() to access the tracer.
+ */
+class Tracer : public QObject {
+  Q_OBJECT
+public:
+  static constexpr int ringCapacity = 16384;
+
+  static Tracer &instance();
+  static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+  void setEnabled(bool enabled);
+  void setOutputDirectory(const QString &directory);
+  Q_INVOKABLE QString dump();
+  bool writeTrace(const QString &path);
+  void startStallWatchdog(int stallMs);
+  void stopStallWatchdog();
+  quint64 queryCount();
+
+  qint64 nowUs() const { return m_clock.nsecsElapsed() / 1000; }
+
+private:
+  friend class TraceSpan;
+
+  explicit Tracer(QObject *parent = nullptr);
+  ~Tracer();
+  int openSpan(const char *category, const char *name);
+  void setSpanQuery(int slot, const QSqlQuery &query, int rows);
+  void closeSpan(int slot);
+  void watchdogLoop(int stallMs);
+
+  static std::atomic<bool> s_enabled;
+
+  QElapsedTimer m_clock;
+  QMutex m_mutex;
+  QVector<traceEvent> m_ring;
+  int m_next;
+  quint64 m_queryCount;
+  int m_nextSlot;
+  QHash<int, traceEvent> m_open;
+  QString m_outputDirectory;
+  quint64 m_guiThreadId;
+
+  QTimer m_heartbeatTimer;
+  std::atomic<qint64> m_heartbeatUs;
+  std::atomic<bool> m_watchdogRunning;
+  std::thread m_watchdog;
+};
+
+/**
+ * @class TraceSpan
+ * @brief Measures the scope it lives in when tracing is enabled.
+ *
+ * Create spans with the TRACE_SPAN macro, which names them after the
+ * enclosing function.
+ */
+class TraceSpan {
+public:
+  TraceSpan(const char *category, const char *name)
+      : m_slot(Tracer::isEnabled()
+                   ? Tracer::instance().openSpan(category, name)
+                   : -1) {}
+  ~TraceSpan() {
+    if (m_slot >= 0)
+      Tracer::instance().closeSpan(m_slot);
+  }
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+  /**
+   * @brief Attaches the SQL text of @p query and its row count to the span.
+   *
+   * Nothing is read from @p query while the span is not recording.
+   *
+   * @param query The executed query.
+   * @param rows Rows returned by a SELECT; -1 uses the rows affected by a write.
+   */
+  void setQuery(const QSqlQuery &query, int rows = -1) {
+    if (m_slot >= 0)
+      Tracer::instance().setSpanQuery(m_slot, query, rows);
+  }
+
+private:
+  int m_slot;
+};
+
+#define TRACE_SPAN(var, category) TraceSpan var(category, Q_FUNC_INFO)
+
+#endif // TRACER_H
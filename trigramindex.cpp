@@ -0,0 +1,362 @@
+#include "trigramindex.h"
+#include "dbmanager.h"
+#include "tracer.h"
+#include "workspaceregistry.h"
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <algorithm>
+
+/**
+ * @brief Returns the index of the current workspace.
+ */
+TrigramIndex &TrigramIndex::instance() {
+  static TrigramIndex index(true);
+  return index;
+}
+
+/**
+ * @brief Creates an empty index.
+ *
+ * @param followCurrentWorkspace If true, the index loads itself from the current workspace and
+ *        follows its change events; otherwise it only holds what is passed to load() and addTitle().
+ * @param parent Parent QObject.
+ */
+TrigramIndex::TrigramIndex(bool followCurrentWorkspace, QObject *parent)
+    : QObject(parent), m_followCurrentWorkspace(followCurrentWorkspace) {
+  if (!m_followCurrentWorkspace)
+    return;
+  QObject::connect(&WorkspaceRegistry::instance(),
+                   &WorkspaceRegistry::currentWorkspaceChanged, this,
+                   &TrigramIndex::invalidate);
+  QObject::connect(&WorkspaceRegistry::instance(), &WorkspaceRegistry::changed,
+                   this, &TrigramIndex::applyDatabaseChange);
+}
+
+/**
+ * @brief Replaces the contents of the index.
+ *
+ * @param titles (note ID, title) pairs.
+ */
+void TrigramIndex::load(const QList<QPair<int, QString>> &titles) {
+  m_titles.clear();
+  m_freeSlots.clear();
+  m_slots.clear();
+  m_postings.clear();
+  m_titles.reserve(titles.size());
+  for (const QPair<int, QString> &title : titles)
+    insertTitle(title.first, title.second);
+  m_loaded = true;
+}
+
+/**
+ * @brief Adds the title of a note, or replaces it if the note is indexed already.
+ */
+void TrigramIndex::addTitle(int noteId, const QString &title) {
+  ensureLoaded();
+  eraseTitle(noteId);
+  insertTitle(noteId, title);
+}
+
+/**
+ * @brief Removes the title of a note.
+ */
+void TrigramIndex::removeTitle(int noteId) {
+  ensureLoaded();
+  eraseTitle(noteId);
+}
+
+/**
+ * @brief Returns the number of indexed titles.
+ */
+int TrigramIndex::count() {
+  ensureLoaded();
+  return m_slots.size();
+}
+
+/**
+ * @brief Returns the best matches of a query, best first.
+ *
+ * Hit counts are accumulated per title while walking the posting lists of
+ * the query's trigrams. Titles holding less than a third of them are
+ * dropped. The rest are ranked by that share, minus a small penalty for
+ * trigrams the query does not cover (so shorter titles win ties). Only the
+ * best few candidates are then compared with the query as a string, and get
+ * a bonus if they contain it, and a larger one if they start with it.
+ *
+ * @param query The text typed so far; only its first maxQueryLength characters are used.
+ * @param limit Maximum number of matches to return.
+ * @return The matches, best first; empty for an empty query.
+ */
+QVector<trigramMatch> TrigramIndex::search(const QString &query, int limit) {
+  TRACE_SPAN(span, "model");
+  ensureLoaded();
+  const QString folded = fold(query.left(maxQueryLength));
+  const QVector<quint64> grams = trigrams(folded, false);
+  if (grams.isEmpty() || limit <= 0)
+    return {};
+
+  m_hits.resize(m_titles.size());
+  m_touched.clear();
+  for (quint64 gram : grams) {
+    auto postings = m_postings.constFind(gram);
+    if (postings == m_postings.cend())
+      continue;
+    for (int slot : *postings)
+      if (m_hits[slot]++ == 0)
+        m_touched.append(slot);
+  }
+
+  const int minHits = qMax(1, (grams.size() + 2) / 3);
+  QVector<trigramMatch> matches;
+  for (int slot : qAsConst(m_touched)) {
+    const int hits = m_hits[slot];
+    m_hits[slot] = 0;
+    if (hits < minHits)
+      continue;
+    const indexedTitle &title = m_titles.at(slot);
+    const double coverage = double(hits) / grams.size();
+    const double uncovered =
+        double(title.trigramCount - hits) / title.trigramCount;
+    matches.append({slot, QString(), coverage - 0.1 * uncovered});
+  }
+  auto better = [](const trigramMatch &a, const trigramMatch &b) {
+    return a.score != b.score ? a.score > b.score : a.noteId < b.noteId;
+  };
+  const int candidates = qMin(matches.size(), limit * 4);
+  std::partial_sort(matches.begin(), matches.begin() + candidates,
+                    matches.end(), better);
+  matches.resize(candidates);
+
+  // noteId holds the slot until here.
+  for (trigramMatch &match : matches) {
+    const indexedTitle &title = m_titles.at(match.noteId);
+    const int position = title.folded.indexOf(folded);
+    if (position == 0)
+      match.score += 0.5;
+    else if (position > 0)
+      match.score += 0.25;
+    match.noteId = title.noteId;
+    match.title = title.title;
+  }
+  std::sort(matches.begin(), matches.end(), better);
+  if (matches.size() > limit)
+    matches.resize(limit);
+  return matches;
+}
+
+/**
+ * @brief Applies a committed database change to the index.
+ *
+ * @param event The change published by DBManager.
+ */
+void TrigramIndex::applyDatabaseChange(const DBChangeEvent &event) {
+  if (!m_loaded || event.table != DBChangeEvent::Notes)
+    return;
+  switch (event.operation) {
+  case DBChangeEvent::Inserted:
+  case DBChangeEvent::Updated:
+    if (event.rowId < 0 || !event.values.contains("title"))
+      return;
+    eraseTitle(event.rowId);
+    insertTitle(event.rowId, event.values.value("title").toString());
+    break;
+  case DBChangeEvent::Deleted:
+    eraseTitle(event.rowId);
+    break;
+  case DBChangeEvent::Reloaded:
+    if (event.rowId < 0) {
+      invalidate();
+      return;
+    }
+    eraseTitle(event.rowId);
+    insertTitle(event.rowId, event.values.value("title").toString());
+    break;
+  }
+  emit indexChanged();
+}
+
+/**
+ * @brief Drops the index so it is rebuilt from the database on next use.
+ */
+void TrigramIndex::invalidate() {
+  m_loaded = false;
+  m_titles.clear();
+  m_freeSlots.clear();
+  m_slots.clear();
+  m_postings.clear();
+  emit indexChanged();
+}
+
+/**
+ * @brief Builds the index from the current workspace if needed.
+ */
+void TrigramIndex::ensureLoaded() {
+  if (m_loaded || !m_followCurrentWorkspace)
+    return;
+  QList<QPair<int, QString>> titles;
+  for (const QVariantMap &note : DBManager::instance()->getAllNotes())
+    titles.append({note["note_id"].toInt(), note["title"].toString()});
+  load(titles);
+}
+
+/**
+ * @brief Stores a title in a free slot and adds the slot to the posting list of each of its trigrams.
+ */
+void TrigramIndex::insertTitle(int noteId, const QString &title) {
+  const QString folded = fold(title);
+  const QVector<quint64> grams = trigrams(folded, true);
+  int slot;
+  if (m_freeSlots.isEmpty()) {
+    slot = m_titles.size();
+    m_titles.append(indexedTitle());
+  } else {
+    slot = m_freeSlots.takeLast();
+  }
+  m_titles[slot] = {noteId, title, folded, int(grams.size())};
+  m_slots.insert(noteId, slot);
+  for (quint64 gram : grams)
+    m_postings[gram].append(slot);
+}
+
+/**
+ * @brief Removes a title from the posting lists of its trigrams and frees its slot.
+ */
+void TrigramIndex::eraseTitle(int noteId) {
+  auto found = m_slots.find(noteId);
+  if (found == m_slots.end())
+    return;
+  const int slot = *found;
+  m_slots.erase(found);
+  for (quint64 gram : trigrams(m_titles.at(slot).folded, true)) {
+    auto postings = m_postings.find(gram);
+    if (postings == m_postings.end())
+      continue;
+    const int position = postings->indexOf(slot);
+    if (position >= 0) {
+      (*postings)[position] = postings->last();
+      postings->removeLast();
+    }
+    if (postings->isEmpty())
+      m_postings.erase(postings);
+  }
+  m_titles[slot] = {-1, QString(), QString(), 0};
+  m_freeSlots.append(slot);
+}
+
+/**
+ * @brief Case-folds a text, strips its diacritics and simplifies its whitespace.
+ */
+QString TrigramIndex::fold(const QString &text) {
+  const QString decomposed =
+      text.normalized(QString::NormalizationForm_KD).toCaseFolded();
+  QString folded;
+  folded.reserve(decomposed.size());
+  for (const QChar c : decomposed)
+    if (!c.isMark())
+      folded.append(c);
+  return folded.simplified();
+}
+
+/**
+ * @brief Returns the distinct trigrams of a folded text, each packed into 48 bits.
+ *
+ * @param folded The folded text.
+ * @param padEnd Whether to pad the end with a space (titles) or not (queries, whose last word may be incomplete).
+ */
+QVector<quint64> TrigramIndex::trigrams(const QString &folded, bool padEnd) {
+  QVector<quint64> grams;
+  if (folded.isEmpty())
+    return grams;
+  QString padded = QStringLiteral("  ") + folded;
+  if (padEnd)
+    padded += ' ';
+  grams.reserve(padded.size() - 2);
+  for (int i = 0; i + 2 < padded.size(); ++i)
+    grams.append(quint64(padded.at(i).unicode()) << 32 |
+                 quint64(padded.at(i + 1).unicode()) << 16 |
+                 padded.at(i + 2).unicode());
+  std::sort(grams.begin(), grams.end());
+  grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+  return grams;
+}
+
+/**
+ * @brief Times as-you-type searches over synthetic titles and prints the results to stdout.
+ *
+ * Builds an index of @p titleCount titles of two to four words from a fixed
+ * seed. Then it types 200 of them character by character, each with one
+ * pair of adjacent characters swapped, and searches after every keystroke.
+ * Reports the build time, the per-keystroke search latency and how often
+ * the intended title was among the top 10 once fully typed.
+ *
+ * @param titleCount Number of synthetic titles.
+ */
+void TrigramIndex::runBenchmark(int titleCount) {
+  constexpr int typedTitles = 200;
+  constexpr int resultCount = 10;
+  static const char *const words[] = {
+      "weekly",   "groceries", "project",  "launch",  "house",   "garden",
+      "budget",   "reading",   "travel",   "packing", "birthday", "party",
+      "meeting",  "notes",     "backlog",  "release", "holiday",  "gifts",
+      "workout",  "plan",      "recipes",  "dinner",  "car",      "repairs",
+      "school",   "homework",  "invoices", "taxes",   "moving",   "checklist",
+      "team",     "retro",     "ideas",    "sprint",  "bugs",     "errands",
+      "music",    "practice",  "books",    "wishlist"};
+  constexpr int wordCount = int(sizeof(words) / sizeof(words[0]));
+  QTextStream out(stdout);
+  QRandomGenerator random(42);
+
+  QList<QPair<int, QString>> titles;
+  for (int id = 1; id <= titleCount; ++id) {
+    QStringList parts;
+    const int length = 2 + random.bounded(3);
+    for (int w = 0; w < length; ++w)
+      parts.append(words[random.bounded(wordCount)]);
+    parts.append(QString::number(random.bounded(1000)));
+    titles.append({id, parts.join(' ')});
+  }
+  TrigramIndex index(false);
+  QElapsedTimer timer;
+  timer.start();
+  index.load(titles);
+  out << "Indexed " << titleCount << " titles in " << timer.elapsed()
+      << " ms\n";
+
+  QVector<qint64> samples;
+  int found = 0;
+  for (int t = 0; t < typedTitles && !titles.isEmpty(); ++t) {
+    const QPair<int, QString> &target =
+        titles.at(random.bounded(titles.size()));
+    QString typed = target.second;
+    const int swap = 1 + random.bounded(typed.size() - 2);
+    const QChar swapped = typed.at(swap);
+    typed[swap] = typed.at(swap + 1);
+    typed[swap + 1] = swapped;
+    QVector<trigramMatch> matches;
+    for (int length = 1; length <= typed.size(); ++length) {
+      timer.restart();
+      matches = index.search(typed.left(length), resultCount);
+      samples.append(timer.nsecsElapsed());
+    }
+    for (const trigramMatch &match : qAsConst(matches))
+      if (match.noteId == target.first)
+        ++found;
+  }
+  if (samples.isEmpty())
+    return;
+  std::sort(samples.begin(), samples.end());
+  auto percentile = [&samples](double p) {
+    const int index = qMin(samples.size() - 1, int(p * samples.size()));
+    return QString::number(samples.at(index) / 1000.0, 'f', 1);
+  };
+  out << "keystroke    count     p50 us     p99 us     max us\n";
+  out << "search    " << QString::number(samples.size()).rightJustified(7)
+      << percentile(0.50).rightJustified(11)
+      << percentile(0.99).rightJustified(11)
+      << QString::number(samples.last() / 1000.0, 'f', 1).rightJustified(11)
+      << "\n";
+  out << "Typed title with a typo in the top " << resultCount << ": " << found
+      << " of " << typedTitles << "\n";
+  out.flush();
+}
@@ -0,0 +1,106 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include "dbchangeevent.h"
+#include <QHash>
+#include <QObject>
+#include <QVector>
+
+/**
+ * @struct indexedTitle
+ * @brief One note title held by TrigramIndex.
+ *
+ * @var indexedTitle::noteId
+ *   Note the title belongs to, or -1 if the slot is free.
+ * @var indexedTitle::title
+ *   The title as stored.
+ * @var indexedTitle::folded
+ *   The title case-folded, without diacritics and with whitespace simplified.
+ * @var indexedTitle::trigramCount
+ *   Number of distinct trigrams of the folded title.
+ */
+struct indexedTitle {
+  int noteId;
+  QString title;
+  QString folded;
+  int trigramCount;
+};
+
+/**
+ * @struct trigramMatch
+ * @brief One result of TrigramIndex::search().
+ *
+ * @var trigramMatch::noteId
+ *   The matching note.
+ * @var trigramMatch::title
+ *   Its title.
+ * @var trigramMatch::score
+ *   Rank of the match; higher is better.
+ */
+struct trigramMatch {
+  int noteId;
+  QString title;
+  double score;
+};
+
+/**
+ * @class TrigramIndex
+ * @brief In-memory trigram index of note titles for typo-tolerant, as-you-type matching.
+ *
+ * Every folded title is split into the overlapping three-character sequences of its text padded
+ * with two leading spaces and one trailing space, and each trigram maps to the list of titles
+ * containing it. A query is split the same way (without the trailing space, so the last word may
+ * be incomplete); titles are ranked by the share of the query's trigrams they contain, so a typo
+ * only costs the few trigrams it touches. Titles that contain the query verbatim, at the start
+ * in particular, and shorter titles rank higher. A search only walks the posting lists of the
+ * query's trigrams and never touches the database.
+ *
+ * The shared index follows the current workspace: it is built from the database on first use and
+ * kept up to date from DBManager change events (note inserts, title updates, note deletes).
+ * indexChanged() is emitted after each applied change.
+ *
+ * Usage:
+ *   QVector<trigramMatch> matches = TrigramIndex::instance().search("grocries", 10);
+ */
+class TrigramIndex : public QObject {
+  Q_OBJECT
+public:
+  static constexpr int maxQueryLength = 64;
+
+  static TrigramIndex &instance(); // Index of the current workspace
+
+  explicit TrigramIndex(bool followCurrentWorkspace, QObject *parent = nullptr);
+
+  void load(const QList<QPair<int, QString>> &titles);
+  void addTitle(int noteId, const QString &title);
+  void removeTitle(int noteId);
+  QVector<trigramMatch> search(const QString &query, int limit);
+  int count();
+
+  static void runBenchmark(int titleCount);
+
+signals:
+  void indexChanged();
+
+private slots:
+  void applyDatabaseChange(const DBChangeEvent &event);
+  void invalidate();
+
+private:
+  void ensureLoaded();
+  void insertTitle(int noteId, const QString &title);
+  void eraseTitle(int noteId);
+  static QString fold(const QString &text);
+  static QVector<quint64> trigrams(const QString &folded, bool padEnd);
+
+  bool m_followCurrentWorkspace;
+  bool m_loaded = false;
+  QVector<indexedTitle> m_titles;
+  QVector<int> m_freeSlots;
+  QHash<int, int> m_slots;
+  QHash<quint64, QVector<int>> m_postings;
+  QVector<quint16> m_hits;
+  QVector<int> m_touched;
+};
+
+#endif // TRIGRAMINDEX_H
@@ -0,0 +1,226 @@
+#include "workloadreplayer.h"
+#include "dbmanager.h"
+#include "todolistmodel.h"
+#include "todonotesmodel.h"
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTextStream>
+#include <QTimer>
+#include <QUuid>
+#include <algorithm>
+
+WorkloadReplayer::WorkloadReplayer(TODONotesModel &notesModel,
+                                   ToDoListModel &todoModel, QObject *parent)
+    : QObject(parent), m_notesModel(notesModel), m_todoModel(todoModel) {}
+
+/**
+ * @brief Reads the eventLogs history of a source database.
+ *
+ * The source is opened read-only on its own connection and is never modified.
+ *
+ * @param sourceDbPath Path of the database whose eventLogs table is replayed.
+ * @return true if the events were read, false otherwise.
+ */
+bool WorkloadReplayer::loadEvents(const QString &sourceDbPath) {
+  const QString connectionName =
+      QStringLiteral("replay-source-") + QUuid::createUuid().toString();
+  bool ok = false;
+  {
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setConnectOptions("QSQLITE_OPEN_READONLY");
+    db.setDatabaseName(sourceDbPath);
+    if (!db.open()) {
+      qDebug() << "Replay source open error:" << db.lastError().text();
+    } else {
+      QSqlQuery query(db);
+      ok = query.exec("SELECT event_type, event_description, created_at FROM "
+                      "eventLogs ORDER BY id ASC");
+      if (!ok)
+        qDebug() << "Replay source read error:" << query.lastError().text();
+      while (ok && query.next()) {
+        QJsonObject description =
+            QJsonDocument::fromJson(query.value(1).toString().toUtf8())
+                .object();
+        replayEvent event;
+        event.type = query.value(0).toString();
+        event.noteName = description.value("NoteName").toString();
+        event.taskName = description.value("TaskName").toString();
+        event.timestamp = DBManager::toDateTime(query.value(2));
+        m_events.append(event);
+      }
+      db.close();
+    }
+  }
+  QSqlDatabase::removeDatabase(connectionName);
+  return ok;
+}
+
+/**
+ * @brief Starts replaying the loaded events.
+ *
+ * @param speed Pace relative to the recording (1 = original pace, 10 = ten
+ *              times faster). 0 or less replays the events back to back.
+ */
+void WorkloadReplayer::start(double speed) {
+  m_speed = speed;
+  m_next = 0;
+  m_skipped = 0;
+  m_latencies.clear();
+  m_clock.start();
+  QTimer::singleShot(0, this, &WorkloadReplayer::replayNext);
+}
+
+/**
+ * @brief Replays the next event and schedules the one after it.
+ */
+void WorkloadReplayer::replayNext() {
+  if (m_next >= m_events.size()) {
+    printReport();
+    emit finished();
+    return;
+  }
+
+  const replayEvent &event = m_events.at(m_next++);
+  QElapsedTimer timer;
+  timer.start();
+  if (execute(event))
+    m_latencies[event.type].append(timer.nsecsElapsed());
+  else
+    ++m_skipped;
+
+  int delay = 0;
+  if (m_speed > 0 && m_next < m_events.size()) {
+    const QDateTime &first = m_events.first().timestamp;
+    qint64 due = qint64(first.msecsTo(m_events.at(m_next).timestamp) / m_speed);
+    delay = int(qMax<qint64>(0, due - m_clock.elapsed()));
+  }
+  QTimer::singleShot(delay, this, &WorkloadReplayer::replayNext);
+}
+
+/**
+ * @brief Performs one recorded action through the models.
+ *
+ * @param event The action to perform.
+ * @return true if the action was performed, false if it could not be mapped
+ *         (unknown type, or a note or task that does not exist).
+ */
+bool WorkloadReplayer::execute(const replayEvent &event) {
+  if (event.type == QLatin1String("NOTE_CREATED")) {
+    m_notesModel.addNoteToList(event.noteName);
+    return true;
+  }
+  if (event.type == QLatin1String("NOTE_DELETED")) {
+    int row = findNoteRow(event.noteName);
+    if (row < 0)
+      return false;
+    m_notesModel.removeNoteFromList(row);
+    return true;
+  }
+  if (!selectNote(event.noteName))
+    return false;
+  if (event.type == QLatin1String("TASK_ADDED")) {
+    m_todoModel.addItemToList(event.taskName);
+    return true;
+  }
+  if (event.type == QLatin1String("TASK_DELETED")) {
+    int row = findTaskRow(event.taskName);
+    if (row < 0)
+      return false;
+    m_todoModel.removeItemFromList(row);
+    return true;
+  }
+  if (event.type == QLatin1String("TASK_STATUS_TOGGLED")) {
+    const int separator = event.taskName.lastIndexOf(':');
+    int row = findTaskRow(event.taskName.left(separator));
+    if (separator < 0 || row < 0)
+      return false;
+    m_todoModel.toggleTaskStatus(row, event.taskName.mid(separator + 1) ==
+                                          QLatin1String("1"));
+    m_todoModel.flushPendingStatusChanges();
+    return true;
+  }
+  if (event.type == QLatin1String("TASK_UPDATED")) {
+    const int separator = event.taskName.indexOf('\n');
+    int row = findTaskRow(event.taskName.left(separator));
+    if (separator < 0 || row < 0)
+      return false;
+    m_todoModel.setTaskText(row, event.taskName.mid(separator + 1));
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Opens the note with the given name in the to-do list model, like a click on the first page.
+ *
+ * @return true if the note exists, false otherwise.
+ */
+bool WorkloadReplayer::selectNote(const QString &noteName) {
+  int row = findNoteRow(noteName);
+  if (row < 0)
+    return false;
+  m_todoModel.setNoteID(
+      m_notesModel.data(m_notesModel.index(row), TODONotesModel::noteIDRole)
+          .toInt());
+  return true;
+}
+
+/**
+ * @brief Returns the row of the newest note with the given name, or -1.
+ */
+int WorkloadReplayer::findNoteRow(const QString &noteName) const {
+  for (int row = 0; row < m_notesModel.rowCount(); ++row)
+    if (m_notesModel.data(m_notesModel.index(row), TODONotesModel::ItemNameRole)
+            .toString() == noteName)
+      return row;
+  return -1;
+}
+
+/**
+ * @brief Returns the row of the first task with the given name in the open note, or -1.
+ */
+int WorkloadReplayer::findTaskRow(const QString &taskName) const {
+  for (int row = 0; row < m_todoModel.rowCount(); ++row)
+    if (m_todoModel.data(m_todoModel.index(row), ToDoListModel::ItemNameRole)
+            .toString() == taskName)
+      return row;
+  return -1;
+}
+
+
+/**
+ * @brief Prints throughput and per-operation latency percentiles to stdout.
+ */
+void WorkloadReplayer::printReport() const {
+  QTextStream out(stdout);
+  const qint64 wallMs = qMax<qint64>(1, m_clock.elapsed());
+  int replayed = 0;
+  for (const QVector<qint64> &samples : m_latencies)
+    replayed += samples.size();
+
+  out << "Replayed " << replayed << " of " << m_events.size() << " events ("
+      << m_skipped << " skipped) in " << wallMs << " ms, "
+      << QString::number(replayed * 1000.0 / wallMs, 'f', 1) << " ops/s\n";
+  out << "operation              count     p50 us     p90 us     p99 us     "
+         "max us\n";
+  for (auto it = m_latencies.cbegin(); it != m_latencies.cend(); ++it) {
+    QVector<qint64> samples = it.value();
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+      int index = qMin(samples.size() - 1, int(p * samples.size()));
+      return QString::number(samples.at(index) / 1000.0, 'f', 1);
+    };
+    out << it.key().leftJustified(20)
+        << QString::number(samples.size()).rightJustified(7)
+        << percentile(0.50).rightJustified(11)
+        << percentile(0.90).rightJustified(11)
+        << percentile(0.99).rightJustified(11)
+        << QString::number(samples.last() / 1000.0, 'f', 1).rightJustified(11)
+        << "\n";
+  }
+  out.flush();
+}
@@ -0,0 +1,77 @@
+#ifndef WORKLOADREPLAYER_H
+#define WORKLOADREPLAYER_H
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QVector>
+
+class ToDoListModel;
+class TODONotesModel;
+
+/**
+ * @struct replayEvent
+ * @brief One recorded user action read from an eventLogs table.
+ *
+ * @var replayEvent::type
+ *   Event type name (e.g. "TASK_ADDED").
+ * @var replayEvent::noteName
+ *   Name of the note the action applied to.
+ * @var replayEvent::taskName
+ *   Name of the task, including the ":0"/":1" status suffix for toggles.
+ * @var replayEvent::timestamp
+ *   When the action was originally recorded.
+ */
+struct replayEvent {
+  QString type;
+  QString noteName;
+  QString taskName;
+  QDateTime timestamp;
+};
+
+/**
+ * @class WorkloadReplayer
+ * @brief Re-executes a recorded eventLogs history against the current workspace through the models.
+ *
+ * The replayer reads every entry of the eventLogs table of a source database (typically a copy of a
+ * production database) and drives TODONotesModel and ToDoListModel the same way the QML views do,
+ * so the measured cost includes the models, the logger and DBManager. Events can be replayed at the
+ * original pace, accelerated by a factor, or back to back. When done, it prints the throughput and
+ * the per-operation latency percentiles and emits finished().
+ *
+ * @note Status toggles are flushed immediately so their latency includes the database write.
+ */
+class WorkloadReplayer : public QObject {
+  Q_OBJECT
+public:
+  WorkloadReplayer(TODONotesModel &notesModel, ToDoListModel &todoModel,
+                   QObject *parent = nullptr);
+
+  bool loadEvents(const QString &sourceDbPath);
+  void start(double speed);
+
+signals:
+  void finished();
+
+private slots:
+  void replayNext();
+
+private:
+  bool execute(const replayEvent &event);
+  bool selectNote(const QString &noteName);
+  int findNoteRow(const QString &noteName) const;
+  int findTaskRow(const QString &taskName) const;
+  void printReport() const;
+
+  TODONotesModel &m_notesModel;
+  ToDoListModel &m_todoModel;
+  QVector<replayEvent> m_events;
+  int m_next = 0;
+  double m_speed = 0;
+  int m_skipped = 0;
+  QElapsedTimer m_clock;
+  QHash<QString, QVector<qint64>> m_latencies;
+};
+
+#endif // WORKLOADREPLAYER_H
@@ -0,0 +1,96 @@
+#include "benchmarks.h"
+#include "dbmanager.h"
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+/**
+ * @brief Compares one large database with the same tasks split over several workspaces and prints the result.
+ *
+ * Creates, in a temporary directory, one database of @p taskCount tasks and
+ * @p shardCount databases of taskCount / shardCount tasks each, in notes of
+ * 100 tasks; one task in 100 contains "urgent". Then times the queries the
+ * views run: getAllNotes() and getNoteContents() of a random note on the
+ * large file and on one shard, and a findNoteContents() search over the large
+ * file and over all shards, the others attached to the first.
+ *
+ * @param taskCount Total number of tasks.
+ * @param shardCount Number of workspaces the tasks are split over.
+ */
+void Benchmarks::runWorkspaceBenchmark(int taskCount, int shardCount) {
+  constexpr int noteSize = 100;
+  constexpr int rounds = 20;
+  QTextStream out(stdout);
+  QTemporaryDir directory;
+  if (!directory.isValid() || shardCount < 1)
+    return;
+  auto fill = [](DBManager &db, int tasks) {
+    db.beginTransaction();
+    for (int i = 0; i < tasks; i += noteSize) {
+      const int noteId = db.addNote(QStringLiteral("Note %1").arg(i));
+      for (int j = i; j < qMin(tasks, i + noteSize); ++j)
+        db.addNoteContent(noteId, j % 100 == 0
+                                      ? QStringLiteral("Task %1 urgent").arg(j)
+                                      : QStringLiteral("Task %1").arg(j));
+    }
+    db.commitTransaction();
+  };
+  DBManager single(directory.filePath("single.db"));
+  fill(single, taskCount);
+  QVector<DBManager *> shards;
+  QStringList aliases;
+  for (int i = 0; i < shardCount; ++i) {
+    shards.append(new DBManager(directory.filePath(
+        QStringLiteral("shard-%1.db").arg(i))));
+    fill(*shards.last(), taskCount / shardCount);
+    if (i > 0 && shards.first()->attachDatabase(
+                     QStringLiteral("ws%1").arg(i),
+                     shards.last()->databasePath()))
+      aliases.append(QStringLiteral("ws%1").arg(i));
+  }
+
+  QRandomGenerator random(7);
+  auto averageUs = [](auto &&query) {
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < rounds; ++i)
+      query();
+    return QString::number(timer.nsecsElapsed() / 1000.0 / rounds, 'f', 1);
+  };
+  auto noteIdsOf = [](DBManager &db) {
+    QVector<int> ids;
+    for (const QVariantMap &note : db.getAllNotes())
+      ids.append(note["note_id"].toInt());
+    return ids;
+  };
+  DBManager &shard = *shards.first();
+  const QVector<int> singleNotes = noteIdsOf(single);
+  const QVector<int> shardNotes = noteIdsOf(shard);
+  if (singleNotes.isEmpty() || shardNotes.isEmpty()) {
+    qDeleteAll(shards);
+    return;
+  }
+  int singleHits = 0;
+  int shardHits = 0;
+  out << "One file of " << taskCount << " tasks vs " << shardCount
+      << " files of " << taskCount / shardCount << ":\n";
+  out << "getAllNotes:       " << averageUs([&]() { single.getAllNotes(); })
+      << " us vs " << averageUs([&]() { shard.getAllNotes(); }) << " us\n";
+  out << "getNoteContents:   " << averageUs([&]() {
+    single.getNoteContents(
+        singleNotes.at(random.bounded(singleNotes.size())));
+  }) << " us vs " << averageUs([&]() {
+    shard.getNoteContents(shardNotes.at(random.bounded(shardNotes.size())));
+  }) << " us\n";
+  out << "findNoteContents:  " << averageUs([&]() {
+    singleHits = single.findNoteContents("urgent", {}).size();
+  }) << " us vs " << averageUs([&]() {
+    shardHits = shard.findNoteContents("urgent", aliases).size();
+  }) << " us over " << aliases.size() + 1 << " files (" << singleHits
+      << " vs " << shardHits << " matches)\n";
+  out.flush();
+  for (const QString &alias : qAsConst(aliases))
+    shard.detachDatabase(alias);
+  qDeleteAll(shards);
+}
@@ -0,0 +1,187 @@
+#include "workspaceregistry.h"
+#include "dbmanager.h"
+#include <QDebug>
+
+static const char *defaultWorkspaceName = "default";
+static const char *defaultWorkspacePath = "./database.db";
+
+WorkspaceRegistry::WorkspaceRegistry(QObject *parent)
+    : QObject(parent), m_unavailable(nullptr) {}
+
+WorkspaceRegistry::~WorkspaceRegistry() {
+  qDeleteAll(m_workspaces);
+  delete m_unavailable;
+}
+
+/**
+ * @brief Returns the singleton instance of the WorkspaceRegistry class.
+ *
+ * @return Reference to the singleton WorkspaceRegistry instance.
+ */
+WorkspaceRegistry &WorkspaceRegistry::instance() {
+  static WorkspaceRegistry registry;
+  return registry;
+}
+
+/**
+ * @brief Opens a workspace backed by the given database file.
+ *
+ * The database and its tables are created if they do not exist. Opening a
+ * workspace does not make it current. If no workspace is current yet, the new
+ * one becomes current.
+ *
+ * @param name Unique name of the workspace.
+ * @param dbPath Path of the SQLite database file.
+ * @return true if the workspace is open, false if the name is taken by another file or the file cannot be opened.
+ */
+bool WorkspaceRegistry::openWorkspace(const QString &name,
+                                      const QString &dbPath) {
+  if (DBManager *existing = m_workspaces.value(name))
+    return existing->databasePath() == dbPath;
+
+  DBManager *manager = new DBManager(dbPath);
+  if (manager->databasePath().isEmpty()) {
+    delete manager;
+    return false;
+  }
+  m_workspaces.insert(name, manager);
+  QObject::connect(manager, &DBManager::databaseRestored, this,
+                   [this, manager]() {
+                     if (m_workspaces.value(m_current) == manager)
+                       emit currentWorkspaceChanged();
+                   });
+  QObject::connect(manager, &DBManager::changed, this,
+                   [this, manager](const DBChangeEvent &event) {
+                     if (m_workspaces.value(m_current) == manager)
+                       emit changed(event);
+                   });
+  if (m_current.isEmpty())
+    m_current = name;
+  return true;
+}
+
+/**
+ * @brief Closes a workspace and its database connection.
+ *
+ * The current workspace cannot be closed.
+ *
+ * @param name Name of the workspace to close.
+ * @return true if the workspace was closed, false otherwise.
+ */
+bool WorkspaceRegistry::closeWorkspace(const QString &name) {
+  if (name == m_current || !m_workspaces.contains(name))
+    return false;
+  delete m_workspaces.take(name);
+  return true;
+}
+
+/**
+ * @brief Makes an open workspace the current one.
+ *
+ * Emits currentWorkspaceAboutToChange() before switching, so models can flush
+ * pending writes into the old workspace, and currentWorkspaceChanged() after.
+ *
+ * @param name Name of an open workspace.
+ * @return true if the workspace is current, false if it is not open.
+ */
+bool WorkspaceRegistry::setCurrentWorkspace(const QString &name) {
+  if (!m_workspaces.contains(name))
+    return false;
+  if (name == m_current)
+    return true;
+  emit currentWorkspaceAboutToChange();
+  m_current = name;
+  emit currentWorkspaceChanged();
+  return true;
+}
+
+/**
+ * @brief Returns the name of the current workspace.
+ */
+QString WorkspaceRegistry::currentWorkspaceName() const { return m_current; }
+
+/**
+ * @brief Returns the names of all open workspaces.
+ */
+QStringList WorkspaceRegistry::workspaceNames() const {
+  return m_workspaces.keys();
+}
+
+/**
+ * @brief Returns the DBManager of the current workspace.
+ *
+ * Opens the default workspace ("./database.db") if no workspace is open yet.
+ * If that fails, returns a manager without a database, whose calls fail
+ * like those of any manager whose file could not be opened, so callers never
+ * get a null pointer; opening a workspace later makes it current.
+ *
+ * @return Pointer to the current DBManager, never nullptr.
+ */
+DBManager *WorkspaceRegistry::current() {
+  if (m_current.isEmpty() && !m_unavailable)
+    openWorkspace(defaultWorkspaceName, defaultWorkspacePath);
+  if (DBManager *manager = m_workspaces.value(m_current))
+    return manager;
+  if (!m_unavailable) {
+    qDebug() << "No workspace could be opened; database calls will fail";
+    m_unavailable = new DBManager(QString());
+  }
+  return m_unavailable;
+}
+
+/**
+ * @brief Returns the DBManager of the named workspace, or nullptr if it is not open.
+ */
+DBManager *WorkspaceRegistry::workspace(const QString &name) const {
+  return m_workspaces.value(name);
+}
+
+/**
+ * @brief Searches task contents in every open workspace with a single query.
+ *
+ * All other workspaces are attached to the current workspace's connection and
+ * searched with one UNION ALL query. SQLite cannot attach inside a
+ * transaction nor more than DBManager::maxAttachedDatabases files; the
+ * workspaces left over are searched on their own connections. Each result
+ * carries the workspace name in "workspace".
+ *
+ * @param text Text to search for (case-insensitive substring match).
+ * @return QVariantList of QVariantMap results.
+ */
+QVariantList WorkspaceRegistry::findTasksInAllWorkspaces(const QString &text) {
+  DBManager *manager = current();
+  QStringList schemas;
+  QMap<QString, QString> schemaToName;
+  QStringList separate;
+  int index = 0;
+  for (auto it = m_workspaces.cbegin(); it != m_workspaces.cend(); ++it) {
+    if (it.key() == m_current)
+      continue;
+    const QString alias = QStringLiteral("ws%1").arg(index++);
+    if (manager->attachDatabase(alias, it.value()->databasePath())) {
+      schemas.append(alias);
+      schemaToName.insert(alias, it.key());
+    } else {
+      separate.append(it.key());
+    }
+  }
+
+  QVariantList results;
+  for (QVariantMap row : manager->findNoteContents(text, schemas)) {
+    const QString schema = row.value("workspace").toString();
+    row["workspace"] = schema == QLatin1String("main")
+                           ? m_current
+                           : schemaToName.value(schema);
+    results.append(row);
+  }
+  for (const QString &alias : qAsConst(schemas))
+    manager->detachDatabase(alias);
+  for (const QString &name : qAsConst(separate)) {
+    DBManager *other = m_workspaces.value(name);
+    for (QVariantMap row : other->findNoteContents(text, {})) {
+      row["workspace"] = name;
+      results.append(row);
+    }
+  }
+  return results;
+}
@@ -0,0 +1,59 @@
+#ifndef WORKSPACEREGISTRY_H
+#define WORKSPACEREGISTRY_H
+
+#include "dbchangeevent.h"
+#include <QMap>
+#include <QObject>
+#include <QStringList>
+#include <QVariantMap>
+
+class DBManager;
+
+/**
+ * @class WorkspaceRegistry
+ * @brief Singleton registry of open workspaces, each backed by its own database file and DBManager.
+ *
+ * Splitting data over several small database files (e.g. per team or per year) keeps each file
+ * small and its indexes hot. The registry owns one DBManager per workspace, tracks which
+ * workspace is current (the one the models and the logger work on) and can search tasks across
+ * all open workspaces by attaching their files to the current connection. Change events of the
+ * current workspace are forwarded through changed(), so models never need to reconnect when the
+ * current workspace switches.
+ *
+ * Usage:
+ *   WorkspaceRegistry::instance().openWorkspace("2024", "./database-2024.db");
+ *   WorkspaceRegistry::instance().setCurrentWorkspace("2024");
+ *
+ * @note This class follows the singleton pattern. Use WorkspaceRegistry::instance() to access it.
+ *       The "default" workspace ("./database.db") is opened on first use.
+ */
+class WorkspaceRegistry : public QObject {
+  Q_OBJECT
+public:
+  static WorkspaceRegistry &instance(); // Singleton accessor
+
+  Q_INVOKABLE bool openWorkspace(const QString &name, const QString &dbPath);
+  Q_INVOKABLE bool closeWorkspace(const QString &name);
+  Q_INVOKABLE bool setCurrentWorkspace(const QString &name);
+  Q_INVOKABLE QString currentWorkspaceName() const;
+  Q_INVOKABLE QStringList workspaceNames() const;
+  Q_INVOKABLE QVariantList findTasksInAllWorkspaces(const QString &text);
+
+  DBManager *current();
+  DBManager *workspace(const QString &name) const;
+
+signals:
+  void currentWorkspaceAboutToChange();
+  void currentWorkspaceChanged();
+  void changed(const DBChangeEvent &event);
+
+private:
+  explicit WorkspaceRegistry(QObject *parent = nullptr);
+  ~WorkspaceRegistry();
+
+  QMap<QString, DBManager *> m_workspaces;
+  QString m_current;
+  DBManager *m_unavailable; // handed out while no workspace can be opened
+};
+
+#endif // WORKSPACEREGISTRY_H